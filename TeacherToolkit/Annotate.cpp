@@ -0,0 +1,267 @@
+// Annotate.cpp : stroke rasterizer and sparse tile compositor.
+
+#include "Annotate.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void FreeStrokeCoverage(AnnotationLayer* layer)
+{
+    for (int index : layer->strokeTiles) {
+        free(layer->strokeCoverage[index]);
+        layer->strokeCoverage[index] = nullptr;
+    }
+    layer->strokeTiles.clear();
+}
+
+static void FreeTiles(AnnotationLayer* layer)
+{
+    FreeStrokeCoverage(layer);
+    for (int index : layer->activeTiles) {
+        free(layer->tiles[index]);
+        layer->tiles[index] = nullptr;
+    }
+    layer->activeTiles.clear();
+}
+
+void AnnotInit(AnnotationLayer* layer, int width, int height)
+{
+    FreeTiles(layer);
+    layer->width  = width  > 0 ? width  : 0;
+    layer->height = height > 0 ? height : 0;
+    layer->tilesX = (layer->width  + ANNOT_TILE - 1) / ANNOT_TILE;
+    layer->tilesY = (layer->height + ANNOT_TILE - 1) / ANNOT_TILE;
+    layer->tiles.assign((size_t)layer->tilesX * layer->tilesY, nullptr);
+    layer->strokeCoverage.assign(layer->tiles.size(), nullptr);
+    layer->points.clear();
+    layer->strokes.clear();
+    layer->drawing = false;
+}
+
+void AnnotFree(AnnotationLayer* layer)
+{
+    FreeTiles(layer);
+    std::vector<uint32_t*>().swap(layer->tiles);
+    std::vector<uint8_t*>().swap(layer->strokeCoverage);
+    std::vector<int>().swap(layer->strokeTiles);
+    std::vector<int>().swap(layer->activeTiles);
+    std::vector<AnnotPoint>().swap(layer->points);
+    std::vector<AnnotStroke>().swap(layer->strokes);
+    layer->width = layer->height = layer->tilesX = layer->tilesY = 0;
+    layer->drawing = false;
+}
+
+static bool GetTiles(AnnotationLayer* layer, int index, uint32_t** tile, uint8_t** coverage)
+{
+    if (!layer->tiles[index]) {
+        uint32_t* t = (uint32_t*)calloc(ANNOT_TILE * ANNOT_TILE, sizeof(uint32_t));
+        if (!t) return false;
+        layer->tiles[index] = t;
+        layer->activeTiles.push_back(index);
+    }
+    if (!layer->strokeCoverage[index]) {
+        uint8_t* c = (uint8_t*)calloc(ANNOT_TILE * ANNOT_TILE, 1);
+        if (!c) return false;
+        layer->strokeCoverage[index] = c;
+        layer->strokeTiles.push_back(index);
+    }
+    *tile = layer->tiles[index];
+    *coverage = layer->strokeCoverage[index];
+    return true;
+}
+
+// Raises a premultiplied pixel from colour at coverage oldCov to colour at
+// newCov (0..255): equivalent to blending once at newCov over what was
+// underneath before this stroke.
+static inline uint32_t RaiseCoverage(uint32_t dst, uint32_t color, uint32_t oldCov, uint32_t newCov)
+{
+    uint32_t alpha = color >> 24;
+    uint32_t a1 = (alpha * oldCov + 127) / 255;
+    uint32_t a2 = (alpha * newCov + 127) / 255;
+    if (a2 <= a1 || a1 >= 255) return dst;
+    uint32_t a = ((a2 - a1) * 255 + (255 - a1) / 2) / (255 - a1);
+
+    uint32_t r = (((color >> 16) & 0xFF) * a + 127) / 255;
+    uint32_t g = (((color >> 8) & 0xFF) * a + 127) / 255;
+    uint32_t b = ((color & 0xFF) * a + 127) / 255;
+    uint32_t inv = 255 - a;
+
+    uint32_t da = dst >> 24, dr = (dst >> 16) & 0xFF, dg = (dst >> 8) & 0xFF, db = dst & 0xFF;
+    da = a + (da * inv + 127) / 255;
+    dr = r + (dr * inv + 127) / 255;
+    dg = g + (dg * inv + 127) / 255;
+    db = b + (db * inv + 127) / 255;
+    return (da << 24) | (dr << 16) | (dg << 8) | db;
+}
+
+// Antialiased capsule from p0 to p1, merged into the open stroke.
+static void RasterSegment(AnnotationLayer* layer, AnnotPoint p0, AnnotPoint p1,
+                          uint32_t color, float width)
+{
+    float r = width * 0.5f;
+    if (r < 0.5f) r = 0.5f;
+
+    int minX = (int)floorf(fminf(p0.x, p1.x) - r - 1.0f);
+    int minY = (int)floorf(fminf(p0.y, p1.y) - r - 1.0f);
+    int maxX = (int)ceilf(fmaxf(p0.x, p1.x) + r + 1.0f);
+    int maxY = (int)ceilf(fmaxf(p0.y, p1.y) + r + 1.0f);
+    if (minX < 0) minX = 0;
+    if (minY < 0) minY = 0;
+    if (maxX > layer->width - 1)  maxX = layer->width - 1;
+    if (maxY > layer->height - 1) maxY = layer->height - 1;
+    if (minX > maxX || minY > maxY) return;
+
+    float dx = p1.x - p0.x;
+    float dy = p1.y - p0.y;
+    float len2 = dx * dx + dy * dy;
+
+    for (int ty = minY / ANNOT_TILE; ty <= maxY / ANNOT_TILE; ty++) {
+        for (int tx = minX / ANNOT_TILE; tx <= maxX / ANNOT_TILE; tx++) {
+            int x0 = tx * ANNOT_TILE, y0 = ty * ANNOT_TILE;
+            int xa = minX > x0 ? minX : x0;
+            int ya = minY > y0 ? minY : y0;
+            int xb = maxX < x0 + ANNOT_TILE - 1 ? maxX : x0 + ANNOT_TILE - 1;
+            int yb = maxY < y0 + ANNOT_TILE - 1 ? maxY : y0 + ANNOT_TILE - 1;
+
+            uint32_t* tile = nullptr;
+            uint8_t* tileCoverage = nullptr;
+            for (int y = ya; y <= yb; y++) {
+                float py = (float)y + 0.5f;
+                for (int x = xa; x <= xb; x++) {
+                    float px = (float)x + 0.5f;
+                    float t = len2 > 0.0f ? ((px - p0.x) * dx + (py - p0.y) * dy) / len2 : 0.0f;
+                    if (t < 0.0f) t = 0.0f;
+                    if (t > 1.0f) t = 1.0f;
+                    float ex = px - (p0.x + t * dx);
+                    float ey = py - (p0.y + t * dy);
+                    float coverage = r + 0.5f - sqrtf(ex * ex + ey * ey);
+                    if (coverage <= 0.0f) continue;
+
+                    if (!tile && !GetTiles(layer, ty * layer->tilesX + tx, &tile, &tileCoverage))
+                        return;
+                    int i = (y - y0) * ANNOT_TILE + (x - x0);
+                    uint32_t cov = coverage >= 1.0f ? 255u : (uint32_t)(coverage * 255.0f + 0.5f);
+                    if (cov <= tileCoverage[i]) continue;
+                    tile[i] = RaiseCoverage(tile[i], color, tileCoverage[i], cov);
+                    tileCoverage[i] = (uint8_t)cov;
+                }
+            }
+        }
+    }
+}
+
+void AnnotBeginStroke(AnnotationLayer* layer, float x, float y, uint32_t color, float width)
+{
+    if (layer->drawing) AnnotEndStroke(layer);
+
+    AnnotStroke stroke;
+    stroke.color = color;
+    stroke.width = width;
+    stroke.firstPoint = (uint32_t)layer->points.size();
+    stroke.pointCount = 1;
+    layer->points.push_back({ x, y });
+    layer->strokes.push_back(stroke);
+    layer->drawing = true;
+
+    // A tap leaves a dot
+    AnnotPoint p = { x, y };
+    RasterSegment(layer, p, p, color, width);
+}
+
+void AnnotAddPoint(AnnotationLayer* layer, float x, float y)
+{
+    if (!layer->drawing || layer->strokes.empty()) return;
+
+    AnnotStroke& stroke = layer->strokes.back();
+    AnnotPoint last = layer->points.back();
+    float dx = x - last.x, dy = y - last.y;
+    if (dx * dx + dy * dy < 1.0f) return;       // sub-pixel moves add nothing
+
+    AnnotPoint p = { x, y };
+    layer->points.push_back(p);
+    stroke.pointCount++;
+    RasterSegment(layer, last, p, stroke.color, stroke.width);
+}
+
+void AnnotEndStroke(AnnotationLayer* layer)
+{
+    layer->drawing = false;
+    FreeStrokeCoverage(layer);
+}
+
+void AnnotUndo(AnnotationLayer* layer)
+{
+    if (layer->strokes.empty()) return;
+    layer->drawing = false;
+    layer->points.resize(layer->strokes.back().firstPoint);
+    layer->strokes.pop_back();
+
+    // Rare and interactive: re-rasterize what is left from the vectors
+    FreeTiles(layer);
+    for (const AnnotStroke& s : layer->strokes) {
+        const AnnotPoint* pts = &layer->points[s.firstPoint];
+        RasterSegment(layer, pts[0], pts[0], s.color, s.width);
+        for (uint32_t i = 1; i < s.pointCount; i++)
+            RasterSegment(layer, pts[i - 1], pts[i], s.color, s.width);
+        FreeStrokeCoverage(layer);
+    }
+}
+
+void AnnotClear(AnnotationLayer* layer)
+{
+    FreeTiles(layer);
+    layer->points.clear();
+    layer->strokes.clear();
+    layer->drawing = false;
+}
+
+bool AnnotIsEmpty(const AnnotationLayer* layer)
+{
+    return layer->activeTiles.empty();
+}
+
+static void BlendTile(const AnnotationLayer* layer, uint32_t* frame, int stride, int index)
+{
+    const uint32_t* tile = layer->tiles[index];
+    int x0 = (index % layer->tilesX) * ANNOT_TILE;
+    int y0 = (index / layer->tilesX) * ANNOT_TILE;
+    int w = layer->width - x0  < ANNOT_TILE ? layer->width - x0  : ANNOT_TILE;
+    int h = layer->height - y0 < ANNOT_TILE ? layer->height - y0 : ANNOT_TILE;
+
+    for (int y = 0; y < h; y++) {
+        const uint32_t* src = tile + y * ANNOT_TILE;
+        uint32_t* dst = frame + (size_t)(y0 + y) * stride + x0;
+        for (int x = 0; x < w; x++) {
+            uint32_t s = src[x];
+            uint32_t a = s >> 24;
+            if (a == 0) continue;
+            if (a == 255) { dst[x] = s; continue; }
+
+            uint32_t d = dst[x];
+            uint32_t inv = 255 - a;
+            // Red and blue together, then green: two multiplies per pixel
+            uint32_t rb = (d & 0x00FF00FF) * inv + 0x00800080;
+            rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+            uint32_t g = (d & 0x0000FF00) * inv + 0x00008000;
+            g = ((g + ((g >> 8) & 0x0000FF00)) >> 8) & 0x0000FF00;
+            dst[x] = ((s & 0x00FFFFFF) + rb + g) | 0xFF000000;
+        }
+    }
+}
+
+int AnnotComposite(const AnnotationLayer* layer, uint32_t* frame, int stride)
+{
+    for (int index : layer->activeTiles)
+        BlendTile(layer, frame, stride, index);
+    return (int)layer->activeTiles.size();
+}
+
+bool AnnotCompositeTile(const AnnotationLayer* layer, uint32_t* frame, int stride, int tx, int ty)
+{
+    if (tx < 0 || ty < 0 || tx >= layer->tilesX || ty >= layer->tilesY) return false;
+    int index = ty * layer->tilesX + tx;
+    if (!layer->tiles[index]) return false;
+    BlendTile(layer, frame, stride, index);
+    return true;
+}
@@ -0,0 +1,65 @@
+// Annotate.h : pen annotations for the projector image.
+//
+// Strokes are kept as vectors (points, colour, width) and rasterized
+// incrementally, segment by segment, into a sparse grid of 64x64 tiles in
+// premultiplied BGRA. Only tiles a stroke has touched are allocated, and
+// only those are blended into the outgoing frame, so an idle annotation
+// layer costs nothing per frame and a few circles cost a few tiles.
+// Portable: no Windows headers.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define ANNOT_TILE          64
+
+struct AnnotPoint {
+    float x, y;
+};
+
+struct AnnotStroke {
+    uint32_t color;             // 0xAARRGGBB, straight alpha
+    float    width;             // px
+    uint32_t firstPoint;        // into AnnotationLayer::points
+    uint32_t pointCount;
+};
+
+struct AnnotationLayer {
+    int width;                  // frame size the layer covers
+    int height;
+    int tilesX;
+    int tilesY;
+    std::vector<uint32_t*>   tiles;         // tilesX * tilesY, nullptr = untouched
+    std::vector<int>         activeTiles;   // indices of non-null tiles
+    std::vector<AnnotPoint>  points;
+    std::vector<AnnotStroke> strokes;
+    bool                     drawing;       // a stroke is open
+
+    // Per-pixel coverage of the open stroke (8-bit, per touched tile), so
+    // overlapping segments of one stroke raise coverage instead of
+    // blending again: translucent pens stay even along the line.
+    std::vector<uint8_t*>    strokeCoverage;
+    std::vector<int>         strokeTiles;
+};
+
+// (Re)initializes for a frame of width x height; drops all strokes.
+void AnnotInit(AnnotationLayer* layer, int width, int height);
+void AnnotFree(AnnotationLayer* layer);
+
+void AnnotBeginStroke(AnnotationLayer* layer, float x, float y, uint32_t color, float width);
+void AnnotAddPoint(AnnotationLayer* layer, float x, float y);
+void AnnotEndStroke(AnnotationLayer* layer);
+
+void AnnotUndo(AnnotationLayer* layer);     // removes the last stroke
+void AnnotClear(AnnotationLayer* layer);
+bool AnnotIsEmpty(const AnnotationLayer* layer);
+
+// Blends the touched tiles over a 32bpp BGRA frame (stride in pixels).
+// Returns the number of tiles blended.
+int  AnnotComposite(const AnnotationLayer* layer, uint32_t* frame, int stride);
+
+// Blends one tile (tile coordinates), if a stroke touched it. Returns true
+// if it did.
+bool AnnotCompositeTile(const AnnotationLayer* layer, uint32_t* frame, int stride, int tx, int ty);
@@ -0,0 +1,182 @@
+// Config.cpp : indexed, layered key/value table for runtime configuration.
+
+#include "Config.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+static char LowerAscii(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static uint32_t HashKey(const char* key, size_t len)
+{
+    uint32_t h = 2166136261u;       // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)LowerAscii(key[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool KeyEquals(const char* stored, const char* key, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (stored[i] == '\0' || LowerAscii(stored[i]) != LowerAscii(key[i]))
+            return false;
+    }
+    return stored[len] == '\0';
+}
+
+// Returns the index slot holding key, or the empty slot where it belongs.
+static int FindSlot(const ConfigTable* t, const char* key, size_t len, uint32_t hash)
+{
+    int slot = (int)(hash & (CONFIG_INDEX_SLOTS - 1));
+    for (;;) {
+        int e = t->index[slot];
+        if (e < 0)
+            return slot;
+        const ConfigEntry* entry = &t->entries[e];
+        if (entry->hash == hash && KeyEquals(t->pool + entry->keyOffset, key, len))
+            return slot;
+        slot = (slot + 1) & (CONFIG_INDEX_SLOTS - 1);
+    }
+}
+
+static bool PoolAppend(ConfigTable* t, const char* text, size_t len, uint16_t* offset)
+{
+    if (t->poolUsed + len + 1 > CONFIG_POOL_BYTES)
+        return false;
+    *offset = (uint16_t)t->poolUsed;
+    memcpy(t->pool + t->poolUsed, text, len);
+    t->pool[t->poolUsed + len] = '\0';
+    t->poolUsed += len + 1;
+    return true;
+}
+
+void ConfigInit(ConfigTable* t)
+{
+    t->count = 0;
+    t->dropped = 0;
+    t->poolUsed = 0;
+    for (int i = 0; i < CONFIG_INDEX_SLOTS; i++)
+        t->index[i] = -1;
+}
+
+bool ConfigSet(ConfigTable* t, const char* key, size_t keyLen,
+               const char* value, size_t valueLen, int layer)
+{
+    if (keyLen == 0) return false;
+
+    uint32_t hash = HashKey(key, keyLen);
+    int slot = FindSlot(t, key, keyLen, hash);
+    int e = t->index[slot];
+
+    if (e >= 0) {
+        // Override: the old value stays in the pool until the next rebuild
+        ConfigEntry* entry = &t->entries[e];
+        uint16_t offset;
+        if (!PoolAppend(t, value, valueLen, &offset)) {
+            t->dropped++;
+            return false;
+        }
+        entry->valueOffset = offset;
+        entry->layer = layer;
+        return true;
+    }
+
+    ConfigEntry* entry = &t->entries[t->count];
+    size_t poolUsed = t->poolUsed;
+    if (t->count >= CONFIG_MAX_ENTRIES ||
+        !PoolAppend(t, key, keyLen, &entry->keyOffset) ||
+        !PoolAppend(t, value, valueLen, &entry->valueOffset)) {
+        t->poolUsed = poolUsed;     // no half-stored key
+        t->dropped++;
+        return false;
+    }
+    entry->hash = hash;
+    entry->layer = layer;
+    t->index[slot] = (int16_t)t->count++;
+    return true;
+}
+
+static bool IsBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+int ConfigParseIni(ConfigTable* t, const char* data, size_t len, int layer)
+{
+    const char* p = data;
+    const char* end = data + len;
+    int set = 0;
+
+    // Files saved by Notepad may start with a UTF-8 BOM
+    if (len >= 3 && (uint8_t)p[0] == 0xEF && (uint8_t)p[1] == 0xBB && (uint8_t)p[2] == 0xBF)
+        p += 3;
+
+    while (p < end) {
+        const char* eol = p;
+        while (eol < end && *eol != '\n') eol++;
+        const char* next = (eol < end) ? eol + 1 : end;
+
+        const char* lineEnd = eol;
+        while (lineEnd > p && (lineEnd[-1] == '\r' || IsBlank(lineEnd[-1]))) lineEnd--;
+        while (p < lineEnd && IsBlank(*p)) p++;
+
+        if (p < lineEnd && *p != '#' && *p != ';' && *p != '[') {
+            const char* eq = p;
+            while (eq < lineEnd && *eq != '=') eq++;
+            if (eq < lineEnd) {
+                const char* keyEnd = eq;
+                while (keyEnd > p && IsBlank(keyEnd[-1])) keyEnd--;
+                const char* val = eq + 1;
+                while (val < lineEnd && IsBlank(*val)) val++;
+
+                if (keyEnd > p &&
+                    ConfigSet(t, p, (size_t)(keyEnd - p), val, (size_t)(lineEnd - val), layer))
+                    set++;
+            }
+        }
+        p = next;
+    }
+    return set;
+}
+
+const char* ConfigGet(const ConfigTable* t, const char* key)
+{
+    size_t len = strlen(key);
+    int e = t->index[FindSlot(t, key, len, HashKey(key, len))];
+    return e >= 0 ? t->pool + t->entries[e].valueOffset : nullptr;
+}
+
+int ConfigGetInt(const ConfigTable* t, const char* key, int def, int minVal, int maxVal)
+{
+    const char* value = ConfigGet(t, key);
+    if (!value) return def;
+
+    char* endp = nullptr;
+    long n = strtol(value, &endp, 10);
+    if (endp == value) return def;
+    if (n < minVal) return minVal;
+    if (n > maxVal) return maxVal;
+    return (int)n;
+}
+
+bool ConfigGetBool(const ConfigTable* t, const char* key, bool def)
+{
+    const char* value = ConfigGet(t, key);
+    if (!value) return def;
+    char c = LowerAscii(value[0]);
+    if (c == '1' || c == 'y' || c == 't' || (c == 'o' && LowerAscii(value[1]) == 'n')) return true;
+    if (c == '0' || c == 'n' || c == 'f' || (c == 'o' && LowerAscii(value[1]) == 'f')) return false;
+    return def;
+}
+
+int ConfigLayerOf(const ConfigTable* t, const char* key)
+{
+    size_t len = strlen(key);
+    int e = t->index[FindSlot(t, key, len, HashKey(key, len))];
+    return e >= 0 ? t->entries[e].layer : CONFIG_LAYER_NONE;
+}
@@ -0,0 +1,60 @@
+// Config.h : indexed, layered key/value table for runtime configuration.
+//
+// Every layer (embedded config.ini, machine file, user file, registry) is
+// parsed once, in a single pass, into one table; later layers override
+// earlier ones key by key. Lookups go through a small open-addressing
+// index instead of rescanning text. Keys are case-insensitive.
+// Portable: no Windows headers.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONFIG_MAX_ENTRIES  128
+#define CONFIG_POOL_BYTES   16384
+#define CONFIG_INDEX_SLOTS  256     // power of two, larger than CONFIG_MAX_ENTRIES
+
+enum ConfigLayer {
+    CONFIG_LAYER_NONE = -1,
+    CONFIG_LAYER_EMBEDDED = 0,      // config.ini compiled into the exe
+    CONFIG_LAYER_MACHINE,           // %ProgramData%\TeacherToolkit\config.ini
+    CONFIG_LAYER_USER,              // %APPDATA%\TeacherToolkit\config.ini
+    CONFIG_LAYER_REGISTRY,          // HKLM, then HKCU \Software\TeacherToolkit\Config
+    CONFIG_LAYER_COUNT
+};
+
+struct ConfigEntry {
+    uint32_t hash;
+    uint16_t keyOffset;             // into pool
+    uint16_t valueOffset;           // into pool
+    int      layer;
+};
+
+struct ConfigTable {
+    int         count;
+    int         dropped;            // sets refused because the table or pool was full
+    size_t      poolUsed;
+    ConfigEntry entries[CONFIG_MAX_ENTRIES];
+    int16_t     index[CONFIG_INDEX_SLOTS];     // entry number, -1 = empty
+    char        pool[CONFIG_POOL_BYTES];
+};
+
+void ConfigInit(ConfigTable* t);
+
+// Parses an INI buffer ("key=value" lines; '#', ';' comments and [section]
+// headers are skipped). "key=" stores an empty value, so a later layer can
+// clear what an earlier one set. Returns the number of keys set.
+int  ConfigParseIni(ConfigTable* t, const char* data, size_t len, int layer);
+
+// Returns false, and counts the key in dropped, when the table or the
+// pool is full.
+bool ConfigSet(ConfigTable* t, const char* key, size_t keyLen,
+               const char* value, size_t valueLen, int layer);
+
+// Returns nullptr if the key is not set in any layer, "" if the last layer
+// to set it cleared it.
+const char* ConfigGet(const ConfigTable* t, const char* key);
+int         ConfigGetInt(const ConfigTable* t, const char* key, int def, int minVal, int maxVal);
+bool        ConfigGetBool(const ConfigTable* t, const char* key, bool def);
+int         ConfigLayerOf(const ConfigTable* t, const char* key);
@@ -0,0 +1,108 @@
+// FramePacer.cpp : deadline grid and interval statistics.
+
+#include "FramePacer.h"
+
+#include <math.h>
+#include <string.h>
+
+int64_t PacerAlignPeriod(int64_t targetUs, int refreshHz)
+{
+    if (refreshHz <= 0) return targetUs;
+    double refreshUs = 1000000.0 / refreshHz;
+    double n = floor(targetUs / refreshUs + 0.5);
+    if (n < 1.0) n = 1.0;
+    return (int64_t)(n * refreshUs + 0.5);
+}
+
+void PacerInit(FramePacer* pacer, int64_t periodUs, int64_t nowUs)
+{
+    pacer->periodUs = periodUs > 0 ? periodUs : 1;
+    pacer->nextUs = nowUs + pacer->periodUs;
+    pacer->ticks = 0;
+    pacer->skipped = 0;
+}
+
+int64_t PacerNextDeadline(const FramePacer* pacer)
+{
+    return pacer->nextUs;
+}
+
+int PacerAdvance(FramePacer* pacer, int64_t nowUs)
+{
+    pacer->ticks++;
+    pacer->nextUs += pacer->periodUs;
+    if (nowUs < pacer->nextUs) return 0;
+
+    // Whole periods went by: rejoin the grid after now
+    int64_t missed = (nowUs - pacer->nextUs) / pacer->periodUs + 1;
+    pacer->nextUs += missed * pacer->periodUs;
+    pacer->skipped += (uint64_t)missed;
+    return (int)missed;
+}
+
+void IntervalsReset(FrameIntervals* iv, int64_t expectedUs)
+{
+    IntervalsRestart(iv, expectedUs);
+    iv->lastUs = -1;
+}
+
+void IntervalsRestart(FrameIntervals* iv, int64_t expectedUs)
+{
+    int64_t last = iv->lastUs;
+    memset(iv, 0, sizeof(*iv));
+    iv->expectedUs = expectedUs;
+    iv->lastUs = last;
+}
+
+void IntervalsRecord(FrameIntervals* iv, int64_t nowUs)
+{
+    int64_t last = iv->lastUs;
+    iv->lastUs = nowUs;
+    if (last < 0 || nowUs < last) return;
+
+    int64_t d = nowUs - last;
+    if (iv->count == 0 || d < iv->minUs) iv->minUs = d;
+    if (iv->count == 0 || d > iv->maxUs) iv->maxUs = d;
+    iv->count++;
+    iv->sumUs += (double)d;
+    iv->sumSqUs += (double)d * (double)d;
+    if (iv->expectedUs > 0 && d * 2 > iv->expectedUs * 3) iv->late++;
+
+    int64_t bucket = d / PACER_HIST_BUCKET_US;
+    iv->hist[bucket < PACER_HIST_BUCKETS ? bucket : PACER_HIST_BUCKETS - 1]++;
+}
+
+// Upper edge of the bucket holding the pct-th percentile, capped by the
+// largest interval actually seen.
+static double Percentile(const FrameIntervals* iv, int pct)
+{
+    uint32_t rank = (uint32_t)(((uint64_t)iv->count * pct + 99) / 100);
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (int b = 0; b < PACER_HIST_BUCKETS; b++) {
+        seen += iv->hist[b];
+        if (seen >= rank) {
+            int64_t edge = (int64_t)(b + 1) * PACER_HIST_BUCKET_US;
+            return (edge < iv->maxUs ? edge : iv->maxUs) / 1000.0;
+        }
+    }
+    return iv->maxUs / 1000.0;
+}
+
+void IntervalsSummarize(const FrameIntervals* iv, FrameIntervalSummary* out)
+{
+    memset(out, 0, sizeof(*out));
+    out->count = iv->count;
+    out->late = iv->late;
+    if (iv->count == 0) return;
+
+    double mean = iv->sumUs / iv->count;
+    double var = iv->sumSqUs / iv->count - mean * mean;
+    out->meanMs = mean / 1000.0;
+    out->jitterMs = var > 0.0 ? sqrt(var) / 1000.0 : 0.0;
+    out->minMs = iv->minUs / 1000.0;
+    out->maxMs = iv->maxUs / 1000.0;
+    out->p50Ms = Percentile(iv, 50);
+    out->p95Ms = Percentile(iv, 95);
+    out->p99Ms = Percentile(iv, 99);
+}
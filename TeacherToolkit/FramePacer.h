@@ -0,0 +1,68 @@
+// FramePacer.h : mirror frame deadlines and interval statistics.
+//
+// FramePacer keeps frame deadlines on an absolute grid (start + k * period).
+// A late frame therefore never pushes the next deadline back. A frame that
+// misses whole periods skips to the next grid point instead of bunching
+// up. The period can be rounded to a whole number of projector refreshes,
+// so every frame stays on the wall equally long.
+//
+// FrameIntervals measures the resulting cadence: mean interval, jitter
+// (standard deviation), percentiles from a 0.25 ms histogram, and frames
+// later than half a period.
+//
+// All times are microseconds on any monotonic clock, so the same code runs
+// against QueryPerformanceCounter or a simulated clock.
+// Portable: no Windows headers.
+
+#pragma once
+
+#include <stdint.h>
+
+#define PACER_HIST_BUCKET_US    250
+#define PACER_HIST_BUCKETS      400     // 0..100 ms; the last bucket takes the rest
+
+struct FramePacer {
+    int64_t  periodUs;
+    int64_t  nextUs;            // next deadline
+    uint64_t ticks;
+    uint64_t skipped;           // grid points missed entirely
+};
+
+// Nearest whole number of refresh periods to targetUs (at least one), or
+// targetUs itself if refreshHz is not known.
+int64_t PacerAlignPeriod(int64_t targetUs, int refreshHz);
+
+// First deadline one period after nowUs.
+void    PacerInit(FramePacer* pacer, int64_t periodUs, int64_t nowUs);
+int64_t PacerNextDeadline(const FramePacer* pacer);
+
+// Call once nowUs has reached the deadline. Moves to the first grid point
+// after nowUs and returns how many were skipped on the way.
+int     PacerAdvance(FramePacer* pacer, int64_t nowUs);
+
+struct FrameIntervals {
+    int64_t  expectedUs;
+    int64_t  lastUs;            // previous frame, -1 if none
+    uint32_t count;
+    uint32_t late;              // intervals over 1.5 periods
+    double   sumUs;
+    double   sumSqUs;
+    int64_t  minUs, maxUs;
+    uint32_t hist[PACER_HIST_BUCKETS];
+};
+
+struct FrameIntervalSummary {
+    uint32_t count;
+    uint32_t late;
+    double   meanMs;
+    double   jitterMs;          // standard deviation
+    double   minMs, maxMs;
+    double   p50Ms, p95Ms, p99Ms;
+};
+
+// Reset starts from scratch; Restart clears the statistics but keeps the
+// previous frame time, so back-to-back measuring windows lose no interval.
+void IntervalsReset(FrameIntervals* iv, int64_t expectedUs);
+void IntervalsRestart(FrameIntervals* iv, int64_t expectedUs);
+void IntervalsRecord(FrameIntervals* iv, int64_t nowUs);
+void IntervalsSummarize(const FrameIntervals* iv, FrameIntervalSummary* out);
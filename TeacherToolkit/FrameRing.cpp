@@ -0,0 +1,407 @@
+// FrameRing.cpp : shared frame ring layout, producer, reader and mapping.
+
+#include "FrameRing.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <stdio.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define FRAME_RING_ALIGN    4096
+
+static size_t AlignUp(size_t n, size_t a)
+{
+    return (n + a - 1) / a * a;
+}
+
+static size_t DirtyBytes(int maxWidth, int maxHeight)
+{
+    size_t tiles = (size_t)((maxWidth + REGION_TILE - 1) / REGION_TILE) *
+                   ((maxHeight + REGION_TILE - 1) / REGION_TILE);
+    return AlignUp((tiles + 7) / 8, 64);
+}
+
+static size_t SlotBytes(int maxWidth, int maxHeight)
+{
+    return AlignUp(sizeof(FrameRingSlot) + DirtyBytes(maxWidth, maxHeight) +
+                   (size_t)maxWidth * maxHeight * sizeof(uint32_t), FRAME_RING_ALIGN);
+}
+
+size_t FrameRingBytes(int maxWidth, int maxHeight)
+{
+    return FRAME_RING_ALIGN + FRAME_RING_SLOTS * SlotBytes(maxWidth, maxHeight);
+}
+
+static FrameRingSlot* SlotAt(FrameRingHeader* header, uint32_t index)
+{
+    return (FrameRingSlot*)((uint8_t*)header + header->headerBytes + (size_t)index * header->slotBytes);
+}
+
+// ---- Producer ------------------------------------------------------------
+
+bool FrameRingFormat(FrameRingWriter* writer, void* base, size_t bytes,
+                     int maxWidth, int maxHeight, uint32_t session)
+{
+    *writer = FrameRingWriter();
+    if (maxWidth <= 0 || maxHeight <= 0 || bytes < FrameRingBytes(maxWidth, maxHeight)) return false;
+
+    // A reader of an earlier session may still be looking: retire that
+    // session before anything else changes underneath it
+    FrameRingHeader* header = (FrameRingHeader*)base;
+    header->state.store(FRAME_RING_STOPPED, std::memory_order_release);
+    header->latest.store(0, std::memory_order_release);
+
+    header->magic       = FRAME_RING_MAGIC;
+    header->version     = FRAME_RING_VERSION;
+    header->headerBytes = FRAME_RING_ALIGN;
+    header->slotBytes   = (uint32_t)SlotBytes(maxWidth, maxHeight);
+    header->slotCount   = FRAME_RING_SLOTS;
+    header->maxWidth    = (uint32_t)maxWidth;
+    header->maxHeight   = (uint32_t)maxHeight;
+    header->tileSize    = REGION_TILE;
+    header->session     = session;
+    memset(header->reserved, 0, sizeof(header->reserved));
+
+    for (uint32_t i = 0; i < FRAME_RING_SLOTS; i++) {
+        FrameRingSlot* slot = SlotAt(header, i);
+        uint32_t lock = slot->lock.load(std::memory_order_relaxed);
+        slot->lock.store(lock + 2 - (lock & 1), std::memory_order_relaxed);    // even, and moved on
+        slot->seq = 0;
+        slot->dirtyOffset = sizeof(FrameRingSlot);
+        slot->pixelOffset = (uint32_t)(sizeof(FrameRingSlot) + DirtyBytes(maxWidth, maxHeight));
+    }
+
+    writer->header = header;
+    writer->bytes  = bytes;
+    writer->slotSeq.assign(FRAME_RING_SLOTS, 0);
+    writer->pulse  = header->readerPulse.load(std::memory_order_relaxed);
+    header->state.store(FRAME_RING_LIVE, std::memory_order_release);
+    return true;
+}
+
+bool FrameRingWanted(FrameRingWriter* writer, uint64_t nowMs)
+{
+    if (!writer->header) return false;
+    uint32_t pulse = writer->header->readerPulse.load(std::memory_order_relaxed);
+    if (pulse != writer->pulse) {
+        writer->pulse = pulse;
+        writer->pulseMs = nowMs ? nowMs : 1;
+    }
+    return writer->pulseMs && nowMs - writer->pulseMs < FRAME_RING_IDLE_MS;
+}
+
+uint32_t FrameRingPublish(FrameRingWriter* writer, const uint32_t* frame, int stride,
+                          int width, int height, const RegionMap* regions, uint64_t timeUs)
+{
+    FrameRingHeader* header = writer->header;
+    if (!header || width <= 0 || height <= 0 ||
+        (uint32_t)width > header->maxWidth || (uint32_t)height > header->maxHeight)
+        return 0;
+
+    if (width != writer->width || height != writer->height) {
+        // Every slot holds the old geometry; the first frame is all new
+        writer->width  = width;
+        writer->height = height;
+        writer->tilesX = (width  + REGION_TILE - 1) / REGION_TILE;
+        writer->tilesY = (height + REGION_TILE - 1) / REGION_TILE;
+        writer->hashes.assign((size_t)writer->tilesX * writer->tilesY, 0);
+        writer->changedAt.assign(writer->hashes.size(), 0);
+        writer->slotSeq.assign(FRAME_RING_SLOTS, 0);
+        writer->primed = false;
+    }
+    bool fresh = !writer->primed;
+    writer->primed = true;
+
+    uint32_t seq = ++writer->seq;
+    if (seq == 0) seq = ++writer->seq;          // 0 means "none"
+    uint32_t index = seq % FRAME_RING_SLOTS;
+    uint32_t held = writer->slotSeq[index];
+    FrameRingSlot* slot = SlotAt(header, index);
+    uint8_t*  dirty  = (uint8_t*)slot + slot->dirtyOffset;
+    uint32_t* pixels = (uint32_t*)((uint8_t*)slot + slot->pixelOffset);
+
+    // Never waits: a reader still on this slot sees the counter move
+    uint32_t lock = slot->lock.load(std::memory_order_relaxed);
+    slot->lock.store(lock + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    bool useRegions = regions && regions->frames > 0 &&
+                      regions->width == width && regions->height == height;
+    uint32_t dirtyTiles = 0;
+    memset(dirty, 0, ((size_t)writer->tilesX * writer->tilesY + 7) / 8);
+    for (int ty = 0; ty < writer->tilesY; ty++) {
+        int y0 = ty * REGION_TILE;
+        int y1 = y0 + REGION_TILE < height ? y0 + REGION_TILE : height;
+        for (int tx = 0; tx < writer->tilesX; tx++) {
+            int x0 = tx * REGION_TILE;
+            int x1 = x0 + REGION_TILE < width ? x0 + REGION_TILE : width;
+            size_t i = (size_t)ty * writer->tilesX + tx;
+            uint64_t h = useRegions ? RegionAt(regions, tx, ty)->hash
+                                    : RegionHashTile(frame, stride, x0, y0, x1, y1);
+            if (fresh || h != writer->hashes[i]) {
+                writer->hashes[i] = h;
+                writer->changedAt[i] = seq;
+                dirty[i >> 3] |= (uint8_t)(1u << (i & 7));
+                dirtyTiles++;
+            }
+
+            // The slot still has frame "held": bring over what changed since
+            if (held == 0 || (int32_t)(writer->changedAt[i] - held) > 0) {
+                size_t rowBytes = (size_t)(x1 - x0) * sizeof(uint32_t);
+                for (int y = y0; y < y1; y++)
+                    memcpy(pixels + (size_t)y * header->maxWidth + x0,
+                           frame + (size_t)y * stride + x0, rowBytes);
+            }
+        }
+    }
+
+    slot->seq        = seq;
+    slot->width      = (uint32_t)width;
+    slot->height     = (uint32_t)height;
+    slot->stride     = header->maxWidth;
+    slot->tilesX     = (uint32_t)writer->tilesX;
+    slot->tilesY     = (uint32_t)writer->tilesY;
+    slot->dirtyTiles = dirtyTiles;
+    slot->timeUs     = timeUs;
+
+    slot->lock.store(lock + 2, std::memory_order_release);
+    header->latest.store(seq, std::memory_order_release);
+    writer->slotSeq[index] = seq;
+    return seq;
+}
+
+void FrameRingStop(FrameRingWriter* writer)
+{
+    if (writer->header)
+        writer->header->state.store(FRAME_RING_STOPPED, std::memory_order_release);
+    *writer = FrameRingWriter();
+}
+
+// ---- Reader --------------------------------------------------------------
+
+bool FrameRingAttach(FrameRingReader* reader, void* base, size_t bytes)
+{
+    *reader = FrameRingReader();
+    FrameRingHeader* header = (FrameRingHeader*)base;
+    if (!base || bytes < sizeof(FrameRingHeader) ||
+        header->magic != FRAME_RING_MAGIC || header->version != FRAME_RING_VERSION)
+        return false;
+    reader->header  = header;
+    reader->bytes   = bytes;
+    reader->session = header->session;
+    return true;
+}
+
+// The header is rewritten whenever the producer formats the ring again,
+// so it is checked on every acquire rather than trusted from attach.
+static bool LayoutValid(const FrameRingHeader* header, size_t bytes)
+{
+    if (header->magic != FRAME_RING_MAGIC || header->version != FRAME_RING_VERSION ||
+        header->slotCount == 0 || header->tileSize != REGION_TILE ||
+        header->maxWidth == 0 || header->maxHeight == 0)
+        return false;
+    size_t need = SlotBytes((int)header->maxWidth, (int)header->maxHeight);
+    return header->headerBytes >= sizeof(FrameRingHeader) && header->slotBytes >= need &&
+           header->headerBytes + (size_t)header->slotCount * header->slotBytes <= bytes;
+}
+
+FrameRingResult FrameRingAcquire(FrameRingReader* reader, FrameView* view)
+{
+    FrameRingHeader* header = reader->header;
+    if (!header) return FRAME_RING_ENDED;
+    header->readerPulse.fetch_add(1, std::memory_order_relaxed);
+
+    if (header->state.load(std::memory_order_acquire) != FRAME_RING_LIVE) return FRAME_RING_ENDED;
+    uint32_t seq = header->latest.load(std::memory_order_acquire);
+    if (seq == 0 || (seq == reader->lastSeq && header->session == reader->session))
+        return FRAME_RING_NONE;
+    if (!LayoutValid(header, reader->bytes)) return FRAME_RING_ENDED;
+
+    const FrameRingSlot* slot = SlotAt(header, seq % header->slotCount);
+    uint32_t lock = slot->lock.load(std::memory_order_acquire);
+    if ((lock & 1) || slot->seq != seq) return FRAME_RING_NONE;     // already being overwritten
+
+    // Anything read here may be torn; bound it before using it
+    uint32_t w = slot->width, h = slot->height, stride = slot->stride;
+    uint32_t tilesX = slot->tilesX, tilesY = slot->tilesY;
+    if (w == 0 || h == 0 || w > header->maxWidth || h > header->maxHeight || stride != header->maxWidth ||
+        tilesX != (w + REGION_TILE - 1) / REGION_TILE || tilesY != (h + REGION_TILE - 1) / REGION_TILE ||
+        slot->dirtyOffset != sizeof(FrameRingSlot) ||
+        slot->pixelOffset != sizeof(FrameRingSlot) + DirtyBytes((int)header->maxWidth, (int)header->maxHeight))
+        return FRAME_RING_NONE;
+
+    bool sameSession = header->session == reader->session;
+    view->seq        = seq;
+    view->width      = (int)w;
+    view->height     = (int)h;
+    view->stride     = (int)stride;
+    view->timeUs     = slot->timeUs;
+    view->pixels     = (const uint32_t*)((const uint8_t*)slot + slot->pixelOffset);
+    view->dirty      = (const uint8_t*)slot + slot->dirtyOffset;
+    view->tilesX     = (int)tilesX;
+    view->tilesY     = (int)tilesY;
+    view->tileSize   = REGION_TILE;
+    view->dirtyTiles = (int)slot->dirtyTiles;
+    view->allDirty   = !sameSession || reader->lastSeq == 0 || seq != reader->lastSeq + 1;
+    view->slot       = slot;
+    view->lock       = lock;
+    if (!sameSession) {
+        reader->session = header->session;
+        reader->lastSeq = 0;
+    }
+    return FRAME_RING_OK;
+}
+
+bool FrameRingRelease(FrameRingReader* reader, const FrameView* view)
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (view->slot->lock.load(std::memory_order_relaxed) != view->lock) return false;
+    reader->lastSeq = view->seq;
+    return true;
+}
+
+// ---- Mapping -------------------------------------------------------------
+
+#ifdef _WIN32
+
+static bool MapName(const char* name, char* out, size_t cch)
+{
+    return (size_t)_snprintf_s(out, cch, _TRUNCATE, "Local\\%s", name) < cch;
+}
+
+bool FrameRingCreate(FrameRingMapping* map, const char* name, size_t bytes)
+{
+    *map = FrameRingMapping();
+    char path[128];
+    if (!MapName(name, path, sizeof(path))) return false;
+
+    // Pagefile-backed: pages only get memory once a frame is written to them
+    HANDLE hMap = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                     (DWORD)((uint64_t)bytes >> 32), (DWORD)bytes, path);
+    if (!hMap) return false;
+    void* base = MapViewOfFile(hMap, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION mbi = {};
+    if (!base || !VirtualQuery(base, &mbi, sizeof(mbi))) {
+        if (base) UnmapViewOfFile(base);
+        CloseHandle(hMap);
+        return false;
+    }
+    // An existing mapping (a reader kept it open) keeps its own size
+    map->base   = base;
+    map->bytes  = mbi.RegionSize;
+    map->handle = (intptr_t)hMap;
+    return true;
+}
+
+bool FrameRingOpen(FrameRingMapping* map, const char* name)
+{
+    *map = FrameRingMapping();
+    char path[128];
+    if (!MapName(name, path, sizeof(path))) return false;
+
+    HANDLE hMap = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, path);
+    if (!hMap) return false;
+    void* base = MapViewOfFile(hMap, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION mbi = {};
+    if (!base || !VirtualQuery(base, &mbi, sizeof(mbi))) {
+        if (base) UnmapViewOfFile(base);
+        CloseHandle(hMap);
+        return false;
+    }
+    map->base   = base;
+    map->bytes  = mbi.RegionSize;
+    map->handle = (intptr_t)hMap;
+    return true;
+}
+
+void FrameRingUnmap(FrameRingMapping* map)
+{
+    if (map->base) UnmapViewOfFile(map->base);
+    if (map->handle) CloseHandle((HANDLE)map->handle);
+    *map = FrameRingMapping();
+}
+
+// The mapping goes away with its last handle
+void FrameRingRemove(const char*)
+{
+}
+
+#else
+
+static bool MapName(const char* name, char* out, size_t cch)
+{
+    size_t n = strlen(name);
+    if (n + 2 > cch) return false;
+    out[0] = '/';
+    memcpy(out + 1, name, n + 1);
+    return true;
+}
+
+static bool MapFd(FrameRingMapping* map, int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) return false;
+    void* base = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) return false;
+    map->base   = base;
+    map->bytes  = (size_t)st.st_size;
+    map->handle = fd;
+    return true;
+}
+
+bool FrameRingCreate(FrameRingMapping* map, const char* name, size_t bytes)
+{
+    *map = FrameRingMapping();
+    char path[128];
+    if (!MapName(name, path, sizeof(path))) return false;
+
+    int fd = shm_open(path, O_CREAT | O_RDWR, 0600);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || ((size_t)st.st_size < bytes && ftruncate(fd, (off_t)bytes) != 0) ||
+        !MapFd(map, fd)) {
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+bool FrameRingOpen(FrameRingMapping* map, const char* name)
+{
+    *map = FrameRingMapping();
+    char path[128];
+    if (!MapName(name, path, sizeof(path))) return false;
+
+    int fd = shm_open(path, O_RDWR, 0);
+    if (fd < 0) return false;
+    if (!MapFd(map, fd)) {
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+void FrameRingUnmap(FrameRingMapping* map)
+{
+    if (map->base) {
+        munmap(map->base, map->bytes);
+        close((int)map->handle);
+    }
+    *map = FrameRingMapping();
+}
+
+// Readers that have it mapped keep their pages; new ones no longer find it
+void FrameRingRemove(const char* name)
+{
+    char path[128];
+    if (MapName(name, path, sizeof(path))) shm_unlink(path);
+}
+
+#endif
@@ -0,0 +1,171 @@
+// FrameRing.h : mirrored frames published in shared memory for other tools.
+//
+// Lesson recorders and accessibility tools can read the frame the app has
+// already captured instead of grabbing the screen again. The producer
+// writes each frame into one of a few fixed slots of a named shared memory
+// block, round robin. Each slot is guarded by a seqlock: the producer makes
+// the slot's counter odd, writes, and makes it even again, and never waits
+// for anyone. A reader works on the slot in place (zero-copy) and checks
+// the counter afterwards. If it changed, the producer lapped the reader and
+// whatever it read from that frame must be thrown away.
+//
+// Frames are 32bpp BGRX, top-down, with the privacy masks and annotations
+// applied and without the cursor. Along with each frame goes a bitmap of
+// the 64x64 tiles that changed since the previous frame. Only changed
+// tiles are copied into a slot, so an unchanged desktop costs a hash pass.
+// The producer stops publishing while no reader has asked for a frame in
+// FRAME_RING_IDLE_MS.
+//
+// The layout only uses fixed-size fields and lock-free 32-bit atomics, so
+// it reads the same from any compiler. The mapping helpers use a file
+// mapping in the session's Local namespace on Windows, shm_open elsewhere.
+// Portable: no Windows headers.
+
+#pragma once
+
+#include "RegionClassify.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define FRAME_RING_NAME         "TeacherToolkit.Frames"
+#define FRAME_RING_MAGIC        0x52465454u     // "TTFR"
+#define FRAME_RING_VERSION      1
+#define FRAME_RING_SLOTS        3
+#define FRAME_RING_IDLE_MS      2000
+
+enum FrameRingState {
+    FRAME_RING_STOPPED,         // not projecting; the mapping may go away
+    FRAME_RING_LIVE,
+};
+
+struct FrameRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerBytes;               // offset of slot 0
+    uint32_t slotBytes;                 // distance between slots
+    uint32_t slotCount;
+    uint32_t maxWidth, maxHeight;
+    uint32_t tileSize;
+    uint32_t session;                   // new each time the producer formats the ring
+    std::atomic<uint32_t> latest;       // newest complete frame, 0 = none yet
+    std::atomic<uint32_t> state;        // FrameRingState
+    std::atomic<uint32_t> readerPulse;  // bumped by readers; keeps the producer publishing
+    uint32_t reserved[4];
+};
+
+struct FrameRingSlot {
+    std::atomic<uint32_t> lock;         // seqlock, odd while the producer writes
+    uint32_t seq;
+    uint32_t width, height;
+    uint32_t stride;                    // pixels per row
+    uint32_t tilesX, tilesY;
+    uint32_t dirtyTiles;                // bits set in the dirty bitmap
+    uint64_t timeUs;                    // producer's monotonic clock
+    uint32_t dirtyOffset;               // from the slot start, one bit per tile, LSB first
+    uint32_t pixelOffset;               // from the slot start
+    uint32_t reserved[4];
+};
+
+static_assert(sizeof(FrameRingHeader) == 64 && sizeof(FrameRingSlot) == 64, "shared layout");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared atomics");
+
+// Named shared memory. The producer creates it (or gets the existing one,
+// which keeps its size) and removes the name when done; readers open
+// whatever is there.
+struct FrameRingMapping {
+    void*    base;
+    size_t   bytes;
+    intptr_t handle;            // HANDLE, or file descriptor
+};
+
+bool FrameRingCreate(FrameRingMapping* map, const char* name, size_t bytes);
+bool FrameRingOpen(FrameRingMapping* map, const char* name);
+void FrameRingUnmap(FrameRingMapping* map);
+void FrameRingRemove(const char* name);
+
+// ---- Producer ------------------------------------------------------------
+
+struct FrameRingWriter {
+    FrameRingHeader* header;
+    size_t   bytes;
+    uint32_t seq;                       // last published
+    int      width, height;             // of the last published frame
+    int      tilesX, tilesY;
+    bool     primed;                    // a frame of this size has been published
+    std::vector<uint64_t> hashes;       // per tile, as last published
+    std::vector<uint32_t> changedAt;    // per tile, seq it last changed in
+    std::vector<uint32_t> slotSeq;      // per slot, frame it holds (0 = nothing usable)
+    uint32_t pulse;                     // readerPulse as last seen
+    uint64_t pulseMs;                   // when it last moved, 0 = never
+};
+
+size_t FrameRingBytes(int maxWidth, int maxHeight);
+
+// Lays out an empty ring for frames up to maxWidth x maxHeight in base.
+// False if bytes is too small (an older, smaller mapping still held open
+// by a reader, for instance).
+bool FrameRingFormat(FrameRingWriter* writer, void* base, size_t bytes,
+                     int maxWidth, int maxHeight, uint32_t session);
+
+// True while some reader has asked for a frame in the last FRAME_RING_IDLE_MS.
+bool FrameRingWanted(FrameRingWriter* writer, uint64_t nowMs);
+
+// Publishes a 32bpp frame (stride in pixels) and returns its sequence
+// number, or 0 if it does not fit. Uses the tile hashes in regions when it
+// covers the same frame size, else hashes the frame itself.
+uint32_t FrameRingPublish(FrameRingWriter* writer, const uint32_t* frame, int stride,
+                          int width, int height, const RegionMap* regions, uint64_t timeUs);
+
+// Tells readers projection stopped; the writer can be formatted again.
+void FrameRingStop(FrameRingWriter* writer);
+
+// ---- Reader --------------------------------------------------------------
+
+enum FrameRingResult {
+    FRAME_RING_NONE,            // no frame newer than the last one read
+    FRAME_RING_OK,
+    FRAME_RING_ENDED,           // producer stopped, or the block is not a frame ring
+};
+
+struct FrameRingReader {
+    FrameRingHeader* header;
+    size_t   bytes;
+    uint32_t lastSeq;           // last frame released intact
+    uint32_t session;
+};
+
+struct FrameView {
+    uint32_t seq;
+    int      width, height;
+    int      stride;            // pixels per row
+    uint64_t timeUs;
+    const uint32_t* pixels;     // points into the shared block
+    const uint8_t*  dirty;      // tilesX * tilesY bits, since frame seq - 1
+    int      tilesX, tilesY, tileSize;
+    int      dirtyTiles;
+    bool     allDirty;          // frames were skipped: every tile may have changed
+
+    const FrameRingSlot* slot;
+    uint32_t lock;
+};
+
+bool FrameRingAttach(FrameRingReader* reader, void* base, size_t bytes);
+
+// Points view at the newest frame. Poll at least every FRAME_RING_IDLE_MS
+// or the producer goes idle.
+FrameRingResult FrameRingAcquire(FrameRingReader* reader, FrameView* view);
+
+// True if the frame stayed intact while it was being read. False: the
+// producer overwrote the slot, discard anything derived from it. The view
+// (pixels and dirty bits) is not to be used after this.
+bool FrameRingRelease(FrameRingReader* reader, const FrameView* view);
+
+inline bool FrameTileDirty(const FrameView* view, int tx, int ty)
+{
+    if (view->allDirty) return true;
+    int i = ty * view->tilesX + tx;
+    return (view->dirty[i >> 3] >> (i & 7)) & 1;
+}
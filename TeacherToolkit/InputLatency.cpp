@@ -0,0 +1,144 @@
+// InputLatency.cpp : input tagging, frame matching and percentiles.
+
+#include "InputLatency.h"
+
+#include <string.h>
+
+void LatencyReset(LatencyTracker* t)
+{
+    memset(t, 0, sizeof(*t));
+}
+
+static void HistAdd(LatencyHist* h, int64_t us)
+{
+    if (us < 0) us = 0;
+    int64_t b = us / LATENCY_HIST_BUCKET_US;
+    h->buckets[b < LATENCY_HIST_BUCKETS ? b : LATENCY_HIST_BUCKETS - 1]++;
+    h->count++;
+    h->sumUs += (double)us;
+    if (us > h->maxUs) h->maxUs = us;
+}
+
+static void RemoveAt(LatencyTracker* t, int i)
+{
+    memmove(&t->pending[i], &t->pending[i + 1], (size_t)(t->pendingCount - i - 1) * sizeof(t->pending[0]));
+    t->pendingCount--;
+}
+
+void LatencyInput(LatencyTracker* t, LatencyKind kind, int64_t nowUs, int x, int y)
+{
+    if (kind == LATENCY_POINTER) {
+        for (int i = 0; i < t->pendingCount; i++)
+            if (t->pending[i].kind == LATENCY_POINTER && !t->pending[i].captureUs) return;
+    }
+    if (t->pendingCount == LATENCY_PENDING) {
+        RemoveAt(t, 0);
+        t->dropped++;
+    }
+    LatencyPendingInput* p = &t->pending[t->pendingCount++];
+    p->inputUs = nowUs;
+    p->captureUs = 0;
+    p->x = x;
+    p->y = y;
+    p->kind = (uint8_t)kind;
+}
+
+static bool ChangedNear(const RegionMap* regions, int x, int y)
+{
+    int tx0 = 0, ty0 = 0, tx1 = regions->tilesX - 1, ty1 = regions->tilesY - 1;
+    if (x >= 0 && y >= 0) {
+        int a = (x - LATENCY_NEAR_PX) / REGION_TILE, b = (x + LATENCY_NEAR_PX) / REGION_TILE;
+        int c = (y - LATENCY_NEAR_PX) / REGION_TILE, d = (y + LATENCY_NEAR_PX) / REGION_TILE;
+        if (a > tx0) tx0 = a;
+        if (b < tx1) tx1 = b;
+        if (c > ty0) ty0 = c;
+        if (d < ty1) ty1 = d;
+    }
+    for (int ty = ty0; ty <= ty1; ty++)
+        for (int tx = tx0; tx <= tx1; tx++)
+            if (RegionAt(regions, tx, ty)->history & 1) return true;
+    return false;
+}
+
+void LatencyCapture(LatencyTracker* t, int64_t captureUs, const RegionMap* regions, bool cursorInFrame)
+{
+    for (int i = 0; i < t->pendingCount; ) {
+        LatencyPendingInput* p = &t->pending[i];
+        if (p->captureUs || p->inputUs >= captureUs) { i++; continue; }
+
+        bool shown = p->kind == LATENCY_POINTER
+            ? cursorInFrame
+            : regions && regions->tilesX && ChangedNear(regions, p->x, p->y);
+        if (shown) {
+            p->captureUs = captureUs;
+            i++;
+        } else if (captureUs - p->inputUs > LATENCY_TIMEOUT_US) {
+            t->unseen++;
+            RemoveAt(t, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+void LatencyCursorDrawn(LatencyTracker* t, int64_t nowUs)
+{
+    for (int i = 0; i < t->pendingCount; ) {
+        LatencyPendingInput* p = &t->pending[i];
+        if (p->kind == LATENCY_POINTER && p->inputUs < nowUs) {
+            int64_t us = nowUs - p->inputUs;
+            HistAdd(&t->capture[LATENCY_POINTER], us);
+            HistAdd(&t->total[LATENCY_POINTER], us);
+            t->lastUs = us;
+            t->lastKind = LATENCY_POINTER;
+            RemoveAt(t, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+int LatencyPresent(LatencyTracker* t, int64_t presentUs)
+{
+    int measured = 0;
+    for (int i = 0; i < t->pendingCount; ) {
+        LatencyPendingInput* p = &t->pending[i];
+        if (!p->captureUs) { i++; continue; }
+        HistAdd(&t->capture[p->kind], p->captureUs - p->inputUs);
+        HistAdd(&t->total[p->kind], presentUs - p->inputUs);
+        t->lastUs = presentUs - p->inputUs;
+        t->lastKind = p->kind;
+        RemoveAt(t, i);
+        measured++;
+    }
+    return measured;
+}
+
+static double Percentile(const LatencyHist* h, int pct)
+{
+    uint32_t rank = (uint32_t)(((uint64_t)h->count * pct + 99) / 100);
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (int b = 0; b < LATENCY_HIST_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            int64_t edge = (int64_t)(b + 1) * LATENCY_HIST_BUCKET_US;
+            return (edge < h->maxUs ? edge : h->maxUs) / 1000.0;
+        }
+    }
+    return h->maxUs / 1000.0;
+}
+
+void LatencySummarize(const LatencyTracker* t, LatencyKind kind, LatencySummary* out)
+{
+    memset(out, 0, sizeof(*out));
+    const LatencyHist* h = &t->total[kind];
+    out->count = h->count;
+    if (h->count == 0) return;
+    out->meanMs = h->sumUs / h->count / 1000.0;
+    out->p50Ms = Percentile(h, 50);
+    out->p95Ms = Percentile(h, 95);
+    out->p99Ms = Percentile(h, 99);
+    out->maxMs = h->maxUs / 1000.0;
+    out->captureP50Ms = Percentile(&t->capture[kind], 50);
+}
@@ -0,0 +1,90 @@
+// InputLatency.h : input-to-projector latency, end to end.
+//
+// Per-stage timings do not say what a teacher feels: the time from moving
+// the mouse or pressing a key to seeing the result on the projector. The
+// tracker timestamps each input, waits for the first captured frame that
+// shows its effect, and closes the measurement when that frame is
+// presented.
+//
+// "Shows its effect" depends on the input:
+//   - pointer moves are resolved when the cursor is next drawn on the
+//     projector, or by the next frame if the cursor is part of the frame;
+//   - clicks and keys are resolved by the first frame, captured after the
+//     input, in which a tile near the input's position changed (the
+//     caret for keys, the pointer for clicks), or any tile if the position
+//     is unknown. Without tile change information they are not resolved.
+// Moves are coalesced: while one is waiting, further moves are the same
+// gesture and are not timed separately. Inputs with no visible effect
+// within LATENCY_TIMEOUT_US are counted and dropped.
+//
+// Times are microseconds on any monotonic clock, positions are pixels of
+// the captured frame. Portable: no Windows headers.
+
+#pragma once
+
+#include "RegionClassify.h"
+
+#include <stdint.h>
+
+#define LATENCY_PENDING         64
+#define LATENCY_TIMEOUT_US      1000000
+#define LATENCY_NEAR_PX         96          // how far from the input a change still counts
+#define LATENCY_HIST_BUCKET_US  500
+#define LATENCY_HIST_BUCKETS    1000        // 0..500 ms; the last bucket takes the rest
+
+enum LatencyKind {
+    LATENCY_POINTER,
+    LATENCY_CLICK,
+    LATENCY_KEY,
+    LATENCY_KIND_COUNT
+};
+
+struct LatencyPendingInput {
+    int64_t inputUs;
+    int64_t captureUs;          // frame that showed it, 0 while waiting
+    int     x, y;               // -1: anywhere
+    uint8_t kind;
+};
+
+struct LatencyHist {
+    uint32_t count;
+    double   sumUs;
+    int64_t  maxUs;
+    uint32_t buckets[LATENCY_HIST_BUCKETS];
+};
+
+struct LatencyTracker {
+    LatencyPendingInput pending[LATENCY_PENDING];   // oldest first
+    int      pendingCount;
+    LatencyHist total[LATENCY_KIND_COUNT];          // input -> present
+    LatencyHist capture[LATENCY_KIND_COUNT];        // input -> capture of the frame showing it
+    uint32_t unseen;            // timed out without a visible effect
+    uint32_t dropped;           // more than LATENCY_PENDING waiting
+    int64_t  lastUs;            // latest measurement, for tracing
+    uint8_t  lastKind;
+};
+
+void LatencyReset(LatencyTracker* t);
+
+void LatencyInput(LatencyTracker* t, LatencyKind kind, int64_t nowUs, int x, int y);
+
+// A frame captured at captureUs. regions holds its tile changes (history
+// bit 0), or is null if they are not known; cursorInFrame: the cursor was
+// drawn into the frame itself.
+void LatencyCapture(LatencyTracker* t, int64_t captureUs, const RegionMap* regions, bool cursorInFrame);
+
+// The cursor was drawn straight onto the projector at nowUs
+void LatencyCursorDrawn(LatencyTracker* t, int64_t nowUs);
+
+// The frames captured so far have been handed to the display. Returns
+// the number of inputs measured.
+int LatencyPresent(LatencyTracker* t, int64_t presentUs);
+
+struct LatencySummary {
+    uint32_t count;
+    double   meanMs;
+    double   p50Ms, p95Ms, p99Ms, maxMs;
+    double   captureP50Ms;      // of which input -> capture
+};
+
+void LatencySummarize(const LatencyTracker* t, LatencyKind kind, LatencySummary* out);
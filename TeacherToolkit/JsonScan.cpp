@@ -0,0 +1,443 @@
+// JsonScan.cpp : streaming JSON field extractor with constant memory.
+
+#include "JsonScan.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+enum {
+    S_VALUE,            // expecting a value
+    S_ARRAY_FIRST,      // after '[': value or ']'
+    S_OBJECT_FIRST,     // after '{': key or '}'
+    S_OBJECT_KEY,       // after ',' in an object: key
+    S_COLON,            // after a key
+    S_AFTER,            // after a value: ',' or a closing bracket
+    S_STRING,
+    S_ESCAPE,
+    S_UNICODE,
+    S_NUMBER,
+    S_LITERAL,
+    S_DONE,
+    S_ERROR,
+};
+
+static bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void AppendByte(JsonScanner* s, char c)
+{
+    if (s->valueLen < JSON_MAX_VALUE - 1)
+        s->value[s->valueLen++] = c;
+    else
+        s->valueTruncated = true;
+}
+
+static void AppendCodePoint(JsonScanner* s, unsigned cp)
+{
+    if (cp < 0x80) {
+        AppendByte(s, (char)cp);
+    } else if (cp < 0x800) {
+        AppendByte(s, (char)(0xC0 | (cp >> 6)));
+        AppendByte(s, (char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        AppendByte(s, (char)(0xE0 | (cp >> 12)));
+        AppendByte(s, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        AppendByte(s, (char)(0x80 | (cp & 0x3F)));
+    } else {
+        AppendByte(s, (char)(0xF0 | (cp >> 18)));
+        AppendByte(s, (char)(0x80 | ((cp >> 12) & 0x3F)));
+        AppendByte(s, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        AppendByte(s, (char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+static void BuildPath(JsonScanner* s)
+{
+    size_t len = 0;
+    for (int i = 0; i < s->depth; i++) {
+        const JsonFrame* f = &s->stack[i];
+        const char* part = f->isArray ? "[]" : f->key;
+        if (!f->isArray && len > 0 && len < JSON_MAX_PATH - 1)
+            s->path[len++] = '.';
+        for (const char* p = part; *p && len < JSON_MAX_PATH - 1; p++)
+            s->path[len++] = *p;
+    }
+    s->path[len] = '\0';
+}
+
+static void EmitValue(JsonScanner* s, JsonValueType type)
+{
+    s->value[s->valueLen] = '\0';
+    if (!s->callback) return;
+
+    int arrayIndex = -1;
+    for (int i = s->depth - 1; i >= 0; i--) {
+        if (s->stack[i].isArray) {
+            arrayIndex = s->stack[i].index;
+            break;
+        }
+    }
+    BuildPath(s);
+    s->callback(s->ctx, s->path, arrayIndex, type, s->value, s->valueLen, s->valueTruncated);
+}
+
+static void BeginValueText(JsonScanner* s)
+{
+    s->valueLen = 0;
+    s->valueTruncated = false;
+}
+
+// A scalar or container just ended: decide what may follow it.
+static void EndValue(JsonScanner* s)
+{
+    s->state = (s->depth == 0) ? S_DONE : S_AFTER;
+}
+
+static bool PushFrame(JsonScanner* s, bool isArray)
+{
+    if (s->depth >= JSON_MAX_DEPTH)
+        return false;
+    JsonFrame* f = &s->stack[s->depth++];
+    f->isArray = isArray;
+    f->index = 0;
+    f->key[0] = '\0';
+    return true;
+}
+
+// Handles the first character of a value. Returns false on malformed input.
+static bool StartValue(JsonScanner* s, char c)
+{
+    switch (c) {
+    case '{':
+        if (!PushFrame(s, false)) return false;
+        s->state = S_OBJECT_FIRST;
+        return true;
+    case '[':
+        if (!PushFrame(s, true)) return false;
+        s->state = S_ARRAY_FIRST;
+        return true;
+    case '"':
+        BeginValueText(s);
+        s->inKey = false;
+        s->highSurrogate = 0;
+        s->state = S_STRING;
+        return true;
+    case 't': s->literal = "true";  break;
+    case 'f': s->literal = "false"; break;
+    case 'n': s->literal = "null";  break;
+    default:
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            BeginValueText(s);
+            AppendByte(s, c);
+            s->state = S_NUMBER;
+            return true;
+        }
+        return false;
+    }
+
+    BeginValueText(s);
+    AppendByte(s, c);
+    s->literalPos = 1;
+    s->state = S_LITERAL;
+    return true;
+}
+
+static void EndString(JsonScanner* s)
+{
+    if (s->highSurrogate) {
+        AppendCodePoint(s, 0xFFFD);
+        s->highSurrogate = 0;
+    }
+
+    if (s->inKey) {
+        JsonFrame* f = &s->stack[s->depth - 1];
+        size_t n = s->valueLen < JSON_MAX_KEY - 1 ? s->valueLen : JSON_MAX_KEY - 1;
+        memcpy(f->key, s->value, n);
+        f->key[n] = '\0';
+        s->state = S_COLON;
+    } else {
+        EmitValue(s, JSON_STRING);
+        EndValue(s);
+    }
+}
+
+static int HexDigit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void EndUnicodeEscape(JsonScanner* s)
+{
+    unsigned cp = s->unicode;
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        if (s->highSurrogate) AppendCodePoint(s, 0xFFFD);
+        s->highSurrogate = cp;
+        return;
+    }
+    if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        if (s->highSurrogate) {
+            cp = 0x10000 + ((s->highSurrogate - 0xD800) << 10) + (cp - 0xDC00);
+            s->highSurrogate = 0;
+        } else {
+            cp = 0xFFFD;
+        }
+    } else if (s->highSurrogate) {
+        AppendCodePoint(s, 0xFFFD);
+        s->highSurrogate = 0;
+    }
+    AppendCodePoint(s, cp);
+}
+
+static bool Step(JsonScanner* s, char c, bool* reprocess)
+{
+    *reprocess = false;
+
+    switch (s->state) {
+    case S_VALUE:
+        if (IsSpace(c)) return true;
+        return StartValue(s, c);
+
+    case S_ARRAY_FIRST:
+        if (IsSpace(c)) return true;
+        if (c == ']') {
+            s->depth--;
+            EndValue(s);
+            return true;
+        }
+        return StartValue(s, c);
+
+    case S_OBJECT_FIRST:
+    case S_OBJECT_KEY:
+        if (IsSpace(c)) return true;
+        if (c == '}' && s->state == S_OBJECT_FIRST) {
+            s->depth--;
+            EndValue(s);
+            return true;
+        }
+        if (c != '"') return false;
+        BeginValueText(s);
+        s->inKey = true;
+        s->highSurrogate = 0;
+        s->state = S_STRING;
+        return true;
+
+    case S_COLON:
+        if (IsSpace(c)) return true;
+        if (c != ':') return false;
+        s->state = S_VALUE;
+        return true;
+
+    case S_AFTER: {
+        if (IsSpace(c)) return true;
+        JsonFrame* f = &s->stack[s->depth - 1];
+        if (c == ',') {
+            if (f->isArray) {
+                f->index++;
+                s->state = S_VALUE;
+            } else {
+                s->state = S_OBJECT_KEY;
+            }
+            return true;
+        }
+        if ((c == ']' && f->isArray) || (c == '}' && !f->isArray)) {
+            s->depth--;
+            EndValue(s);
+            return true;
+        }
+        return false;
+    }
+
+    case S_STRING:
+        if (c == '"') {
+            EndString(s);
+            return true;
+        }
+        if (c == '\\') {
+            s->state = S_ESCAPE;
+            return true;
+        }
+        if ((unsigned char)c < 0x20) return false;
+        if (s->highSurrogate) {
+            AppendCodePoint(s, 0xFFFD);
+            s->highSurrogate = 0;
+        }
+        AppendByte(s, c);
+        return true;
+
+    case S_ESCAPE: {
+        char out;
+        switch (c) {
+        case '"':  out = '"';  break;
+        case '\\': out = '\\'; break;
+        case '/':  out = '/';  break;
+        case 'b':  out = '\b'; break;
+        case 'f':  out = '\f'; break;
+        case 'n':  out = '\n'; break;
+        case 'r':  out = '\r'; break;
+        case 't':  out = '\t'; break;
+        case 'u':
+            s->unicode = 0;
+            s->unicodeDigits = 0;
+            s->state = S_UNICODE;
+            return true;
+        default:
+            return false;
+        }
+        if (s->highSurrogate) {
+            AppendCodePoint(s, 0xFFFD);
+            s->highSurrogate = 0;
+        }
+        AppendByte(s, out);
+        s->state = S_STRING;
+        return true;
+    }
+
+    case S_UNICODE: {
+        int d = HexDigit(c);
+        if (d < 0) return false;
+        s->unicode = (s->unicode << 4) | (unsigned)d;
+        if (++s->unicodeDigits == 4) {
+            EndUnicodeEscape(s);
+            s->state = S_STRING;
+        }
+        return true;
+    }
+
+    case S_NUMBER:
+        if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+            AppendByte(s, c);
+            return true;
+        }
+        EmitValue(s, JSON_NUMBER);
+        EndValue(s);
+        *reprocess = true;
+        return true;
+
+    case S_LITERAL:
+        if (c != s->literal[s->literalPos]) return false;
+        AppendByte(s, c);
+        if (s->literal[++s->literalPos] == '\0') {
+            EmitValue(s, JSON_LITERAL);
+            EndValue(s);
+        }
+        return true;
+
+    case S_DONE:
+        return IsSpace(c);
+
+    default:
+        return false;
+    }
+}
+
+void JsonScanInit(JsonScanner* s, JsonFieldCallback callback, void* ctx)
+{
+    memset(s, 0, sizeof(*s));
+    s->callback = callback;
+    s->ctx = ctx;
+    s->state = S_VALUE;
+}
+
+bool JsonScanFeed(JsonScanner* s, const char* data, size_t len)
+{
+    if (s->state == S_ERROR) return false;
+
+    for (size_t i = 0; i < len; ) {
+        bool reprocess = false;
+        if (!Step(s, data[i], &reprocess)) {
+            s->state = S_ERROR;
+            return false;
+        }
+        if (!reprocess) i++;
+    }
+    return true;
+}
+
+bool JsonScanFinish(JsonScanner* s)
+{
+    // A bare top-level number has no terminator of its own
+    if (s->state == S_NUMBER && s->depth == 0) {
+        EmitValue(s, JSON_NUMBER);
+        s->state = S_DONE;
+    }
+    return s->state == S_DONE;
+}
+
+// � Release metadata (GitHub /releases/latest) ������������������������
+
+static void CopyField(char* dst, size_t cap, const char* value, size_t len)
+{
+    size_t n = len < cap - 1 ? len : cap - 1;
+    memcpy(dst, value, n);
+    dst[n] = '\0';
+}
+
+static void CommitAsset(ReleaseInfo* info)
+{
+    if (info->curIndex < 0) return;
+    info->assetCount++;
+    if (!info->haveAsset && info->wantedAsset[0] != '\0' &&
+        strcmp(info->cur.name, info->wantedAsset) == 0) {
+        info->asset = info->cur;
+        info->haveAsset = true;
+    }
+    memset(&info->cur, 0, sizeof(info->cur));
+    info->curIndex = -1;
+}
+
+static void OnReleaseField(void* ctx, const char* path, int arrayIndex,
+                           JsonValueType type, const char* value, size_t len, bool truncated)
+{
+    auto* info = static_cast<ReleaseInfo*>(ctx);
+
+    if (strcmp(path, "tag_name") == 0 && type == JSON_STRING) {
+        CopyField(info->tagName, sizeof(info->tagName), value, len);
+        return;
+    }
+    if (strncmp(path, "assets[].", 9) != 0 || strchr(path + 9, '[') != nullptr)
+        return;
+
+    // Asset members arrive in document order; a new index means the
+    // previous asset is complete.
+    if (arrayIndex != info->curIndex) {
+        CommitAsset(info);
+        info->curIndex = arrayIndex;
+    }
+
+    const char* field = path + 9;
+    if (strcmp(field, "name") == 0 && type == JSON_STRING) {
+        CopyField(info->cur.name, sizeof(info->cur.name), value, len);
+    } else if (strcmp(field, "size") == 0 && type == JSON_NUMBER) {
+        info->cur.size = strtoull(value, nullptr, 10);
+    } else if (strcmp(field, "digest") == 0 && type == JSON_STRING) {
+        CopyField(info->cur.digest, sizeof(info->cur.digest), value, len);
+    } else if (strcmp(field, "browser_download_url") == 0 && type == JSON_STRING && !truncated) {
+        CopyField(info->cur.url, sizeof(info->cur.url), value, len);
+    }
+}
+
+void ReleaseInfoInit(ReleaseInfo* info, const char* wantedAsset)
+{
+    memset(info, 0, sizeof(*info));
+    info->curIndex = -1;
+    if (wantedAsset)
+        CopyField(info->wantedAsset, sizeof(info->wantedAsset), wantedAsset, strlen(wantedAsset));
+    JsonScanInit(&info->scanner, OnReleaseField, info);
+}
+
+bool ReleaseInfoFeed(ReleaseInfo* info, const char* data, size_t len)
+{
+    return JsonScanFeed(&info->scanner, data, len);
+}
+
+bool ReleaseInfoFinish(ReleaseInfo* info)
+{
+    bool ok = JsonScanFinish(&info->scanner);
+    CommitAsset(info);
+    return ok && info->tagName[0] != '\0';
+}
@@ -0,0 +1,99 @@
+// JsonScan.h : streaming JSON field extractor with constant memory.
+//
+// The scanner is fed the response in whatever chunks the network hands
+// out and reports every scalar value together with its path
+// (e.g. "tag_name", "assets[].name"). Nothing is buffered beyond one key
+// and one (truncated) value, so memory use does not depend on the size of
+// the document. Portable: no Windows headers.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_MAX_DEPTH   16     // deeper documents are rejected
+#define JSON_MAX_KEY     32     // longer keys are truncated
+#define JSON_MAX_VALUE   512    // longer scalar values are truncated
+#define JSON_MAX_PATH    (JSON_MAX_DEPTH * (JSON_MAX_KEY + 3))
+
+enum JsonValueType {
+    JSON_STRING,
+    JSON_NUMBER,
+    JSON_LITERAL,       // true / false / null
+};
+
+// path        dotted path, array levels written as "[]"
+// arrayIndex  index within the innermost enclosing array, -1 if none
+// truncated   the value was longer than JSON_MAX_VALUE
+typedef void (*JsonFieldCallback)(void* ctx, const char* path, int arrayIndex,
+                                  JsonValueType type, const char* value, size_t len,
+                                  bool truncated);
+
+struct JsonFrame {
+    bool isArray;
+    int  index;                 // element count so far (arrays only)
+    char key[JSON_MAX_KEY];     // current member key (objects only)
+};
+
+struct JsonScanner {
+    JsonFieldCallback callback;
+    void*             ctx;
+
+    int       state;
+    int       depth;
+    JsonFrame stack[JSON_MAX_DEPTH];
+
+    bool      inKey;            // the string being read is a member key
+    char      value[JSON_MAX_VALUE];
+    size_t    valueLen;
+    bool      valueTruncated;
+    unsigned  unicode;          // \uXXXX accumulator
+    int       unicodeDigits;
+    unsigned  highSurrogate;
+    const char* literal;        // expected spelling while reading a literal
+    int       literalPos;
+
+    char      path[JSON_MAX_PATH];
+};
+
+void JsonScanInit(JsonScanner* s, JsonFieldCallback callback, void* ctx);
+
+// Returns false once the input is known to be malformed; later calls keep
+// returning false.
+bool JsonScanFeed(JsonScanner* s, const char* data, size_t len);
+
+// Call after the last chunk. Returns true if a complete document was read.
+bool JsonScanFinish(JsonScanner* s);
+
+// � Release metadata (GitHub /releases/latest) ������������������������
+
+#define RELEASE_MAX_TAG     64
+#define RELEASE_MAX_NAME    128
+#define RELEASE_MAX_DIGEST  80
+#define RELEASE_MAX_URL     JSON_MAX_VALUE
+
+struct ReleaseAsset {
+    char     name[RELEASE_MAX_NAME];
+    uint64_t size;
+    char     digest[RELEASE_MAX_DIGEST];    // e.g. "sha256:<hex>", may be empty
+    char     url[RELEASE_MAX_URL];          // browser_download_url
+};
+
+// Keeps the tag and the one asset named wantedAsset; every other asset is
+// only counted, so the footprint stays fixed however many there are.
+struct ReleaseInfo {
+    char         tagName[RELEASE_MAX_TAG];
+    int          assetCount;
+    bool         haveAsset;
+    ReleaseAsset asset;
+
+    char         wantedAsset[RELEASE_MAX_NAME];
+    int          curIndex;
+    ReleaseAsset cur;
+
+    JsonScanner  scanner;
+};
+
+void ReleaseInfoInit(ReleaseInfo* info, const char* wantedAsset);
+bool ReleaseInfoFeed(ReleaseInfo* info, const char* data, size_t len);
+bool ReleaseInfoFinish(ReleaseInfo* info);
@@ -0,0 +1,206 @@
+// MaskSpans.cpp : band/span compilation and application of privacy masks.
+
+#include "MaskSpans.h"
+
+#include <algorithm>
+#include <string.h>
+
+static bool SameRects(const std::vector<MaskRect>& a, const MaskRect* b, int count)
+{
+    return (int)a.size() == count &&
+           (count == 0 || memcmp(a.data(), b, count * sizeof(MaskRect)) == 0);
+}
+
+static void Compile(MaskSet* set)
+{
+    set->bands.clear();
+    set->spans.clear();
+
+    std::vector<MaskRect> clipped;
+    std::vector<int> edges;
+    for (const MaskRect& r : set->rects) {
+        MaskRect c = {
+            std::max(r.left, 0), std::max(r.top, 0),
+            std::min(r.right, set->width), std::min(r.bottom, set->height)
+        };
+        if (c.left >= c.right || c.top >= c.bottom) continue;
+        clipped.push_back(c);
+        edges.push_back(c.top);
+        edges.push_back(c.bottom);
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    std::vector<MaskSpan> row;
+    for (size_t e = 0; e + 1 < edges.size(); e++) {
+        int top = edges[e], bottom = edges[e + 1];
+
+        row.clear();
+        for (const MaskRect& c : clipped) {
+            if (c.top <= top && c.bottom >= bottom)
+                row.push_back({ c.left, c.right });
+        }
+        if (row.empty()) continue;
+
+        std::sort(row.begin(), row.end(),
+                  [](const MaskSpan& a, const MaskSpan& b) { return a.left < b.left; });
+        size_t merged = 0;
+        for (size_t i = 1; i < row.size(); i++) {
+            if (row[i].left <= row[merged].right)
+                row[merged].right = std::max(row[merged].right, row[i].right);
+            else
+                row[++merged] = row[i];
+        }
+        row.resize(merged + 1);
+
+        // Rows directly below an identical band just extend it
+        if (!set->bands.empty()) {
+            MaskBand& prev = set->bands.back();
+            if (prev.bottom == top && prev.spanCount == (int)row.size() &&
+                memcmp(&set->spans[prev.firstSpan], row.data(), row.size() * sizeof(MaskSpan)) == 0) {
+                prev.bottom = bottom;
+                continue;
+            }
+        }
+
+        MaskBand band = { top, bottom, (int)set->spans.size(), (int)row.size() };
+        set->spans.insert(set->spans.end(), row.begin(), row.end());
+        set->bands.push_back(band);
+    }
+}
+
+bool MaskUpdate(MaskSet* set, const MaskRect* rects, int count, int width, int height)
+{
+    if (set->width == width && set->height == height && SameRects(set->rects, rects, count))
+        return false;
+
+    set->width = width;
+    set->height = height;
+    set->rects.assign(rects, rects + count);
+    Compile(set);
+    return true;
+}
+
+bool MaskIsEmpty(const MaskSet* set)
+{
+    return set->bands.empty();
+}
+
+// Pixelates the mask inside [x0, x1) x [y0, y1) over one grid of block-sized
+// cells anchored at the frame origin. Each cell takes the average colour of
+// all its masked pixels, whichever bands and spans they belong to, so band
+// edges (where a masked window overlaps another) never cut a cell into
+// strips thin enough to read. Returns true if any pixel was masked.
+static bool PixelateClipped(const MaskSet* set, uint32_t* frame, int stride, int block,
+                            int x0, int y0, int x1, int y1)
+{
+    struct Cell {
+        uint32_t r, g, b, n;
+        uint32_t avg;
+    };
+    if (x0 >= x1 || y0 >= y1) return false;
+    int firstCol = x0 / block;
+    int cellCount = (x1 - 1) / block - firstCol + 1;
+
+    // One block row of cells; a tile-sized clip fits on the stack
+    Cell local[32];
+    std::vector<Cell> heap;
+    Cell* cells = local;
+    if (cellCount > (int)(sizeof(local) / sizeof(local[0]))) {
+        heap.resize((size_t)cellCount);
+        cells = heap.data();
+    }
+
+    auto first = std::upper_bound(set->bands.begin(), set->bands.end(), y0,
+                                  [](int y, const MaskBand& b) { return y < b.bottom; });
+    bool touched = false;
+    for (int by = y0 - y0 % block; by < y1 && first != set->bands.end(); by += block) {
+        int rowTop = std::max(by, y0), rowBottom = std::min(by + block, y1);
+        std::fill(cells, cells + cellCount, Cell{ 0, 0, 0, 0, 0 });
+
+        // Pass 0 sums each cell's masked pixels, pass 1 paints their average
+        for (int pass = 0; pass < 2; pass++) {
+            for (auto band = first; band != set->bands.end() && band->top < rowBottom; ++band) {
+                int top = std::max(band->top, rowTop), bottom = std::min(band->bottom, rowBottom);
+                if (top >= bottom) continue;
+                const MaskSpan* spans = &set->spans[band->firstSpan];
+                for (int i = 0; i < band->spanCount && spans[i].left < x1; i++) {
+                    int left = std::max(spans[i].left, x0), right = std::min(spans[i].right, x1);
+                    for (int x = left; x < right; ) {
+                        Cell& c = cells[x / block - firstCol];
+                        int end = std::min((x / block + 1) * block, right);
+                        for (int y = top; y < bottom; y++) {
+                            uint32_t* p = frame + (size_t)y * stride;
+                            if (pass == 1) {
+                                std::fill(p + x, p + end, c.avg);
+                                continue;
+                            }
+                            for (int k = x; k < end; k++) {
+                                c.r += (p[k] >> 16) & 0xFF;
+                                c.g += (p[k] >> 8) & 0xFF;
+                                c.b += p[k] & 0xFF;
+                            }
+                            c.n += (uint32_t)(end - x);
+                        }
+                        x = end;
+                    }
+                }
+            }
+            if (pass == 1) break;
+            for (int i = 0; i < cellCount; i++) {
+                Cell& c = cells[i];
+                if (!c.n) continue;
+                touched = true;
+                c.avg = 0xFF000000 | ((c.r / c.n) << 16) | ((c.g / c.n) << 8) | (c.b / c.n);
+            }
+        }
+        while (first != set->bands.end() && first->bottom <= rowBottom) ++first;
+    }
+    return touched;
+}
+
+void MaskApply(const MaskSet* set, uint32_t* frame, int stride, MaskMode mode, int blockPx)
+{
+    if (blockPx < 2) blockPx = 2;
+    if (mode == MASK_PIXELATE) {
+        PixelateClipped(set, frame, stride, blockPx, 0, 0, set->width, set->height);
+        return;
+    }
+
+    for (const MaskBand& band : set->bands) {
+        const MaskSpan* spans = &set->spans[band.firstSpan];
+        for (int i = 0; i < band.spanCount; i++) {
+            for (int y = band.top; y < band.bottom; y++) {
+                uint32_t* row = frame + (size_t)y * stride;
+                std::fill(row + spans[i].left, row + spans[i].right, 0xFF000000u);
+            }
+        }
+    }
+}
+
+bool MaskApplyClipped(const MaskSet* set, uint32_t* frame, int stride, MaskMode mode, int blockPx,
+                      int x0, int y0, int x1, int y1)
+{
+    if (blockPx < 2) blockPx = 2;
+    if (mode == MASK_PIXELATE)
+        return PixelateClipped(set, frame, stride, blockPx, x0, y0, x1, y1);
+
+    // Bands are sorted and disjoint: skip to the first one reaching y0
+    auto band = std::upper_bound(set->bands.begin(), set->bands.end(), y0,
+                                 [](int y, const MaskBand& b) { return y < b.bottom; });
+    bool touched = false;
+    for (; band != set->bands.end() && band->top < y1; ++band) {
+        int top = std::max(band->top, y0), bottom = std::min(band->bottom, y1);
+        const MaskSpan* spans = &set->spans[band->firstSpan];
+        for (int i = 0; i < band->spanCount && spans[i].left < x1; i++) {
+            int left = std::max(spans[i].left, x0), right = std::min(spans[i].right, x1);
+            if (left >= right) continue;
+            touched = true;
+            for (int y = top; y < bottom; y++) {
+                uint32_t* row = frame + (size_t)y * stride;
+                std::fill(row + left, row + right, 0xFF000000u);
+            }
+        }
+    }
+    return touched;
+}
@@ -0,0 +1,58 @@
+// MaskSpans.h : privacy masks for the projector image.
+//
+// The rectangles to hide (masked windows, fixed regions) are compiled into
+// horizontal bands of rows that share one sorted, merged span list, the
+// same banded layout GDI uses for regions. Compiling only happens when the
+// input rectangles change; applying a mask is then a walk over the bands
+// that fills (or pixelates) exactly the covered pixels, with no per-pixel
+// tests. Portable: no Windows headers.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+enum MaskMode {
+    MASK_BLACK,                 // solid black
+    MASK_PIXELATE,              // coarse blocks, unreadable but shows activity
+};
+
+struct MaskRect {
+    int left, top, right, bottom;       // frame pixels, right/bottom exclusive
+};
+
+struct MaskSpan {
+    int left, right;
+};
+
+struct MaskBand {
+    int top, bottom;            // rows [top, bottom)
+    int firstSpan;
+    int spanCount;
+};
+
+struct MaskSet {
+    int width;
+    int height;
+    std::vector<MaskRect> rects;        // input of the last compile, for change detection
+    std::vector<MaskBand> bands;
+    std::vector<MaskSpan> spans;
+};
+
+// Recompiles only if the rectangles or frame size differ from the last
+// call. Rectangles are clipped to the frame. Returns true if it recompiled.
+bool MaskUpdate(MaskSet* set, const MaskRect* rects, int count, int width, int height);
+
+bool MaskIsEmpty(const MaskSet* set);
+
+// Applies the compiled mask to a 32bpp frame (stride in pixels). blockPx is
+// the pixelation block size, on one grid aligned to the frame origin; each
+// block becomes the average of all its masked pixels.
+void MaskApply(const MaskSet* set, uint32_t* frame, int stride, MaskMode mode, int blockPx);
+
+// Same, limited to [x0, x1) x [y0, y1). Pixelation matches MaskApply as
+// long as the clip edges fall on the blockPx grid. Returns true if any
+// pixel in the clip was masked.
+bool MaskApplyClipped(const MaskSet* set, uint32_t* frame, int stride, MaskMode mode, int blockPx,
+                      int x0, int y0, int x1, int y1);
@@ -0,0 +1,183 @@
+// MirrorProfile.cpp : profile presets, parsing and colour tables.
+
+#include "MirrorProfile.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct ProfilePreset {
+    const char* name;
+    uint32_t    frameUs;
+    uint8_t     scaler;
+    uint8_t     capture;
+};
+
+static const ProfilePreset PRESETS[] = {
+    { "default",  0,              PROFILE_SCALER_AUTO,  PROFILE_CAPTURE_TILES },
+    { "video",    1000000 / 60,   PROFILE_SCALER_FAST,  PROFILE_CAPTURE_FULL },
+    { "document", 1000000 / 5,    PROFILE_SCALER_SHARP, PROFILE_CAPTURE_TILES },
+    { "cad",      1000000 / 15,   PROFILE_SCALER_SHARP, PROFILE_CAPTURE_TILES },
+};
+
+// Executables and window classes with a profile out of the box
+static const struct { const char* key; const char* spec; } BUILTIN[] = {
+    { "vlc.exe",                "video" },
+    { "mpc-hc.exe",             "video" },
+    { "mpc-hc64.exe",           "video" },
+    { "mpc-be.exe",             "video" },
+    { "mpc-be64.exe",           "video" },
+    { "mpv.exe",                "video" },
+    { "potplayermini.exe",      "video" },
+    { "potplayermini64.exe",    "video" },
+    { "wmplayer.exe",           "video" },
+    { "video.ui.exe",           "video" },      // Filmes e TV
+    { "MediaPlayerClassicW",    "video" },
+    { "winword.exe",            "document" },
+    { "acrord32.exe",           "document" },
+    { "acrobat.exe",            "document" },
+    { "sumatrapdf.exe",         "document" },
+    { "notepad.exe",            "document" },
+    { "wordpad.exe",            "document" },
+    { "acad.exe",               "cad" },
+    { "sldworks.exe",           "cad" },
+    { "inventor.exe",           "cad" },
+    { "freecad.exe",            "cad" },
+    { "sketchup.exe",           "cad" },
+    { "geogebra.exe",           "cad" },
+};
+
+static char LowerAscii(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static bool EqualNoCase(const char* a, size_t aLen, const char* b)
+{
+    size_t i = 0;
+    for (; i < aLen && b[i]; i++)
+        if (LowerAscii(a[i]) != LowerAscii(b[i])) return false;
+    return i == aLen && !b[i];
+}
+
+static void ApplyPreset(MirrorProfile* p, const ProfilePreset& preset)
+{
+    p->frameUs = preset.frameUs;
+    p->scaler  = preset.scaler;
+    p->capture = preset.capture;
+    if (strcmp(preset.name, "default") == 0)
+        p->preset[0] = '\0';
+    else
+        memcpy(p->preset, preset.name, strlen(preset.name) + 1);
+}
+
+void ProfileDefault(MirrorProfile* p)
+{
+    memset(p, 0, sizeof(*p));
+}
+
+// One "name" or "field:value" token
+static bool ParseToken(MirrorProfile* p, const char* tok, size_t len)
+{
+    const char* colon = (const char*)memchr(tok, ':', len);
+    if (!colon) {
+        for (const ProfilePreset& preset : PRESETS) {
+            if (EqualNoCase(tok, len, preset.name)) {
+                ApplyPreset(p, preset);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t keyLen = (size_t)(colon - tok);
+    const char* val = colon + 1;
+    size_t valLen = len - keyLen - 1;
+    if (EqualNoCase(tok, keyLen, "fps")) {
+        char num[8];
+        if (valLen == 0 || valLen >= sizeof(num)) return false;
+        memcpy(num, val, valLen);
+        num[valLen] = '\0';
+        char* end = nullptr;
+        long fps = strtol(num, &end, 10);
+        if (*end || fps < 1 || fps > 200) return false;
+        p->frameUs = (uint32_t)(1000000 / fps);
+        return true;
+    }
+    if (EqualNoCase(tok, keyLen, "scaler")) {
+        if (EqualNoCase(val, valLen, "auto"))       p->scaler = PROFILE_SCALER_AUTO;
+        else if (EqualNoCase(val, valLen, "sharp")) p->scaler = PROFILE_SCALER_SHARP;
+        else if (EqualNoCase(val, valLen, "fast"))  p->scaler = PROFILE_SCALER_FAST;
+        else return false;
+        return true;
+    }
+    if (EqualNoCase(tok, keyLen, "capture")) {
+        if (EqualNoCase(val, valLen, "tiles"))      p->capture = PROFILE_CAPTURE_TILES;
+        else if (EqualNoCase(val, valLen, "full"))  p->capture = PROFILE_CAPTURE_FULL;
+        else return false;
+        return true;
+    }
+    if (EqualNoCase(tok, keyLen, "color")) {
+        if (EqualNoCase(val, valLen, "none"))          p->color = PROFILE_COLOR_NONE;
+        else if (EqualNoCase(val, valLen, "bright"))   p->color = PROFILE_COLOR_BRIGHT;
+        else if (EqualNoCase(val, valLen, "contrast")) p->color = PROFILE_COLOR_CONTRAST;
+        else return false;
+        return true;
+    }
+    return false;
+}
+
+bool ProfileParse(MirrorProfile* p, const char* spec)
+{
+    ProfileDefault(p);
+    const char* s = spec;
+    while (*s) {
+        while (*s == ' ' || *s == ',' || *s == ';') s++;
+        const char* tok = s;
+        while (*s && *s != ' ' && *s != ',' && *s != ';') s++;
+        if (s > tok && !ParseToken(p, tok, (size_t)(s - tok))) {
+            ProfileDefault(p);
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* ProfileBuiltin(const char* key)
+{
+    size_t len = strlen(key);
+    for (const auto& b : BUILTIN)
+        if (EqualNoCase(key, len, b.key)) return b.spec;
+    return nullptr;
+}
+
+bool ProfileEqual(const MirrorProfile* a, const MirrorProfile* b)
+{
+    return a->frameUs == b->frameUs && a->scaler == b->scaler &&
+           a->capture == b->capture && a->color == b->color;
+}
+
+struct ColorTables {
+    uint8_t lut[PROFILE_COLOR_COUNT][256];
+};
+
+static ColorTables BuildColorTables()
+{
+    ColorTables t;
+    for (int i = 0; i < 256; i++) {
+        double x = i / 255.0;
+        double bright = pow(x, 0.8);
+        double half = x < 0.5 ? 0.5 * pow(2.0 * x, 1.4) : 1.0 - 0.5 * pow(2.0 * (1.0 - x), 1.4);
+        t.lut[PROFILE_COLOR_NONE][i]     = (uint8_t)i;
+        t.lut[PROFILE_COLOR_BRIGHT][i]   = (uint8_t)(bright * 255.0 + 0.5);
+        t.lut[PROFILE_COLOR_CONTRAST][i] = (uint8_t)(half * 255.0 + 0.5);
+    }
+    return t;
+}
+
+const uint8_t* ProfileColorLut(int color)
+{
+    if (color <= PROFILE_COLOR_NONE || color >= PROFILE_COLOR_COUNT) return nullptr;
+    static const ColorTables tables = BuildColorTables();
+    return tables.lut[color];
+}
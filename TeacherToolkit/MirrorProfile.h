@@ -0,0 +1,66 @@
+// MirrorProfile.h : per-application mirroring profiles.
+//
+// Not every application needs the same mirror. A video player wants every
+// projector refresh and gains nothing from the sharp filter; a word
+// processor changes a few tiles a second; a CAD viewer has thin lines that
+// need the sharp filter, at a moderate rate. A profile sets the frame
+// rate, the scaler, whether only changed tiles are repainted (capture) and
+// an optional colour stage, for whichever application is in the
+// foreground. Anything a profile leaves out follows the global config.
+//
+// The profile for an executable or window class comes from config
+// (profile.<exe or class>=...) or else from a built-in table. Its value
+// is a preset, fields, or both, separated by commas:
+//   profile.vlc.exe=video
+//   profile.acad.exe=cad,fps:20
+//   profile.winword.exe=default        (turns a built-in one off)
+// Fields: fps:<1..200>, scaler:auto|sharp|fast, capture:tiles|full,
+// color:none|bright|contrast.
+// Portable: no Windows headers.
+
+#pragma once
+
+#include <stdint.h>
+
+enum ProfileScaler {
+    PROFILE_SCALER_AUTO,        // per tile: sharp for text, fast for video
+    PROFILE_SCALER_SHARP,
+    PROFILE_SCALER_FAST,
+};
+
+enum ProfileCapture {
+    PROFILE_CAPTURE_TILES,      // repaint changed tiles (with region_classify=1)
+    PROFILE_CAPTURE_FULL,       // rescale the whole frame every time, no hashing
+};
+
+enum ProfileColor {
+    PROFILE_COLOR_NONE,
+    PROFILE_COLOR_BRIGHT,       // lifts mid-tones for dim or washed-out projectors
+    PROFILE_COLOR_CONTRAST,     // S-curve: darker text, whiter paper
+    PROFILE_COLOR_COUNT
+};
+
+struct MirrorProfile {
+    char     preset[12];        // preset it was based on, "" = none
+    uint32_t frameUs;           // 0 = mirror_fps_ms
+    uint8_t  scaler;            // ProfileScaler
+    uint8_t  capture;           // ProfileCapture
+    uint8_t  color;             // ProfileColor
+};
+
+// The global settings: no overrides
+void ProfileDefault(MirrorProfile* p);
+
+// Parses a profile value into p. False (and p left at the default) if it
+// names an unknown preset or field.
+bool ProfileParse(MirrorProfile* p, const char* spec);
+
+// Built-in value for an executable name or window class (any case), or
+// nullptr
+const char* ProfileBuiltin(const char* key);
+
+bool ProfileEqual(const MirrorProfile* a, const MirrorProfile* b);
+
+// 256-entry table applied to each channel (LutStage), nullptr for
+// PROFILE_COLOR_NONE. The tables are static and built on first use.
+const uint8_t* ProfileColorLut(int color);
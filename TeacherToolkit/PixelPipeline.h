@@ -0,0 +1,215 @@
+// PixelPipeline.h : in-place frame stages fused into one cache-blocked pass.
+//
+// Between the capture and the scaler the frame goes through several
+// in-place stages: privacy masks, annotations, optionally a colour table,
+// and the tile hashes RegionClassify needs. Run one after the other over
+// the whole frame, each stage would pull the frame (8 MB at 1080p, more
+// than the cache of a low-end laptop) through memory again. FusePixelStages
+// instead walks the frame once, in 64x64 tiles (16 KB, fits in L1). Every
+// stage finishes a tile before the next tile is loaded, so the frame is
+// read and written about once, whatever the number of stages.
+//
+// The pipeline type is a template over its stages, so each stage call is
+// resolved and inlined at compile time: no per-pixel or per-tile virtual
+// dispatch. A stage is any type with
+//     bool Active() const;                 // checked once per pass
+//     bool Tile(const PixelTile& t);       // in place; true if it read or wrote the tile
+//     static const bool writes;            // for the traffic estimate
+// Stages only see their own tile, so a stage that needs neighbouring
+// pixels (scaling, the keystone warp) cannot be fused and runs after it.
+// Portable: no Windows headers.
+
+#pragma once
+
+#include "Annotate.h"
+#include "MaskSpans.h"
+#include "RegionClassify.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <initializer_list>
+#include <tuple>
+#include <utility>
+
+#define PIXEL_TILE          REGION_TILE
+
+static_assert(PIXEL_TILE == ANNOT_TILE, "annotation tiles must line up with pass tiles");
+
+struct PixelTile {
+    uint32_t* frame;            // whole frame
+    int stride;                 // pixels
+    int tx, ty;                 // tile coordinates
+    int x0, y0, x1, y1;         // pixel bounds, right/bottom exclusive
+};
+
+// Frame memory traffic of a pass, counting a tile once per stage that
+// touched it (unfused) or once per pass (fused).
+struct PixelPassStats {
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+};
+
+// ---- Stages ----------------------------------------------------------------
+
+// Privacy masks. Pixelation can only be fused when its blocks never
+// straddle a tile; otherwise run MaskApply before the pass.
+struct MaskStage {
+    const MaskSet* set;
+    MaskMode mode;
+    int blockPx;
+    static const bool writes = true;
+
+    static bool Fusable(MaskMode mode, int blockPx)
+    {
+        return mode != MASK_PIXELATE || (blockPx >= 2 && PIXEL_TILE % blockPx == 0);
+    }
+    bool Active() const { return set && !MaskIsEmpty(set) && Fusable(mode, blockPx); }
+    bool Tile(const PixelTile& t) const
+    {
+        return MaskApplyClipped(set, t.frame, t.stride, mode, blockPx, t.x0, t.y0, t.x1, t.y1);
+    }
+};
+
+struct AnnotStage {
+    const AnnotationLayer* layer;
+    static const bool writes = true;
+
+    bool Active() const { return layer && !AnnotIsEmpty(layer); }
+    bool Tile(const PixelTile& t) const
+    {
+        return AnnotCompositeTile(layer, t.frame, t.stride, t.tx, t.ty);
+    }
+};
+
+// Per-channel lookup (brightness, gamma or colour correction)
+struct LutStage {
+    const uint8_t* r;           // 256 entries each
+    const uint8_t* g;
+    const uint8_t* b;
+    static const bool writes = true;
+
+    bool Active() const { return r && g && b; }
+    bool Tile(const PixelTile& t) const
+    {
+        for (int y = t.y0; y < t.y1; y++) {
+            uint32_t* p = t.frame + (size_t)y * t.stride;
+            for (int x = t.x0; x < t.x1; x++) {
+                uint32_t c = p[x];
+                p[x] = (c & 0xFF000000u) | (uint32_t)r[(c >> 16) & 0xFF] << 16 |
+                       (uint32_t)g[(c >> 8) & 0xFF] << 8 | b[c & 0xFF];
+            }
+        }
+        return true;
+    }
+};
+
+// RegionHashTile of the finished tile, for RegionUpdateHashed. Goes last.
+struct HashStage {
+    uint64_t* hashes;           // tilesX per tile row, row-major
+    int tilesX;
+    static const bool writes = false;
+
+    bool Active() const { return hashes != nullptr; }
+    bool Tile(const PixelTile& t) const
+    {
+        hashes[(size_t)t.ty * tilesX + t.tx] = RegionHashTile(t.frame, t.stride, t.x0, t.y0, t.x1, t.y1);
+        return true;
+    }
+};
+
+// ---- Pipeline --------------------------------------------------------------
+
+template <class... Stages>
+struct PixelPipeline {
+    std::tuple<Stages...> stages;
+
+    // One pass, tile row by tile row, every active stage on each tile in turn
+    PixelPassStats Run(uint32_t* frame, int stride, int width, int height)
+    {
+        return RunImpl(frame, stride, width, height, std::index_sequence_for<Stages...>());
+    }
+
+    // Reference: each stage over the whole frame before the next one starts.
+    // Same results, for benchmarks and checks.
+    PixelPassStats RunUnfused(uint32_t* frame, int stride, int width, int height)
+    {
+        return RunUnfusedImpl(frame, stride, width, height, std::index_sequence_for<Stages...>());
+    }
+
+private:
+    template <class F>
+    static void ForEachTile(uint32_t* frame, int stride, int width, int height, F&& f)
+    {
+        PixelTile t;
+        t.frame = frame;
+        t.stride = stride;
+        for (t.ty = 0, t.y0 = 0; t.y0 < height; t.ty++, t.y0 += PIXEL_TILE) {
+            t.y1 = t.y0 + PIXEL_TILE < height ? t.y0 + PIXEL_TILE : height;
+            for (t.tx = 0, t.x0 = 0; t.x0 < width; t.tx++, t.x0 += PIXEL_TILE) {
+                t.x1 = t.x0 + PIXEL_TILE < width ? t.x0 + PIXEL_TILE : width;
+                f(t);
+            }
+        }
+    }
+
+    static uint64_t TileBytes(const PixelTile& t)
+    {
+        return (uint64_t)(t.x1 - t.x0) * (t.y1 - t.y0) * sizeof(uint32_t);
+    }
+
+    template <size_t... I>
+    PixelPassStats RunImpl(uint32_t* frame, int stride, int width, int height, std::index_sequence<I...>)
+    {
+        PixelPassStats stats = {};
+        const bool active[] = { std::get<I>(stages).Active()..., false };
+        bool any = false;
+        for (bool a : active) any = any || a;
+        if (!any) return stats;
+
+        ForEachTile(frame, stride, width, height, [&](const PixelTile& t) {
+            bool read = false, written = false;
+            (void)std::initializer_list<int>{ (RunStage(std::get<I>(stages), active[I], t, &read, &written), 0)... };
+            if (read)    stats.bytesRead    += TileBytes(t);
+            if (written) stats.bytesWritten += TileBytes(t);
+        });
+        return stats;
+    }
+
+    template <size_t... I>
+    PixelPassStats RunUnfusedImpl(uint32_t* frame, int stride, int width, int height, std::index_sequence<I...>)
+    {
+        PixelPassStats stats = {};
+        (void)std::initializer_list<int>{ (RunWholeFrame(std::get<I>(stages), frame, stride, width, height, &stats), 0)... };
+        return stats;
+    }
+
+    template <class S>
+    static void RunStage(S& stage, bool active, const PixelTile& t, bool* read, bool* written)
+    {
+        if (active && stage.Tile(t)) {
+            *read = true;
+            *written = *written || S::writes;
+        }
+    }
+
+    template <class S>
+    static void RunWholeFrame(S& stage, uint32_t* frame, int stride, int width, int height, PixelPassStats* stats)
+    {
+        if (!stage.Active()) return;
+        ForEachTile(frame, stride, width, height, [&](const PixelTile& t) {
+            if (!stage.Tile(t)) return;
+            stats->bytesRead += TileBytes(t);
+            if (S::writes) stats->bytesWritten += TileBytes(t);
+        });
+    }
+};
+
+// Fixes the stage order and the data each stage works on. The pipeline is
+// a tuple of the stage structs (a few pointers and flags, no allocation),
+// so callers build a fresh one for every frame from that frame's masks,
+// colour table and hash buffer rather than keeping one in sync with them.
+template <class... Stages>
+PixelPipeline<Stages...> FusePixelStages(Stages... stages)
+{
+    return PixelPipeline<Stages...>{ std::make_tuple(stages...) };
+}
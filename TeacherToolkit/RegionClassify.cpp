@@ -0,0 +1,164 @@
+// RegionClassify.cpp : tile hashing, edge density and labelling.
+
+#include "RegionClassify.h"
+
+#include <string.h>
+
+#define EDGE_LUMA_STEP      40      // luma difference that counts as a hard edge
+#define VIDEO_MAX_EDGES     120     // per mille; above this it is text or UI
+#define VIDEO_ENTER         6       // changes in the last 8 frames to become video
+#define VIDEO_STAY          3       // ...and to remain video
+#define STATIC_MAX_CHANGES  2       // changes in the last 32 frames to count as static
+
+static int BitCount(uint32_t v)
+{
+    v = v - ((v >> 1) & 0x55555555u);
+    v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+    return (int)((((v + (v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+}
+
+void RegionInit(RegionMap* map, int width, int height)
+{
+    map->width  = width;
+    map->height = height;
+    map->tilesX = (width  + REGION_TILE - 1) / REGION_TILE;
+    map->tilesY = (height + REGION_TILE - 1) / REGION_TILE;
+    map->tiles.assign((size_t)map->tilesX * map->tilesY, RegionTile{});
+    map->frames = 0;
+    memset(map->counts, 0, sizeof(map->counts));
+}
+
+void RegionFree(RegionMap* map)
+{
+    std::vector<RegionTile>().swap(map->tiles);
+    std::vector<uint64_t>().swap(map->rowHashes);
+    map->width = map->height = map->tilesX = map->tilesY = 0;
+    map->frames = 0;
+}
+
+// Per mille of sampled pixels (every other row) whose luma differs from
+// the right-hand neighbour by more than EDGE_LUMA_STEP.
+static uint16_t EdgeDensity(const uint32_t* frame, int stride, int x0, int y0, int x1, int y1)
+{
+    int edges = 0, samples = 0;
+    for (int y = y0; y < y1; y += 2) {
+        const uint32_t* p = frame + (size_t)y * stride;
+        int prev = -1;
+        for (int x = x0; x < x1; x++) {
+            uint32_t c = p[x];
+            int luma = (int)(((c >> 16) & 0xFF) + ((c >> 7) & 0x1FE) + (c & 0xFF)) >> 2;
+            if (prev >= 0) {
+                int d = luma - prev;
+                if (d > EDGE_LUMA_STEP || d < -EDGE_LUMA_STEP) edges++;
+                samples++;
+            }
+            prev = luma;
+        }
+    }
+    return samples ? (uint16_t)(edges * 1000 / samples) : 0;
+}
+
+static RegionClass Classify(const RegionTile& t)
+{
+    int recent = BitCount(t.history & 0xFF);
+    int needed = t.label == REGION_VIDEO ? VIDEO_STAY : VIDEO_ENTER;
+    if (recent >= needed && t.edgeDensity <= VIDEO_MAX_EDGES)
+        return REGION_VIDEO;
+    if (BitCount(t.history) <= STATIC_MAX_CHANGES)
+        return REGION_STATIC;
+    return REGION_OCCASIONAL;
+}
+
+// Updates history, edge density and label of tile row ty from its hashes.
+// Returns the number of tiles left dirty.
+static int UpdateTileRow(RegionMap* map, const uint32_t* frame, int stride, int ty, const uint64_t* hashes)
+{
+    int y0 = ty * REGION_TILE;
+    int y1 = y0 + REGION_TILE < map->height ? y0 + REGION_TILE : map->height;
+    int dirty = 0;
+    for (int tx = 0; tx < map->tilesX; tx++) {
+        RegionTile& t = map->tiles[(size_t)ty * map->tilesX + tx];
+        bool changed = map->frames == 0 || hashes[tx] != t.hash;
+        t.hash = hashes[tx];
+        t.history = (t.history << 1) | (changed && map->frames > 0 ? 1u : 0u);
+        if (changed) {
+            int x0 = tx * REGION_TILE;
+            int x1 = x0 + REGION_TILE < map->width ? x0 + REGION_TILE : map->width;
+            t.edgeDensity = EdgeDensity(frame, stride, x0, y0, x1, y1);
+        }
+
+        RegionClass label = Classify(t);
+        t.dirty = changed || (t.label == REGION_VIDEO && label != REGION_VIDEO);
+        t.label = (uint8_t)label;
+        map->counts[label]++;
+        if (t.dirty) dirty++;
+    }
+    return dirty;
+}
+
+int RegionUpdate(RegionMap* map, const uint32_t* frame, int stride)
+{
+    if (map->tiles.empty()) return 0;
+
+    // Hash row-major so the frame is streamed through once
+    std::vector<uint64_t>& hashes = map->rowHashes;
+    hashes.resize((size_t)map->tilesX);
+    int dirty = 0;
+    memset(map->counts, 0, sizeof(map->counts));
+
+    for (int ty = 0; ty < map->tilesY; ty++) {
+        int y0 = ty * REGION_TILE;
+        int y1 = y0 + REGION_TILE < map->height ? y0 + REGION_TILE : map->height;
+        for (int tx = 0; tx < map->tilesX; tx++) hashes[tx] = 0xCBF29CE484222325ull;
+
+        for (int y = y0; y < y1; y++) {
+            const uint32_t* row = frame + (size_t)y * stride;
+            for (int tx = 0; tx < map->tilesX; tx++) {
+                int x0 = tx * REGION_TILE;
+                int x1 = x0 + REGION_TILE < map->width ? x0 + REGION_TILE : map->width;
+                uint64_t h = hashes[tx];
+                int x = x0;
+                for (; x + 2 <= x1; x += 2) {
+                    uint64_t v;
+                    memcpy(&v, row + x, sizeof(v));
+                    h = (h ^ v) * 0x100000001B3ull;
+                }
+                if (x < x1) h = (h ^ row[x]) * 0x100000001B3ull;
+                hashes[tx] = h ^ (h >> 29);
+            }
+        }
+        dirty += UpdateTileRow(map, frame, stride, ty, hashes.data());
+    }
+    map->frames++;
+    return dirty;
+}
+
+int RegionUpdateHashed(RegionMap* map, const uint32_t* frame, int stride, const uint64_t* tileHashes)
+{
+    if (map->tiles.empty()) return 0;
+
+    int dirty = 0;
+    memset(map->counts, 0, sizeof(map->counts));
+    for (int ty = 0; ty < map->tilesY; ty++)
+        dirty += UpdateTileRow(map, frame, stride, ty, tileHashes + (size_t)ty * map->tilesX);
+    map->frames++;
+    return dirty;
+}
+
+// Same FNV-1a over pixel pairs as RegionUpdate, one tile at a time
+uint64_t RegionHashTile(const uint32_t* frame, int stride, int x0, int y0, int x1, int y1)
+{
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (int y = y0; y < y1; y++) {
+        const uint32_t* row = frame + (size_t)y * stride;
+        int x = x0;
+        for (; x + 2 <= x1; x += 2) {
+            uint64_t v;
+            memcpy(&v, row + x, sizeof(v));
+            h = (h ^ v) * 0x100000001B3ull;
+        }
+        if (x < x1) h = (h ^ row[x]) * 0x100000001B3ull;
+        h ^= h >> 29;
+    }
+    return h;
+}
@@ -0,0 +1,67 @@
+// RegionClassify.h : per-tile content classification of the mirrored frame.
+//
+// The frame is split into 64x64 tiles. Each frame, every tile is hashed to
+// tell whether it changed; a 32-frame change history and an edge density
+// (measured only when the tile changes) then label it as static (slides,
+// documents, text), occasionally changing, or video. The renderer uses the
+// labels to repaint only tiles that changed, with a sharp filter for
+// static/occasional content and a cheap one for video.
+// Portable: no Windows headers.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define REGION_TILE         64
+
+enum RegionClass {
+    REGION_STATIC,              // unchanged for most of the history window
+    REGION_OCCASIONAL,          // typing, scrolling, the odd animation
+    REGION_VIDEO,               // changes nearly every frame, few hard edges
+    REGION_CLASS_COUNT
+};
+
+struct RegionTile {
+    uint64_t hash;
+    uint32_t history;           // bit 0 = changed in the latest frame
+    uint16_t edgeDensity;       // per mille of sampled pixels on a hard edge
+    uint8_t  label;             // RegionClass
+    uint8_t  dirty;             // needs repainting this frame
+};
+
+struct RegionMap {
+    int width;
+    int height;
+    int tilesX;
+    int tilesY;
+    std::vector<RegionTile> tiles;
+    std::vector<uint64_t> rowHashes;    // scratch, one per tile column
+    uint32_t frames;            // updates since RegionInit
+    int counts[REGION_CLASS_COUNT];
+};
+
+// (Re)initializes for a frame of width x height; every tile starts dirty.
+void RegionInit(RegionMap* map, int width, int height);
+void RegionFree(RegionMap* map);
+
+// Hashes the 32bpp frame (stride in pixels), updates histories and labels
+// and sets each tile's dirty flag: it changed, or it stopped being video
+// and should be repainted with the sharp filter. Returns the number of
+// dirty tiles.
+int  RegionUpdate(RegionMap* map, const uint32_t* frame, int stride);
+
+// Same, with the tile hashes (RegionHashTile, row-major) already computed
+// for this frame, e.g. by a fused pixel pass. The frame is then only read
+// again for the edge density of tiles that changed.
+int  RegionUpdateHashed(RegionMap* map, const uint32_t* frame, int stride, const uint64_t* tileHashes);
+
+// Hash of one tile, the same value RegionUpdate stores for it, for callers
+// that need to tell changed tiles apart without a RegionMap.
+uint64_t RegionHashTile(const uint32_t* frame, int stride, int x0, int y0, int x1, int y1);
+
+inline const RegionTile* RegionAt(const RegionMap* map, int tx, int ty)
+{
+    return &map->tiles[(size_t)ty * map->tilesX + tx];
+}
@@ -0,0 +1,252 @@
+// ReplayRing.cpp : tile capture, RLE codec and eviction.
+
+#include "ReplayRing.h"
+
+#include <string.h>
+
+#define RLE_RUN_FLAG        0x8000u     // header: run of (n & 0x7FFF) + 1 copies of one pixel
+#define RLE_MAX_COUNT       0x8000      // pixels per header, either kind
+#define RLE_MIN_RUN         3           // shorter repeats are cheaper as literals
+
+void ReplayInit(ReplayRing* ring, int width, int height, size_t budgetBytes, uint64_t maxAgeMs)
+{
+    ReplayFree(ring);
+    ring->width  = width;
+    ring->height = height;
+    ring->tilesX = (width  + REGION_TILE - 1) / REGION_TILE;
+    ring->tilesY = (height + REGION_TILE - 1) / REGION_TILE;
+    ring->lastHashes.assign((size_t)ring->tilesX * ring->tilesY, 0);
+    ReplaySetLimits(ring, budgetBytes, maxAgeMs);
+}
+
+void ReplayFree(ReplayRing* ring)
+{
+    std::vector<uint64_t>().swap(ring->lastHashes);
+    std::deque<ReplayFrame>().swap(ring->frames);
+    std::vector<ReplayBlob>().swap(ring->blobs);
+    std::vector<uint32_t>().swap(ring->freeBlobs);
+    ring->width = ring->height = ring->tilesX = ring->tilesY = 0;
+    ring->primed = false;
+    ring->firstSeq = 0;
+    ring->bytes = 0;
+}
+
+void ReplaySetLimits(ReplayRing* ring, size_t budgetBytes, uint64_t maxAgeMs)
+{
+    ring->budgetBytes = budgetBytes;
+    ring->maxAgeMs = maxAgeMs;
+}
+
+int ReplayCapture(ReplayRing* ring, ReplayJob* job, const uint32_t* frame, int stride,
+                  const RegionMap* regions, uint64_t timeMs)
+{
+    if (ring->lastHashes.empty()) return 0;
+    bool useRegions = regions && regions->frames > 0 &&
+                      regions->width == ring->width && regions->height == ring->height;
+
+    job->timeMs = timeMs;
+    job->tiles.clear();
+    for (int ty = 0; ty < ring->tilesY; ty++) {
+        int y0 = ty * REGION_TILE;
+        int y1 = y0 + REGION_TILE < ring->height ? y0 + REGION_TILE : ring->height;
+        for (int tx = 0; tx < ring->tilesX; tx++) {
+            int x0 = tx * REGION_TILE;
+            int x1 = x0 + REGION_TILE < ring->width ? x0 + REGION_TILE : ring->width;
+            size_t i = (size_t)ty * ring->tilesX + tx;
+            uint64_t h = useRegions ? RegionAt(regions, tx, ty)->hash
+                                    : RegionHashTile(frame, stride, x0, y0, x1, y1);
+            if (ring->primed && h == ring->lastHashes[i]) continue;
+            ring->lastHashes[i] = h;
+
+            // Copy now; the frame buffer is overwritten by the next capture
+            job->tiles.push_back((uint32_t)i);
+            job->pixels.resize(job->tiles.size() * REPLAY_TILE_PIXELS);
+            uint32_t* dst = job->pixels.data() + (job->tiles.size() - 1) * REPLAY_TILE_PIXELS;
+            size_t rowBytes = (size_t)(x1 - x0) * sizeof(uint32_t);
+            for (int y = y0; y < y1; y++, dst += x1 - x0)
+                memcpy(dst, frame + (size_t)y * stride + x0, rowBytes);
+        }
+    }
+    ring->primed = true;
+    return (int)job->tiles.size();
+}
+
+// Stream of 16-bit headers, each followed by one pixel (run) or n pixels
+// (literals). Returns the encoded size.
+size_t ReplayEncodeTile(const uint32_t* pixels, int count, std::vector<uint8_t>* out)
+{
+    out->clear();
+    out->reserve((size_t)count * sizeof(uint32_t) / 4);
+
+    auto put16 = [out](uint32_t v) {
+        out->push_back((uint8_t)v);
+        out->push_back((uint8_t)(v >> 8));
+    };
+    auto putPixels = [out](const uint32_t* p, int n) {
+        size_t at = out->size();
+        out->resize(at + (size_t)n * sizeof(uint32_t));
+        memcpy(out->data() + at, p, (size_t)n * sizeof(uint32_t));
+    };
+
+    int i = 0, literalStart = 0;
+    while (i < count) {
+        int run = 1;
+        while (i + run < count && run < RLE_MAX_COUNT && pixels[i + run] == pixels[i]) run++;
+        if (run < RLE_MIN_RUN) { i += run; continue; }
+
+        for (int s = literalStart; s < i; s += RLE_MAX_COUNT) {
+            int n = i - s < RLE_MAX_COUNT ? i - s : RLE_MAX_COUNT;
+            put16((uint32_t)(n - 1));
+            putPixels(pixels + s, n);
+        }
+        put16(RLE_RUN_FLAG | (uint32_t)(run - 1));
+        putPixels(pixels + i, 1);
+        i += run;
+        literalStart = i;
+    }
+    for (int s = literalStart; s < count; s += RLE_MAX_COUNT) {
+        int n = count - s < RLE_MAX_COUNT ? count - s : RLE_MAX_COUNT;
+        put16((uint32_t)(n - 1));
+        putPixels(pixels + s, n);
+    }
+    return out->size();
+}
+
+bool ReplayDecodeTile(const uint8_t* data, size_t size, uint32_t* pixels, int count)
+{
+    size_t at = 0;
+    int filled = 0;
+    while (at + 2 <= size) {
+        uint32_t header = data[at] | ((uint32_t)data[at + 1] << 8);
+        at += 2;
+        int n = (int)(header & (RLE_RUN_FLAG - 1)) + 1;
+        if (filled + n > count) return false;
+        if (header & RLE_RUN_FLAG) {
+            if (at + sizeof(uint32_t) > size) return false;
+            uint32_t v;
+            memcpy(&v, data + at, sizeof(v));
+            at += sizeof(v);
+            for (int k = 0; k < n; k++) pixels[filled + k] = v;
+        } else {
+            size_t bytes = (size_t)n * sizeof(uint32_t);
+            if (at + bytes > size) return false;
+            memcpy(pixels + filled, data + at, bytes);
+            at += bytes;
+        }
+        filled += n;
+    }
+    return at == size && filled == count;
+}
+
+static void TileSize(const ReplayRing* ring, uint32_t index, int* x0, int* y0, int* w, int* h)
+{
+    *x0 = (int)(index % ring->tilesX) * REGION_TILE;
+    *y0 = (int)(index / ring->tilesX) * REGION_TILE;
+    *w = ring->width  - *x0 < REGION_TILE ? ring->width  - *x0 : REGION_TILE;
+    *h = ring->height - *y0 < REGION_TILE ? ring->height - *y0 : REGION_TILE;
+}
+
+static size_t FrameTableBytes(const ReplayRing* ring)
+{
+    return sizeof(ReplayFrame) + (size_t)ring->tilesX * ring->tilesY * sizeof(uint32_t);
+}
+
+static void ReleaseBlob(ReplayRing* ring, uint32_t id)
+{
+    ReplayBlob& b = ring->blobs[id];
+    if (--b.refs) return;
+    ring->bytes -= b.data.capacity();
+    std::vector<uint8_t>().swap(b.data);
+    ring->freeBlobs.push_back(id);
+}
+
+void ReplayCommit(ReplayRing* ring, const ReplayJob* job)
+{
+    if (ring->lastHashes.empty() || job->tiles.empty()) return;
+
+    ReplayFrame frame;
+    frame.timeMs = job->timeMs;
+    if (ring->frames.empty()) {
+        // The first job holds every tile (ReplayCapture is not primed yet)
+        frame.blobs.assign(ring->lastHashes.size(), 0);
+    } else {
+        frame.blobs = ring->frames.back().blobs;
+        for (uint32_t id : frame.blobs) ring->blobs[id].refs++;
+    }
+
+    for (size_t t = 0; t < job->tiles.size(); t++) {
+        uint32_t index = job->tiles[t];
+        int x0, y0, w, h;
+        TileSize(ring, index, &x0, &y0, &w, &h);
+        const uint32_t* pixels = job->pixels.data() + t * REPLAY_TILE_PIXELS;
+        int count = w * h;
+
+        uint32_t id;
+        if (!ring->freeBlobs.empty()) {
+            id = ring->freeBlobs.back();
+            ring->freeBlobs.pop_back();
+        } else {
+            id = (uint32_t)ring->blobs.size();
+            ring->blobs.emplace_back();
+        }
+        ReplayBlob& b = ring->blobs[id];
+        b.refs = 1;
+        b.raw = ReplayEncodeTile(pixels, count, &b.data) >= (size_t)count * sizeof(uint32_t);
+        if (b.raw) b.data.assign((const uint8_t*)pixels, (const uint8_t*)(pixels + count));
+        b.data.shrink_to_fit();
+        ring->bytes += b.data.capacity();
+
+        if (!ring->frames.empty()) ReleaseBlob(ring, frame.blobs[index]);
+        frame.blobs[index] = id;
+    }
+
+    ring->frames.push_back(std::move(frame));
+    ring->bytes += FrameTableBytes(ring);
+
+    while (ring->frames.size() > 1 &&
+           (ring->bytes > ring->budgetBytes ||
+            ring->frames.back().timeMs - ring->frames.front().timeMs > ring->maxAgeMs)) {
+        for (uint32_t id : ring->frames.front().blobs) ReleaseBlob(ring, id);
+        ring->frames.pop_front();
+        ring->bytes -= FrameTableBytes(ring);
+        ring->firstSeq++;
+    }
+}
+
+bool ReplayIsEmpty(const ReplayRing* ring)
+{
+    return ring->frames.empty();
+}
+
+uint32_t ReplayOldestSeq(const ReplayRing* ring)
+{
+    return ring->firstSeq;
+}
+
+uint32_t ReplayNewestSeq(const ReplayRing* ring)
+{
+    return ring->firstSeq + (uint32_t)ring->frames.size() - (ring->frames.empty() ? 0 : 1);
+}
+
+bool ReplayDecode(const ReplayRing* ring, uint32_t seq, uint32_t* out, int stride, uint64_t* timeMs)
+{
+    if (ring->frames.empty()) return false;
+    if ((int32_t)(seq - ReplayOldestSeq(ring)) < 0) seq = ReplayOldestSeq(ring);
+    if ((int32_t)(seq - ReplayNewestSeq(ring)) > 0) seq = ReplayNewestSeq(ring);
+    const ReplayFrame& frame = ring->frames[seq - ring->firstSeq];
+    if (timeMs) *timeMs = frame.timeMs;
+
+    uint32_t tile[REPLAY_TILE_PIXELS];
+    for (uint32_t index = 0; index < (uint32_t)frame.blobs.size(); index++) {
+        int x0, y0, w, h;
+        TileSize(ring, index, &x0, &y0, &w, &h);
+        const ReplayBlob& b = ring->blobs[frame.blobs[index]];
+        if (b.raw)
+            memcpy(tile, b.data.data(), b.data.size());
+        else if (!ReplayDecodeTile(b.data.data(), b.data.size(), tile, w * h))
+            memset(tile, 0, sizeof(tile));      // not produced by our own encoder
+        for (int y = 0; y < h; y++)
+            memcpy(out + (size_t)(y0 + y) * stride + x0, tile + (size_t)y * w, (size_t)w * sizeof(uint32_t));
+    }
+    return true;
+}
@@ -0,0 +1,88 @@
+// ReplayRing.h : bounded in-memory history of the projected image.
+//
+// The frame is kept as the same 64x64 tiles RegionClassify hashes. Each
+// stored frame is just a table of tile versions; a tile version is
+// RLE-compressed once, when it first appears, and shared (reference
+// counted) by every later frame in which that tile did not change. Memory
+// therefore grows only with actual change, and dropping the oldest frame
+// frees exactly the versions nothing newer uses. Old frames are evicted
+// once the byte budget or the age limit is exceeded.
+//
+// Capturing is split in two so the encoder can run on another thread:
+// ReplayCapture (hot path) only copies the tiles whose hash changed into a
+// job, ReplayCommit compresses the job into the ring. The caller
+// serializes ReplayCommit against ReplayDecode.
+// Portable: no Windows headers.
+
+#pragma once
+
+#include "RegionClassify.h"
+
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define REPLAY_TILE_PIXELS  (REGION_TILE * REGION_TILE)
+
+struct ReplayJob {
+    uint64_t timeMs;
+    std::vector<uint32_t> tiles;        // changed tile indices
+    std::vector<uint32_t> pixels;       // REPLAY_TILE_PIXELS per tile, rows packed
+};
+
+struct ReplayBlob {
+    std::vector<uint8_t> data;          // RLE stream, or raw pixels if that was smaller
+    uint32_t refs;
+    bool     raw;
+};
+
+struct ReplayFrame {
+    uint64_t timeMs;
+    std::vector<uint32_t> blobs;        // per tile, index into ReplayRing::blobs
+};
+
+struct ReplayRing {
+    int width, height;
+    int tilesX, tilesY;
+    size_t   budgetBytes;
+    uint64_t maxAgeMs;
+
+    // Capture side (hot path thread only)
+    std::vector<uint64_t> lastHashes;   // per tile, as of the last job
+    bool primed;                        // a full first job has been made
+
+    // Encoder side
+    std::deque<ReplayFrame> frames;     // oldest first
+    uint32_t firstSeq;                  // sequence number of frames.front()
+    std::vector<ReplayBlob> blobs;
+    std::vector<uint32_t>   freeBlobs;
+    size_t bytes;                       // blob data + frame tables
+};
+
+void ReplayInit(ReplayRing* ring, int width, int height, size_t budgetBytes, uint64_t maxAgeMs);
+void ReplayFree(ReplayRing* ring);
+void ReplaySetLimits(ReplayRing* ring, size_t budgetBytes, uint64_t maxAgeMs);
+
+// Fills job with the tiles that changed since the previous job and returns
+// their count (0: nothing to store, leave the job alone). Uses the hashes
+// in regions when it covers the same frame size, else hashes itself. Every
+// job this returns non-zero for must be committed, in order.
+int  ReplayCapture(ReplayRing* ring, ReplayJob* job, const uint32_t* frame, int stride,
+                   const RegionMap* regions, uint64_t timeMs);
+
+// Compresses the job into a new newest frame, then evicts old frames
+// (never the newest) until the budget and age limit hold.
+void ReplayCommit(ReplayRing* ring, const ReplayJob* job);
+
+bool     ReplayIsEmpty(const ReplayRing* ring);
+uint32_t ReplayOldestSeq(const ReplayRing* ring);
+uint32_t ReplayNewestSeq(const ReplayRing* ring);
+
+// Rebuilds frame seq (clamped to what is still stored) into a 32bpp
+// width x height image. Returns false if the ring is empty.
+bool ReplayDecode(const ReplayRing* ring, uint32_t seq, uint32_t* out, int stride, uint64_t* timeMs);
+
+// RLE codec for one tile, exposed for testing.
+size_t ReplayEncodeTile(const uint32_t* pixels, int count, std::vector<uint8_t>* out);
+bool   ReplayDecodeTile(const uint8_t* data, size_t size, uint32_t* pixels, int count);
@@ -12,13 +12,29 @@
 #define IDC_MYICON				2
 #define IDR_CONFIG              110
 
+// Version (shared by the VERSIONINFO resource and the code)
+#define APP_VER_MAJOR           0
+#define APP_VER_MINOR           1
+#define APP_VER_PATCH           2
+#define APP_VERSION_STR         "0.1.2"
+
 // Tray
 #define WM_TRAYICON             (WM_USER + 1)
 #define WM_CHECKMONITOR         (WM_USER + 2)
+#define WM_DEFERREDINIT         (WM_USER + 3)
+#define WM_UPDATECHECKED        (WM_USER + 4)
+#define WM_CONFIGCHANGED        (WM_USER + 5)
+#define WM_MIRRORTICK           (WM_USER + 6)
 #define IDM_TRAY_EXIT           200
 #define IDM_TRAY_STARTUP        201
 #define IDM_TRAY_ABOUT          202
 #define IDM_TRAY_UPDATE         203
+#define IDM_TRAY_DIAG           204
+#define IDM_TRAY_PAUSE          205
+#define IDM_TRAY_RESUME         206
+#define IDM_REEXTEND            207     // control pipe only, no menu item
+#define IDM_TRAY_ANNOTATE       208
+#define IDM_TRAY_SLIDES         209
 
 // Update dialog button IDs
 #define IDB_UPDATE_DOWNLOAD     1000
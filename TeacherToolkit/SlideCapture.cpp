@@ -0,0 +1,604 @@
+// SlideCapture.cpp : stable content detection, slide hashes, PNG and PDF output.
+
+#include "SlideCapture.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---- Stable content detection ----------------------------------------------
+
+void SlideDetectorReset(SlideDetector* d)
+{
+    d->width = d->height = 0;
+    d->tilesX = d->tilesY = 0;
+    d->hashes.clear();
+    d->taken.clear();
+    d->differ = 0;
+    d->quietSinceUs = -1;
+    d->primed = false;
+}
+
+bool SlideDetectorUpdate(SlideDetector* d, const uint32_t* frame, int stride, int width, int height,
+                         const RegionMap* regions, int64_t nowUs)
+{
+    if (width <= 0 || height <= 0) return false;
+    if (width != d->width || height != d->height) {
+        // A new resolution is new content everywhere
+        d->width = width;
+        d->height = height;
+        d->tilesX = (width + REGION_TILE - 1) / REGION_TILE;
+        d->tilesY = (height + REGION_TILE - 1) / REGION_TILE;
+        d->hashes.assign((size_t)d->tilesX * d->tilesY, 0);
+        d->taken.clear();
+        d->differ = 0;
+        d->quietSinceUs = -1;
+        d->primed = false;
+    }
+
+    bool useRegions = regions && regions->width == width && regions->height == height;
+    int changed = 0;
+    for (int ty = 0; ty < d->tilesY; ty++) {
+        int y0 = ty * REGION_TILE, y1 = y0 + REGION_TILE < height ? y0 + REGION_TILE : height;
+        for (int tx = 0; tx < d->tilesX; tx++) {
+            size_t i = (size_t)ty * d->tilesX + tx;
+            if (useRegions) {
+                const RegionTile* t = &regions->tiles[i];
+                changed += (t->history & 1) != 0;
+                d->hashes[i] = t->hash;
+            } else {
+                int x0 = tx * REGION_TILE, x1 = x0 + REGION_TILE < width ? x0 + REGION_TILE : width;
+                uint64_t h = RegionHashTile(frame, stride, x0, y0, x1, y1);
+                changed += !d->primed || h != d->hashes[i];
+                d->hashes[i] = h;
+            }
+        }
+    }
+    d->primed = true;
+
+    // Small changes still count as still, unless they keep spreading (the
+    // first frames of a transition, or a slide being drawn)
+    int tiles = d->tilesX * d->tilesY;
+    int differ = tiles;
+    if (!d->taken.empty()) {
+        differ = 0;
+        for (int i = 0; i < tiles; i++) differ += d->hashes[i] != d->taken[i];
+    }
+    int quietMax = tiles * SLIDE_QUIET_PCT / 100;
+    bool moving = changed > (quietMax > SLIDE_QUIET_TILES ? quietMax : SLIDE_QUIET_TILES);
+    if (moving || differ > d->differ) d->quietSinceUs = -1;
+    d->differ = differ;
+    if (moving) return false;
+    if (d->quietSinceUs < 0) d->quietSinceUs = nowUs;
+
+    int minChange = tiles * SLIDE_MIN_CHANGE_PCT / 100;
+    return nowUs - d->quietSinceUs >= SLIDE_STABLE_US && differ >= (minChange > 1 ? minChange : 1);
+}
+
+void SlideDetectorTake(SlideDetector* d)
+{
+    d->taken = d->hashes;
+    d->differ = 0;
+}
+
+// ---- Fingerprints and the index --------------------------------------------
+
+#define THUMB_CELLS     (SLIDE_THUMB_W * SLIDE_THUMB_H)
+
+void SlideFingerprintFrame(const uint32_t* frame, int stride, int width, int height, SlideFingerprint* out)
+{
+    memset(out, 0, sizeof(*out));
+    if (width <= 0 || height <= 0) return;
+
+    std::vector<uint64_t> sum(THUMB_CELLS, 0);
+    std::vector<uint32_t> count(THUMB_CELLS, 0);
+    std::vector<uint16_t> cellOf((size_t)width);
+    for (int x = 0; x < width; x++) cellOf[x] = (uint16_t)((int64_t)x * SLIDE_THUMB_W / width);
+    for (int y = 0; y < height; y++) {
+        size_t rowCell = (size_t)((int64_t)y * SLIDE_THUMB_H / height) * SLIDE_THUMB_W;
+        const uint32_t* row = frame + (size_t)y * stride;
+        for (int x = 0; x < width; x++) {
+            uint32_t c = row[x];
+            sum[rowCell + cellOf[x]] += (((c >> 16) & 0xFF) * 77 + ((c >> 8) & 0xFF) * 150 + (c & 0xFF) * 29) >> 8;
+            count[rowCell + cellOf[x]]++;
+        }
+    }
+    uint32_t histogram[256] = {};
+    for (int i = 0; i < THUMB_CELLS; i++) {
+        out->thumb[i] = (uint8_t)(count[i] ? sum[i] / count[i] : 0);
+        histogram[out->thumb[i]]++;
+    }
+    for (int v = 1; v < 256; v++)
+        if (histogram[v] > histogram[out->background]) out->background = (uint8_t)v;
+
+    // The hash cells are groups of thumbnail cells
+    const int G = SLIDE_HASH_GRID;
+    uint32_t hsum[G][G + 1] = {}, hcount[G][G + 1] = {};
+    for (int y = 0; y < SLIDE_THUMB_H; y++)
+        for (int x = 0; x < SLIDE_THUMB_W; x++) {
+            int cy = y * G / SLIDE_THUMB_H, cx = x * (G + 1) / SLIDE_THUMB_W;
+            hsum[cy][cx] += out->thumb[y * SLIDE_THUMB_W + x];
+            hcount[cy][cx]++;
+        }
+    for (int cy = 0; cy < G; cy++)
+        for (int cx = 0; cx < G; cx++) {
+            // Means compared without dividing: a/na > b/nb
+            if ((uint64_t)hsum[cy][cx] * hcount[cy][cx + 1] > (uint64_t)hsum[cy][cx + 1] * hcount[cy][cx]) {
+                int bit = cy * G + cx;
+                out->hash[bit >> 6] |= 1ull << (bit & 63);
+            }
+        }
+}
+
+int SlideHashDistance(const SlideFingerprint* a, const SlideFingerprint* b)
+{
+    int bits = 0;
+    for (size_t i = 0; i < sizeof(a->hash) / sizeof(a->hash[0]); i++) {
+        uint64_t v = a->hash[i] ^ b->hash[i];
+        while (v) {
+            v &= v - 1;
+            bits++;
+        }
+    }
+    return bits;
+}
+
+// Thumbnail cells that differ between an older and a newer fingerprint,
+// and how many of those were background in the older one
+static int ThumbDiff(const SlideFingerprint* older, const SlideFingerprint* newer, int* wasBackground)
+{
+    int differ = 0, background = 0;
+    for (int i = 0; i < THUMB_CELLS; i++) {
+        if (abs(older->thumb[i] - newer->thumb[i]) <= SLIDE_CELL_DIFF) continue;
+        differ++;
+        background += abs(older->thumb[i] - older->background) <= SLIDE_CELL_DIFF / 2;
+    }
+    if (wasBackground) *wasBackground = background;
+    return differ;
+}
+
+int SlideIndexFind(const SlideIndex* index, const SlideFingerprint* fp)
+{
+    int best = -1, bestDiff = THUMB_CELLS * SLIDE_SAME_PERMILLE / 1000 + 1;
+    for (size_t i = 0; i < index->slides.size(); i++) {
+        if (SlideHashDistance(&index->slides[i], fp) > SLIDE_NEAR_BITS) continue;
+        int diff = ThumbDiff(&index->slides[i], fp, nullptr);
+        if (diff < bestDiff) {
+            best = (int)i;
+            bestDiff = diff;
+        }
+    }
+    return best;
+}
+
+SlideVerdict SlideIndexAdd(SlideIndex* index, const SlideFingerprint* fp, int* slideNo)
+{
+    int n = (int)index->slides.size();
+    if (n) {
+        // Additions to what is on the latest slide: keep the fuller version
+        int wasBackground;
+        int diff = ThumbDiff(&index->slides[n - 1], fp, &wasBackground);
+        if (diff && wasBackground * 100 >= diff * SLIDE_ADDED_PCT) {
+            index->slides[n - 1] = *fp;
+            *slideNo = n;
+            return SLIDE_UPDATE;
+        }
+    }
+    int seen = SlideIndexFind(index, fp);
+    if (seen >= 0 || n >= SLIDE_MAX) {
+        *slideNo = seen + 1;
+        return SLIDE_SEEN;
+    }
+    index->slides.push_back(*fp);
+    *slideNo = n + 1;
+    return SLIDE_NEW;
+}
+
+// ---- PNG -------------------------------------------------------------------
+
+#define PNG_IDAT_BYTES      65536       // compressed bytes per IDAT chunk
+#define LZ_WINDOW           32768
+#define LZ_HASH_BITS        15
+#define LZ_CHAIN            16          // candidates tried per position
+#define LZ_MIN_MATCH        3
+#define LZ_MAX_MATCH        258
+
+static const uint32_t* CrcTable()
+{
+    static struct Table {
+        uint32_t v[256];
+        Table()
+        {
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                v[n] = c;
+            }
+        }
+    } table;
+    return table.v;
+}
+
+static uint32_t Crc32(uint32_t crc, const uint8_t* p, size_t n)
+{
+    const uint32_t* t = CrcTable();
+    crc = ~crc;
+    while (n--) crc = t[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void PutBE32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t GetBE32(const uint8_t* p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static bool WriteChunk(SlideWriteFn write, void* ctx, const char* type, const uint8_t* data, uint32_t bytes)
+{
+    uint8_t head[8], tail[4];
+    PutBE32(head, bytes);
+    memcpy(head + 4, type, 4);
+    PutBE32(tail, Crc32(Crc32(0, head + 4, 4), data, bytes));
+    return write(ctx, head, 8) && (bytes == 0 || write(ctx, data, bytes)) && write(ctx, tail, 4);
+}
+
+// zlib stream of fixed Huffman deflate blocks, handed out as IDAT chunks
+struct PngDeflate {
+    SlideWriteFn write;
+    void*    ctx;
+    bool     ok;
+    std::vector<uint8_t> out;       // compressed, not yet in a chunk
+    uint64_t bitBuf;
+    int      bitCount;
+    uint32_t adlerA, adlerB;
+
+    std::vector<uint8_t> data;      // window plus input not yet compressed
+    uint32_t base;                  // stream position of data[0]
+    uint32_t pos;                   // stream position of the next byte to compress
+    std::vector<uint32_t> head;     // per hash, latest position + 1 (0 = none)
+    std::vector<uint32_t> prev;     // per position mod LZ_WINDOW, previous with the same hash + 1
+
+    uint16_t litCode[288];          // bit-reversed fixed codes
+    uint8_t  litBits[288];
+};
+
+static const uint16_t kLenBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                       35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t  kLenExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t kDistBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                        8193, 12289, 16385, 24577 };
+static const uint8_t  kDistExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                         7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static uint32_t Reverse(uint32_t code, int bits)
+{
+    uint32_t r = 0;
+    for (int i = 0; i < bits; i++, code >>= 1) r = (r << 1) | (code & 1);
+    return r;
+}
+
+static void DeflateFlushOut(PngDeflate* z, bool all)
+{
+    while (z->ok && (z->out.size() >= PNG_IDAT_BYTES || (all && !z->out.empty()))) {
+        uint32_t n = z->out.size() < PNG_IDAT_BYTES ? (uint32_t)z->out.size() : PNG_IDAT_BYTES;
+        z->ok = WriteChunk(z->write, z->ctx, "IDAT", z->out.data(), n);
+        z->out.erase(z->out.begin(), z->out.begin() + n);
+    }
+}
+
+static inline void PutBits(PngDeflate* z, uint32_t value, int bits)
+{
+    z->bitBuf |= (uint64_t)value << z->bitCount;
+    z->bitCount += bits;
+    while (z->bitCount >= 8) {
+        z->out.push_back((uint8_t)z->bitBuf);
+        z->bitBuf >>= 8;
+        z->bitCount -= 8;
+    }
+}
+
+static void DeflateInit(PngDeflate* z, SlideWriteFn write, void* ctx)
+{
+    z->write = write;
+    z->ctx = ctx;
+    z->ok = true;
+    z->out.clear();
+    z->bitBuf = 0;
+    z->bitCount = 0;
+    z->adlerA = 1;
+    z->adlerB = 0;
+    z->data.clear();
+    z->base = z->pos = 0;
+    z->head.assign((size_t)1 << LZ_HASH_BITS, 0);
+    z->prev.assign(LZ_WINDOW, 0);
+    for (int s = 0; s < 288; s++) {
+        int bits = s < 144 ? 8 : s < 256 ? 9 : s < 280 ? 7 : 8;
+        uint32_t code = s < 144 ? 0x30 + s : s < 256 ? 0x190 + (s - 144) : s < 280 ? s - 256 : 0xC0 + (s - 280);
+        z->litCode[s] = (uint16_t)Reverse(code, bits);
+        z->litBits[s] = (uint8_t)bits;
+    }
+
+    z->out.push_back(0x78);         // zlib: deflate, 32K window
+    z->out.push_back(0x01);
+    PutBits(z, 1, 1);               // one final block
+    PutBits(z, 1, 2);               // fixed Huffman
+}
+
+static inline uint32_t Hash3(const uint8_t* p)
+{
+    return (((uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]) * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static void PutSymbol(PngDeflate* z, int s)
+{
+    PutBits(z, z->litCode[s], z->litBits[s]);
+}
+
+static void PutMatch(PngDeflate* z, int len, int dist)
+{
+    int l = 28;
+    while (kLenBase[l] > len) l--;
+    PutSymbol(z, 257 + l);
+    if (kLenExtra[l]) PutBits(z, len - kLenBase[l], kLenExtra[l]);
+    int d = 29;
+    while (kDistBase[d] > dist) d--;
+    PutBits(z, Reverse(d, 5), 5);
+    if (kDistExtra[d]) PutBits(z, dist - kDistBase[d], kDistExtra[d]);
+}
+
+// Compresses what is buffered, keeping LZ_MAX_MATCH bytes of lookahead
+// unless this is the end of the stream
+static void DeflateRun(PngDeflate* z, bool final)
+{
+    uint32_t end = z->base + (uint32_t)z->data.size();
+    uint32_t stop = final ? end : (end > LZ_MAX_MATCH ? end - LZ_MAX_MATCH : 0);
+    const uint8_t* d = z->data.data();
+    uint32_t b = z->base;           // stream position of d[0]
+    while (z->pos < stop) {
+        uint32_t p = z->pos;
+        int bestLen = 0;
+        uint32_t bestDist = 0;
+        if (end - p >= LZ_MIN_MATCH) {
+            uint32_t h = Hash3(d + (p - b));
+            uint32_t maxLen = end - p < LZ_MAX_MATCH ? end - p : LZ_MAX_MATCH;
+            uint32_t cand = z->head[h];
+            for (int chain = 0; cand && chain < LZ_CHAIN; chain++) {
+                uint32_t c = cand - 1;
+                if (p - c > LZ_WINDOW - 1 || c < b) break;
+                const uint8_t* q = d + (c - b);
+                const uint8_t* s = d + (p - b);
+                if (q[bestLen] == s[bestLen]) {
+                    uint32_t len = 0;
+                    while (len < maxLen && q[len] == s[len]) len++;
+                    if ((int)len > bestLen) {
+                        bestLen = (int)len;
+                        bestDist = p - c;
+                        if (len == maxLen) break;
+                    }
+                }
+                cand = z->prev[c % LZ_WINDOW];
+            }
+        }
+
+        uint32_t advance = bestLen >= LZ_MIN_MATCH ? (uint32_t)bestLen : 1;
+        if (advance > 1) PutMatch(z, bestLen, (int)bestDist);
+        else             PutSymbol(z, d[p - b]);
+        for (uint32_t i = 0; i < advance; i++, p++) {
+            if (end - p < LZ_MIN_MATCH) continue;
+            uint32_t h = Hash3(d + (p - b));
+            z->prev[p % LZ_WINDOW] = z->head[h];
+            z->head[h] = p + 1;
+        }
+        z->pos = p;
+        if (z->out.size() >= PNG_IDAT_BYTES) DeflateFlushOut(z, false);
+    }
+
+    // Keep one window behind the next position
+    uint32_t keep = z->pos > LZ_WINDOW ? z->pos - LZ_WINDOW : 0;
+    if (keep > z->base + LZ_WINDOW) {
+        z->data.erase(z->data.begin(), z->data.begin() + (keep - z->base));
+        z->base = keep;
+    }
+}
+
+static void DeflateAdd(PngDeflate* z, const uint8_t* p, size_t n)
+{
+    // Adler-32 of the uncompressed stream, reduced before it can overflow
+    for (size_t i = 0; i < n; ) {
+        size_t run = n - i < 5552 ? n - i : 5552;
+        for (size_t k = 0; k < run; k++) {
+            z->adlerA += p[i + k];
+            z->adlerB += z->adlerA;
+        }
+        z->adlerA %= 65521;
+        z->adlerB %= 65521;
+        i += run;
+    }
+    z->data.insert(z->data.end(), p, p + n);
+    DeflateRun(z, false);
+}
+
+static bool DeflateFinish(PngDeflate* z)
+{
+    DeflateRun(z, true);
+    PutSymbol(z, 256);
+    if (z->bitCount) PutBits(z, 0, 8 - z->bitCount);
+    uint8_t adler[4];
+    PutBE32(adler, z->adlerB << 16 | z->adlerA);
+    z->out.insert(z->out.end(), adler, adler + 4);
+    DeflateFlushOut(z, true);
+    return z->ok;
+}
+
+bool SlideEncodePng(const uint32_t* frame, int stride, int width, int height,
+                    SlideWriteFn write, void* ctx)
+{
+    if (width <= 0 || height <= 0) return false;
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    uint8_t ihdr[13];
+    PutBE32(ihdr, (uint32_t)width);
+    PutBE32(ihdr + 4, (uint32_t)height);
+    ihdr[8] = 8;                    // bits per sample
+    ihdr[9] = 2;                    // RGB
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+    if (!write(ctx, signature, 8) || !WriteChunk(write, ctx, "IHDR", ihdr, 13)) return false;
+
+    PngDeflate z;
+    DeflateInit(&z, write, ctx);
+    size_t rowBytes = (size_t)width * 3;
+    std::vector<uint8_t> raw(rowBytes), above(rowBytes, 0), filtered[3];
+    for (auto& f : filtered) f.resize(rowBytes + 1);
+    for (int y = 0; y < height && z.ok; y++) {
+        const uint32_t* src = frame + (size_t)y * stride;
+        for (int x = 0; x < width; x++) {
+            raw[x * 3]     = (uint8_t)(src[x] >> 16);
+            raw[x * 3 + 1] = (uint8_t)(src[x] >> 8);
+            raw[x * 3 + 2] = (uint8_t)src[x];
+        }
+
+        // Smallest sum of absolute (signed) residuals, the usual heuristic
+        uint64_t cost[3] = {};
+        for (int f = 0; f < 3; f++) {
+            uint8_t* out = filtered[f].data();
+            out[0] = (uint8_t)f;
+            for (size_t i = 0; i < rowBytes; i++) {
+                uint8_t pred = f == 0 ? 0 : f == 1 ? (i >= 3 ? raw[i - 3] : 0) : above[i];
+                uint8_t v = (uint8_t)(raw[i] - pred);
+                out[i + 1] = v;
+                cost[f] += v < 128 ? v : 256 - v;
+            }
+        }
+        int best = cost[1] < cost[0] ? 1 : 0;
+        if (cost[2] < cost[best]) best = 2;
+        DeflateAdd(&z, filtered[best].data(), rowBytes + 1);
+        raw.swap(above);
+    }
+    return DeflateFinish(&z) && WriteChunk(write, ctx, "IEND", nullptr, 0);
+}
+
+// ---- PDF -------------------------------------------------------------------
+
+static bool PdfWrite(SlidePdf* pdf, const void* data, size_t bytes)
+{
+    if (pdf->ok && bytes) pdf->ok = pdf->write(pdf->ctx, data, bytes);
+    pdf->offset += bytes;
+    return pdf->ok;
+}
+
+static bool PdfPrintf(SlidePdf* pdf, const char* fmt, ...)
+{
+    char buf[512];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (n < 0 || n >= (int)sizeof(buf)) return pdf->ok = false;
+    return PdfWrite(pdf, buf, (size_t)n);
+}
+
+// Starts object number id (1-based) at the current offset
+static void PdfObject(SlidePdf* pdf, int id)
+{
+    if (pdf->objects.size() < (size_t)id) pdf->objects.resize(id, 0);
+    pdf->objects[id - 1] = pdf->offset;
+    PdfPrintf(pdf, "%d 0 obj\n", id);
+}
+
+// Objects: 1 catalog, 2 page tree (written last), then page, content
+// stream and image for each slide
+#define PDF_PAGE_OBJ(i)     (3 + 3 * (i))
+
+void SlidePdfBegin(SlidePdf* pdf, SlideWriteFn write, void* ctx)
+{
+    pdf->write = write;
+    pdf->ctx = ctx;
+    pdf->offset = 0;
+    pdf->objects.clear();
+    pdf->pages = 0;
+    pdf->ok = true;
+    PdfPrintf(pdf, "%%PDF-1.4\n%%\xE2\xE3\xCF\xD3\n");
+    PdfObject(pdf, 1);
+    PdfPrintf(pdf, "<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+}
+
+bool SlidePdfAddPng(SlidePdf* pdf, const uint8_t* png, size_t bytes)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (!pdf->ok || bytes < 8 || memcmp(png, signature, 8) != 0) return false;
+
+    // First pass: header and total image data
+    uint32_t width = 0, height = 0;
+    uint64_t dataBytes = 0;
+    bool header = false;
+    for (size_t at = 8; at + 12 <= bytes; ) {
+        uint32_t len = GetBE32(png + at);
+        if (len > bytes - at - 12) return false;
+        const uint8_t* type = png + at + 4;
+        const uint8_t* body = png + at + 8;
+        if (memcmp(type, "IHDR", 4) == 0) {
+            if (len != 13 || body[8] != 8 || body[9] != 2 || body[12] != 0) return false;
+            width = GetBE32(body);
+            height = GetBE32(body + 4);
+            header = true;
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            dataBytes += len;
+        }
+        at += 12 + (size_t)len;
+    }
+    if (!header || !width || !height || !dataBytes) return false;
+
+    int page = PDF_PAGE_OBJ(pdf->pages);
+    uint32_t pageH = (uint32_t)((uint64_t)SLIDE_PDF_WIDTH * height / width);
+    if (pageH < 1) pageH = 1;
+
+    PdfObject(pdf, page);
+    PdfPrintf(pdf, "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %d %u] /Resources << /XObject << /Im0 %d 0 R >> >> "
+                   "/Contents %d 0 R >>\nendobj\n", SLIDE_PDF_WIDTH, pageH, page + 2, page + 1);
+
+    char content[96];
+    int contentLen = snprintf(content, sizeof(content), "q %d 0 0 %u 0 0 cm /Im0 Do Q\n", SLIDE_PDF_WIDTH, pageH);
+    PdfObject(pdf, page + 1);
+    PdfPrintf(pdf, "<< /Length %d >>\nstream\n", contentLen);
+    PdfWrite(pdf, content, (size_t)contentLen);
+    PdfPrintf(pdf, "endstream\nendobj\n");
+
+    PdfObject(pdf, page + 2);
+    PdfPrintf(pdf, "<< /Type /XObject /Subtype /Image /Width %u /Height %u /ColorSpace /DeviceRGB "
+                   "/BitsPerComponent 8 /Filter /FlateDecode "
+                   "/DecodeParms << /Predictor 15 /Colors 3 /BitsPerComponent 8 /Columns %u >> "
+                   "/Length %llu >>\nstream\n", width, height, width, (unsigned long long)dataBytes);
+    for (size_t at = 8; at + 12 <= bytes; ) {
+        uint32_t len = GetBE32(png + at);
+        if (memcmp(png + at + 4, "IDAT", 4) == 0) PdfWrite(pdf, png + at + 8, len);
+        at += 12 + (size_t)len;
+    }
+    PdfPrintf(pdf, "\nendstream\nendobj\n");
+    pdf->pages++;
+    return pdf->ok;
+}
+
+bool SlidePdfEnd(SlidePdf* pdf)
+{
+    PdfObject(pdf, 2);
+    PdfPrintf(pdf, "<< /Type /Pages /Count %d /Kids [", pdf->pages);
+    for (int i = 0; i < pdf->pages; i++) PdfPrintf(pdf, "%s%d 0 R", i ? " " : "", PDF_PAGE_OBJ(i));
+    PdfPrintf(pdf, "] >>\nendobj\n");
+
+    uint64_t xref = pdf->offset;
+    PdfPrintf(pdf, "xref\n0 %d\n0000000000 65535 f \n", (int)pdf->objects.size() + 1);
+    for (uint64_t at : pdf->objects) PdfPrintf(pdf, "%010llu 00000 n \n", (unsigned long long)at);
+    PdfPrintf(pdf, "trailer\n<< /Size %d /Root 1 0 R >>\nstartxref\n%llu\n%%%%EOF\n",
+              (int)pdf->objects.size() + 1, (unsigned long long)xref);
+    return pdf->ok;
+}
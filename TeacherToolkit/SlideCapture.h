@@ -0,0 +1,131 @@
+// SlideCapture.h : handouts of what was shown, one image per distinct slide.
+//
+// While slide capture is on, every mirrored frame goes through a detector
+// that watches the 64x64 tile hashes. When the screen has stayed still for
+// SLIDE_STABLE_US and differs from the last candidate in at least
+// SLIDE_MIN_CHANGE_PCT of its tiles, the frame is a new candidate: the
+// teacher moved to a new slide, page or board and left it up. A clock or
+// a blinking caret (up to SLIDE_QUIET_PCT of the tiles, or
+// SLIDE_QUIET_TILES, per frame) does not count as movement, as long as it
+// does not keep spreading to more tiles; video never settles and is never
+// taken.
+//
+// Each candidate is fingerprinted: a 16x16 difference hash (256 bits) for
+// the index and a 64x36 luma thumbnail to confirm a match, since slides
+// on one template can hash alike. A candidate matching a slide already
+// kept (going back, or a redraw that changed nothing visible) is dropped.
+// One that only adds to the latest slide, with nearly all its changes on
+// what was background, replaces it: a bullet point appearing or more ink
+// on the whiteboard keeps the fuller version. Only fingerprints stay in
+// memory (about 2.3 KB a slide); slides are encoded to PNG as they are
+// accepted, and the PNGs can be bound into one PDF at the end. The
+// encoders write through a callback, so the caller decides where the
+// bytes go. Portable: no Windows headers.
+
+#pragma once
+
+#include "RegionClassify.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define SLIDE_STABLE_US         1500000
+#define SLIDE_MIN_CHANGE_PCT    3
+#define SLIDE_QUIET_PCT         1
+#define SLIDE_QUIET_TILES       4
+#define SLIDE_HASH_GRID         16          // SLIDE_HASH_GRID^2 bits
+#define SLIDE_NEAR_BITS         48          // hash distance worth comparing thumbnails
+#define SLIDE_THUMB_W           64
+#define SLIDE_THUMB_H           36
+#define SLIDE_CELL_DIFF         12          // luma difference that makes a thumbnail cell differ
+#define SLIDE_SAME_PERMILLE     8           // differing cells at or below this: the same slide
+#define SLIDE_ADDED_PCT         90          // differing cells that were background: content was added
+#define SLIDE_MAX               500
+
+// ---- Stable content detection ----------------------------------------------
+
+struct SlideDetector {
+    int      width, height;
+    int      tilesX, tilesY;
+    std::vector<uint64_t> hashes;   // tile hashes of the latest frame
+    std::vector<uint64_t> taken;    // of the last candidate taken; empty before the first
+    int      differ;                // tiles that differ from taken, as of the latest frame
+    int64_t  quietSinceUs;          // first frame of the current still stretch, -1 while moving
+    bool     primed;                // hashes hold the previous frame
+};
+
+void SlideDetectorReset(SlideDetector* d);
+
+// Feeds one 32bpp frame (stride in pixels). Uses the tile changes in
+// regions when it covers the same frame size, else hashes the frame
+// itself. True while the frame is a candidate that was not taken yet.
+bool SlideDetectorUpdate(SlideDetector* d, const uint32_t* frame, int stride, int width, int height,
+                         const RegionMap* regions, int64_t nowUs);
+
+// The candidate was dealt with (kept, or found to be a copy); the next one
+// has to differ from it. Until this is called the same candidate is
+// offered again, e.g. while the encoder is still busy.
+void SlideDetectorTake(SlideDetector* d);
+
+// ---- Perceptual hash index -------------------------------------------------
+
+struct SlideFingerprint {
+    uint64_t hash[SLIDE_HASH_GRID * SLIDE_HASH_GRID / 64];
+    uint8_t  thumb[SLIDE_THUMB_W * SLIDE_THUMB_H];     // mean luma per cell
+    uint8_t  background;                                // most common thumb value
+};
+
+// One pass over the frame: the thumbnail, and from it the difference hash
+// ((GRID+1) x GRID cells, one bit per pair of horizontal neighbours, set
+// when the left one is brighter).
+void SlideFingerprintFrame(const uint32_t* frame, int stride, int width, int height, SlideFingerprint* out);
+int  SlideHashDistance(const SlideFingerprint* a, const SlideFingerprint* b);
+
+struct SlideIndex {
+    std::vector<SlideFingerprint> slides;   // slide i+1 is slides[i]
+};
+
+// An earlier slide with the same content (the latest included), or -1
+int SlideIndexFind(const SlideIndex* index, const SlideFingerprint* fp);
+
+enum SlideVerdict {
+    SLIDE_NEW,                  // append as a new slide
+    SLIDE_UPDATE,               // replaces the latest slide
+    SLIDE_SEEN,                 // same as a slide already kept; nothing to do
+};
+
+// Decides what to do with a candidate and records its fingerprint
+// (*slideNo: 1-based slide it became or matched). SLIDE_NEW is refused, as
+// SLIDE_SEEN with *slideNo = 0, once SLIDE_MAX slides are kept.
+SlideVerdict SlideIndexAdd(SlideIndex* index, const SlideFingerprint* fp, int* slideNo);
+
+// ---- Export ----------------------------------------------------------------
+
+typedef bool (*SlideWriteFn)(void* ctx, const void* data, size_t bytes);
+
+// 8-bit RGB PNG of a 32bpp BGRX frame. Rows are filtered (none, sub or up,
+// whichever looks smaller) and deflated with fixed Huffman codes: screen
+// content is mostly runs and repeats, which LZ77 alone takes care of.
+bool SlideEncodePng(const uint32_t* frame, int stride, int width, int height,
+                    SlideWriteFn write, void* ctx);
+
+// A PDF with one page per slide. Each page takes the image data of a PNG
+// written by SlideEncodePng as it is (PDF reads PNG-predicted Flate
+// streams), so nothing is decoded or compressed again. Pages are
+// SLIDE_PDF_WIDTH points wide and as tall as the slide's aspect asks.
+#define SLIDE_PDF_WIDTH         842         // A4 landscape
+
+struct SlidePdf {
+    SlideWriteFn write;
+    void*    ctx;
+    uint64_t offset;
+    std::vector<uint64_t> objects;  // byte offset of object i+1
+    int      pages;
+    bool     ok;
+};
+
+void SlidePdfBegin(SlidePdf* pdf, SlideWriteFn write, void* ctx);
+// False if png is not an 8-bit RGB, non-interlaced PNG (or writing failed)
+bool SlidePdfAddPng(SlidePdf* pdf, const uint8_t* png, size_t bytes);
+bool SlidePdfEnd(SlidePdf* pdf);
@@ -0,0 +1,350 @@
+// Soak.cpp : process sampling, trend checks, synthetic content and script.
+
+#include "Soak.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <dirent.h>
+#endif
+
+const SoakSize SOAK_SIZES[] = {
+    { 1920, 1080 }, { 1366, 768 }, { 1280, 1024 }, { 3840, 2160 }, { 1024, 768 }, { 2560, 1440 },
+};
+const int SOAK_SIZE_COUNT = (int)(sizeof(SOAK_SIZES) / sizeof(SOAK_SIZES[0]));
+
+bool SoakReadProcess(SoakSample* sample)
+{
+#ifdef _WIN32
+    HANDLE self = GetCurrentProcess();
+    sample->gdiObjects  = GetGuiResources(self, GR_GDIOBJECTS);
+    sample->userObjects = GetGuiResources(self, GR_USEROBJECTS);
+    DWORD handles = 0;
+    GetProcessHandleCount(self, &handles);
+    sample->handles = handles;
+    PROCESS_MEMORY_COUNTERS_EX pmc = {};
+    pmc.cb = sizeof(pmc);
+    if (!GetProcessMemoryInfo(self, (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) return false;
+    sample->privateBytes = pmc.PrivateUsage;
+    return true;
+#else
+    sample->gdiObjects = sample->userObjects = 0;
+
+    // Anonymous resident memory is the closest to Windows private bytes
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (!fp) return false;
+    char line[256];
+    bool found = false;
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long long kb;
+        if (sscanf(line, "RssAnon: %llu kB", &kb) == 1) {
+            sample->privateBytes = (uint64_t)kb * 1024;
+            found = true;
+            break;
+        }
+    }
+    fclose(fp);
+
+    DIR* dir = opendir("/proc/self/fd");
+    if (!dir) return false;
+    uint32_t fds = 0;
+    while (struct dirent* e = readdir(dir))
+        if (e->d_name[0] != '.') fds++;
+    closedir(dir);
+    sample->handles = fds ? fds - 1 : 0;    // not counting the one reading the directory
+    return found;
+#endif
+}
+
+// ---- Frame times -----------------------------------------------------------
+
+void SoakFrameTime(SoakFrameTimes* times, double ms)
+{
+    times->ms.push_back((float)ms);
+}
+
+static float Percentile(const std::vector<float>& sorted, double q)
+{
+    return sorted[(size_t)(q * (double)(sorted.size() - 1) + 0.5)];
+}
+
+void SoakFrameSummary(SoakFrameTimes* times, SoakSample* sample)
+{
+    sample->frames = (uint32_t)times->ms.size();
+    if (times->ms.empty()) {
+        sample->p50Ms = sample->p95Ms = sample->p99Ms = sample->maxMs = 0.0f;
+        return;
+    }
+    std::sort(times->ms.begin(), times->ms.end());
+    sample->p50Ms = Percentile(times->ms, 0.50);
+    sample->p95Ms = Percentile(times->ms, 0.95);
+    sample->p99Ms = Percentile(times->ms, 0.99);
+    sample->maxMs = times->ms.back();
+    times->ms.clear();
+}
+
+// ---- Trend checks ----------------------------------------------------------
+
+#define SOAK_MIN_SAMPLES    8
+
+void SoakDefaultLimits(SoakLimits* limits)
+{
+    memset(limits, 0, sizeof(*limits));
+    limits->warmupFraction = 0.2;
+    limits->maxPerHour[SOAK_GDI]     = 10;
+    limits->minGrowth[SOAK_GDI]      = 20;
+    limits->maxPerHour[SOAK_USER]    = 10;
+    limits->minGrowth[SOAK_USER]     = 20;
+    limits->maxPerHour[SOAK_HANDLES] = 30;
+    limits->minGrowth[SOAK_HANDLES]  = 50;
+    limits->maxPerHour[SOAK_PRIVATE] = 4.0 * 1024 * 1024;
+    limits->minGrowth[SOAK_PRIVATE]  = 8.0 * 1024 * 1024;
+    limits->minGrowth[SOAK_FRAME_P95] = 2.0;
+    limits->maxFrameDrift = 1.5;
+}
+
+static double MetricValue(const SoakSample* s, int metric)
+{
+    switch (metric) {
+    case SOAK_GDI:       return s->gdiObjects;
+    case SOAK_USER:      return s->userObjects;
+    case SOAK_HANDLES:   return s->handles;
+    case SOAK_PRIVATE:   return (double)s->privateBytes;
+    default:             return s->p95Ms;
+    }
+}
+
+static double Median(std::vector<double> v)
+{
+    if (v.empty()) return 0.0;
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    return v[v.size() / 2];
+}
+
+// Median of the values of samples [from, to)
+static double RangeMedian(const std::vector<const SoakSample*>& s, size_t from, size_t to, int metric)
+{
+    std::vector<double> v;
+    for (size_t i = from; i < to; i++) v.push_back(MetricValue(s[i], metric));
+    return Median(v);
+}
+
+static bool PerSize(int metric)
+{
+    return metric == SOAK_PRIVATE || metric == SOAK_FRAME_P95;
+}
+
+static bool SameSize(const SoakSample* a, const SoakSample* b)
+{
+    return a->width == b->width && a->height == b->height;
+}
+
+// Index of the sample from which every resolution of the run has been seen
+static size_t AllSizesSeen(const SoakSample* samples, size_t count)
+{
+    size_t seen = 0;
+    for (size_t i = 1; i < count; i++) {
+        size_t j = 0;
+        while (j < i && !SameSize(&samples[j], &samples[i])) j++;
+        if (j == i) seen = i;
+    }
+    return seen;
+}
+
+bool SoakAnalyze(const SoakSample* samples, size_t count, const SoakLimits* limits, SoakReport* report)
+{
+    memset(report, 0, sizeof(*report));
+    size_t start = (size_t)(limits->warmupFraction * (double)count);
+    size_t sizedStart = std::max(start, AllSizesSeen(samples, count));
+    report->used = count - start;
+    report->usedSized = count - sizedStart;
+    if (report->used < SOAK_MIN_SAMPLES) {
+        report->tooShort = true;
+        return true;
+    }
+
+    for (int m = 0; m < SOAK_METRIC_COUNT; m++) {
+        // Frame time only from samples that had frames; one group per
+        // resolution where it matters, else a single group
+        std::vector<std::vector<const SoakSample*>> groups;
+        size_t total = 0;
+        for (size_t i = PerSize(m) ? sizedStart : start; i < count; i++) {
+            const SoakSample* p = &samples[i];
+            if (m == SOAK_FRAME_P95 && !p->frames) continue;
+            size_t g = 0;
+            while (g < groups.size() && PerSize(m) && !SameSize(groups[g][0], p)) g++;
+            if (g == groups.size()) groups.emplace_back();
+            groups[g].push_back(p);
+            total++;
+        }
+        if (total < SOAK_MIN_SAMPLES) continue;
+
+        // Least squares slope per hour, with one intercept per group
+        double sxx = 0, sxy = 0;
+        for (const auto& s : groups) {
+            double mx = 0, my = 0;
+            for (const SoakSample* p : s) {
+                mx += (double)p->tMs / 3600000.0;
+                my += MetricValue(p, m);
+            }
+            mx /= (double)s.size();
+            my /= (double)s.size();
+            for (const SoakSample* p : s) {
+                double dx = (double)p->tMs / 3600000.0 - mx;
+                sxx += dx * dx;
+                sxy += dx * (MetricValue(p, m) - my);
+            }
+        }
+        SoakMetricResult& r = report->metric[m];
+        r.perHour = sxx > 0 ? sxy / sxx : 0.0;
+
+        // First and last stretch of each group, weighted by its samples
+        double first = 0, last = 0;
+        for (const auto& s : groups) {
+            size_t k = std::max<size_t>(1, m == SOAK_FRAME_P95 ? s.size() / 4 : s.size() / 10);
+            double w = (double)s.size() / (double)total;
+            first += w * RangeMedian(s, 0, k, m);
+            last  += w * RangeMedian(s, s.size() - k, s.size(), m);
+        }
+        r.growth = last - first;
+        if (m == SOAK_FRAME_P95)
+            r.failed = r.growth > limits->minGrowth[m] && last > first * limits->maxFrameDrift;
+        else
+            r.failed = r.growth > limits->minGrowth[m] && r.perHour > limits->maxPerHour[m];
+        report->failed = report->failed || r.failed;
+    }
+    return !report->failed;
+}
+
+const char* SoakMetricName(SoakMetric metric)
+{
+    static const char* const names[SOAK_METRIC_COUNT] = {
+        "gdi_objects", "user_objects", "handles", "private_kb", "frame_p95_ms",
+    };
+    return metric < SOAK_METRIC_COUNT ? names[metric] : "?";
+}
+
+size_t SoakFormatReport(const SoakReport* report, char* buf, size_t cap)
+{
+    size_t len = 0;
+    auto put = [&](int n) { if (n > 0) len = std::min(cap ? cap - 1 : 0, len + (size_t)n); };
+    if (cap) buf[0] = '\0';
+    if (report->tooShort) {
+        put(snprintf(buf + len, cap - len, "too short: %zu samples after warm-up\n", report->used));
+        return len;
+    }
+    for (int m = 0; m < SOAK_METRIC_COUNT; m++) {
+        const SoakMetricResult& r = report->metric[m];
+        double scale = m == SOAK_PRIVATE ? 1.0 / 1024 : 1.0;
+        put(snprintf(buf + len, cap - len, "%-14s %+10.1f/h %+10.1f  %s\n", SoakMetricName((SoakMetric)m),
+                     r.perHour * scale, r.growth * scale, r.failed ? "GROWING" : "ok"));
+    }
+    if (report->usedSized != report->used)
+        put(snprintf(buf + len, cap - len, "%s (%zu samples after warm-up, %zu after every resolution was seen)\n",
+                     report->failed ? "FAIL" : "pass", report->used, report->usedSized));
+    else
+        put(snprintf(buf + len, cap - len, "%s (%zu samples after warm-up)\n",
+                     report->failed ? "FAIL" : "pass", report->used));
+    return len;
+}
+
+size_t SoakFormatCsvHeader(char* buf, size_t cap)
+{
+    int n = snprintf(buf, cap, "t_s,width,height,gdi_objects,user_objects,handles,private_kb,frames,p50_ms,p95_ms,p99_ms,max_ms\n");
+    return n > 0 ? std::min((size_t)n, cap ? cap - 1 : 0) : 0;
+}
+
+size_t SoakFormatCsvRow(const SoakSample* s, char* buf, size_t cap)
+{
+    int n = snprintf(buf, cap, "%.1f,%d,%d,%u,%u,%u,%llu,%u,%.2f,%.2f,%.2f,%.2f\n",
+                     (double)s->tMs / 1000.0, s->width, s->height, s->gdiObjects, s->userObjects, s->handles,
+                     (unsigned long long)(s->privateBytes / 1024), s->frames,
+                     s->p50Ms, s->p95Ms, s->p99Ms, s->maxMs);
+    return n > 0 ? std::min((size_t)n, cap ? cap - 1 : 0) : 0;
+}
+
+// ---- Synthetic content and script ------------------------------------------
+
+#define SOAK_LINE_FRAMES    45      // a new line of "typing" this often
+#define SOAK_BLINK_FRAMES   30
+
+static void FillRect32(uint32_t* frame, int stride, int x0, int y0, int x1, int y1, uint32_t color)
+{
+    for (int y = y0; y < y1; y++) {
+        uint32_t* row = frame + (size_t)y * stride;
+        for (int x = x0; x < x1; x++) row[x] = color;
+    }
+}
+
+void SoakDrawFrame(uint32_t* frame, int stride, int width, int height, uint32_t frameNo)
+{
+    int title = height / 12, margin = width / 24;
+    int lineH = std::max(8, height / 36);
+    int textRight = width / 2;
+    int lines = (height - title - 2 * margin) / lineH;
+    if (lines < 1) lines = 1;
+
+    // Frame 0 paints the slide; later frames only what changes
+    uint32_t line = frameNo / SOAK_LINE_FRAMES;
+    if (frameNo == 0 || (frameNo % SOAK_LINE_FRAMES == 0 && line % (uint32_t)lines == 0)) {
+        FillRect32(frame, stride, 0, 0, width, height, 0xFFF4F4F4u);
+        FillRect32(frame, stride, 0, 0, width, title, 0xFF1F3A68u);
+    }
+
+    // Words of the current line, one line per SOAK_LINE_FRAMES
+    int ly = title + margin + (int)(line % (uint32_t)lines) * lineH;
+    if (frameNo % SOAK_LINE_FRAMES == 0) {
+        uint32_t seed = line * 2654435761u + 1;
+        for (int x = margin; x < textRight; ) {
+            seed = seed * 1664525u + 1013904223u;
+            int w = lineH + (int)(seed >> 27) * lineH / 4;
+            FillRect32(frame, stride, x, ly + lineH / 4, std::min(x + w, textRight), ly + lineH * 3 / 4, 0xFF202020u);
+            x += w + lineH / 2;
+        }
+    }
+
+    // Blinking caret after the line
+    uint32_t caret = (frameNo / SOAK_BLINK_FRAMES) & 1 ? 0xFFF4F4F4u : 0xFF000000u;
+    FillRect32(frame, stride, textRight + 4, ly, std::min(textRight + 7, width), std::min(ly + lineH, height), caret);
+
+    // "Video": a moving plasma in the right part
+    int vx0 = width * 3 / 5, vx1 = width - margin;
+    int vy0 = height / 3, vy1 = height * 3 / 4;
+    uint32_t t = frameNo * 3;
+    for (int y = vy0; y < vy1; y++) {
+        uint32_t* row = frame + (size_t)y * stride;
+        for (int x = vx0; x < vx1; x++) {
+            uint32_t v = (uint32_t)(x + t) ^ (uint32_t)(y * 2 - t);
+            row[x] = 0xFF000000u | (v & 0xFF) << 16 | ((v >> 1) & 0xFF) << 8 | ((x + y + t) & 0xFF);
+        }
+    }
+}
+
+void SoakScriptInit(SoakScript* script, uint64_t reconnectMs, uint64_t resizeMs)
+{
+    script->reconnectMs = reconnectMs;
+    script->resizeMs = resizeMs;
+    script->nextReconnect = reconnectMs;
+    script->nextResize = resizeMs;
+    script->sizeIndex = 0;
+}
+
+SoakAction SoakScriptStep(SoakScript* script, uint64_t nowMs)
+{
+    if (script->reconnectMs && nowMs >= script->nextReconnect) {
+        while (script->nextReconnect <= nowMs) script->nextReconnect += script->reconnectMs;
+        return SOAK_RECONNECT;
+    }
+    if (script->resizeMs && nowMs >= script->nextResize) {
+        while (script->nextResize <= nowMs) script->nextResize += script->resizeMs;
+        script->sizeIndex = (script->sizeIndex + 1) % SOAK_SIZE_COUNT;
+        return SOAK_RESIZE;
+    }
+    return SOAK_NONE;
+}
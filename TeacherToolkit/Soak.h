@@ -0,0 +1,126 @@
+// Soak.h : long-running soak test: synthetic content, samples, trend checks.
+//
+// The leaks that matter for an app left projecting all day are slow ones: a
+// bitmap not freed on one reconnect path, a few KB per resolution change.
+// They only show after hours. A soak run drives the mirror pipeline on
+// synthetic content for that long, with scripted reconnects and resolution
+// changes (SoakScript). Every few seconds it takes a sample of the process:
+// GDI and USER objects, kernel handles, private bytes, and the frame-time
+// percentiles since the previous sample.
+//
+// SoakAnalyze skips a warm-up and then looks for growth. Resources fail
+// when both the fitted slope per hour and the observed growth are over
+// their limits, so a single late allocation or noise on a flat series
+// does not trip it. Frame time fails when the p95 of the last quarter has
+// drifted from the first. Private bytes and frame time depend on the
+// resolution, so they are only compared between samples taken at the same
+// one, and only once every resolution of the run has been seen: the heap
+// keeps the high-water mark of the largest.
+// Portable: no Windows headers.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct SoakSample {
+    uint64_t tMs;               // since the start of the run
+    int      width, height;     // resolution being mirrored, 0 if not known
+    uint32_t gdiObjects;        // 0 where the platform has none
+    uint32_t userObjects;
+    uint32_t handles;           // kernel handles, or open file descriptors
+    uint64_t privateBytes;
+    uint32_t frames;            // since the previous sample
+    float    p50Ms, p95Ms, p99Ms, maxMs;    // frame time over those frames
+};
+
+// Counters of the calling process; false if they could not be read
+bool SoakReadProcess(SoakSample* sample);
+
+// ---- Frame times -----------------------------------------------------------
+
+struct SoakFrameTimes {
+    std::vector<float> ms;
+};
+
+void SoakFrameTime(SoakFrameTimes* times, double ms);
+
+// Fills frames and the percentiles from the times added since the last
+// call, and starts over
+void SoakFrameSummary(SoakFrameTimes* times, SoakSample* sample);
+
+// ---- Trend checks ----------------------------------------------------------
+
+enum SoakMetric {
+    SOAK_GDI,
+    SOAK_USER,
+    SOAK_HANDLES,
+    SOAK_PRIVATE,               // bytes
+    SOAK_FRAME_P95,             // ms
+    SOAK_METRIC_COUNT
+};
+
+struct SoakLimits {
+    double warmupFraction;                  // of the samples, left out of every check
+    double maxPerHour[SOAK_METRIC_COUNT];   // fitted slope
+    double minGrowth[SOAK_METRIC_COUNT];    // last tenth against first tenth, medians
+    double maxFrameDrift;                   // p95 ratio, last quarter / first quarter
+};
+
+void SoakDefaultLimits(SoakLimits* limits);
+
+struct SoakMetricResult {
+    double perHour;
+    double growth;
+    bool   failed;
+};
+
+struct SoakReport {
+    SoakMetricResult metric[SOAK_METRIC_COUNT];
+    size_t used;                // samples after the warm-up
+    size_t usedSized;           // ...of which after every resolution was seen
+    bool   tooShort;            // too few to judge; nothing failed
+    bool   failed;
+};
+
+// Returns false if any metric failed
+bool SoakAnalyze(const SoakSample* samples, size_t count, const SoakLimits* limits, SoakReport* report);
+
+const char* SoakMetricName(SoakMetric metric);
+
+// One line per metric; returns the length written
+size_t SoakFormatReport(const SoakReport* report, char* buf, size_t cap);
+size_t SoakFormatCsvHeader(char* buf, size_t cap);
+size_t SoakFormatCsvRow(const SoakSample* sample, char* buf, size_t cap);
+
+// ---- Synthetic content and script ------------------------------------------
+
+struct SoakSize {
+    int width, height;
+};
+
+// Resolutions a run cycles through, the first one is where it starts
+extern const SoakSize SOAK_SIZES[];
+extern const int SOAK_SIZE_COUNT;
+
+// A slide with text lines, a region playing "video" and a blinking caret,
+// so static, occasional and video tiles all appear every frame
+void SoakDrawFrame(uint32_t* frame, int stride, int width, int height, uint32_t frameNo);
+
+enum SoakAction {
+    SOAK_NONE,
+    SOAK_RECONNECT,             // projector unplugged and plugged back
+    SOAK_RESIZE,                // primary resolution changed to SOAK_SIZES[sizeIndex]
+};
+
+struct SoakScript {
+    uint64_t reconnectMs, resizeMs;         // 0 = never
+    uint64_t nextReconnect, nextResize;
+    int      sizeIndex;
+};
+
+void SoakScriptInit(SoakScript* script, uint64_t reconnectMs, uint64_t resizeMs);
+
+// At most one action per call; call at least once per frame
+SoakAction SoakScriptStep(SoakScript* script, uint64_t nowMs);
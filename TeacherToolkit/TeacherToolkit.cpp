@@ -5,42 +5,148 @@
 
 #include "framework.h"
 #include "TeacherToolkit.h"
+#include "JsonScan.h"
+#include "Config.h"
+#include "TraceLog.h"
+#include "Annotate.h"
+#include "MaskSpans.h"
+#include "Warp.h"
+#include "RegionClassify.h"
+#include "ReplayRing.h"
+#include "FramePacer.h"
+#include "FrameRing.h"
+#include "PixelPipeline.h"
+#include "Soak.h"
+#include "InputLatency.h"
+#include "SlideCapture.h"
+#include "MirrorProfile.h"
 
 #include <dbt.h>
+#include <algorithm>
 
 #define MAX_LOADSTRING 100
 
-// Version
-#define APP_VERSION       L"0.1.2"
-#define APP_VERSION_A      "0.1.2"
+// Version (numbers live in Resource.h so the VERSIONINFO resource matches)
+#define APP_VERSION_A     APP_VERSION_STR
+#define APP_VERSION       _CRT_WIDE(APP_VERSION_STR)
 
 // Timer IDs
 #define IDT_MONITOR_POLL    1
 #define IDT_MIRROR_REFRESH  2
 #define IDT_EXTEND_RETRY    3
 #define IDT_DISPLAY_SETTLE  4
+#define IDT_CURSOR_REFRESH  5
+#define IDT_IDLE_TRIM       6
+#define IDT_SCREENSAVER     7
+
+// Global hotkeys
+#define HOTKEY_ANNOTATE     1       // Ctrl+Alt+A
+#define HOTKEY_REPLAY_BACK  2       // Ctrl+Alt+PgUp
+#define HOTKEY_REPLAY_FWD   3       // Ctrl+Alt+PgDn
+#define HOTKEY_REPLAY_LIVE  4       // Ctrl+Alt+End
 
 // Context menu IDs
 #define IDM_TRAY_STATUS    300
 
-// Intervals
+// Intervals (defaults; see RuntimeConfig for the live values)
 #define MONITOR_POLL_MS  2000
 #define MIRROR_FPS_MS    33     // ~30 fps (reduzido de 60 para diminuir carga)
 #define EXTEND_RETRY_MS  1000   // retry checking after extend
 
-// Registry key for update preferences
+// Minimum overlap (px, both axes) for a window to count as being on the projector
+#define WINDOW_OVERLAP_MIN_PX  80
+
+// Config hot reload: let an editor's save burst settle before re-reading
+#define CONFIG_RELOAD_SETTLE_MS  250
+
+// Trace log: drain period and default size cap for trace.ttt + trace.ttt.1
+#define TRACE_FLUSH_MS   1000
+#define TRACE_MAX_KB     4096
+
+// Idle footprint: how long nothing must be projecting before buffers are
+// released and the working set trimmed
+#define IDLE_TRIM_DELAY_MS 5000
+
+// Launch self-check: exe digests cached per path in HKCU. Portable copies
+// run from USB sticks or temp folders each add a path, so only the most
+// recently hashed ones are kept
+#define DIGEST_CACHE_MAX   8
+
+// Instant replay: history budget, how far back it reaches, and how often
+// the projected image is sampled into it
+#define REPLAY_MB           64
+#define REPLAY_MINUTES      5
+#define REPLAY_INTERVAL_MS  1000
+
+// Capture suspension (g_suspendFlags): any bit set stops capture, window
+// eviction and monitor polling
+#define SUSPEND_LOCKED        0x01
+#define SUSPEND_DISCONNECTED  0x02  // fast user switching, console taken over
+#define SUSPEND_DISPLAY_OFF   0x04
+#define SUSPEND_LID_CLOSED    0x08
+#define SUSPEND_SLEEP         0x10
+#define SUSPEND_SCREENSAVER   0x20
+#define SCREENSAVER_POLL_MS   1000  // only while the screensaver runs
+
+// Annotation pen width in frame pixels (default)
+#define ANNOT_WIDTH_PX   5
+
+// Privacy masks
+#define MASK_MAX_RULES    16        // per list (processes, classes, regions)
+#define MASK_MAX_RECTS    64        // masked windows + regions per frame
+#define MASK_BLOCK_PX     24        // default pixelation block
+#define MASK_CACHE_SWEEP_MS 5000    // forget processes that have exited
+
+// Update check
+#define UPDATE_TIMEOUT_MS      5000                          // connect/send/receive
+#define UPDATE_CHECK_INTERVAL  (24ULL * 60 * 60 * 10000000)  // once a day, in FILETIME units
+#define UPDATE_DOWNLOAD_KBPS   256                           // default bandwidth cap
+
+// Warm-start budget from process creation to the first mirrored frame
+#define STARTUP_TARGET_MS  100.0
+
+// Control pipe limits
+#define IPC_MAX_REQUEST     512
+#define IPC_MAX_REPLY       1024
+#define IPC_CLIENT_TIMEOUT_MS  2000     // idle clients are dropped after this
+
+// Registry key for update preferences (a test build keeps its own, so
+// --update-test never touches the real cache or staged update)
+#ifdef UPDATE_TEST_TRUST
+static const WCHAR REG_KEY[]   = L"Software\\TeacherToolkit\\UpdateTest";
+#else
 static const WCHAR REG_KEY[]   = L"Software\\TeacherToolkit";
+#endif
 static const WCHAR REG_SKIP[]  = L"SkipVersion";
+static const WCHAR REG_UPDATE_ETAG[]      = L"UpdateETag";
+static const WCHAR REG_UPDATE_SOURCE[]    = L"UpdateSource";
+static const WCHAR REG_UPDATE_MODIFIED[]  = L"UpdateLastModified";
+static const WCHAR REG_UPDATE_LATEST[]    = L"UpdateLatestVersion";
+static const WCHAR REG_UPDATE_CHECKED[]   = L"UpdateLastCheck";
+static const WCHAR REG_UPDATE_ASSET_URL[] = L"UpdateAssetUrl";
+static const WCHAR REG_UPDATE_ASSET_SHA[] = L"UpdateAssetDigest";
+static const WCHAR REG_UPDATE_ASSET_SIZE[] = L"UpdateAssetSize";
+static const WCHAR REG_STAGED_VERSION[]   = L"StagedVersion";
+static const WCHAR REG_STAGED_DIGEST[]    = L"StagedDigest";
+static const WCHAR REG_DIGEST_CACHE[] = L"Software\\TeacherToolkit\\DigestCache";
+static const WCHAR REG_CONFIG_KEY[]   = L"Software\\TeacherToolkit\\Config";
+
+// Release asset the updater looks for
+static const char RELEASE_ASSET_NAME[] = "TeacherToolkit.exe";
 
 // Single-instance mutex name
 static const WCHAR MUTEX_NAME[] = L"Global\\TeacherToolkit_SingleInstance";
 
+// Local control/telemetry pipe (see "Control pipe" below)
+static const WCHAR IPC_PIPE_NAME[] = L"\\\\.\\pipe\\TeacherToolkit";
+
 // Global Variables
 HINSTANCE hInst;
 WCHAR szTitle[MAX_LOADSTRING];
 WCHAR szWindowClass[MAX_LOADSTRING];
 
 static const WCHAR MIRROR_CLASS[] = L"TeacherToolkitMirror";
+static const WCHAR ANNOTATE_CLASS[] = L"TeacherToolkitAnnotate";
 
 // State
 NOTIFYICONDATA nid = {};
@@ -48,31 +154,187 @@ HWND g_hHidden  = nullptr;
 HWND g_hMirror  = nullptr;
 BOOL g_bProjecting = FALSE;
 BOOL g_bExtendPending = FALSE;
+BOOL g_bPaused = FALSE;             // mirroring suspended from the tray or control pipe
+DWORD g_suspendFlags = 0;           // SUSPEND_*: locked, display off, ...
 int  g_nExtendRetries = 0;
 RECT g_rcSecond  = {};
 RECT g_rcPrimary = {};
+UINT g_dpiSecond  = 96;             // effective DPI of each, as of HasSecondMonitor
+UINT g_dpiPrimary = 96;
 HDEVNOTIFY g_hDevNotify = nullptr;
+HPOWERNOTIFY g_hDisplayStateNotify = nullptr;
+HPOWERNOTIFY g_hLidNotify = nullptr;
+
+// GUID_CONSOLE_DISPLAY_STATE {6FE69556-704A-47A0-8F24-C28D936FDA47}
+static const GUID GUID_DISPLAY_STATE = { 0x6FE69556, 0x704A, 0x47A0,
+    { 0x8F, 0x24, 0xC2, 0x8D, 0x93, 0x6F, 0xDA, 0x47 } };
+// GUID_LIDSWITCH_STATE_CHANGE {BA3E0F4D-B817-4094-A2D1-D56379E6A0F3}
+static const GUID GUID_LID_STATE = { 0xBA3E0F4D, 0xB817, 0x4094,
+    { 0xA2, 0xD1, 0xD5, 0x63, 0x79, 0xE6, 0xA0, 0xF3 } };
 HANDLE g_hMutex = nullptr;
 
 // Mirroring resources
 HDC     g_hdcMem    = nullptr;
 HBITMAP g_hBmpMem   = nullptr;
 HBITMAP g_hOldBmp   = nullptr;
+UINT32* g_pMemBits  = nullptr;      // 32bpp top-down DIB section behind g_hBmpMem
 int     g_memW      = 0;
 int     g_memH      = 0;
 
+// Keystone correction for the current projector, and the output-sized
+// DIB the warp writes into
+char       g_szProjectorId[32] = "";
+BOOL       g_bWarpEnabled = FALSE;
+WarpParams g_warpParams;
+WarpMap    g_warpMap;
+HDC     g_hdcWarp     = nullptr;
+HBITMAP g_hBmpWarp    = nullptr;
+HBITMAP g_hOldWarpBmp = nullptr;
+UINT32* g_pWarpBits   = nullptr;
+int     g_warpW       = 0;
+int     g_warpH       = 0;
+
+// Cursor fast path: the cursor is drawn on the projector window on top of
+// the scaled frame, so mouse moves repaint just its old and new rectangles
+struct MirrorCursor {
+    BOOL     active;            // last frame left the cursor out of g_hdcMem
+    int      srcW, srcH;
+    RECT     box;               // letterbox rect of the last frame
+    RECT     drawn;             // window rect the cursor occupies, empty if none
+    HCURSOR  hCursor;
+    LONGLONG lastTicks;
+    LONGLONG minTicks;          // one projector refresh period
+    HCURSOR  shape;             // cached size/hotspot of this cursor
+    int      shapeW, shapeH, hotX, hotY;
+    HDC      hdc;               // small scratch buffer for composing
+    HBITMAP  hBmp;
+    HBITMAP  hOldBmp;
+    int      bufW, bufH;
+};
+MirrorCursor g_cursor = {};
+
+// Content classification of the captured frame, for per-tile repaints
+RegionMap g_regions;
+RECT      g_regionBox = {};             // letterbox the tiles were last painted into
+std::vector<uint64_t> g_passHashes;     // tile hashes from this frame's pixel pass
+BOOL      g_passHashed = FALSE;         // g_passHashes belong to the frame in g_pMemBits
+
+// Soak mode (--soak): a synthetic "screen" the mirror captures instead of
+// the desktop, and the frame times gathered between samples
+struct SoakState {
+    BOOL     active;
+    HDC      hdc;
+    HBITMAP  hBmp;
+    HBITMAP  hOldBmp;
+    UINT32*  bits;
+    int      width, height;
+    uint32_t frameNo;
+    SoakFrameTimes times;
+};
+SoakState g_soak = {};
+
+// Input to projector latency (InputLatency.h), UI thread only
+LatencyTracker g_latency;
+
+// Instant replay: recent history of the projected image. The ring is
+// written by the encoder thread and read by the UI thread under lock;
+// everything else is UI thread only
+struct ReplayState {
+    ReplayRing    ring;
+    ReplayJob     job;              // owned by the encoder while busy
+    SRWLOCK       lock;
+    HANDLE        hWake;            // job ready
+    volatile LONG busy;
+    ULONGLONG     lastSample;
+    BOOL          showing;          // projector shows frame seq, not live
+    uint32_t      seq;
+    HDC           hdc;              // decoded frame, source sized
+    HBITMAP       hBmp;
+    HBITMAP       hOldBmp;
+    UINT32*       pBits;
+    int           w, h;
+};
+ReplayState g_replay = { {}, {}, SRWLOCK_INIT };
+
+// Slide capture: the encoder thread owns the job and the folder while
+// busy; everything else is UI thread only
+struct SlideState {
+    BOOL          on;
+    SlideDetector detector;
+    SlideIndex    index;
+    WCHAR         dir[MAX_PATH];    // this session's folder, created with the first slide
+    HANDLE        hWake;            // job ready
+    volatile LONG busy;
+    std::vector<uint32_t> job;      // frame to encode, jobW x jobH
+    int           jobW, jobH, jobSlide;
+    volatile LONG saved;            // PNGs written
+    BOOL          failed;           // the last one could not be written
+};
+SlideState g_slides;
+
+// Application profile in effect (MirrorProfile.h), UI thread only
+struct ProfileState {
+    HWINEVENTHOOK hHook;            // foreground changes, while projecting
+    MirrorProfile active;
+    WCHAR         key[64];          // executable or window class that chose it
+};
+ProfileState g_profile;
+
+// Annotation overlay, in frame (primary screen) pixels
+AnnotationLayer g_annot;
+HWND     g_hAnnotInput = nullptr;   // invisible input window over the primary while drawing
+uint32_t g_annotColor  = 0;
+
+// Performance knobs, re-read whenever the configuration changes
+struct RuntimeConfig {
+    UINT monitorPollMs;
+    UINT mirrorFpsMs;
+    UINT extendRetryMs;
+    int  overlapMinPx;
+    int  traceMaxKB;            // read when the trace writer starts
+    int  annotWidthPx;
+    BOOL regionClassify;        // repaint changed tiles only, filter chosen per tile
+    int  replayMB;              // 0 = no instant replay
+    int  replayMinutes;
+    UINT replayIntervalMs;
+    BOOL mirrorHiResClock;      // frame clock on a high-resolution waitable timer
+    BOOL mirrorVsync;           // frame period a whole number of projector refreshes
+    BOOL frameShare;            // publish frames in shared memory (FrameRing.h)
+    BOOL slidesAuto;            // start slide capture with every projection
+    BOOL slidesPdf;             // bind the slides into a PDF when capture ends
+    BOOL profiles;              // per-application profiles (MirrorProfile.h)
+};
+RuntimeConfig g_cfg = { MONITOR_POLL_MS, MIRROR_FPS_MS, EXTEND_RETRY_MS, WINDOW_OVERLAP_MIN_PX,
+                        TRACE_MAX_KB, ANNOT_WIDTH_PX, TRUE,
+                        REPLAY_MB, REPLAY_MINUTES, REPLAY_INTERVAL_MS, TRUE, TRUE, TRUE,
+                        FALSE, TRUE, TRUE };
+
 // Config loaded from embedded resource (config.ini compiled into exe)
 WCHAR g_szAuthor[128]      = L"";
 WCHAR g_szGitHubRepo[256]  = L"";
+WCHAR g_szUpdateUrl[512]   = L"";   // optional override, e.g. a local stand-in server
 WCHAR g_szLatestVer[64]    = L"";
 BOOL  g_bUpdateAvailable   = FALSE;
+BOOL  g_bUpdateStaged      = FALSE;   // downloaded and verified, swapped in on next launch
+BOOL  g_bAutoUpdate        = FALSE;   // config: auto_update=1
+DWORD g_nDownloadKBps      = UPDATE_DOWNLOAD_KBPS;   // config: download_kbps (0 = no cap)
+
+// The update settings the startup worker runs with, copied on the UI thread
+// before it starts so a config reload cannot change them under it
+struct UpdateSettings {
+    WCHAR url[512];             // release metadata, "" = no update source
+    BOOL  autoUpdate;
+    DWORD downloadKBps;
+};
 
 // Forward declarations
 ATOM                RegisterHiddenClass(HINSTANCE hInstance);
 ATOM                RegisterMirrorClass(HINSTANCE hInstance);
+ATOM                RegisterAnnotateClass(HINSTANCE hInstance);
 BOOL                InitInstance(HINSTANCE, int);
 LRESULT CALLBACK    HiddenWndProc(HWND, UINT, WPARAM, LPARAM);
 LRESULT CALLBACK    MirrorWndProc(HWND, UINT, WPARAM, LPARAM);
+LRESULT CALLBACK    AnnotateWndProc(HWND, UINT, WPARAM, LPARAM);
 
 void AddTrayIcon(HWND hWnd);
 void RemoveTrayIcon();
@@ -81,19 +343,67 @@ BOOL HasSecondMonitor(RECT* rcPrimary, RECT* rcSecond);
 int  CountPhysicalDisplays();
 void StartMirroring();
 void StopMirroring();
+void StartFrameClock();
+void StopFrameClock();
+void RenderMirrorFrame(HWND hWnd);
 void FreeMirrorResources();
+void LoadMaskRules();
+void LoadWarpConfig();
+void FreeWarpResources();
+void UpdateMirrorCursor(HDC hdcWnd, BOOL force);
+int  GetMonitorRefreshHz(const RECT* rc);
+void FreeCursorResources();
+void ScheduleIdleTrim();
+void AppendMemoryText(WCHAR* buf, size_t cch);
+void AppendDpiText(WCHAR* buf, size_t cch);
+void StepReplay(int delta);
+void LeaveReplay(BOOL repaint);
+void FreeReplayHistory();
+void AppendReplayText(WCHAR* buf, size_t cch);
+void StartFrameShare();
+void StopFrameShare();
+void AppendFrameShareText(WCHAR* buf, size_t cch);
+void StartSlideCapture();
+void StopSlideCapture(BOOL openFolder);
+void ExportSlides();
+void AppendSlidesText(WCHAR* buf, size_t cch);
+void StartProfiles();
+void StopProfiles();
+void AppendProfileText(WCHAR* buf, size_t cch);
+int64_t QpcMicros(LONGLONG ticks);
+int64_t NowMicros();
+void BeginAnnotating();
+void EndAnnotating();
 BOOL IsSecondScreenOccupiedByOtherApp();
 void MoveOtherWindowsToPrimaryFromSecond();
 void TryExtendAndMirror();
 BOOL SetExtendMode();
 void CheckMonitorState();
+void SetSuspendFlag(DWORD flag, BOOL on);
 void RegisterForDeviceNotifications(HWND hWnd);
 void UnregisterDeviceNotifications();
 void ShowAboutDialog(HWND hWnd);
+void ShowDiagnosticsDialog(HWND hWnd);
 
 // Config / update helpers
-void LoadLocalConfig();
-BOOL CheckForUpdate();
+void LoadConfig();
+void ApplyConfig();
+void StartConfigWatcher();
+void StartTraceWriter();
+void StopTraceWriter();
+BOOL GetTracePath(WCHAR* buf, DWORD cch);
+
+// Control pipe
+void StartIpcServer();
+void PublishIpcState();
+int  ForwardCommandLine(const WCHAR* cmdLine);
+void PauseMirroring();
+void ResumeMirroring();
+void FrameStatsRecord(LONGLONG startTicks, LONGLONG endTicks);
+void FrameStatsSetPacing(const FrameIntervalSummary* pacing, double periodMs, BOOL hiRes, LONG dropped);
+void AppendPacingText(WCHAR* buf, size_t cch);
+void AppendLatencyText(WCHAR* buf, size_t cch);
+BOOL CheckForUpdate(const UpdateSettings* settings, WCHAR* latestOut, DWORD latestCch);
 void PromptUpdate(HWND hWnd);
 BOOL IsVersionNewer(const char* remote, const char* local);
 BOOL IsVersionSkipped(const WCHAR* version);
@@ -105,69 +415,410 @@ void EnableStartup();
 void DisableStartup();
 BOOL GetAppDataExePath(WCHAR* buf, DWORD cch);
 BOOL GetStartupShortcutPath(WCHAR* buf, DWORD cch);
+BOOL ExeFilesMatch(const WCHAR* path1, const WCHAR* path2);
 BOOL FilesMatchByHash(const WCHAR* path1, const WCHAR* path2);
 BOOL ComputeFileHash(const WCHAR* path, BYTE* hashOut, DWORD hashSize);
 
+// Startup timeline
+enum StartupMilestone {
+    STARTUP_TRAY_ICON = 0,
+    STARTUP_FIRST_FRAME,
+    STARTUP_MILESTONE_COUNT
+};
+void StartupTimelineBegin();
+void StartupTimelineMark(StartupMilestone milestone);
+
+// � Startup timeline ��������������������������������������������������
+// Milestones are taken with QueryPerformanceCounter relative to wWinMain
+// entry. The gap between process creation and wWinMain comes from
+// GetProcessTimes, so every value reads "process start -> milestone".
+struct StartupTimeline {
+    LARGE_INTEGER freq;
+    LARGE_INTEGER entry;
+    double        msBeforeEntry;
+    double        msAt[STARTUP_MILESTONE_COUNT];   // < 0 = not reached yet
+};
+static StartupTimeline g_startup = {};
+
+typedef VOID (WINAPI* PFN_GetSystemTimePreciseAsFileTime)(LPFILETIME);
+
+void StartupTimelineBegin()
+{
+    QueryPerformanceFrequency(&g_startup.freq);
+    QueryPerformanceCounter(&g_startup.entry);
+    for (int i = 0; i < STARTUP_MILESTONE_COUNT; i++)
+        g_startup.msAt[i] = -1.0;
+
+    // Windows 8+ has a precise wall clock; Windows 7 falls back to the
+    // tick-granular one, which is still good enough for a ballpark figure.
+    FILETIME ftNow = {};
+    auto pPrecise = (PFN_GetSystemTimePreciseAsFileTime)GetProcAddress(
+        GetModuleHandleW(L"kernel32.dll"), "GetSystemTimePreciseAsFileTime");
+    if (pPrecise) pPrecise(&ftNow);
+    else          GetSystemTimeAsFileTime(&ftNow);
+
+    FILETIME ftCreate, ftExit, ftKernel, ftUser;
+    if (GetProcessTimes(GetCurrentProcess(), &ftCreate, &ftExit, &ftKernel, &ftUser)) {
+        ULARGE_INTEGER create, now;
+        create.LowPart  = ftCreate.dwLowDateTime;
+        create.HighPart = ftCreate.dwHighDateTime;
+        now.LowPart     = ftNow.dwLowDateTime;
+        now.HighPart    = ftNow.dwHighDateTime;
+        if (now.QuadPart > create.QuadPart)
+            g_startup.msBeforeEntry = (double)(now.QuadPart - create.QuadPart) / 10000.0;
+    }
+}
+
+void StartupTimelineMark(StartupMilestone milestone)
+{
+    if (milestone < 0 || milestone >= STARTUP_MILESTONE_COUNT) return;
+    if (g_startup.freq.QuadPart == 0 || g_startup.msAt[milestone] >= 0.0) return;
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    g_startup.msAt[milestone] = g_startup.msBeforeEntry +
+        (double)(now.QuadPart - g_startup.entry.QuadPart) * 1000.0 / (double)g_startup.freq.QuadPart;
+
+    if (milestone == STARTUP_FIRST_FRAME) {
+        WCHAR line[160];
+        StringCchPrintfW(line, ARRAYSIZE(line),
+            L"TeacherToolkit: startup %.1f ms to tray icon, %.1f ms to first mirrored frame\n",
+            g_startup.msAt[STARTUP_TRAY_ICON], g_startup.msAt[STARTUP_FIRST_FRAME]);
+        OutputDebugStringW(line);
+    }
+}
+
 // � Config loading ����������������������������������������������������
-// TrimWhitespace() removed - now done by the parser
-
-// Parse a value from an INI-style buffer: looks for "key=" and returns
-// the text after '=' up to the next newline.
-static BOOL ParseIniValue(const char* data, DWORD dataLen,
-                          const char* key, WCHAR* out, DWORD outCch)
-{
-    out[0] = L'\0';
-    size_t keyLen = strlen(key);
-    const char* p = data;
-    const char* end = data + dataLen;
-
-    while (p < end) {
-        // Skip whitespace/newlines
-        while (p < end && (*p == '\r' || *p == '\n' || *p == ' ' || *p == '\t'))
-            p++;
-        if (p >= end) break;
-
-        // Skip comments and section headers
-        if (*p == '#' || *p == ';' || *p == '[') {
-            while (p < end && *p != '\n') p++;
-            continue;
+// Layers, lowest priority first: the config.ini compiled into the exe,
+// %ProgramData%\TeacherToolkit\config.ini (machine-wide), the same file
+// under %APPDATA% (per-user), then values under Software\TeacherToolkit\Config
+// in HKLM and HKCU. Each layer is parsed once into one indexed table.
+//
+// The update settings decide what gets downloaded and run, so they are read
+// only from places a standard user cannot write: the embedded config.ini
+// and HKLM. Any local user can create %ProgramData%\TeacherToolkit.
+
+static ConfigTable g_config;        // UI thread only
+static ConfigTable g_updateConfig;  // embedded + HKLM only, UI thread only
+
+static BOOL GetConfigDir(int csidl, WCHAR* buf, DWORD cch)
+{
+    WCHAR root[MAX_PATH];
+    if (FAILED(SHGetFolderPathW(nullptr, csidl, nullptr, 0, root)))
+        return FALSE;
+    return SUCCEEDED(StringCchPrintfW(buf, cch, L"%s\\TeacherToolkit", root));
+}
+
+static void LoadConfigFile(int csidl, int layer)
+{
+    WCHAR path[MAX_PATH];
+    if (!GetConfigDir(csidl, path, MAX_PATH)) return;
+    if (FAILED(StringCchCatW(path, MAX_PATH, L"\\config.ini"))) return;
+
+    HANDLE hFile = CreateFileW(path, GENERIC_READ,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               nullptr, OPEN_EXISTING, 0, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER size = {};
+    if (GetFileSizeEx(hFile, &size) && size.QuadPart > 0 && size.QuadPart <= 64 * 1024) {
+        char* data = (char*)HeapAlloc(GetProcessHeap(), 0, (SIZE_T)size.QuadPart);
+        DWORD bytesRead = 0;
+        if (data && ReadFile(hFile, data, size.LowPart, &bytesRead, nullptr))
+            ConfigParseIni(&g_config, data, bytesRead, layer);
+        if (data) HeapFree(GetProcessHeap(), 0, data);
+    }
+    CloseHandle(hFile);
+}
+
+// REG_SZ and REG_DWORD values override the file layers key by key.
+static void LoadConfigRegistry(HKEY root, ConfigTable* table)
+{
+    HKEY hKey;
+    if (RegOpenKeyExW(root, REG_CONFIG_KEY, 0, KEY_READ, &hKey) != ERROR_SUCCESS)
+        return;
+
+    for (DWORD i = 0; ; i++) {
+        WCHAR name[64];
+        DWORD cchName = ARRAYSIZE(name);
+        BYTE data[1024];
+        DWORD cbData = sizeof(data);
+        DWORD type = 0;
+        LONG rc = RegEnumValueW(hKey, i, name, &cchName, nullptr, &type, data, &cbData);
+        if (rc == ERROR_NO_MORE_ITEMS) break;
+        if (rc != ERROR_SUCCESS) continue;
+
+        char key[64];
+        char value[512];
+        int keyLen = WideCharToMultiByte(CP_UTF8, 0, name, (int)cchName,
+                                         key, sizeof(key), nullptr, nullptr);
+        int valueLen = -1;
+        if (type == REG_DWORD && cbData == sizeof(DWORD)) {
+            StringCchPrintfA(value, ARRAYSIZE(value), "%lu", *(DWORD*)data);
+            valueLen = (int)strlen(value);
+        } else if (type == REG_SZ) {
+            // An empty string clears the key, as "key=" does in a file
+            int cch = (int)(cbData / sizeof(WCHAR));
+            const WCHAR* text = (const WCHAR*)data;
+            while (cch > 0 && text[cch - 1] == L'\0') cch--;
+            valueLen = cch == 0 ? 0 : WideCharToMultiByte(CP_UTF8, 0, text, cch,
+                                                          value, sizeof(value), nullptr, nullptr);
+            if (cch > 0 && valueLen == 0) valueLen = -1;
         }
+        if (keyLen > 0 && valueLen >= 0)
+            ConfigSet(table, key, (size_t)keyLen, value, (size_t)valueLen, CONFIG_LAYER_REGISTRY);
+    }
+    RegCloseKey(hKey);
+}
 
-        // Check if this line starts with the key
-        if ((size_t)(end - p) > keyLen &&
-            _strnicmp(p, key, keyLen) == 0 && p[keyLen] == '=') {
-            const char* val = p + keyLen + 1;
-            const char* eol = val;
-            while (eol < end && *eol != '\r' && *eol != '\n') eol++;
-            int len = (int)(eol - val);
-            if (len > 0 && (DWORD)len < outCch) {
-                MultiByteToWideChar(CP_UTF8, 0, val, len, out, outCch);
-                out[len] = L'\0';
-                return TRUE;
-            }
-            return FALSE;
+void LoadConfig()
+{
+    ConfigInit(&g_config);
+    ConfigInit(&g_updateConfig);
+
+    HRSRC hRes = FindResourceW(hInst, MAKEINTRESOURCEW(IDR_CONFIG), RT_RCDATA);
+    HGLOBAL hData = hRes ? LoadResource(hInst, hRes) : nullptr;
+    const char* data = hData ? (const char*)LockResource(hData) : nullptr;
+    if (data) {
+        ConfigParseIni(&g_config, data, SizeofResource(hInst, hRes), CONFIG_LAYER_EMBEDDED);
+        ConfigParseIni(&g_updateConfig, data, SizeofResource(hInst, hRes), CONFIG_LAYER_EMBEDDED);
+    }
+
+    LoadConfigFile(CSIDL_COMMON_APPDATA, CONFIG_LAYER_MACHINE);
+    LoadConfigFile(CSIDL_APPDATA, CONFIG_LAYER_USER);
+    LoadConfigRegistry(HKEY_LOCAL_MACHINE, &g_config);
+    LoadConfigRegistry(HKEY_LOCAL_MACHINE, &g_updateConfig);
+    LoadConfigRegistry(HKEY_CURRENT_USER, &g_config);
+
+    if (g_config.dropped > 0) {
+        WCHAR line[128];
+        StringCchPrintfW(line, ARRAYSIZE(line),
+            L"TeacherToolkit: config full, %d setting(s) ignored\n", g_config.dropped);
+        OutputDebugStringW(line);
+    }
+
+    ApplyConfig();
+}
+
+static void ApplyConfigString(const ConfigTable* table, const char* key, WCHAR* out, DWORD cch)
+{
+    const char* text = ConfigGet(table, key);
+    if (!text || MultiByteToWideChar(CP_UTF8, 0, text, -1, out, (int)cch) == 0)
+        out[0] = L'\0';
+}
+
+void ApplyConfig()
+{
+    ApplyConfigString(&g_config, "author", g_szAuthor, ARRAYSIZE(g_szAuthor));
+    ApplyConfigString(&g_updateConfig, "github_repo", g_szGitHubRepo, ARRAYSIZE(g_szGitHubRepo));
+    ApplyConfigString(&g_updateConfig, "update_url", g_szUpdateUrl, ARRAYSIZE(g_szUpdateUrl));
+    g_bAutoUpdate   = ConfigGetBool(&g_updateConfig, "auto_update", false);
+    g_nDownloadKBps = (DWORD)ConfigGetInt(&g_updateConfig, "download_kbps", UPDATE_DOWNLOAD_KBPS, 0, 1000000);
+
+    RuntimeConfig old = g_cfg;
+    g_cfg.monitorPollMs = (UINT)ConfigGetInt(&g_config, "monitor_poll_ms", MONITOR_POLL_MS, 250, 60000);
+    g_cfg.mirrorFpsMs   = (UINT)ConfigGetInt(&g_config, "mirror_fps_ms", MIRROR_FPS_MS, 5, 1000);
+    g_cfg.mirrorHiResClock = ConfigGetBool(&g_config, "mirror_clock", true);
+    g_cfg.mirrorVsync   = ConfigGetBool(&g_config, "mirror_vsync", true);
+    g_cfg.extendRetryMs = (UINT)ConfigGetInt(&g_config, "extend_retry_ms", EXTEND_RETRY_MS, 100, 10000);
+    g_cfg.overlapMinPx  = ConfigGetInt(&g_config, "overlap_min_px", WINDOW_OVERLAP_MIN_PX, 0, 4096);
+    g_cfg.traceMaxKB    = ConfigGetInt(&g_config, "trace_max_kb", TRACE_MAX_KB, 64, 65536);
+    g_cfg.annotWidthPx  = ConfigGetInt(&g_config, "annotate_width", ANNOT_WIDTH_PX, 1, 32);
+    g_cfg.regionClassify = ConfigGetBool(&g_config, "region_classify", true);
+    g_cfg.replayMB      = ConfigGetInt(&g_config, "replay_mb", REPLAY_MB, 0, 1024);
+    g_cfg.replayMinutes = ConfigGetInt(&g_config, "replay_minutes", REPLAY_MINUTES, 1, 60);
+    g_cfg.replayIntervalMs = (UINT)ConfigGetInt(&g_config, "replay_interval_ms", REPLAY_INTERVAL_MS, 100, 60000);
+    g_cfg.frameShare    = ConfigGetBool(&g_config, "frame_share", true);
+    g_cfg.slidesAuto    = ConfigGetBool(&g_config, "slides", false);
+    g_cfg.slidesPdf     = ConfigGetBool(&g_config, "slides_pdf", true);
+    g_cfg.profiles      = ConfigGetBool(&g_config, "profiles", true);
+    LoadMaskRules();
+    LoadWarpConfig();
+
+    BOOL trace = ConfigGetBool(&g_config, "trace", true);
+    TraceSetEnabled(trace != FALSE);
+    if (trace) StartTraceWriter();
+
+    // SetTimer on a live timer ID just re-arms it with the new period;
+    // suspension arms them again on its own
+    if (g_hHidden && !g_suspendFlags && g_cfg.monitorPollMs != old.monitorPollMs)
+        SetTimer(g_hHidden, IDT_MONITOR_POLL, g_cfg.monitorPollMs, nullptr);
+    if (g_hHidden && g_bExtendPending && g_cfg.extendRetryMs != old.extendRetryMs)
+        SetTimer(g_hHidden, IDT_EXTEND_RETRY, g_cfg.extendRetryMs, nullptr);
+    if (g_hMirror && !g_suspendFlags &&
+        (g_cfg.mirrorFpsMs != old.mirrorFpsMs || g_cfg.mirrorHiResClock != old.mirrorHiResClock ||
+         g_cfg.mirrorVsync != old.mirrorVsync))
+        StartFrameClock();
+    if (g_bProjecting && g_cfg.frameShare != old.frameShare) {
+        if (g_cfg.frameShare) StartFrameShare();
+        else                  StopFrameShare();
+    }
+    if (g_bProjecting && g_cfg.slidesAuto && !old.slidesAuto)
+        StartSlideCapture();
+    if (g_bProjecting && !g_soak.active) {
+        if (g_cfg.profiles) StartProfiles();        // profile values may have changed too
+        else                StopProfiles();
+    }
+}
+
+// � Config hot reload �������������������������������������������������
+// A watcher thread sleeps on change notifications for both config folders
+// (or their parent while the folder does not exist yet) and on the HKCU
+// Config key, and posts WM_CONFIGCHANGED when something relevant changed.
+
+static HANDLE WatchConfigDir(int csidl)
+{
+    WCHAR dir[MAX_PATH];
+    if (!GetConfigDir(csidl, dir, MAX_PATH)) return INVALID_HANDLE_VALUE;
+
+    DWORD attrs = GetFileAttributesW(dir);
+    if (attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_DIRECTORY))
+        return FindFirstChangeNotificationW(dir, FALSE,
+            FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+
+    WCHAR* lastSlash = wcsrchr(dir, L'\\');
+    if (!lastSlash) return INVALID_HANDLE_VALUE;
+    *lastSlash = L'\0';
+    return FindFirstChangeNotificationW(dir, FALSE, FILE_NOTIFY_CHANGE_DIR_NAME);
+}
+
+// Last-write times of both config files: the %APPDATA% folder also holds
+// the startup copy and update downloads, which must not trigger reloads.
+static void GetConfigFileTimes(FILETIME* times)
+{
+    const int csidls[2] = { CSIDL_COMMON_APPDATA, CSIDL_APPDATA };
+    for (int i = 0; i < 2; i++) {
+        WCHAR path[MAX_PATH];
+        WIN32_FILE_ATTRIBUTE_DATA fad;
+        ZeroMemory(&times[i], sizeof(FILETIME));
+        if (GetConfigDir(csidls[i], path, MAX_PATH) &&
+            SUCCEEDED(StringCchCatW(path, MAX_PATH, L"\\config.ini")) &&
+            GetFileAttributesExW(path, GetFileExInfoStandard, &fad))
+            times[i] = fad.ftLastWriteTime;
+    }
+}
+
+static DWORD WINAPI ConfigWatchProc(LPVOID)
+{
+    HKEY hKey = nullptr;
+    RegCreateKeyExW(HKEY_CURRENT_USER, REG_CONFIG_KEY, 0, nullptr, 0,
+                    KEY_NOTIFY, nullptr, &hKey, nullptr);
+    HANDLE hRegEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+
+    FILETIME seen[2];
+    GetConfigFileTimes(seen);
+
+    for (;;) {
+        HANDLE handles[3];
+        DWORD count = 0;
+        HANDLE hMachine = WatchConfigDir(CSIDL_COMMON_APPDATA);
+        HANDLE hUser = WatchConfigDir(CSIDL_APPDATA);
+        if (hMachine != INVALID_HANDLE_VALUE) handles[count++] = hMachine;
+        if (hUser != INVALID_HANDLE_VALUE)    handles[count++] = hUser;
+
+        DWORD regIndex = MAXDWORD;
+        if (hKey && hRegEvent &&
+            RegNotifyChangeKeyValue(hKey, FALSE, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET,
+                                    hRegEvent, TRUE) == ERROR_SUCCESS) {
+            regIndex = count;
+            handles[count++] = hRegEvent;
         }
+        if (count == 0) break;
+
+        DWORD rc = WaitForMultipleObjects(count, handles, FALSE, INFINITE);
+        if (hMachine != INVALID_HANDLE_VALUE) FindCloseChangeNotification(hMachine);
+        if (hUser != INVALID_HANDLE_VALUE)    FindCloseChangeNotification(hUser);
+        if (rc >= WAIT_OBJECT_0 + count) break;
+
+        Sleep(CONFIG_RELOAD_SETTLE_MS);
+
+        FILETIME now[2];
+        GetConfigFileTimes(now);
+        BOOL changed = (rc - WAIT_OBJECT_0 == regIndex) ||
+                       CompareFileTime(&now[0], &seen[0]) != 0 ||
+                       CompareFileTime(&now[1], &seen[1]) != 0;
+        seen[0] = now[0];
+        seen[1] = now[1];
+        if (changed)
+            PostMessage(g_hHidden, WM_CONFIGCHANGED, 0, 0);
+    }
 
-        // Skip to next line
-        while (p < end && *p != '\n') p++;
+    if (hRegEvent) CloseHandle(hRegEvent);
+    if (hKey) RegCloseKey(hKey);
+    return 0;
+}
+
+void StartConfigWatcher()
+{
+    HANDLE hThread = CreateThread(nullptr, 0, ConfigWatchProc, nullptr, 0, nullptr);
+    if (hThread) {
+        SetThreadPriority(hThread, THREAD_PRIORITY_BELOW_NORMAL);
+        CloseHandle(hThread);
     }
-    return FALSE;
 }
 
-void LoadLocalConfig()
+// � Trace log writer ��������������������������������������������������
+// The tracer itself (TraceLog.cpp) only fills per-thread rings; this thread
+// drains them to %LOCALAPPDATA%\TeacherToolkit\trace.ttt once a second.
+// Decode with tools/TraceDecode.
+
+static HANDLE g_hTraceThread = nullptr;
+static HANDLE g_hTraceStop   = nullptr;
+
+BOOL GetTracePath(WCHAR* buf, DWORD cch)
 {
-    HRSRC hRes = FindResourceW(hInst, MAKEINTRESOURCEW(IDR_CONFIG), RT_RCDATA);
-    if (!hRes) return;
+    WCHAR dir[MAX_PATH];
+    if (!GetConfigDir(CSIDL_LOCAL_APPDATA, dir, MAX_PATH)) return FALSE;
+    CreateDirectoryW(dir, nullptr);
+    return SUCCEEDED(StringCchPrintfW(buf, cch, L"%s\\trace.ttt", dir));
+}
+
+static DWORD WINAPI TraceWriterProc(LPVOID param)
+{
+    TraceFile* file = (TraceFile*)param;
+    while (WaitForSingleObject(g_hTraceStop, TRACE_FLUSH_MS) == WAIT_TIMEOUT)
+        TraceFlush(file);
+    TraceFlush(file);
+    TraceFileClose(file);
+    HeapFree(GetProcessHeap(), 0, file);
+    return 0;
+}
+
+void StartTraceWriter()
+{
+    if (g_hTraceThread) return;
+
+    WCHAR path[MAX_PATH];
+    if (!GetTracePath(path, MAX_PATH)) return;
 
-    HGLOBAL hData = LoadResource(hInst, hRes);
-    if (!hData) return;
+    auto* file = (TraceFile*)HeapAlloc(GetProcessHeap(), 0, sizeof(TraceFile));
+    if (!file) return;
+    if (!TraceFileOpen(file, path, (uint64_t)g_cfg.traceMaxKB * 1024)) {
+        HeapFree(GetProcessHeap(), 0, file);
+        return;
+    }
 
-    const char* data = (const char*)LockResource(hData);
-    DWORD dataLen = SizeofResource(hInst, hRes);
-    if (!data || dataLen == 0) return;
+    g_hTraceStop = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    g_hTraceThread = g_hTraceStop ? CreateThread(nullptr, 0, TraceWriterProc, file, 0, nullptr) : nullptr;
+    if (!g_hTraceThread) {
+        TraceFileClose(file);
+        HeapFree(GetProcessHeap(), 0, file);
+        if (g_hTraceStop) { CloseHandle(g_hTraceStop); g_hTraceStop = nullptr; }
+        return;
+    }
+    SetThreadPriority(g_hTraceThread, THREAD_PRIORITY_BELOW_NORMAL);
+}
 
-    ParseIniValue(data, dataLen, "author", g_szAuthor, ARRAYSIZE(g_szAuthor));
-    ParseIniValue(data, dataLen, "github_repo", g_szGitHubRepo, ARRAYSIZE(g_szGitHubRepo));
+// Final flush on exit, so the last seconds before a quit are on disk.
+void StopTraceWriter()
+{
+    if (!g_hTraceThread) return;
+    SetEvent(g_hTraceStop);
+    WaitForSingleObject(g_hTraceThread, 1000);
+    CloseHandle(g_hTraceThread);
+    CloseHandle(g_hTraceStop);
+    g_hTraceThread = nullptr;
+    g_hTraceStop = nullptr;
 }
 
 // � Version comparison ������������������������������������������������
@@ -215,70 +866,270 @@ void SetVersionSkipped(const WCHAR* version)
 }
 
 // � Update check (GitHub API) �����������������������������������������
-// Fetches /repos/{owner}/{repo}/releases/latest from the GitHub API.
-// Parses "tag_name" from the JSON response to get the latest version.
-BOOL CheckForUpdate()
+// The last answer is cached in the registry together with its ETag and
+// Last-Modified validators. At most one request goes out per day, and it
+// is conditional, so GitHub normally answers 304 with an empty body. The
+// cache belongs to the URL it was fetched from and is dropped when
+// update_url or github_repo point elsewhere; a failed check keeps it.
+struct UpdateCache {
+    WCHAR     source[512];      // metadata URL the answer came from
+    WCHAR     etag[128];
+    WCHAR     lastModified[64];
+    WCHAR     latestVer[64];
+    ULONGLONG lastCheck;        // FILETIME of the last successful check
+
+    // The release's TeacherToolkit.exe asset, for the background download
+    WCHAR     assetUrl[RELEASE_MAX_URL];
+    WCHAR     assetDigest[RELEASE_MAX_DIGEST];
+    ULONGLONG assetSize;
+};
+
+static void ReadRegString(HKEY hKey, const WCHAR* name, WCHAR* out, DWORD cch)
 {
-    g_bUpdateAvailable = FALSE;
-    g_szLatestVer[0] = L'\0';
+    DWORD cb = cch * sizeof(WCHAR);
+    DWORD type = 0;
+    if (RegQueryValueExW(hKey, name, nullptr, &type, (BYTE*)out, &cb) != ERROR_SUCCESS ||
+        type != REG_SZ) {
+        out[0] = L'\0';
+        return;
+    }
+    out[cch - 1] = L'\0';
+}
 
-    if (g_szGitHubRepo[0] == L'\0')
-        return FALSE;
+static void WriteRegString(HKEY hKey, const WCHAR* name, const WCHAR* value)
+{
+    RegSetValueExW(hKey, name, 0, REG_SZ, (const BYTE*)value,
+                   (DWORD)((wcslen(value) + 1) * sizeof(WCHAR)));
+}
+
+static void LoadUpdateCache(UpdateCache* cache)
+{
+    ZeroMemory(cache, sizeof(*cache));
+    HKEY hKey;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, REG_KEY, 0, KEY_READ, &hKey) != ERROR_SUCCESS)
+        return;
+
+    ReadRegString(hKey, REG_UPDATE_SOURCE, cache->source, ARRAYSIZE(cache->source));
+    ReadRegString(hKey, REG_UPDATE_ETAG, cache->etag, ARRAYSIZE(cache->etag));
+    ReadRegString(hKey, REG_UPDATE_MODIFIED, cache->lastModified, ARRAYSIZE(cache->lastModified));
+    ReadRegString(hKey, REG_UPDATE_LATEST, cache->latestVer, ARRAYSIZE(cache->latestVer));
+    ReadRegString(hKey, REG_UPDATE_ASSET_URL, cache->assetUrl, ARRAYSIZE(cache->assetUrl));
+    ReadRegString(hKey, REG_UPDATE_ASSET_SHA, cache->assetDigest, ARRAYSIZE(cache->assetDigest));
+
+    DWORD cb = sizeof(cache->lastCheck);
+    DWORD type = 0;
+    if (RegQueryValueExW(hKey, REG_UPDATE_CHECKED, nullptr, &type,
+                         (BYTE*)&cache->lastCheck, &cb) != ERROR_SUCCESS || type != REG_QWORD)
+        cache->lastCheck = 0;
+    cb = sizeof(cache->assetSize);
+    if (RegQueryValueExW(hKey, REG_UPDATE_ASSET_SIZE, nullptr, &type,
+                         (BYTE*)&cache->assetSize, &cb) != ERROR_SUCCESS || type != REG_QWORD)
+        cache->assetSize = 0;
+    RegCloseKey(hKey);
+}
+
+static void SaveUpdateCache(const UpdateCache* cache)
+{
+    HKEY hKey;
+    if (RegCreateKeyExW(HKEY_CURRENT_USER, REG_KEY, 0, nullptr,
+                        0, KEY_WRITE, nullptr, &hKey, nullptr) != ERROR_SUCCESS)
+        return;
+
+    WriteRegString(hKey, REG_UPDATE_SOURCE, cache->source);
+    WriteRegString(hKey, REG_UPDATE_ETAG, cache->etag);
+    WriteRegString(hKey, REG_UPDATE_MODIFIED, cache->lastModified);
+    WriteRegString(hKey, REG_UPDATE_LATEST, cache->latestVer);
+    WriteRegString(hKey, REG_UPDATE_ASSET_URL, cache->assetUrl);
+    WriteRegString(hKey, REG_UPDATE_ASSET_SHA, cache->assetDigest);
+    RegSetValueExW(hKey, REG_UPDATE_CHECKED, 0, REG_QWORD,
+                   (const BYTE*)&cache->lastCheck, sizeof(cache->lastCheck));
+    RegSetValueExW(hKey, REG_UPDATE_ASSET_SIZE, 0, REG_QWORD,
+                   (const BYTE*)&cache->assetSize, sizeof(cache->assetSize));
+    RegCloseKey(hKey);
+}
+
+static ULONGLONG GetFileTimeNow()
+{
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    ULARGE_INTEGER now;
+    now.LowPart  = ft.dwLowDateTime;
+    now.HighPart = ft.dwHighDateTime;
+    return now.QuadPart;
+}
 
-    WCHAR url[512];
-    StringCchPrintfW(url, ARRAYSIZE(url),
-        L"https://api.github.com/repos/%s/releases/latest", g_szGitHubRepo);
+// Turns a release tag ("vX.Y.Z" or "X.Y.Z") into the stored version string.
+static BOOL ReleaseTagToVersion(const char* tag, WCHAR* latestOut, DWORD latestCch)
+{
+    if (*tag == 'v' || *tag == 'V') tag++;
+    if (*tag == '\0') return FALSE;
+    return MultiByteToWideChar(CP_UTF8, 0, tag, -1, latestOut, latestCch) > 0;
+}
 
+// Sends a conditional GET for the release metadata. Returns TRUE when the
+// cache holds a valid answer afterwards (fresh 200 or 304 Not Modified).
+static BOOL FetchLatestRelease(const WCHAR* url, UpdateCache* cache)
+{
     HINTERNET hInet = InternetOpenW(L"TeacherToolkit/" APP_VERSION,
         INTERNET_OPEN_TYPE_PRECONFIG, nullptr, nullptr, 0);
     if (!hInet) return FALSE;
 
-    HINTERNET hUrl = InternetOpenUrlW(hInet, url, nullptr, 0,
-        INTERNET_FLAG_SECURE | INTERNET_FLAG_NO_CACHE_WRITE | INTERNET_FLAG_RELOAD, 0);
+    // Captive proxies on school networks can otherwise hold the worker for
+    // minutes; WinINet's defaults are far too generous.
+    DWORD timeout = UPDATE_TIMEOUT_MS;
+    InternetSetOptionW(hInet, INTERNET_OPTION_CONNECT_TIMEOUT, &timeout, sizeof(timeout));
+    InternetSetOptionW(hInet, INTERNET_OPTION_SEND_TIMEOUT, &timeout, sizeof(timeout));
+    InternetSetOptionW(hInet, INTERNET_OPTION_RECEIVE_TIMEOUT, &timeout, sizeof(timeout));
+
+    WCHAR headers[512] = L"";
+    if (cache->latestVer[0] != L'\0') {
+        WCHAR line[256];
+        if (cache->etag[0] != L'\0') {
+            StringCchPrintfW(line, ARRAYSIZE(line), L"If-None-Match: %s\r\n", cache->etag);
+            StringCchCatW(headers, ARRAYSIZE(headers), line);
+        }
+        if (cache->lastModified[0] != L'\0') {
+            StringCchPrintfW(line, ARRAYSIZE(line), L"If-Modified-Since: %s\r\n", cache->lastModified);
+            StringCchCatW(headers, ARRAYSIZE(headers), line);
+        }
+    }
+
+    DWORD flags = INTERNET_FLAG_NO_CACHE_WRITE | INTERNET_FLAG_RELOAD | INTERNET_FLAG_NO_UI;
+    if (_wcsnicmp(url, L"https:", 6) == 0)
+        flags |= INTERNET_FLAG_SECURE;
+
+    HINTERNET hUrl = InternetOpenUrlW(hInet, url,
+        headers[0] ? headers : nullptr, headers[0] ? (DWORD)-1L : 0, flags, 0);
     if (!hUrl) {
         InternetCloseHandle(hInet);
         return FALSE;
     }
 
-    char buf[4096] = {};
-    DWORD totalRead = 0;
-    DWORD bytesRead = 0;
-    while (InternetReadFile(hUrl, buf + totalRead,
-           (DWORD)(sizeof(buf) - 1 - totalRead), &bytesRead) && bytesRead > 0) {
-        totalRead += bytesRead;
-        if (totalRead >= sizeof(buf) - 1) break;
+    DWORD status = 0;
+    DWORD cbStatus = sizeof(status);
+    HttpQueryInfoW(hUrl, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER,
+                   &status, &cbStatus, nullptr);
+
+    BOOL result = FALSE;
+    if (status == HTTP_STATUS_NOT_MODIFIED) {
+        result = (cache->latestVer[0] != L'\0');
+    }
+    else if (status == HTTP_STATUS_OK) {
+        // The body is streamed through the JSON scanner chunk by chunk, so
+        // the fields are found wherever they sit in the response.
+        ReleaseInfo release;
+        ReleaseInfoInit(&release, RELEASE_ASSET_NAME);
+
+        char chunk[4096];
+        DWORD bytesRead = 0;
+        BOOL parsed = TRUE;
+        while (InternetReadFile(hUrl, chunk, sizeof(chunk), &bytesRead) && bytesRead > 0) {
+            if (!ReleaseInfoFeed(&release, chunk, bytesRead)) {
+                parsed = FALSE;
+                break;
+            }
+        }
+
+        WCHAR latest[64];
+        if (parsed && ReleaseInfoFinish(&release) &&
+            ReleaseTagToVersion(release.tagName, latest, ARRAYSIZE(latest))) {
+            StringCchCopyW(cache->latestVer, ARRAYSIZE(cache->latestVer), latest);
+
+            cache->assetUrl[0] = L'\0';
+            cache->assetDigest[0] = L'\0';
+            cache->assetSize = 0;
+            if (release.haveAsset) {
+                MultiByteToWideChar(CP_UTF8, 0, release.asset.url, -1,
+                                    cache->assetUrl, ARRAYSIZE(cache->assetUrl));
+                MultiByteToWideChar(CP_UTF8, 0, release.asset.digest, -1,
+                                    cache->assetDigest, ARRAYSIZE(cache->assetDigest));
+                cache->assetSize = release.asset.size;
+            }
+
+            DWORD cb = sizeof(cache->etag);
+            if (!HttpQueryInfoW(hUrl, HTTP_QUERY_ETAG, cache->etag, &cb, nullptr))
+                cache->etag[0] = L'\0';
+            cb = sizeof(cache->lastModified);
+            if (!HttpQueryInfoW(hUrl, HTTP_QUERY_LAST_MODIFIED, cache->lastModified, &cb, nullptr))
+                cache->lastModified[0] = L'\0';
+            result = TRUE;
+        }
     }
-    buf[totalRead] = '\0';
 
     InternetCloseHandle(hUrl);
     InternetCloseHandle(hInet);
+    return result;
+}
 
-    // Simple JSON parse for "tag_name":"vX.Y.Z" or "tag_name":"X.Y.Z"
-    const char* tagKey = "\"tag_name\"";
-    char* pos = strstr(buf, tagKey);
-    if (!pos) return FALSE;
+// UI thread: update_url, else the GitHub API for github_repo.
+static void GetUpdateSettings(UpdateSettings* out)
+{
+    out->url[0] = L'\0';
+    if (g_szUpdateUrl[0] != L'\0')
+        StringCchCopyW(out->url, ARRAYSIZE(out->url), g_szUpdateUrl);
+    else if (g_szGitHubRepo[0] != L'\0')
+        StringCchPrintfW(out->url, ARRAYSIZE(out->url),
+            L"https://api.github.com/repos/%s/releases/latest", g_szGitHubRepo);
+    out->autoUpdate   = g_bAutoUpdate;
+    out->downloadKBps = g_nDownloadKBps;
+}
+
+// Runs on the startup worker thread: it only reads its own copy of the
+// settings and reports through latestOut, leaving the update globals to
+// the UI thread.
+BOOL CheckForUpdate(const UpdateSettings* settings, WCHAR* latestOut, DWORD latestCch)
+{
+    latestOut[0] = L'\0';
 
-    pos += strlen(tagKey);
-    while (*pos == ' ' || *pos == ':' || *pos == '"') pos++;
-    if (*pos == 'v' || *pos == 'V') pos++;
+    const WCHAR* url = settings->url;
+    if (url[0] == L'\0') return FALSE;
 
-    char ver[64] = {};
-    int vi = 0;
-    while (*pos && *pos != '"' && vi < 63) {
-        ver[vi++] = *pos++;
+    UpdateCache cache;
+    LoadUpdateCache(&cache);
+    if (wcscmp(cache.source, url) != 0) {
+        // Another server: its validators and "latest" mean nothing here
+        ZeroMemory(&cache, sizeof(cache));
+        StringCchCopyW(cache.source, ARRAYSIZE(cache.source), url);
     }
-    ver[vi] = '\0';
 
-    if (vi == 0) return FALSE;
+    ULONGLONG now = GetFileTimeNow();
+    BOOL fresh = cache.latestVer[0] != L'\0' && cache.lastCheck <= now &&
+                 now - cache.lastCheck < UPDATE_CHECK_INTERVAL;
+    if (!fresh) {
+        if (FetchLatestRelease(url, &cache)) {
+            cache.lastCheck = now;
+            SaveUpdateCache(&cache);
+        } else if (cache.latestVer[0] == L'\0') {
+            return FALSE;
+        }
+        // Offline or a server error: the last good answer stands, and the
+        // next launch asks again
+    }
 
-    // Convert to wide for storage
-    MultiByteToWideChar(CP_UTF8, 0, ver, -1, g_szLatestVer, ARRAYSIZE(g_szLatestVer));
+    StringCchCopyW(latestOut, latestCch, cache.latestVer);
 
-    if (IsVersionNewer(ver, APP_VERSION_A)) {
-        g_bUpdateAvailable = TRUE;
-        return TRUE;
+    char ver[64];
+    WideCharToMultiByte(CP_UTF8, 0, cache.latestVer, -1, ver, sizeof(ver), nullptr, nullptr);
+    return IsVersionNewer(ver, APP_VERSION_A);
+}
+
+// Where "Transferir agora" goes: the release page for github_repo, else
+// the asset (or failing that the metadata) the update_url server
+// announced. Only http(s) URLs are handed to ShellExecute.
+static BOOL GetUpdateDownloadUrl(WCHAR* url, DWORD cch)
+{
+    if (g_szUpdateUrl[0] == L'\0') {
+        if (g_szGitHubRepo[0] == L'\0') return FALSE;
+        return SUCCEEDED(StringCchPrintfW(url, cch, L"https://github.com/%s/releases/latest", g_szGitHubRepo));
     }
-    return FALSE;
+
+    UpdateCache cache;
+    LoadUpdateCache(&cache);
+    if (wcscmp(cache.source, g_szUpdateUrl) != 0) return FALSE;
+    const WCHAR* target = cache.assetUrl[0] != L'\0' ? cache.assetUrl : cache.source;
+    if (_wcsnicmp(target, L"https://", 8) != 0 && _wcsnicmp(target, L"http://", 7) != 0)
+        return FALSE;
+    return SUCCEEDED(StringCchCopyW(url, cch, target));
 }
 
 void PromptUpdate(HWND hWnd)
@@ -318,10 +1169,9 @@ void PromptUpdate(HWND hWnd)
     if (FAILED(hr)) return;
 
     if (pressed == IDB_UPDATE_DOWNLOAD) {
-        WCHAR url[512];
-        StringCchPrintfW(url, ARRAYSIZE(url),
-            L"https://github.com/%s/releases/latest", g_szGitHubRepo);
-        ShellExecuteW(nullptr, L"open", url, nullptr, nullptr, SW_SHOWNORMAL);
+        WCHAR url[RELEASE_MAX_URL];
+        if (GetUpdateDownloadUrl(url, ARRAYSIZE(url)))
+            ShellExecuteW(nullptr, L"open", url, nullptr, nullptr, SW_SHOWNORMAL);
     }
     else if (pressed == IDB_UPDATE_SKIP) {
         SetVersionSkipped(g_szLatestVer);
@@ -354,102 +1204,623 @@ void ShowAboutDialog(HWND hWnd)
     MessageBoxIndirectW(&mbp);
 }
 
-// � Monitor enumeration �����������������������������������������������
-struct MonitorEnumData {
-    int   count;
-    RECT  rcPrimary;
-    RECT  rcSecondary;
-    BOOL  foundPrimary;
-    BOOL  foundSecondary;
-};
-
-static BOOL CALLBACK MonitorEnumProc(HMONITOR hMon, HDC, LPRECT, LPARAM lParam)
+// � Diagnostics �������������������������������������������������������
+static void AppendStartupLine(WCHAR* buf, size_t cch, const WCHAR* label,
+                              StartupMilestone milestone, BOOL withTarget)
 {
-    auto* data = reinterpret_cast<MonitorEnumData*>(lParam);
-    MONITORINFOEX mi = {};
-    mi.cbSize = sizeof(mi);
-    GetMonitorInfo(hMon, &mi);
-
-    if (mi.dwFlags & MONITORINFOF_PRIMARY) {
-        data->rcPrimary = mi.rcMonitor;
-        data->foundPrimary = TRUE;
+    WCHAR line[160];
+    double ms = g_startup.msAt[milestone];
+    if (ms < 0.0) {
+        StringCchPrintfW(line, ARRAYSIZE(line), L"  %s: \x2014\n", label);
+    } else if (withTarget) {
+        StringCchPrintfW(line, ARRAYSIZE(line), L"  %s: %.1f ms %s (objetivo < %.0f ms)\n",
+            label, ms, ms <= STARTUP_TARGET_MS ? L"\x2714" : L"\x2716", STARTUP_TARGET_MS);
     } else {
-        data->rcSecondary = mi.rcMonitor;
-        data->foundSecondary = TRUE;
+        StringCchPrintfW(line, ARRAYSIZE(line), L"  %s: %.1f ms\n", label, ms);
     }
-    data->count++;
-    return TRUE;
+    StringCchCatW(buf, cch, line);
 }
 
-BOOL HasSecondMonitor(RECT* rcPrimary, RECT* rcSecond)
+static void BuildDiagnosticsText(WCHAR* buf, size_t cch)
 {
-    MonitorEnumData data = {};
-    EnumDisplayMonitors(nullptr, nullptr, MonitorEnumProc, reinterpret_cast<LPARAM>(&data));
-    if (data.count >= 2 && data.foundSecondary) {
-        if (rcPrimary) *rcPrimary = data.rcPrimary;
-        if (rcSecond)  *rcSecond  = data.rcSecondary;
-        return TRUE;
+    buf[0] = L'\0';
+    StringCchCatW(buf, cch, L"Arranque (desde o in\x00ED" L"cio do processo)\n");
+    AppendStartupLine(buf, cch, L"\x00CD" L"cone na barra de tarefas", STARTUP_TRAY_ICON, FALSE);
+    AppendStartupLine(buf, cch, L"Primeira imagem projetada", STARTUP_FIRST_FRAME, TRUE);
+
+    static const WCHAR* const layerNames[CONFIG_LAYER_COUNT] = {
+        L"config.ini embutido", L"ficheiro da m\x00E1quina", L"ficheiro do utilizador", L"registo",
+    };
+    struct { const char* key; int value; } knobs[] = {
+        { "mirror_fps_ms",   (int)g_cfg.mirrorFpsMs },
+        { "mirror_clock",    g_cfg.mirrorHiResClock },
+        { "mirror_vsync",    g_cfg.mirrorVsync },
+        { "monitor_poll_ms", (int)g_cfg.monitorPollMs },
+        { "extend_retry_ms", (int)g_cfg.extendRetryMs },
+        { "overlap_min_px",  g_cfg.overlapMinPx },
+        { "region_classify", g_cfg.regionClassify },
+        { "replay_mb",       g_cfg.replayMB },
+        { "replay_minutes",  g_cfg.replayMinutes },
+        { "frame_share",     g_cfg.frameShare },
+        { "slides",          g_cfg.slidesAuto },
+        { "slides_pdf",      g_cfg.slidesPdf },
+        { "profiles",        g_cfg.profiles },
+    };
+    StringCchCatW(buf, cch, L"\nConfigura\x00E7\x00E3o\n");
+    if (g_config.dropped > 0) {
+        WCHAR line[160];
+        StringCchPrintfW(line, ARRAYSIZE(line),
+            L"  %d defini\x00E7\x00F5" L"es ignoradas: demasiadas chaves ou texto\n", g_config.dropped);
+        StringCchCatW(buf, cch, line);
+    }
+    for (int i = 0; i < (int)ARRAYSIZE(knobs); i++) {
+        int layer = ConfigLayerOf(&g_config, knobs[i].key);
+        WCHAR line[160];
+        StringCchPrintfW(line, ARRAYSIZE(line), L"  %S = %d (%s)\n", knobs[i].key, knobs[i].value,
+            layer >= 0 && layer < CONFIG_LAYER_COUNT ? layerNames[layer] : L"predefini\x00E7\x00E3o");
+        StringCchCatW(buf, cch, line);
+    }
+
+    if (g_bProjecting) {
+        WCHAR line[160];
+        StringCchPrintfW(line, ARRAYSIZE(line), L"\nProjetor\n  %S, corre\x00E7\x00E3o de trap\x00E9zio %s\n",
+            g_szProjectorId[0] ? g_szProjectorId : "?", g_bWarpEnabled ? L"ativa" : L"desligada");
+        StringCchCatW(buf, cch, line);
+        AppendDpiText(buf, cch);
+        AppendPacingText(buf, cch);
+        AppendProfileText(buf, cch);
+        AppendLatencyText(buf, cch);
+        AppendReplayText(buf, cch);
+        AppendFrameShareText(buf, cch);
+    }
+    AppendSlidesText(buf, cch);
+
+    AppendMemoryText(buf, cch);
+
+    WCHAR tracePath[MAX_PATH];
+    if (TraceIsEnabled() && GetTracePath(tracePath, MAX_PATH)) {
+        StringCchCatW(buf, cch, L"\nRegisto de eventos\n  ");
+        StringCchCatW(buf, cch, tracePath);
+        StringCchCatW(buf, cch, L"\n");
     }
-    return FALSE;
 }
 
-struct WindowEnumData {
-    RECT rcSecond;
-    RECT rcPrimary;
-    BOOL moveWindows;
-    BOOL occupied;
+void ShowDiagnosticsDialog(HWND hWnd)
+{
+    WCHAR text[4096];
+    BuildDiagnosticsText(text, ARRAYSIZE(text));
+    MessageBoxW(hWnd, text, L"Diagn\x00F3stico \x2014 TeacherToolkit", MB_OK | MB_ICONINFORMATION);
+}
+
+// � Privacy masks �����������������������������������������������������
+// Config:
+//   mask_process=outlook.exe;keepass.exe   executables whose windows are hidden
+//   mask_class=Chrome_WidgetWin_1          window classes likewise
+//   mask_regions=0,1040,400,40;...          fixed x,y,w,h areas of the primary
+//   mask_mode=black | pixelate              mask_block_px=24
+// Matching windows are collected during the per-frame window pass
+// (MoveOtherWindowsToPrimaryFromSecond) and blanked before scaling.
+
+struct MaskRules {
+    WCHAR    processes[MASK_MAX_RULES][64];
+    int      processCount;
+    WCHAR    classes[MASK_MAX_RULES][64];
+    int      classCount;
+    MaskRect regions[MASK_MAX_RULES];
+    int      regionCount;
+    MaskMode mode;
+    int      blockPx;
+};
+static MaskRules g_maskRules = {};
+static MaskSet   g_maskSet;
+
+// Process lookups are too slow for every window on every frame; remember
+// the answer per process, for as many processes as have windows. Each entry
+// holds its process open, and Windows never reuses the PID of a process
+// while a handle to it is open, so an answer can never be applied to a
+// different program. Processes that have exited are dropped every
+// MASK_CACHE_SWEEP_MS.
+struct MaskMatchCacheEntry {
+    DWORD  pid;
+    HANDLE hProcess;            // pins the PID; nullptr = could not open, expires at the sweep
+    BOOL   match;
 };
+static std::vector<MaskMatchCacheEntry> g_maskCache;    // sorted by pid
+static ULONGLONG g_maskCacheSwept = 0;
 
-static int ClampToRange(int value, int minVal, int maxVal)
+static void ClearMaskCache()
 {
-    if (value < minVal) return minVal;
-    if (value > maxVal) return maxVal;
-    return value;
+    for (const MaskMatchCacheEntry& e : g_maskCache)
+        if (e.hProcess) CloseHandle(e.hProcess);
+    std::vector<MaskMatchCacheEntry>().swap(g_maskCache);
 }
 
-static BOOL CALLBACK EnumWindowsOnSecondMonitorProc(HWND hWnd, LPARAM lParam)
+static int SplitConfigList(const char* key, WCHAR (*out)[64], int max)
 {
-    auto* data = reinterpret_cast<WindowEnumData*>(lParam);
-    if (!data) return FALSE;
+    const char* value = ConfigGet(&g_config, key);
+    if (!value) return 0;
+
+    WCHAR list[512];
+    if (MultiByteToWideChar(CP_UTF8, 0, value, -1, list, ARRAYSIZE(list)) == 0) return 0;
+
+    int count = 0;
+    WCHAR* context = nullptr;
+    for (WCHAR* item = wcstok_s(list, L";,", &context); item && count < max;
+         item = wcstok_s(nullptr, L";,", &context)) {
+        while (*item == L' ') item++;
+        size_t len = wcslen(item);
+        while (len > 0 && item[len - 1] == L' ') item[--len] = L'\0';
+        if (len > 0) StringCchCopyW(out[count++], 64, item);
+    }
+    return count;
+}
 
-    if (hWnd == g_hMirror || hWnd == g_hHidden)
-        return TRUE;
+void LoadMaskRules()
+{
+    MaskRules& rules = g_maskRules;
+    rules.processCount = SplitConfigList("mask_process", rules.processes, MASK_MAX_RULES);
+    rules.classCount   = SplitConfigList("mask_class", rules.classes, MASK_MAX_RULES);
+
+    rules.regionCount = 0;
+    const char* p = ConfigGet(&g_config, "mask_regions");
+    while (p && *p && rules.regionCount < MASK_MAX_RULES) {
+        long v[4];
+        int n = 0;
+        char* end = nullptr;
+        for (; n < 4; n++) {
+            v[n] = strtol(p, &end, 10);
+            if (end == p) break;
+            p = end;
+            while (*p == ' ' || *p == ',') p++;
+        }
+        if (n == 4 && v[2] > 0 && v[3] > 0)
+            rules.regions[rules.regionCount++] = { (int)v[0], (int)v[1], (int)(v[0] + v[2]), (int)(v[1] + v[3]) };
+        while (*p && *p != ';') p++;
+        if (*p == ';') p++;
+    }
 
-    if (!IsWindowVisible(hWnd) || IsIconic(hWnd))
-        return TRUE;
+    const char* mode = ConfigGet(&g_config, "mask_mode");
+    rules.mode = (mode && _stricmp(mode, "pixelate") == 0) ? MASK_PIXELATE : MASK_BLACK;
+    rules.blockPx = ConfigGetInt(&g_config, "mask_block_px", MASK_BLOCK_PX, 4, 128);
 
-    LONG_PTR style = GetWindowLongPtrW(hWnd, GWL_STYLE);
-    LONG_PTR exStyle = GetWindowLongPtrW(hWnd, GWL_EXSTYLE);
-    if (style & WS_CHILD)
-        return TRUE;
-    if (exStyle & WS_EX_TOOLWINDOW)
-        return TRUE;
-    if (GetWindow(hWnd, GW_OWNER) != nullptr)
-        return TRUE;
+    ClearMaskCache();
+    MaskUpdate(&g_maskSet, nullptr, 0, 0, 0);
+}
 
-    WCHAR className[64] = {};
-    GetClassNameW(hWnd, className, ARRAYSIZE(className));
-    if (wcscmp(className, L"Progman") == 0 ||
-        wcscmp(className, L"WorkerW") == 0 ||
-        wcscmp(className, L"Shell_TrayWnd") == 0 ||
-        wcscmp(className, L"Shell_SecondaryTrayWnd") == 0) {
-        return TRUE;
-    }
+// "C:\\...\\vlc.exe" -> "vlc.exe"
+static BOOL GetProcessExeNameOf(HANDLE hProcess, WCHAR* buf, DWORD cch)
+{
+    WCHAR path[MAX_PATH];
+    DWORD len = MAX_PATH;
+    if (!QueryFullProcessImageNameW(hProcess, 0, path, &len)) return FALSE;
+    const WCHAR* name = wcsrchr(path, L'\\');
+    return SUCCEEDED(StringCchCopyW(buf, cch, name ? name + 1 : path));
+}
 
-    RECT rcWindow = {};
-    if (!GetWindowRect(hWnd, &rcWindow))
-        return TRUE;
+static BOOL GetProcessExeName(DWORD pid, WCHAR* buf, DWORD cch)
+{
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!hProcess) return FALSE;
+    BOOL ok = GetProcessExeNameOf(hProcess, buf, cch);
+    CloseHandle(hProcess);
+    return ok;
+}
 
-    RECT rcIntersection = {};
-    if (!IntersectRect(&rcIntersection, &rcWindow, &data->rcSecond))
-        return TRUE;
+static BOOL ProcessMatchesMask(DWORD pid)
+{
+    ULONGLONG now = GetTickCount64();
+    if (now - g_maskCacheSwept >= MASK_CACHE_SWEEP_MS) {
+        g_maskCacheSwept = now;
+        size_t kept = 0;
+        for (const MaskMatchCacheEntry& e : g_maskCache) {
+            if (e.hProcess && WaitForSingleObject(e.hProcess, 0) == WAIT_TIMEOUT)
+                g_maskCache[kept++] = e;
+            else if (e.hProcess)
+                CloseHandle(e.hProcess);
+        }
+        g_maskCache.resize(kept);
+    }
 
-    int overlapW = rcIntersection.right - rcIntersection.left;
-    int overlapH = rcIntersection.bottom - rcIntersection.top;
-    if (overlapW < 80 || overlapH < 80)
-        return TRUE;
+    auto it = std::lower_bound(g_maskCache.begin(), g_maskCache.end(), pid,
+        [](const MaskMatchCacheEntry& e, DWORD p) { return e.pid < p; });
+    if (it != g_maskCache.end() && it->pid == pid)
+        return it->match;
 
-    data->occupied = TRUE;
+    MaskMatchCacheEntry e = { pid, OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, pid), FALSE };
+    WCHAR name[MAX_PATH];
+    if (e.hProcess && GetProcessExeNameOf(e.hProcess, name, MAX_PATH)) {
+        for (int i = 0; i < g_maskRules.processCount && !e.match; i++)
+            e.match = _wcsicmp(name, g_maskRules.processes[i]) == 0;
+    }
+    g_maskCache.insert(it, e);
+    return e.match;
+}
+
+static BOOL WindowMatchesMask(HWND hWnd, const WCHAR* className)
+{
+    for (int i = 0; i < g_maskRules.classCount; i++) {
+        if (_wcsicmp(className, g_maskRules.classes[i]) == 0)
+            return TRUE;
+    }
+    if (g_maskRules.processCount == 0)
+        return FALSE;
+
+    DWORD pid = 0;
+    GetWindowThreadProcessId(hWnd, &pid);
+    return ProcessMatchesMask(pid);
+}
+
+// � Keystone correction �����������������������������������������������
+// Config (per projector, falling back to the plain key):
+//   keystone=0.04,0,0.96,0,1,1,0,1     where the output's TL, TR, BR, BL
+//   keystone.ACR0398=...               corners should land, 0..1 of the output
+//   keystone_rotate=-1.5               degrees clockwise, about the centre
+// The projector ID is the monitor's hardware ID (manufacturer + product code
+// from its EDID), shown in the diagnostics dialog. The warp replaces the
+// letterbox StretchBlt with one remap of the captured frame (Warp.h).
+
+// "MONITOR\ACR0398\{4d36e96e-...}\0001" -> "ACR0398"
+static void ReadProjectorId()
+{
+    g_szProjectorId[0] = '\0';
+
+    MONITORINFOEXW mi = {};
+    mi.cbSize = sizeof(mi);
+    if (!GetMonitorInfoW(MonitorFromRect(&g_rcSecond, MONITOR_DEFAULTTONULL), &mi)) return;
+
+    DISPLAY_DEVICEW dd = {};
+    dd.cb = sizeof(dd);
+    if (!EnumDisplayDevicesW(mi.szDevice, 0, &dd, 0)) return;
+
+    const WCHAR* p = wcschr(dd.DeviceID, L'\\');
+    if (!p) return;
+    int n = 0;
+    for (p++; *p && *p != L'\\' && n < (int)ARRAYSIZE(g_szProjectorId) - 1; p++) {
+        if (*p < 0x80) g_szProjectorId[n++] = (char)*p;
+    }
+    g_szProjectorId[n] = '\0';
+}
+
+// Looks up "<key>.<projector>" first, then "<key>".
+static const char* GetProjectorConfig(const char* key)
+{
+    if (g_szProjectorId[0]) {
+        char scoped[64];
+        if (SUCCEEDED(StringCchPrintfA(scoped, ARRAYSIZE(scoped), "%s.%s", key, g_szProjectorId))) {
+            const char* value = ConfigGet(&g_config, scoped);
+            if (value) return value;
+        }
+    }
+    return ConfigGet(&g_config, key);
+}
+
+void LoadWarpConfig()
+{
+    WarpParams params;
+    WarpParamsIdentity(&params);
+
+    const char* corners = GetProjectorConfig("keystone");
+    if (corners && *corners && !WarpParseCorners(&params, corners))
+        WarpParamsIdentity(&params);
+    const char* rotate = GetProjectorConfig("keystone_rotate");
+    if (rotate) {
+        float deg = strtof(rotate, nullptr);
+        if (deg >= -45.0f && deg <= 45.0f) params.rotateDeg = deg;
+    }
+
+    g_warpParams = params;
+    g_bWarpEnabled = !WarpIsIdentity(&params);
+    if (!g_bWarpEnabled) FreeWarpResources();
+}
+
+void FreeWarpResources()
+{
+    if (g_hdcWarp) {
+        if (g_hOldWarpBmp) SelectObject(g_hdcWarp, g_hOldWarpBmp);
+        DeleteDC(g_hdcWarp);
+        g_hdcWarp = nullptr;
+    }
+    if (g_hBmpWarp) {
+        DeleteObject(g_hBmpWarp);
+        g_hBmpWarp = nullptr;
+    }
+    g_hOldWarpBmp = nullptr;
+    g_pWarpBits = nullptr;
+    g_warpW = 0;
+    g_warpH = 0;
+    WarpFree(&g_warpMap);
+}
+
+// Warps a finished srcW x srcH frame (g_pMemBits, or a replayed one) onto
+// the whole window. Returns FALSE (and draws nothing) if the geometry
+// cannot be warped, so the caller falls back to the plain letterbox.
+static BOOL RenderWarpedFrame(HDC hdcWnd, HDC hdcScreen, const UINT32* srcBits, int srcW, int srcH,
+                              int dstW, int dstH, const RECT& box)
+{
+    if (!srcBits) return FALSE;
+
+    uint64_t buildStart = TraceNow();
+    if (WarpBuild(&g_warpMap, &g_warpParams, srcW, srcH, dstW, dstH,
+                  box.left, box.top, box.right, box.bottom))
+        TraceSpan(TRACE_WARP_BUILD, buildStart, (uint64_t)dstW * dstH);
+    if (!WarpIsReady(&g_warpMap)) return FALSE;
+
+    if (!g_hdcWarp || !g_hBmpWarp || g_warpW != dstW || g_warpH != dstH) {
+        if (g_hdcWarp) {
+            if (g_hOldWarpBmp) SelectObject(g_hdcWarp, g_hOldWarpBmp);
+            DeleteDC(g_hdcWarp);
+        }
+        if (g_hBmpWarp) DeleteObject(g_hBmpWarp);
+        g_hdcWarp = CreateCompatibleDC(hdcScreen);
+
+        BITMAPINFO bmi = {};
+        bmi.bmiHeader.biSize        = sizeof(bmi.bmiHeader);
+        bmi.bmiHeader.biWidth       = dstW;
+        bmi.bmiHeader.biHeight      = -dstH;
+        bmi.bmiHeader.biPlanes      = 1;
+        bmi.bmiHeader.biBitCount    = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        void* bits = nullptr;
+        g_hBmpWarp = CreateDIBSection(hdcScreen, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
+        g_pWarpBits = g_hBmpWarp ? (UINT32*)bits : nullptr;
+        g_hOldWarpBmp = (g_hdcWarp && g_hBmpWarp) ? (HBITMAP)SelectObject(g_hdcWarp, g_hBmpWarp) : nullptr;
+        g_warpW = dstW;
+        g_warpH = dstH;
+    }
+    if (!g_hdcWarp || !g_pWarpBits) return FALSE;
+
+    GdiFlush();
+    WarpApply(&g_warpMap, (const uint32_t*)srcBits, srcW, (uint32_t*)g_pWarpBits, dstW);
+    BitBlt(hdcWnd, 0, 0, dstW, dstH, g_hdcWarp, 0, 0, SRCCOPY);
+    return TRUE;
+}
+
+// � DPI awareness �����������������������������������������������������
+// Everything here works in physical pixels: the mirror BitBlt reads the
+// primary's real pixels and the letterbox StretchBlt (or the warp) is the
+// only resample. A process that is only system-aware gets virtualized
+// rects on a monitor with another scale, and DWM bitmap-stretches its
+// captures and its projector window on top of our own scaling.
+// The manifest already asks for per-monitor v2; this covers Windows
+// versions that ignore the manifest entry (and a stripped manifest), down
+// to system-aware on Windows 7. All of it is looked up at run time.
+
+enum DpiMode { DPI_UNAWARE, DPI_SYSTEM, DPI_PER_MONITOR, DPI_PER_MONITOR_V2 };
+
+typedef BOOL    (WINAPI* PFN_SetProcessDpiAwarenessContext)(HANDLE);
+typedef HANDLE  (WINAPI* PFN_GetThreadDpiAwarenessContext)();
+typedef int     (WINAPI* PFN_GetAwarenessFromDpiAwarenessContext)(HANDLE);
+typedef BOOL    (WINAPI* PFN_AreDpiAwarenessContextsEqual)(HANDLE, HANDLE);
+typedef HRESULT (WINAPI* PFN_SetProcessDpiAwareness)(int);
+typedef HRESULT (WINAPI* PFN_GetProcessDpiAwareness)(HANDLE, int*);
+typedef HRESULT (WINAPI* PFN_GetDpiForMonitor)(HMONITOR, int, UINT*, UINT*);
+
+#define DPI_CONTEXT_PER_MONITOR_V2  ((HANDLE)-4)    // DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2
+#define PROCESS_DPI_PER_MONITOR     2               // PROCESS_PER_MONITOR_DPI_AWARE
+#define MONITOR_DPI_EFFECTIVE       0               // MDT_EFFECTIVE_DPI
+
+static DpiMode g_dpiMode = DPI_UNAWARE;
+static PFN_GetDpiForMonitor g_pGetDpiForMonitor = nullptr;
+
+// shcore.dll is Windows 8.1+; user32 already has it mapped on Windows 10
+static FARPROC GetShcoreProc(const char* name)
+{
+    static HMODULE hShcore = nullptr;
+    static BOOL tried = FALSE;
+    if (!tried) {
+        tried = TRUE;
+        hShcore = LoadLibraryExW(L"shcore.dll", nullptr, LOAD_LIBRARY_SEARCH_SYSTEM32);
+    }
+    return hShcore ? GetProcAddress(hShcore, name) : nullptr;
+}
+
+static void EnableDpiAwareness()
+{
+    HMODULE hUser = GetModuleHandleW(L"user32.dll");
+
+    // Windows 10 1703+. Fails with ERROR_ACCESS_DENIED when the manifest
+    // has already set it, which is fine: the query below sees the result.
+    auto pSetContext = (PFN_SetProcessDpiAwarenessContext)GetProcAddress(hUser, "SetProcessDpiAwarenessContext");
+    if (pSetContext) pSetContext(DPI_CONTEXT_PER_MONITOR_V2);
+
+    auto pGetContext = (PFN_GetThreadDpiAwarenessContext)GetProcAddress(hUser, "GetThreadDpiAwarenessContext");
+    auto pAwareness  = (PFN_GetAwarenessFromDpiAwarenessContext)GetProcAddress(hUser, "GetAwarenessFromDpiAwarenessContext");
+    auto pEqual      = (PFN_AreDpiAwarenessContextsEqual)GetProcAddress(hUser, "AreDpiAwarenessContextsEqual");
+    if (pGetContext && pAwareness && pEqual) {
+        HANDLE ctx = pGetContext();
+        if (pEqual(ctx, DPI_CONTEXT_PER_MONITOR_V2)) {
+            g_dpiMode = DPI_PER_MONITOR_V2;
+        } else {
+            int awareness = pAwareness(ctx);
+            g_dpiMode = awareness == 2 ? DPI_PER_MONITOR : awareness == 1 ? DPI_SYSTEM : DPI_UNAWARE;
+        }
+    } else {
+        // Windows 8.1, or 10 before 1607
+        auto pSetAwareness = (PFN_SetProcessDpiAwareness)GetShcoreProc("SetProcessDpiAwareness");
+        auto pGetAwareness = (PFN_GetProcessDpiAwareness)GetShcoreProc("GetProcessDpiAwareness");
+        int awareness = 0;
+        if (pSetAwareness) pSetAwareness(PROCESS_DPI_PER_MONITOR);
+        if (pGetAwareness && SUCCEEDED(pGetAwareness(nullptr, &awareness))) {
+            g_dpiMode = awareness == 2 ? DPI_PER_MONITOR : awareness == 1 ? DPI_SYSTEM : DPI_UNAWARE;
+        } else {
+            SetProcessDPIAware();
+            g_dpiMode = IsProcessDPIAware() ? DPI_SYSTEM : DPI_UNAWARE;
+        }
+    }
+
+    if (g_dpiMode >= DPI_PER_MONITOR)
+        g_pGetDpiForMonitor = (PFN_GetDpiForMonitor)GetShcoreProc("GetDpiForMonitor");
+}
+
+// Effective DPI of one monitor; the system DPI where Windows has no
+// per-monitor value (or we are not per-monitor aware, where it is the
+// only one that applies to our coordinates).
+static UINT GetMonitorDpi(HMONITOR hMon)
+{
+    UINT dpiX = 0, dpiY = 0;
+    if (g_pGetDpiForMonitor && hMon &&
+        SUCCEEDED(g_pGetDpiForMonitor(hMon, MONITOR_DPI_EFFECTIVE, &dpiX, &dpiY)) && dpiX)
+        return dpiX;
+
+    HDC hdc = GetDC(nullptr);
+    int dpi = hdc ? GetDeviceCaps(hdc, LOGPIXELSX) : 0;
+    if (hdc) ReleaseDC(nullptr, hdc);
+    return dpi > 0 ? (UINT)dpi : 96;
+}
+
+// Scales a length given at 100% (96 DPI) to a monitor's pixels
+static int ScaleForDpi(int px, UINT dpi)
+{
+    return MulDiv(px, (int)dpi, 96);
+}
+
+// The projector window must stay exactly on its monitor's pixels. Windows
+// would otherwise resize it by the DPI ratio whenever it (re)lands on a
+// monitor with another scale, or that monitor's scale is changed.
+static void PinWindowOnDpiChange(HWND hWnd, const RECT* rc, WPARAM wParam)
+{
+    TraceEvent(TRACE_DPI_CHANGE, LOWORD(wParam), (uint64_t)(ULONG_PTR)hWnd);
+    SetWindowPos(hWnd, nullptr, rc->left, rc->top, rc->right - rc->left, rc->bottom - rc->top,
+                 SWP_NOACTIVATE | SWP_NOZORDER | SWP_NOOWNERZORDER);
+    if (g_hHidden) PostMessage(g_hHidden, WM_CHECKMONITOR, 0, 0);
+}
+
+void AppendDpiText(WCHAR* buf, size_t cch)
+{
+    static const WCHAR* const modeNames[] = {
+        L"sem escala", L"sistema", L"por monitor", L"por monitor v2",
+    };
+    WCHAR line[160];
+    StringCchPrintfW(line, ARRAYSIZE(line), L"  Escala: %s; ecr\x00E3 %d%%, projetor %d%%\n",
+        modeNames[g_dpiMode], MulDiv(g_dpiPrimary, 100, 96), MulDiv(g_dpiSecond, 100, 96));
+    StringCchCatW(buf, cch, line);
+}
+
+// � Monitor enumeration �����������������������������������������������
+struct MonitorEnumData {
+    int   count;
+    RECT  rcPrimary;
+    RECT  rcSecondary;
+    BOOL  foundPrimary;
+    BOOL  foundSecondary;
+    UINT  dpiPrimary;
+    UINT  dpiSecondary;
+};
+
+static BOOL CALLBACK MonitorEnumProc(HMONITOR hMon, HDC, LPRECT, LPARAM lParam)
+{
+    auto* data = reinterpret_cast<MonitorEnumData*>(lParam);
+    MONITORINFOEX mi = {};
+    mi.cbSize = sizeof(mi);
+    GetMonitorInfo(hMon, &mi);
+
+    if (mi.dwFlags & MONITORINFOF_PRIMARY) {
+        data->rcPrimary = mi.rcMonitor;
+        data->dpiPrimary = GetMonitorDpi(hMon);
+        data->foundPrimary = TRUE;
+    } else {
+        data->rcSecondary = mi.rcMonitor;
+        data->dpiSecondary = GetMonitorDpi(hMon);
+        data->foundSecondary = TRUE;
+    }
+    data->count++;
+    return TRUE;
+}
+
+BOOL HasSecondMonitor(RECT* rcPrimary, RECT* rcSecond)
+{
+    MonitorEnumData data = {};
+    EnumDisplayMonitors(nullptr, nullptr, MonitorEnumProc, reinterpret_cast<LPARAM>(&data));
+    if (data.count >= 2 && data.foundSecondary) {
+        if (rcPrimary) *rcPrimary = data.rcPrimary;
+        if (rcSecond)  *rcSecond  = data.rcSecondary;
+        if (rcPrimary && rcSecond) {
+            g_dpiPrimary = data.dpiPrimary;
+            g_dpiSecond  = data.dpiSecondary;
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+struct WindowEnumData {
+    RECT rcSecond;
+    RECT rcPrimary;
+    BOOL moveWindows;
+    BOOL occupied;
+    int  overlapMinPx;          // projector pixels
+    UINT dpiPrimary, dpiSecond;
+    MaskRect* masks;            // non-null: also collect masked windows (whole pass)
+    int  maskCount;
+};
+
+static int ClampToRange(int value, int minVal, int maxVal)
+{
+    if (value < minVal) return minVal;
+    if (value > maxVal) return maxVal;
+    return value;
+}
+
+static BOOL CALLBACK EnumWindowsOnSecondMonitorProc(HWND hWnd, LPARAM lParam)
+{
+    auto* data = reinterpret_cast<WindowEnumData*>(lParam);
+    if (!data) return FALSE;
+
+    if (hWnd == g_hMirror || hWnd == g_hHidden)
+        return TRUE;
+
+    if (!IsWindowVisible(hWnd) || IsIconic(hWnd))
+        return TRUE;
+
+    WCHAR className[64] = {};
+    GetClassNameW(hWnd, className, ARRAYSIZE(className));
+
+    // Masks apply to any visible window, owned popups and tool windows
+    // (notifications) included, so check before the eviction filters
+    if (data->masks && data->maskCount < MASK_MAX_RECTS && WindowMatchesMask(hWnd, className)) {
+        RECT rc;
+        if (GetWindowRect(hWnd, &rc)) {
+            MaskRect* m = &data->masks[data->maskCount++];
+            m->left   = rc.left   - data->rcPrimary.left;
+            m->top    = rc.top    - data->rcPrimary.top;
+            m->right  = rc.right  - data->rcPrimary.left;
+            m->bottom = rc.bottom - data->rcPrimary.top;
+        }
+    }
+
+    LONG_PTR style = GetWindowLongPtrW(hWnd, GWL_STYLE);
+    LONG_PTR exStyle = GetWindowLongPtrW(hWnd, GWL_EXSTYLE);
+    if (style & WS_CHILD)
+        return TRUE;
+    if (exStyle & WS_EX_TOOLWINDOW)
+        return TRUE;
+    if (GetWindow(hWnd, GW_OWNER) != nullptr)
+        return TRUE;
+
+    if (wcscmp(className, L"Progman") == 0 ||
+        wcscmp(className, L"WorkerW") == 0 ||
+        wcscmp(className, L"Shell_TrayWnd") == 0 ||
+        wcscmp(className, L"Shell_SecondaryTrayWnd") == 0) {
+        return TRUE;
+    }
+
+    RECT rcWindow = {};
+    if (!GetWindowRect(hWnd, &rcWindow))
+        return TRUE;
+
+    RECT rcIntersection = {};
+    if (!IntersectRect(&rcIntersection, &rcWindow, &data->rcSecond))
+        return TRUE;
+
+    int overlapW = rcIntersection.right - rcIntersection.left;
+    int overlapH = rcIntersection.bottom - rcIntersection.top;
+    if (overlapW < data->overlapMinPx || overlapH < data->overlapMinPx)
+        return TRUE;
+
+    // Collecting masks keeps the pass going; still evict one window per pass
+    if (data->occupied)
+        return TRUE;
+    data->occupied = TRUE;
 
     if (data->moveWindows) {
         int winW = rcWindow.right - rcWindow.left;
@@ -463,20 +1834,29 @@ static BOOL CALLBACK EnumWindowsOnSecondMonitorProc(HWND hWnd, LPARAM lParam)
         if (winW > primaryW) winW = primaryW;
         if (winH > primaryH) winH = primaryH;
 
-        int targetX = data->rcPrimary.left + (rcWindow.left - data->rcSecond.left);
-        int targetY = data->rcPrimary.top + (rcWindow.top - data->rcSecond.top);
-
-        int maxX = data->rcPrimary.right - winW;
-        int maxY = data->rcPrimary.bottom - winH;
+        // All rects are physical pixels. Across a scale change Windows
+        // resizes the window by the DPI ratio once it lands, so keep the
+        // offset in the same proportion and clamp it with the size it will
+        // have on the primary.
+        int landW = min(primaryW, MulDiv(winW, (int)data->dpiPrimary, (int)data->dpiSecond));
+        int landH = min(primaryH, MulDiv(winH, (int)data->dpiPrimary, (int)data->dpiSecond));
+        int targetX = data->rcPrimary.left +
+                      MulDiv(rcWindow.left - data->rcSecond.left, (int)data->dpiPrimary, (int)data->dpiSecond);
+        int targetY = data->rcPrimary.top +
+                      MulDiv(rcWindow.top - data->rcSecond.top, (int)data->dpiPrimary, (int)data->dpiSecond);
+
+        int maxX = data->rcPrimary.right - landW;
+        int maxY = data->rcPrimary.bottom - landH;
         targetX = ClampToRange(targetX, data->rcPrimary.left, maxX);
         targetY = ClampToRange(targetY, data->rcPrimary.top, maxY);
 
         SetWindowPos(hWnd, nullptr,
                      targetX, targetY, winW, winH,
                      SWP_NOACTIVATE | SWP_NOOWNERZORDER | SWP_NOZORDER);
+        TraceEvent(TRACE_EVICT, 0, (uint64_t)(ULONG_PTR)hWnd);
     }
 
-    return FALSE;
+    return data->masks ? TRUE : FALSE;
 }
 
 BOOL IsSecondScreenOccupiedByOtherApp()
@@ -485,17 +1865,34 @@ BOOL IsSecondScreenOccupiedByOtherApp()
     data.rcSecond = g_rcSecond;
     data.rcPrimary = g_rcPrimary;
     data.moveWindows = FALSE;
+    data.overlapMinPx = ScaleForDpi(g_cfg.overlapMinPx, g_dpiSecond);
+    data.dpiPrimary = g_dpiPrimary;
+    data.dpiSecond = g_dpiSecond;
     EnumWindows(EnumWindowsOnSecondMonitorProc, reinterpret_cast<LPARAM>(&data));
     return data.occupied;
 }
 
+// Runs every frame; the same pass also gathers the masked windows, and
+// the mask spans are only recompiled when that geometry changed.
 void MoveOtherWindowsToPrimaryFromSecond()
 {
+    MaskRect masks[MASK_MAX_RECTS];
+    BOOL collect = g_maskRules.processCount > 0 || g_maskRules.classCount > 0;
+
     WindowEnumData data = {};
     data.rcSecond = g_rcSecond;
     data.rcPrimary = g_rcPrimary;
     data.moveWindows = TRUE;
+    data.overlapMinPx = ScaleForDpi(g_cfg.overlapMinPx, g_dpiSecond);
+    data.dpiPrimary = g_dpiPrimary;
+    data.dpiSecond = g_dpiSecond;
+    data.masks = collect ? masks : nullptr;
     EnumWindows(EnumWindowsOnSecondMonitorProc, reinterpret_cast<LPARAM>(&data));
+
+    for (int i = 0; i < g_maskRules.regionCount && data.maskCount < MASK_MAX_RECTS; i++)
+        masks[data.maskCount++] = g_maskRules.regions[i];
+    MaskUpdate(&g_maskSet, masks, data.maskCount,
+               g_rcPrimary.right - g_rcPrimary.left, g_rcPrimary.bottom - g_rcPrimary.top);
 }
 
 // Count how many physical displays are connected (including inactive ones)
@@ -654,21 +2051,27 @@ void TryExtendAndMirror()
 {
     if (g_bProjecting || g_bExtendPending) return;
 
-    SetExtendMode();
+    uint64_t traceStart = TraceNow();
+    BOOL extended = SetExtendMode();
+    TraceSpan(TRACE_EXTEND, traceStart, extended);
     g_bExtendPending = TRUE;
     g_nExtendRetries = 0;
-    SetTimer(g_hHidden, IDT_EXTEND_RETRY, EXTEND_RETRY_MS, nullptr);
+    SetTimer(g_hHidden, IDT_EXTEND_RETRY, g_cfg.extendRetryMs, nullptr);
 }
 
 // � Central monitor check ���������������������������������������������
 void CheckMonitorState()
 {
+    if (g_bPaused || g_suspendFlags) return;
+
     BOOL secondNow = HasSecondMonitor(&g_rcPrimary, &g_rcSecond);
+    TraceEvent(TRACE_MONITOR_CHECK, secondNow, g_bProjecting);
     if (secondNow && !g_bProjecting) {
         // A second monitor appeared � cancel any pending extend and start mirroring
         if (g_bExtendPending) {
             KillTimer(g_hHidden, IDT_EXTEND_RETRY);
             g_bExtendPending = FALSE;
+            TraceEvent(TRACE_EXTEND_RESULT, 1, g_nExtendRetries);
         }
         StartMirroring();
     } else if (secondNow && g_bProjecting) {
@@ -680,6 +2083,7 @@ void CheckMonitorState()
     } else if (!secondNow && g_bProjecting) {
         StopMirroring();
     }
+    PublishIpcState();
 }
 
 // � Device notification registration ���������������������������������
@@ -694,6 +2098,14 @@ void RegisterForDeviceNotifications(HWND hWnd)
 
     g_hDevNotify = RegisterDeviceNotification(hWnd, &filter,
         DEVICE_NOTIFY_WINDOW_HANDLE);
+
+    // Lock/unlock and user switching, display on/off and the lid; both
+    // power settings report their current state right away
+    WTSRegisterSessionNotification(hWnd, NOTIFY_FOR_THIS_SESSION);
+    g_hDisplayStateNotify = RegisterPowerSettingNotification(hWnd, &GUID_DISPLAY_STATE,
+        DEVICE_NOTIFY_WINDOW_HANDLE);
+    g_hLidNotify = RegisterPowerSettingNotification(hWnd, &GUID_LID_STATE,
+        DEVICE_NOTIFY_WINDOW_HANDLE);
 }
 
 void UnregisterDeviceNotifications()
@@ -702,6 +2114,86 @@ void UnregisterDeviceNotifications()
         UnregisterDeviceNotification(g_hDevNotify);
         g_hDevNotify = nullptr;
     }
+    if (g_hDisplayStateNotify) {
+        UnregisterPowerSettingNotification(g_hDisplayStateNotify);
+        g_hDisplayStateNotify = nullptr;
+    }
+    if (g_hLidNotify) {
+        UnregisterPowerSettingNotification(g_hLidNotify);
+        g_hLidNotify = nullptr;
+    }
+    if (g_hHidden) WTSUnRegisterSessionNotification(g_hHidden);
+}
+
+// � Capture suspension ������������������������������������������������
+// While the session is locked or switched away, the display is off, the
+// lid is closed, the machine is going to sleep or the screensaver runs,
+// nothing is captured, evicted or polled: the timers are killed, frame
+// buffers freed and the projector holds black (nothing from before the
+// lock stays up on the wall). Clearing the last reason re-arms everything
+// and renders a frame straight away.
+
+static void EnterSuspend()
+{
+    KillTimer(g_hHidden, IDT_MONITOR_POLL);
+    KillTimer(g_hHidden, IDT_DISPLAY_SETTLE);
+    if (g_bExtendPending) {
+        KillTimer(g_hHidden, IDT_EXTEND_RETRY);
+        g_bExtendPending = FALSE;
+    }
+
+    if (g_hMirror) {
+        StopFrameClock();
+        KillTimer(g_hMirror, IDT_CURSOR_REFRESH);
+        LeaveReplay(FALSE);
+        HDC hdc = GetDC(g_hMirror);
+        if (hdc) {
+            RECT rc;
+            GetClientRect(g_hMirror, &rc);
+            FillRect(hdc, &rc, (HBRUSH)GetStockObject(BLACK_BRUSH));
+            ReleaseDC(g_hMirror, hdc);
+        }
+        FreeMirrorResources();
+    }
+}
+
+static void LeaveSuspend()
+{
+    SetTimer(g_hHidden, IDT_MONITOR_POLL, g_cfg.monitorPollMs, nullptr);
+
+    // The topology may have changed meanwhile; this also starts or stops
+    // mirroring as needed
+    CheckMonitorState();
+    if (g_bProjecting && g_hMirror) {
+        ClipCursor(&g_rcPrimary);
+        StartFrameClock();
+        RenderMirrorFrame(g_hMirror);
+    }
+}
+
+void SetSuspendFlag(DWORD flag, BOOL on)
+{
+    DWORD old = g_suspendFlags;
+    g_suspendFlags = on ? (old | flag) : (old & ~flag);
+    if (g_suspendFlags == old) return;
+
+    TraceEvent(TRACE_SUSPEND, g_suspendFlags);
+    if (!old)
+        EnterSuspend();
+    else if (!g_suspendFlags)
+        LeaveSuspend();
+    PublishIpcState();
+}
+
+static void OnPowerSettingChange(const POWERBROADCAST_SETTING* setting)
+{
+    if (setting->DataLength < sizeof(DWORD)) return;
+    DWORD value = *(const DWORD*)setting->Data;
+
+    if (IsEqualGUID(setting->PowerSetting, GUID_DISPLAY_STATE))
+        SetSuspendFlag(SUSPEND_DISPLAY_OFF, value == 0);      // 1 on, 2 dimmed
+    else if (IsEqualGUID(setting->PowerSetting, GUID_LID_STATE))
+        SetSuspendFlag(SUSPEND_LID_CLOSED, value == 0);
 }
 
 // � Tray helpers ������������������������������������������������������
@@ -721,6 +2213,7 @@ void AddTrayIcon(HWND hWnd)
     StringCchCopy(nid.szTip, ARRAYSIZE(nid.szTip), L"TeacherToolkit v" APP_VERSION);
 
     Shell_NotifyIcon(NIM_ADD, &nid);
+    StartupTimelineMark(STARTUP_TRAY_ICON);
 
     nid.uVersion = NOTIFYICON_VERSION_4;
     Shell_NotifyIcon(NIM_SETVERSION, &nid);
@@ -747,14 +2240,23 @@ void ShowTrayMenu(HWND hWnd)
     StringCchPrintfW(verLabel, ARRAYSIZE(verLabel), L"TeacherToolkit v%s", APP_VERSION);
     AppendMenu(hMenu, MF_STRING | MF_DISABLED | MF_GRAYED, 0, verLabel);
 
-    if (g_bProjecting)
+    if (g_bPaused)
+        AppendMenu(hMenu, MF_STRING | MF_DISABLED | MF_GRAYED, IDM_TRAY_STATUS,
+                   L"\x23F8  Proje\x00E7\x00E3o em pausa");
+    else if (g_bProjecting)
         AppendMenu(hMenu, MF_STRING | MF_DISABLED | MF_GRAYED, IDM_TRAY_STATUS,
                    L"\x2714  Neste momento a projetar");
     else
         AppendMenu(hMenu, MF_STRING | MF_DISABLED | MF_GRAYED, IDM_TRAY_STATUS,
                    L"\x2716  Nenhum Projetor (est� em modo espandir?)");
 
-    if (g_bUpdateAvailable && g_szLatestVer[0] != L'\0') {
+    if (g_bUpdateStaged && g_szLatestVer[0] != L'\0') {
+        WCHAR updateLabel[128];
+        StringCchPrintfW(updateLabel, ARRAYSIZE(updateLabel),
+            L"\x2B06  Atualiza\x00E7\x00E3o v%s pronta (aplicada ao reiniciar)", g_szLatestVer);
+        AppendMenu(hMenu, MF_STRING | MF_DISABLED | MF_GRAYED, IDM_TRAY_UPDATE, updateLabel);
+    }
+    else if (g_bUpdateAvailable && g_szLatestVer[0] != L'\0') {
         WCHAR updateLabel[128];
         StringCchPrintfW(updateLabel, ARRAYSIZE(updateLabel),
             L"\x2B06  Atualiza��o dispon�vel: v%s", g_szLatestVer);
@@ -763,10 +2265,21 @@ void ShowTrayMenu(HWND hWnd)
 
     AppendMenu(hMenu, MF_SEPARATOR, 0, nullptr);
 
+    AppendMenu(hMenu, MF_STRING | (g_hAnnotInput ? MF_CHECKED : MF_UNCHECKED) |
+               (g_bProjecting ? 0 : MF_GRAYED), IDM_TRAY_ANNOTATE, L"Anotar no projetor\tCtrl+Alt+A");
+    AppendMenu(hMenu, MF_STRING | (g_slides.on ? MF_CHECKED : MF_UNCHECKED),
+               IDM_TRAY_SLIDES, L"Guardar diapositivos");
+
+    if (g_bPaused)
+        AppendMenu(hMenu, MF_STRING, IDM_TRAY_RESUME, L"Retomar proje\x00E7\x00E3o");
+    else
+        AppendMenu(hMenu, MF_STRING, IDM_TRAY_PAUSE, L"Pausar proje\x00E7\x00E3o");
+
     BOOL startupEnabled = IsStartupEnabled();
     AppendMenu(hMenu, MF_STRING | (startupEnabled ? MF_CHECKED : MF_UNCHECKED),
                IDM_TRAY_STARTUP, L"Iniciar com o Windows");
 
+    AppendMenu(hMenu, MF_STRING, IDM_TRAY_DIAG, L"Diagn\x00F3stico");
     AppendMenu(hMenu, MF_STRING, IDM_TRAY_ABOUT, L"Sobre");
 
     AppendMenu(hMenu, MF_SEPARATOR, 0, nullptr);
@@ -781,8 +2294,16 @@ void ShowTrayMenu(HWND hWnd)
 }
 
 // � Startup helpers ���������������������������������������������������
+#ifdef UPDATE_TEST_TRUST
+static WCHAR g_szUpdateTestDir[MAX_PATH] = L"";    // stands in for %APPDATA%\TeacherToolkit
+#endif
+
 BOOL GetAppDataExePath(WCHAR* buf, DWORD cch)
 {
+#ifdef UPDATE_TEST_TRUST
+    if (g_szUpdateTestDir[0] != L'\0')
+        return SUCCEEDED(StringCchPrintfW(buf, cch, L"%s\\TeacherToolkit.exe", g_szUpdateTestDir));
+#endif
     WCHAR appData[MAX_PATH];
     if (FAILED(SHGetFolderPathW(nullptr, CSIDL_APPDATA, nullptr, 0, appData)))
         return FALSE;
@@ -799,22 +2320,49 @@ BOOL GetStartupShortcutPath(WCHAR* buf, DWORD cch)
     return TRUE;
 }
 
+// Hashes the file through a read-only mapping of the whole image: one
+// CryptHashData call over the view, no copies through an intermediate
+// buffer. Pages of the running exe usually come straight from the cache.
 BOOL ComputeFileHash(const WCHAR* path, BYTE* hashOut, DWORD hashSize)
 {
     BOOL result = FALSE;
     HANDLE hFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
-                               OPEN_EXISTING, 0, nullptr);
+                               OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
     if (hFile == INVALID_HANDLE_VALUE) return FALSE;
 
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(hFile, &size) || size.HighPart != 0) {
+        CloseHandle(hFile);
+        return FALSE;
+    }
+
+    HANDLE hMap = nullptr;
+    const BYTE* view = nullptr;
+    if (size.LowPart > 0) {
+        hMap = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (hMap) view = (const BYTE*)MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+        if (!view) {
+            if (hMap) CloseHandle(hMap);
+            CloseHandle(hFile);
+            return FALSE;
+        }
+    }
+
     HCRYPTPROV hProv = 0;
     HCRYPTHASH hHash = 0;
     if (CryptAcquireContextW(&hProv, nullptr, nullptr, PROV_RSA_AES, CRYPT_VERIFYCONTEXT)) {
         if (CryptCreateHash(hProv, CALG_SHA_256, 0, 0, &hHash)) {
-            BYTE buffer[8192];
-            DWORD bytesRead;
             BOOL ok = TRUE;
-            while (ReadFile(hFile, buffer, sizeof(buffer), &bytesRead, nullptr) && bytesRead > 0) {
-                if (!CryptHashData(hHash, buffer, bytesRead, 0)) { ok = FALSE; break; }
+            if (view) {
+                // A mapped view turns I/O errors (e.g. a USB stick pulled out)
+                // into in-page exceptions instead of ReadFile failures.
+                __try {
+                    ok = CryptHashData(hHash, view, size.LowPart, 0);
+                }
+                __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ?
+                          EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+                    ok = FALSE;
+                }
             }
             if (ok) {
                 DWORD cbHash = hashSize;
@@ -824,50 +2372,185 @@ BOOL ComputeFileHash(const WCHAR* path, BYTE* hashOut, DWORD hashSize)
         }
         CryptReleaseContext(hProv, 0);
     }
+
+    if (view) UnmapViewOfFile(view);
+    if (hMap) CloseHandle(hMap);
     CloseHandle(hFile);
     return result;
 }
 
-BOOL FilesMatchByHash(const WCHAR* path1, const WCHAR* path2)
+// Digests are cached in the registry per path, keyed by size + last-write
+// time, so an unchanged exe is hashed once and never again. Entries carry
+// the time they were written; past DIGEST_CACHE_MAX the oldest go.
+struct DigestCacheEntry {
+    ULONGLONG size;
+    FILETIME  lastWrite;
+    BYTE      hash[32];
+    FILETIME  cached;
+};
+
+// Deletes unreadable entries and the oldest ones until there is room for
+// one more. hKey needs KEY_READ | KEY_WRITE
+static void TrimDigestCache(HKEY hKey)
 {
-    BYTE hash1[32], hash2[32];
-    if (!ComputeFileHash(path1, hash1, sizeof(hash1))) return FALSE;
-    if (!ComputeFileHash(path2, hash2, sizeof(hash2))) return FALSE;
-    return (memcmp(hash1, hash2, 32) == 0);
+    for (;;) {
+        WCHAR oldest[MAX_PATH] = L"";
+        FILETIME oldestTime = { 0xFFFFFFFF, 0xFFFFFFFF };
+        DWORD count = 0;
+        for (DWORD i = 0; ; i++) {
+            WCHAR name[MAX_PATH];
+            DWORD cchName = MAX_PATH, type = 0;
+            DigestCacheEntry entry;
+            DWORD cbEntry = sizeof(entry);
+            LONG rc = RegEnumValueW(hKey, i, name, &cchName, nullptr, &type, (BYTE*)&entry, &cbEntry);
+            if (rc == ERROR_NO_MORE_ITEMS) break;
+            count++;
+            if (rc != ERROR_SUCCESS || type != REG_BINARY || cbEntry != sizeof(entry)) {
+                entry.cached.dwLowDateTime = entry.cached.dwHighDateTime = 0;     // goes first
+                if (rc != ERROR_SUCCESS && rc != ERROR_MORE_DATA) continue;
+                if (rc == ERROR_MORE_DATA) {
+                    cchName = MAX_PATH;             // the name, at least, is wanted
+                    if (RegEnumValueW(hKey, i, name, &cchName, nullptr, nullptr, nullptr, nullptr) != ERROR_SUCCESS)
+                        continue;
+                }
+            }
+            if (CompareFileTime(&entry.cached, &oldestTime) < 0) {
+                oldestTime = entry.cached;
+                StringCchCopyW(oldest, MAX_PATH, name);
+            }
+        }
+        if (count < DIGEST_CACHE_MAX || !oldest[0] || RegDeleteValueW(hKey, oldest) != ERROR_SUCCESS)
+            return;
+    }
 }
 
-static BOOL CreateShortcut(const WCHAR* targetPath, const WCHAR* shortcutPath)
+static BOOL GetCachedFileHash(const WCHAR* path, const WIN32_FILE_ATTRIBUTE_DATA* fad, BYTE* hashOut)
 {
-    BOOL result = FALSE;
-    CoInitialize(nullptr);
-
-    IShellLinkW* pShellLink = nullptr;
-    HRESULT hr = CoCreateInstance(CLSID_ShellLink, nullptr, CLSCTX_INPROC_SERVER,
-                                  IID_IShellLinkW, (void**)&pShellLink);
-    if (SUCCEEDED(hr)) {
-        pShellLink->SetPath(targetPath);
-
-        WCHAR dir[MAX_PATH];
-        StringCchCopyW(dir, MAX_PATH, targetPath);
-        WCHAR* lastSlash = wcsrchr(dir, L'\\');
-        if (lastSlash) *lastSlash = L'\0';
-        pShellLink->SetWorkingDirectory(dir);
+    DigestCacheEntry entry = {};
+    ULONGLONG size = ((ULONGLONG)fad->nFileSizeHigh << 32) | fad->nFileSizeLow;
 
-        IPersistFile* pPersist = nullptr;
-        hr = pShellLink->QueryInterface(IID_IPersistFile, (void**)&pPersist);
-        if (SUCCEEDED(hr)) {
-            hr = pPersist->Save(shortcutPath, TRUE);
-            result = SUCCEEDED(hr);
-            pPersist->Release();
+    HKEY hKey;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, REG_DIGEST_CACHE, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+        DWORD cbEntry = sizeof(entry);
+        DWORD type = 0;
+        LONG rc = RegQueryValueExW(hKey, path, nullptr, &type, (BYTE*)&entry, &cbEntry);
+        RegCloseKey(hKey);
+        if (rc == ERROR_SUCCESS && type == REG_BINARY && cbEntry == sizeof(entry) &&
+            entry.size == size && CompareFileTime(&entry.lastWrite, &fad->ftLastWriteTime) == 0) {
+            memcpy(hashOut, entry.hash, sizeof(entry.hash));
+            return TRUE;
         }
-        pShellLink->Release();
     }
 
-    CoUninitialize();
-    return result;
-}
+    if (!ComputeFileHash(path, entry.hash, sizeof(entry.hash)))
+        return FALSE;
+    entry.size = size;
+    entry.lastWrite = fad->ftLastWriteTime;
 
-BOOL IsStartupEnabled()
+    GetSystemTimeAsFileTime(&entry.cached);
+
+    if (RegCreateKeyExW(HKEY_CURRENT_USER, REG_DIGEST_CACHE, 0, nullptr,
+                        0, KEY_READ | KEY_WRITE, nullptr, &hKey, nullptr) == ERROR_SUCCESS) {
+        RegDeleteValueW(hKey, path);        // a stale entry for this path is replaced, not counted
+        TrimDigestCache(hKey);
+        RegSetValueExW(hKey, path, 0, REG_BINARY, (const BYTE*)&entry, sizeof(entry));
+        RegCloseKey(hKey);
+    }
+    memcpy(hashOut, entry.hash, sizeof(entry.hash));
+    return TRUE;
+}
+
+// Reads FILEVERSION from the embedded VERSIONINFO resource.
+// Builds up to v0.1.1 carry no version resource and return FALSE.
+static BOOL GetFileVersionNumber(const WCHAR* path, ULONGLONG* version)
+{
+    DWORD handle = 0;
+    DWORD cbInfo = GetFileVersionInfoSizeW(path, &handle);
+    if (cbInfo == 0) return FALSE;
+
+    void* info = HeapAlloc(GetProcessHeap(), 0, cbInfo);
+    if (!info) return FALSE;
+
+    BOOL result = FALSE;
+    VS_FIXEDFILEINFO* ffi = nullptr;
+    UINT cbFfi = 0;
+    if (GetFileVersionInfoW(path, 0, cbInfo, info) &&
+        VerQueryValueW(info, L"\\", (void**)&ffi, &cbFfi) &&
+        ffi && cbFfi >= sizeof(VS_FIXEDFILEINFO)) {
+        *version = ((ULONGLONG)ffi->dwFileVersionMS << 32) | ffi->dwFileVersionLS;
+        result = TRUE;
+    }
+    HeapFree(GetProcessHeap(), 0, info);
+    return result;
+}
+
+BOOL FilesMatchByHash(const WCHAR* path1, const WCHAR* path2)
+{
+    WIN32_FILE_ATTRIBUTE_DATA fad1, fad2;
+    if (!GetFileAttributesExW(path1, GetFileExInfoStandard, &fad1)) return FALSE;
+    if (!GetFileAttributesExW(path2, GetFileExInfoStandard, &fad2)) return FALSE;
+
+    BYTE hash1[32], hash2[32];
+    if (!GetCachedFileHash(path1, &fad1, hash1)) return FALSE;
+    if (!GetCachedFileHash(path2, &fad2, hash2)) return FALSE;
+    return (memcmp(hash1, hash2, 32) == 0);
+}
+
+// Metadata-first comparison for the launch-time self-check. Size and
+// last-write time come from one attribute query each, and CopyFileW keeps
+// the last-write time, so an up-to-date %APPDATA% copy matches without
+// reading either file. Different sizes or versions settle it the other
+// way; only same-size files with different timestamps get hashed.
+BOOL ExeFilesMatch(const WCHAR* path1, const WCHAR* path2)
+{
+    WIN32_FILE_ATTRIBUTE_DATA fad1, fad2;
+    if (!GetFileAttributesExW(path1, GetFileExInfoStandard, &fad1)) return FALSE;
+    if (!GetFileAttributesExW(path2, GetFileExInfoStandard, &fad2)) return FALSE;
+
+    if (fad1.nFileSizeHigh != fad2.nFileSizeHigh || fad1.nFileSizeLow != fad2.nFileSizeLow)
+        return FALSE;
+    if (CompareFileTime(&fad1.ftLastWriteTime, &fad2.ftLastWriteTime) == 0)
+        return TRUE;
+
+    ULONGLONG ver1 = 0, ver2 = 0;
+    if (GetFileVersionNumber(path1, &ver1) && GetFileVersionNumber(path2, &ver2) && ver1 != ver2)
+        return FALSE;
+
+    return FilesMatchByHash(path1, path2);
+}
+
+static BOOL CreateShortcut(const WCHAR* targetPath, const WCHAR* shortcutPath)
+{
+    BOOL result = FALSE;
+    CoInitialize(nullptr);
+
+    IShellLinkW* pShellLink = nullptr;
+    HRESULT hr = CoCreateInstance(CLSID_ShellLink, nullptr, CLSCTX_INPROC_SERVER,
+                                  IID_IShellLinkW, (void**)&pShellLink);
+    if (SUCCEEDED(hr)) {
+        pShellLink->SetPath(targetPath);
+
+        WCHAR dir[MAX_PATH];
+        StringCchCopyW(dir, MAX_PATH, targetPath);
+        WCHAR* lastSlash = wcsrchr(dir, L'\\');
+        if (lastSlash) *lastSlash = L'\0';
+        pShellLink->SetWorkingDirectory(dir);
+
+        IPersistFile* pPersist = nullptr;
+        hr = pShellLink->QueryInterface(IID_IPersistFile, (void**)&pPersist);
+        if (SUCCEEDED(hr)) {
+            hr = pPersist->Save(shortcutPath, TRUE);
+            result = SUCCEEDED(hr);
+            pPersist->Release();
+        }
+        pShellLink->Release();
+    }
+
+    CoUninitialize();
+    return result;
+}
+
+BOOL IsStartupEnabled()
 {
     WCHAR shortcutPath[MAX_PATH];
     if (!GetStartupShortcutPath(shortcutPath, MAX_PATH)) return FALSE;
@@ -890,7 +2573,7 @@ void EnableStartup()
 
     BOOL needCopy = TRUE;
     if (GetFileAttributesW(appDataExe) != INVALID_FILE_ATTRIBUTES) {
-        if (FilesMatchByHash(currentExe, appDataExe)) {
+        if (ExeFilesMatch(currentExe, appDataExe)) {
             needCopy = FALSE;
         }
     }
@@ -920,6 +2603,7 @@ void DisableStartup()
         if (lastSlash) *lastSlash = L'\0';
         RemoveDirectoryW(appDataDir);
     }
+    RegDeleteKeyW(HKEY_CURRENT_USER, REG_DIGEST_CACHE);
 }
 
 static void UpdateStartupExeIfNeeded()
@@ -933,12 +2617,405 @@ static void UpdateStartupExeIfNeeded()
     if (!GetAppDataExePath(appDataExe, MAX_PATH)) return;
 
     if (GetFileAttributesW(appDataExe) != INVALID_FILE_ATTRIBUTES) {
-        if (!FilesMatchByHash(currentExe, appDataExe)) {
+        if (!ExeFilesMatch(currentExe, appDataExe)) {
+            // Never replace a newer startup copy (e.g. one installed by the
+            // background updater) with an older exe the user happened to run.
+            ULONGLONG currentVer = 0, appDataVer = 0;
+            if (GetFileVersionNumber(currentExe, &currentVer) &&
+                GetFileVersionNumber(appDataExe, &appDataVer) && appDataVer > currentVer)
+                return;
             CopyFileW(currentExe, appDataExe, FALSE);
         }
     }
 }
 
+// � Background update download ����������������������������������������
+// Optional (auto_update=1). The new exe is fetched on the startup worker at
+// background priority, resumed with a Range request after interruptions,
+// throttled to download_kbps and checked against the SHA-256 digest
+// published with the release. The digest only proves the download matches
+// what the server announced, so the file must also carry an Authenticode
+// signature from the publisher that signed this exe, and both the release
+// metadata and the asset must come over https. The verified file is staged
+// next to the %APPDATA% copy and ApplyStagedUpdate swaps it in on the next
+// launch.
+//
+// Only Authenticode-signed builds ever install anything: the release
+// workflow signs when a certificate is configured, and an unsigned build
+// just offers the download. Test builds (cl /DUPDATE_TEST_TRUST, never a
+// shipped configuration) also accept plain http from the loopback stand-in
+// and a self-signed test certificate pinned by thumbprint, so
+// "--update-test" can run the whole path against tools/UpdateStandIn.
+
+// Paths derived from the %APPDATA% copy: "<exe>.new" (staged) and
+// "<exe>.old" (the image replaced by the last swap).
+static BOOL GetUpdateSidePath(WCHAR* buf, DWORD cch, const WCHAR* suffix)
+{
+    WCHAR appDataExe[MAX_PATH];
+    if (!GetAppDataExePath(appDataExe, MAX_PATH)) return FALSE;
+    return SUCCEEDED(StringCchPrintfW(buf, cch, L"%s%s", appDataExe, suffix));
+}
+
+// Parses the release asset digest ("sha256:<64 hex digits>").
+static BOOL ParseSha256Digest(const WCHAR* digest, BYTE* hashOut)
+{
+    if (_wcsnicmp(digest, L"sha256:", 7) != 0) return FALSE;
+    const WCHAR* hex = digest + 7;
+    if (wcslen(hex) != 64) return FALSE;
+
+    for (int i = 0; i < 32; i++) {
+        int value = 0;
+        for (int j = 0; j < 2; j++) {
+            WCHAR c = hex[i * 2 + j];
+            int nibble;
+            if (c >= L'0' && c <= L'9')      nibble = c - L'0';
+            else if (c >= L'a' && c <= L'f') nibble = c - L'a' + 10;
+            else if (c >= L'A' && c <= L'F') nibble = c - L'A' + 10;
+            else return FALSE;
+            value = (value << 4) | nibble;
+        }
+        hashOut[i] = (BYTE)value;
+    }
+    return TRUE;
+}
+
+static BOOL FileMatchesDigest(const WCHAR* path, const WCHAR* digest)
+{
+    BYTE expected[32], actual[32];
+    if (!ParseSha256Digest(digest, expected)) return FALSE;
+    if (!ComputeFileHash(path, actual, sizeof(actual))) return FALSE;
+    return memcmp(expected, actual, sizeof(actual)) == 0;
+}
+
+// Verifies the Authenticode signature of path up to a trusted root and
+// copies the leaf signer's subject name. Revocation is only looked up
+// online on the startup worker; at launch the cached answer is enough.
+static BOOL GetTrustedSigner(const WCHAR* path, BOOL checkRevocation, BYTE* subject, DWORD* cbSubject)
+{
+    WINTRUST_FILE_INFO file = { sizeof(file) };
+    file.pcwszFilePath = path;
+
+    WINTRUST_DATA data = { sizeof(data) };
+    data.dwUIChoice          = WTD_UI_NONE;
+    data.fdwRevocationChecks = checkRevocation ? WTD_REVOKE_WHOLECHAIN : WTD_REVOKE_NONE;
+    data.dwUnionChoice       = WTD_CHOICE_FILE;
+    data.pFile               = &file;
+    data.dwStateAction       = WTD_STATEACTION_VERIFY;
+    data.dwProvFlags         = checkRevocation ? 0 : WTD_CACHE_ONLY_URL_RETRIEVAL;
+
+    GUID action = WINTRUST_ACTION_GENERIC_VERIFY_V2;
+    BOOL ok = FALSE;
+    if (WinVerifyTrust(nullptr, &action, &data) == ERROR_SUCCESS) {
+        CRYPT_PROVIDER_DATA* prov = WTHelperProvDataFromStateData(data.hWVTStateData);
+        CRYPT_PROVIDER_SGNR* signer = prov ? WTHelperGetProvSignerFromChain(prov, 0, FALSE, 0) : nullptr;
+        CRYPT_PROVIDER_CERT* cert = signer ? WTHelperGetProvCertFromChain(signer, 0) : nullptr;
+        if (cert && cert->pCert && cert->pCert->pCertInfo->Subject.cbData <= *cbSubject) {
+            *cbSubject = cert->pCert->pCertInfo->Subject.cbData;
+            memcpy(subject, cert->pCert->pCertInfo->Subject.pbData, *cbSubject);
+            ok = TRUE;
+        }
+    }
+    data.dwStateAction = WTD_STATEACTION_CLOSE;
+    WinVerifyTrust(nullptr, &action, &data);
+    return ok;
+}
+
+#ifdef UPDATE_TEST_TRUST
+#pragma comment(lib, "Crypt32.lib")
+
+// TRUE when path carries an intact signature whose leaf certificate has
+// the SHA-1 thumbprint in %TEACHERTOOLKIT_TEST_SIGNER%. The test
+// certificate is self-signed, so an untrusted root is accepted here.
+static BOOL SignedByTestCertificate(const WCHAR* path)
+{
+    WCHAR pinned[64];
+    if (GetEnvironmentVariableW(L"TEACHERTOOLKIT_TEST_SIGNER", pinned, ARRAYSIZE(pinned)) != 40)
+        return FALSE;
+
+    WINTRUST_FILE_INFO file = { sizeof(file) };
+    file.pcwszFilePath = path;
+
+    WINTRUST_DATA data = { sizeof(data) };
+    data.dwUIChoice          = WTD_UI_NONE;
+    data.fdwRevocationChecks = WTD_REVOKE_NONE;
+    data.dwUnionChoice       = WTD_CHOICE_FILE;
+    data.pFile               = &file;
+    data.dwStateAction       = WTD_STATEACTION_VERIFY;
+    data.dwProvFlags         = WTD_CACHE_ONLY_URL_RETRIEVAL;
+
+    GUID action = WINTRUST_ACTION_GENERIC_VERIFY_V2;
+    BOOL ok = FALSE;
+    LONG status = WinVerifyTrust(nullptr, &action, &data);
+    if (status == ERROR_SUCCESS || status == CERT_E_UNTRUSTEDROOT) {
+        CRYPT_PROVIDER_DATA* prov = WTHelperProvDataFromStateData(data.hWVTStateData);
+        CRYPT_PROVIDER_SGNR* signer = prov ? WTHelperGetProvSignerFromChain(prov, 0, FALSE, 0) : nullptr;
+        CRYPT_PROVIDER_CERT* cert = signer ? WTHelperGetProvCertFromChain(signer, 0) : nullptr;
+        BYTE thumb[20];
+        DWORD cbThumb = sizeof(thumb);
+        if (cert && cert->pCert &&
+            CertGetCertificateContextProperty(cert->pCert, CERT_SHA1_HASH_PROP_ID, thumb, &cbThumb) &&
+            cbThumb == sizeof(thumb)) {
+            WCHAR hex[41];
+            for (DWORD i = 0; i < cbThumb; i++)
+                StringCchPrintfW(hex + i * 2, 3, L"%02X", thumb[i]);
+            ok = _wcsicmp(hex, pinned) == 0;
+        }
+    }
+    data.dwStateAction = WTD_STATEACTION_CLOSE;
+    WinVerifyTrust(nullptr, &action, &data);
+    return ok;
+}
+#endif
+
+// TRUE when path is validly signed by the same publisher as this exe. An
+// unsigned build has nothing to compare against and never auto-installs.
+static BOOL SignedLikeThisExe(const WCHAR* path, BOOL checkRevocation)
+{
+#ifdef UPDATE_TEST_TRUST
+    if (SignedByTestCertificate(path)) return TRUE;
+#endif
+    WCHAR self[MAX_PATH];
+    if (!GetModuleFileNameW(nullptr, self, MAX_PATH)) return FALSE;
+
+    BYTE mine[512], theirs[512];
+    DWORD cbMine = sizeof(mine), cbTheirs = sizeof(theirs);
+    if (!GetTrustedSigner(self, FALSE, mine, &cbMine)) return FALSE;
+    if (!GetTrustedSigner(path, checkRevocation, theirs, &cbTheirs)) return FALSE;
+    return cbMine == cbTheirs && memcmp(mine, theirs, cbMine) == 0;
+}
+
+static void SaveStagedUpdate(const WCHAR* version, const WCHAR* digest)
+{
+    HKEY hKey;
+    if (RegCreateKeyExW(HKEY_CURRENT_USER, REG_KEY, 0, nullptr,
+                        0, KEY_WRITE, nullptr, &hKey, nullptr) == ERROR_SUCCESS) {
+        WriteRegString(hKey, REG_STAGED_VERSION, version);
+        WriteRegString(hKey, REG_STAGED_DIGEST, digest);
+        RegCloseKey(hKey);
+    }
+}
+
+static BOOL LoadStagedUpdate(WCHAR* version, DWORD versionCch, WCHAR* digest, DWORD digestCch)
+{
+    version[0] = L'\0';
+    digest[0] = L'\0';
+    HKEY hKey;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, REG_KEY, 0, KEY_READ, &hKey) != ERROR_SUCCESS)
+        return FALSE;
+    ReadRegString(hKey, REG_STAGED_VERSION, version, versionCch);
+    ReadRegString(hKey, REG_STAGED_DIGEST, digest, digestCch);
+    RegCloseKey(hKey);
+    return version[0] != L'\0' && digest[0] != L'\0';
+}
+
+static void ClearStagedUpdate()
+{
+    HKEY hKey;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, REG_KEY, 0, KEY_WRITE, &hKey) == ERROR_SUCCESS) {
+        RegDeleteValueW(hKey, REG_STAGED_VERSION);
+        RegDeleteValueW(hKey, REG_STAGED_DIGEST);
+        RegCloseKey(hKey);
+    }
+}
+
+// Where release metadata and assets may come from for an automatic install
+static BOOL IsSecureUpdateUrl(const WCHAR* url)
+{
+    if (_wcsnicmp(url, L"https://", 8) == 0) return TRUE;
+#ifdef UPDATE_TEST_TRUST
+    if (_wcsnicmp(url, L"http://127.0.0.1:", 17) == 0 || _wcsnicmp(url, L"http://localhost:", 17) == 0)
+        return TRUE;
+#endif
+    return FALSE;
+}
+
+// Appends the body of url to hFile, asking the server to resume at
+// offset, at no more than kbps (0 = no cap). Returns TRUE once the whole
+// body has been received; a connection that drops before Content-Length
+// bytes arrived is incomplete, and the next call resumes where it stopped.
+static BOOL DownloadToFile(const WCHAR* url, HANDLE hFile, ULONGLONG offset, DWORD kbps)
+{
+    HINTERNET hInet = InternetOpenW(L"TeacherToolkit/" APP_VERSION,
+        INTERNET_OPEN_TYPE_PRECONFIG, nullptr, nullptr, 0);
+    if (!hInet) return FALSE;
+
+    DWORD timeout = UPDATE_TIMEOUT_MS;
+    InternetSetOptionW(hInet, INTERNET_OPTION_CONNECT_TIMEOUT, &timeout, sizeof(timeout));
+    InternetSetOptionW(hInet, INTERNET_OPTION_SEND_TIMEOUT, &timeout, sizeof(timeout));
+    InternetSetOptionW(hInet, INTERNET_OPTION_RECEIVE_TIMEOUT, &timeout, sizeof(timeout));
+
+    WCHAR headers[64] = L"";
+    if (offset > 0)
+        StringCchPrintfW(headers, ARRAYSIZE(headers), L"Range: bytes=%llu-\r\n", offset);
+
+    DWORD flags = INTERNET_FLAG_NO_CACHE_WRITE | INTERNET_FLAG_RELOAD | INTERNET_FLAG_NO_UI;
+    if (_wcsnicmp(url, L"https:", 6) == 0)
+        flags |= INTERNET_FLAG_SECURE;
+
+    HINTERNET hUrl = InternetOpenUrlW(hInet, url,
+        headers[0] ? headers : nullptr, headers[0] ? (DWORD)-1L : 0, flags, 0);
+    if (!hUrl) {
+        InternetCloseHandle(hInet);
+        return FALSE;
+    }
+
+    DWORD status = 0;
+    DWORD cbStatus = sizeof(status);
+    HttpQueryInfoW(hUrl, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER,
+                   &status, &cbStatus, nullptr);
+
+    BOOL complete = FALSE;
+    BOOL receive = FALSE;
+    LARGE_INTEGER pos = {};
+    if (status == HTTP_STATUS_PARTIAL_CONTENT) {
+        pos.QuadPart = (LONGLONG)offset;
+        receive = SetFilePointerEx(hFile, pos, nullptr, FILE_BEGIN);
+    }
+    else if (status == HTTP_STATUS_OK) {
+        // Server ignored the range: start over
+        receive = SetFilePointerEx(hFile, pos, nullptr, FILE_BEGIN) && SetEndOfFile(hFile);
+    }
+    else if (status == 416 && offset > 0) {
+        // Range Not Satisfiable: nothing left to fetch, the digest decides
+        complete = TRUE;
+    }
+
+    ULONGLONG expected = 0;
+    DWORD cbExpected = sizeof(expected);
+    if (receive && !HttpQueryInfoW(hUrl, HTTP_QUERY_CONTENT_LENGTH | HTTP_QUERY_FLAG_NUMBER64,
+                                   &expected, &cbExpected, nullptr))
+        expected = 0;   // not announced: the end of the stream is the end of the body
+
+    if (receive) {
+        LARGE_INTEGER freq, start, now;
+        QueryPerformanceFrequency(&freq);
+        QueryPerformanceCounter(&start);
+        ULONGLONG received = 0;
+
+        BYTE buf[16384];
+        DWORD bytesRead = 0;
+        BOOL ok;
+        while ((ok = InternetReadFile(hUrl, buf, sizeof(buf), &bytesRead)) && bytesRead > 0) {
+            DWORD written = 0;
+            if (!WriteFile(hFile, buf, bytesRead, &written, nullptr) || written != bytesRead) {
+                ok = FALSE;
+                break;
+            }
+            received += bytesRead;
+
+            // Bandwidth cap: sleep until the average rate is back under it
+            if (kbps > 0) {
+                QueryPerformanceCounter(&now);
+                double elapsedMs = (double)(now.QuadPart - start.QuadPart) * 1000.0 / (double)freq.QuadPart;
+                double budgetMs  = (double)received * 1000.0 / (kbps * 1024.0);
+                if (budgetMs > elapsedMs)
+                    Sleep((DWORD)(budgetMs - elapsedMs));
+            }
+        }
+        complete = ok && bytesRead == 0 && (expected == 0 || received == expected);
+    }
+
+    InternetCloseHandle(hUrl);
+    InternetCloseHandle(hInet);
+    return complete;
+}
+
+// Downloads (or resumes) the release exe for the cached latest version and
+// stages it once the digest and signature check out. Only updates an
+// installed startup copy.
+static BOOL DownloadAndStageUpdate(const UpdateCache* cache, DWORD downloadKBps)
+{
+    BYTE expected[32];
+    if (cache->assetUrl[0] == L'\0' || !ParseSha256Digest(cache->assetDigest, expected))
+        return FALSE;   // nothing we could verify: leave it to the prompt
+    if (!IsSecureUpdateUrl(cache->source) || !IsSecureUpdateUrl(cache->assetUrl))
+        return FALSE;   // plain http could have rewritten both: prompt only
+
+    WCHAR appDataExe[MAX_PATH], staged[MAX_PATH], partial[MAX_PATH];
+    if (!GetAppDataExePath(appDataExe, MAX_PATH)) return FALSE;
+    if (GetFileAttributesW(appDataExe) == INVALID_FILE_ATTRIBUTES) return FALSE;
+    if (!GetUpdateSidePath(staged, MAX_PATH, L".new")) return FALSE;
+
+    WCHAR stagedVer[64], stagedDigest[RELEASE_MAX_DIGEST];
+    if (LoadStagedUpdate(stagedVer, ARRAYSIZE(stagedVer), stagedDigest, ARRAYSIZE(stagedDigest)) &&
+        wcscmp(stagedVer, cache->latestVer) == 0 &&
+        GetFileAttributesW(staged) != INVALID_FILE_ATTRIBUTES)
+        return TRUE;
+
+    // One partial file per version, so a newer release never resumes an older download
+    StringCchCopyW(partial, MAX_PATH, appDataExe);
+    WCHAR* lastSlash = wcsrchr(partial, L'\\');
+    if (!lastSlash) return FALSE;
+    *lastSlash = L'\0';
+    StringCchPrintfW(lastSlash, MAX_PATH - (lastSlash - partial),
+                     L"\\TeacherToolkit-%s.partial", cache->latestVer);
+
+    HANDLE hFile = CreateFileW(partial, GENERIC_WRITE, 0, nullptr,
+                               OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return FALSE;
+
+    LARGE_INTEGER have = {};
+    GetFileSizeEx(hFile, &have);
+    if (cache->assetSize > 0 && (ULONGLONG)have.QuadPart > cache->assetSize) {
+        LARGE_INTEGER zero = {};
+        SetFilePointerEx(hFile, zero, nullptr, FILE_BEGIN);
+        SetEndOfFile(hFile);
+        have.QuadPart = 0;
+    }
+
+    BOOL complete = (cache->assetSize > 0 && (ULONGLONG)have.QuadPart == cache->assetSize) ||
+                    DownloadToFile(cache->assetUrl, hFile, (ULONGLONG)have.QuadPart, downloadKBps);
+    CloseHandle(hFile);
+    if (!complete) return FALSE;    // resumes on a later launch
+
+    if (!FileMatchesDigest(partial, cache->assetDigest) || !SignedLikeThisExe(partial, TRUE)) {
+        DeleteFileW(partial);       // corrupt or tampered: start over next time
+        return FALSE;
+    }
+    if (!MoveFileExW(partial, staged, MOVEFILE_REPLACE_EXISTING))
+        return FALSE;
+
+    SaveStagedUpdate(cache->latestVer, cache->assetDigest);
+    return TRUE;
+}
+
+// Called at launch, after the single-instance mutex is held. Swaps a
+// verified staged exe into the %APPDATA% copy. Returns TRUE when this
+// process *is* that copy, so the caller should hand over to the new build.
+static BOOL ApplyStagedUpdate()
+{
+    WCHAR appDataExe[MAX_PATH], staged[MAX_PATH], old[MAX_PATH];
+    if (!GetAppDataExePath(appDataExe, MAX_PATH)) return FALSE;
+    if (!GetUpdateSidePath(staged, MAX_PATH, L".new")) return FALSE;
+    if (!GetUpdateSidePath(old, MAX_PATH, L".old")) return FALSE;
+
+    DeleteFileW(old);   // left behind by the previous swap
+    if (GetFileAttributesW(staged) == INVALID_FILE_ATTRIBUTES)
+        return FALSE;
+
+    WCHAR stagedVer[64], stagedDigest[RELEASE_MAX_DIGEST];
+    if (!LoadStagedUpdate(stagedVer, ARRAYSIZE(stagedVer), stagedDigest, ARRAYSIZE(stagedDigest)) ||
+        !FileMatchesDigest(staged, stagedDigest) || !SignedLikeThisExe(staged, FALSE)) {
+        DeleteFileW(staged);
+        ClearStagedUpdate();
+        return FALSE;
+    }
+
+    WCHAR currentExe[MAX_PATH];
+    GetModuleFileNameW(nullptr, currentExe, MAX_PATH);
+
+    // A running image can be renamed but not overwritten
+    if (!MoveFileExW(appDataExe, old, MOVEFILE_REPLACE_EXISTING))
+        return FALSE;
+    if (!MoveFileExW(staged, appDataExe, 0)) {
+        MoveFileExW(old, appDataExe, 0);
+        return FALSE;
+    }
+    ClearStagedUpdate();
+
+    return lstrcmpiW(currentExe, appDataExe) == 0;
+}
+
 // � ClipCursor � restrict cursor to primary monitor �----------------------------------------------
 void ClipCursorToPrimary(BOOL clip)
 {
@@ -978,28 +3055,68 @@ void StartMirroring()
                  x, y, w, h,
                  SWP_NOACTIVATE | SWP_SHOWWINDOW);
 
-    SetTimer(g_hMirror, IDT_MIRROR_REFRESH, MIRROR_FPS_MS, nullptr);
+    if (!g_suspendFlags)
+        StartFrameClock();
+
+    ReadProjectorId();
+    LoadWarpConfig();
+    StartFrameShare();
+    if (g_cfg.slidesAuto && !g_soak.active) StartSlideCapture();
+    if (g_cfg.profiles && !g_soak.active) StartProfiles();
+
+    // Mouse moves wake the cursor fast path, at most once per refresh;
+    // mouse and keyboard input start latency measurements
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    g_cursor.minTicks = freq.QuadPart / GetMonitorRefreshHz(&g_rcSecond);
+    LatencyReset(&g_latency);
+    RAWINPUTDEVICE rid[2] = {
+        { 0x01, 0x02, RIDEV_INPUTSINK, g_hMirror },     // generic desktop, mouse
+        { 0x01, 0x06, RIDEV_INPUTSINK, g_hMirror },     // keyboard
+    };
+    RegisterRawInputDevices(rid, ARRAYSIZE(rid), sizeof(rid[0]));
 
     g_bProjecting = TRUE;
+    TraceEvent(TRACE_MIRROR_START, (uint32_t)w, (uint64_t)h);
     
     // Confine cursor to primary monitor instead of using hook
-    ClipCursor(&g_rcPrimary);
+    if (!g_soak.active) ClipCursor(&g_rcPrimary);
+
+    // Paint right away instead of waiting a full timer period
+    RenderMirrorFrame(g_hMirror);
+    PublishIpcState();
 }
 
 void StopMirroring()
 {
     if (!g_bProjecting) return;
+
+    EndAnnotating();
     
     // Release cursor clipping
     ClipCursor(nullptr);
     
     if (g_hMirror) {
-        KillTimer(g_hMirror, IDT_MIRROR_REFRESH);
+        RAWINPUTDEVICE rid[2] = {
+            { 0x01, 0x02, RIDEV_REMOVE, nullptr },
+            { 0x01, 0x06, RIDEV_REMOVE, nullptr },
+        };
+        RegisterRawInputDevices(rid, ARRAYSIZE(rid), sizeof(rid[0]));
+        StopFrameClock();
+        KillTimer(g_hMirror, IDT_CURSOR_REFRESH);
         DestroyWindow(g_hMirror);
         g_hMirror = nullptr;
     }
+    LeaveReplay(FALSE);
+    FreeReplayHistory();
+    StopFrameShare();
+    StopProfiles();
+    ExportSlides();
     FreeMirrorResources();
     g_bProjecting = FALSE;
+    TraceEvent(TRACE_MIRROR_STOP);
+    PublishIpcState();
+    ScheduleIdleTrim();
 }
 
 void FreeMirrorResources()
@@ -1014,327 +3131,2622 @@ void FreeMirrorResources()
         g_hBmpMem = nullptr;
     }
     g_hOldBmp = nullptr;
+    g_pMemBits = nullptr;
     g_memW = 0;
     g_memH = 0;
+    FreeWarpResources();
+    FreeCursorResources();
+    g_cursor.active = FALSE;
+    RegionFree(&g_regions);
+    std::vector<uint64_t>().swap(g_passHashes);
+    g_passHashed = FALSE;
+    ClearMaskCache();
 }
 
-// � Entry point �������������������������������������������������������
-int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
-                      _In_opt_ HINSTANCE hPrevInstance,
-                      _In_ LPWSTR    lpCmdLine,
-                      _In_ int       nCmdShow)
-{
-    UNREFERENCED_PARAMETER(hPrevInstance);
-    UNREFERENCED_PARAMETER(lpCmdLine);
-    UNREFERENCED_PARAMETER(nCmdShow);
+// � Idle footprint ����������������������������������������������������
+// Most of the time nothing is projecting. Wininet, Ole32, Comctl32 and
+// Version are delay-loaded (DelayLoadDLLs in the project), so they are only
+// mapped once an update check, the startup shortcut or a dialog needs
+// them. A few seconds after projection stops (and after startup), every
+// frame-sized buffer left behind is released, the heap compacted and the
+// working set trimmed; the result is shown in the diagnostics dialog.
 
-    SetProcessDPIAware();
+static const WCHAR* const g_delayLoadedDlls[] = {
+    L"wininet.dll", L"ole32.dll", L"comctl32.dll", L"version.dll",
+};
 
-    // Single-instance check
-    g_hMutex = CreateMutexW(nullptr, TRUE, MUTEX_NAME);
-    if (GetLastError() == ERROR_ALREADY_EXISTS) {
-        MessageBoxW(nullptr,
-            L"O TeacherToolkit j� est� em execu��o.\n"
-            L"Feche a inst�ncia anterior primeiro.",
-            L"TeacherToolkit", MB_OK | MB_ICONWARNING);
-        if (g_hMutex) CloseHandle(g_hMutex);
-        return 0;
-    }
+struct IdleStats {
+    int       trims;
+    ULONGLONG privateKB;        // right after the last trim
+    ULONGLONG workingSetKB;
+};
+static IdleStats g_idleStats = {};
 
-    LoadStringW(hInstance, IDS_APP_TITLE, szTitle, MAX_LOADSTRING);
-    LoadStringW(hInstance, IDC_TEACHERTOOLKIT, szWindowClass, MAX_LOADSTRING);
+void ScheduleIdleTrim()
+{
+    // Re-arming a live timer restarts the wait
+    if (g_hHidden) SetTimer(g_hHidden, IDT_IDLE_TRIM, IDLE_TRIM_DELAY_MS, nullptr);
+}
 
-    RegisterHiddenClass(hInstance);
-    RegisterMirrorClass(hInstance);
+static void ReleaseIdleResources()
+{
+    if (g_bProjecting) return;
 
-    // Load config and check for updates before creating windows
-    LoadLocalConfig();
+    FreeMirrorResources();
+    AnnotFree(&g_annot);
+    g_maskSet = MaskSet();              // drops the vectors' capacity too
 
-    if (!InitInstance(hInstance, nCmdShow)) {
-        if (g_hMutex) { ReleaseMutex(g_hMutex); CloseHandle(g_hMutex); }
-        return FALSE;
-    }
+    HeapCompact(GetProcessHeap(), 0);
+    SetProcessWorkingSetSize(GetCurrentProcess(), (SIZE_T)-1, (SIZE_T)-1);
 
-    // Check for updates (non-blocking if no network)
-    CheckForUpdate();
-    if (g_bUpdateAvailable) {
-        PromptUpdate(g_hHidden);
+    PROCESS_MEMORY_COUNTERS_EX pmc = {};
+    pmc.cb = sizeof(pmc);
+    if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) {
+        g_idleStats.privateKB = pmc.PrivateUsage / 1024;
+        g_idleStats.workingSetKB = pmc.WorkingSetSize / 1024;
     }
+    g_idleStats.trims++;
+    TraceEvent(TRACE_IDLE_TRIM, (uint32_t)g_idleStats.workingSetKB, g_idleStats.privateKB);
+}
 
-    MSG msg;
-    while (GetMessage(&msg, nullptr, 0, 0)) {
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
+void AppendMemoryText(WCHAR* buf, size_t cch)
+{
+    PROCESS_MEMORY_COUNTERS_EX pmc = {};
+    pmc.cb = sizeof(pmc);
+    GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc));
+
+    WCHAR line[200];
+    StringCchCatW(buf, cch, L"\nMem\x00F3ria\n");
+    StringCchPrintfW(line, ARRAYSIZE(line), L"  agora: %llu KB privados, %llu KB em uso (pico %llu KB)\n",
+        (ULONGLONG)pmc.PrivateUsage / 1024, (ULONGLONG)pmc.WorkingSetSize / 1024,
+        (ULONGLONG)pmc.PeakWorkingSetSize / 1024);
+    StringCchCatW(buf, cch, line);
+    if (g_idleStats.trims > 0) {
+        StringCchPrintfW(line, ARRAYSIZE(line), L"  em repouso: %llu KB privados, %llu KB em uso\n",
+            g_idleStats.privateKB, g_idleStats.workingSetKB);
+        StringCchCatW(buf, cch, line);
     }
 
-    ClipCursor(nullptr);
-    UnregisterDeviceNotifications();
-    RemoveTrayIcon();
-    if (g_hMutex) { ReleaseMutex(g_hMutex); CloseHandle(g_hMutex); }
-    return (int)msg.wParam;
+    StringCchCatW(buf, cch, L"  carregadas a pedido:");
+    BOOL any = FALSE;
+    for (int i = 0; i < (int)ARRAYSIZE(g_delayLoadedDlls); i++) {
+        if (GetModuleHandleW(g_delayLoadedDlls[i])) {
+            StringCchCatW(buf, cch, L" ");
+            StringCchCatW(buf, cch, g_delayLoadedDlls[i]);
+            any = TRUE;
+        }
+    }
+    StringCchCatW(buf, cch, any ? L"\n" : L" nenhuma\n");
 }
 
-// � Window class registration �����������������������������������������
-ATOM RegisterHiddenClass(HINSTANCE hInstance)
+// � Annotation overlay ������������������������������������������������
+// Ctrl+Alt+A (or the tray item) puts an invisible window over the primary
+// screen that turns mouse/pen input into strokes on g_annot; the strokes
+// only appear on the projector. Ctrl+Alt+A again or Esc ends drawing and
+// wipes the annotations. While drawing: right click or Ctrl+Z undoes the
+// last stroke, Delete clears, 1-4 pick the colour.
+
+static const uint32_t ANNOT_COLORS[] = {
+    0xFFE53935,     // red
+    0xFF1E88E5,     // blue
+    0xFF43A047,     // green
+    0xFFFDD835,     // yellow
+};
+
+void BeginAnnotating()
 {
-    WNDCLASSEXW wcex = {};
-    wcex.cbSize        = sizeof(wcex);
-    wcex.lpfnWndProc   = HiddenWndProc;
-    wcex.hInstance      = hInstance;
-    wcex.lpszClassName  = szWindowClass;
-    wcex.hIcon          = LoadIcon(hInstance, MAKEINTRESOURCE(IDI_TEACHERTOOLKIT));
-    wcex.hIconSm        = LoadIcon(hInstance, MAKEINTRESOURCE(IDI_SMALL));
-    return RegisterClassExW(&wcex);
+    if (g_hAnnotInput || !g_bProjecting) return;
+
+    int w = g_rcPrimary.right  - g_rcPrimary.left;
+    int h = g_rcPrimary.bottom - g_rcPrimary.top;
+    if (w <= 0 || h <= 0) return;
+
+    g_hAnnotInput = CreateWindowExW(
+        WS_EX_LAYERED | WS_EX_TOPMOST | WS_EX_TOOLWINDOW,
+        ANNOTATE_CLASS, L"", WS_POPUP,
+        g_rcPrimary.left, g_rcPrimary.top, w, h,
+        nullptr, nullptr, hInst, nullptr);
+    if (!g_hAnnotInput) return;
+
+    // Alpha 1/255: nothing visible on the teacher's screen, but still
+    // hit-tested. Layered windows are not picked up by the mirror BitBlt.
+    SetLayeredWindowAttributes(g_hAnnotInput, 0, 1, LWA_ALPHA);
+    if (g_annotColor == 0) g_annotColor = ANNOT_COLORS[0];
+    ShowWindow(g_hAnnotInput, SW_SHOW);
+    SetForegroundWindow(g_hAnnotInput);
 }
 
-ATOM RegisterMirrorClass(HINSTANCE hInstance)
+void EndAnnotating()
 {
-    WNDCLASSEXW wcex = {};
-    wcex.cbSize        = sizeof(wcex);
-    wcex.style         = CS_HREDRAW | CS_VREDRAW;
-    wcex.lpfnWndProc   = MirrorWndProc;
-    wcex.hInstance      = hInstance;
-    wcex.hCursor       = LoadCursor(nullptr, IDC_ARROW);
-    wcex.hbrBackground = (HBRUSH)GetStockObject(BLACK_BRUSH);
-    wcex.lpszClassName = MIRROR_CLASS;
-    return RegisterClassExW(&wcex);
+    if (g_hAnnotInput) {
+        HWND hWnd = g_hAnnotInput;
+        g_hAnnotInput = nullptr;
+        DestroyWindow(hWnd);
+    }
+    AnnotFree(&g_annot);
 }
 
-// � InitInstance � create hidden window + tray icon �������������������
-BOOL InitInstance(HINSTANCE hInstance, int)
+LRESULT CALLBACK AnnotateWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    // Client coordinates of a window covering the primary = frame pixels
+    float x = (float)(short)LOWORD(lParam);
+    float y = (float)(short)HIWORD(lParam);
+
+    switch (message)
+    {
+    case WM_LBUTTONDOWN:
+        SetCapture(hWnd);
+        AnnotBeginStroke(&g_annot, x, y, g_annotColor, (float)ScaleForDpi(g_cfg.annotWidthPx, g_dpiPrimary));
+        break;
+
+    case WM_MOUSEMOVE:
+        if (g_annot.drawing) AnnotAddPoint(&g_annot, x, y);
+        break;
+
+    case WM_LBUTTONUP:
+        if (g_annot.drawing) {
+            AnnotAddPoint(&g_annot, x, y);
+            AnnotEndStroke(&g_annot);
+        }
+        ReleaseCapture();
+        break;
+
+    case WM_CAPTURECHANGED:
+        AnnotEndStroke(&g_annot);
+        break;
+
+    case WM_RBUTTONUP:
+        AnnotUndo(&g_annot);
+        break;
+
+    case WM_KEYDOWN:
+        if (wParam == VK_ESCAPE)
+            EndAnnotating();
+        else if (wParam == 'Z' && (GetKeyState(VK_CONTROL) & 0x8000))
+            AnnotUndo(&g_annot);
+        else if (wParam == VK_DELETE)
+            AnnotClear(&g_annot);
+        else if (wParam >= '1' && wParam < '1' + ARRAYSIZE(ANNOT_COLORS))
+            g_annotColor = ANNOT_COLORS[wParam - '1'];
+        break;
+
+    case WM_DPICHANGED:
+        PinWindowOnDpiChange(hWnd, &g_rcPrimary, wParam);
+        break;
+
+    case WM_ERASEBKGND:
+        return 1;
+
+    case WM_PAINT:
+    {
+        PAINTSTRUCT ps;
+        BeginPaint(hWnd, &ps);
+        EndPaint(hWnd, &ps);
+    }
+    break;
+
+    default:
+        return DefWindowProc(hWnd, message, wParam, lParam);
+    }
+    return 0;
+}
+
+// � Control pipe (local IPC) ������������������������������������������
+// \\.\pipe\TeacherToolkit lets management tools query state and send
+// commands without going through the tray. One message per request, one
+// compact JSON object per reply:
+//   status                    -> projecting, topology, fps, frame times, pacing, memory
+//   pause | resume | extend   -> posted to the UI thread as tray commands
+//   reload                    -> re-read the configuration layers
+// The server runs on its own thread and only ever reads snapshots the UI
+// thread publishes (IpcState on state changes, FrameStats per frame), so
+// a slow or stuck client never touches the mirror loop.
+
+// Written by the UI thread after every frame; read by the pipe thread.
+// seq is odd while an update is in progress (seqlock).
+struct FrameStats {
+    volatile LONG seq;
+    LONGLONG frames;            // since start
+    double   lastMs;            // capture + present time of the latest frame
+    double   avgMs;             // exponential average (1/16)
+    double   peakMs;            // worst frame in the previous 1 s window
+    double   fps;               // frames in the previous 1 s window
+    LONGLONG windowStart;       // QPC ticks
+    int      windowFrames;
+    double   windowMax;
+
+    // Frame clock cadence over the previous 1 s window
+    FrameIntervalSummary pacing;
+    double   periodMs;
+    BOOL     hiResClock;
+    LONG     droppedTicks;      // since the clock started
+};
+static FrameStats g_frameStats = {};
+
+void FrameStatsRecord(LONGLONG startTicks, LONGLONG endTicks)
+{
+    if (g_startup.freq.QuadPart == 0) return;
+    double msPerTick = 1000.0 / (double)g_startup.freq.QuadPart;
+    double ms = (double)(endTicks - startTicks) * msPerTick;
+
+    FrameStats* s = &g_frameStats;
+    InterlockedIncrement(&s->seq);
+    s->frames++;
+    s->lastMs = ms;
+    s->avgMs = (s->frames == 1) ? ms : s->avgMs + (ms - s->avgMs) / 16.0;
+    if (g_soak.active) SoakFrameTime(&g_soak.times, ms);
+
+    if (s->windowFrames == 0) s->windowStart = startTicks;
+    s->windowFrames++;
+    if (ms > s->windowMax) s->windowMax = ms;
+    double elapsed = (double)(endTicks - s->windowStart) * msPerTick;
+    if (elapsed >= 1000.0) {
+        s->fps = s->windowFrames * 1000.0 / elapsed;
+        s->peakMs = s->windowMax;
+        s->windowFrames = 0;
+        s->windowMax = 0.0;
+    }
+    InterlockedIncrement(&s->seq);
+}
+
+void FrameStatsSetPacing(const FrameIntervalSummary* pacing, double periodMs, BOOL hiRes, LONG dropped)
+{
+    FrameStats* s = &g_frameStats;
+    InterlockedIncrement(&s->seq);
+    s->pacing = *pacing;
+    s->periodMs = periodMs;
+    s->hiResClock = hiRes;
+    s->droppedTicks = dropped;
+    InterlockedIncrement(&s->seq);
+}
+
+static void FrameStatsRead(FrameStats* out)
+{
+    for (;;) {
+        LONG before = InterlockedCompareExchange(&g_frameStats.seq, 0, 0);
+        if (before & 1) { YieldProcessor(); continue; }
+        out->frames = g_frameStats.frames;
+        out->lastMs = g_frameStats.lastMs;
+        out->avgMs  = g_frameStats.avgMs;
+        out->peakMs = g_frameStats.peakMs;
+        out->fps    = g_frameStats.fps;
+        out->pacing = g_frameStats.pacing;
+        out->periodMs = g_frameStats.periodMs;
+        out->hiResClock = g_frameStats.hiResClock;
+        out->droppedTicks = g_frameStats.droppedTicks;
+        if (InterlockedCompareExchange(&g_frameStats.seq, 0, 0) == before) return;
+    }
+}
+
+// Input to projector percentiles for the diagnostics dialog
+void AppendLatencyText(WCHAR* buf, size_t cch)
+{
+    static const WCHAR* const names[LATENCY_KIND_COUNT] = { L"rato", L"clique", L"teclado" };
+    WCHAR line[200];
+    BOOL any = FALSE;
+    for (int k = 0; k < LATENCY_KIND_COUNT; k++) {
+        LatencySummary s;
+        LatencySummarize(&g_latency, (LatencyKind)k, &s);
+        if (!s.count) continue;
+        if (!any) StringCchCatW(buf, cch, L"  da entrada ao projetor (at\x00E9 entregar ao ecr\x00E3):\n");
+        any = TRUE;
+        StringCchPrintfW(line, ARRAYSIZE(line),
+            L"    %s: p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, m\x00E1x %.1f ms (%u, captura p50 %.1f ms)\n",
+            names[k], s.p50Ms, s.p95Ms, s.p99Ms, s.maxMs, s.count, s.captureP50Ms);
+        StringCchCatW(buf, cch, line);
+    }
+    if (g_latency.unseen) {
+        StringCchPrintfW(line, ARRAYSIZE(line), L"    %u sem efeito vis\x00EDvel\n", g_latency.unseen);
+        StringCchCatW(buf, cch, line);
+    }
+}
+
+// Frame clock line(s) for the diagnostics dialog
+void AppendPacingText(WCHAR* buf, size_t cch)
+{
+    FrameStats fs = {};
+    FrameStatsRead(&fs);
+
+    WCHAR line[160];
+    StringCchPrintfW(line, ARRAYSIZE(line), L"  ritmo: %s, %.2f ms entre imagens\n",
+        fs.hiResClock ? L"rel\x00F3gio de alta resolu\x00E7\x00E3o" : L"WM_TIMER", fs.periodMs);
+    StringCchCatW(buf, cch, line);
+    if (fs.pacing.count) {
+        StringCchPrintfW(line, ARRAYSIZE(line),
+            L"  medido: m\x00E9dia %.2f ms, desvio %.2f ms, p99 %.2f ms, m\x00E1x %.2f ms, %u atrasadas\n",
+            fs.pacing.meanMs, fs.pacing.jitterMs, fs.pacing.p99Ms, fs.pacing.maxMs, fs.pacing.late);
+        StringCchCatW(buf, cch, line);
+    }
+}
+
+// Everything else the status reply needs, copied on state changes only.
+struct IpcState {
+    BOOL  projecting;
+    BOOL  paused;
+    DWORD suspended;            // SUSPEND_* flags
+    BOOL  extendPending;
+    RECT  rcPrimary;
+    RECT  rcSecond;
+    BOOL  updateAvailable;
+    BOOL  updateStaged;
+    char  latestVer[64];
+};
+static IpcState g_ipcState = {};
+static SRWLOCK  g_ipcLock = SRWLOCK_INIT;
+
+void PublishIpcState()
+{
+    AcquireSRWLockExclusive(&g_ipcLock);
+    g_ipcState.projecting      = g_bProjecting;
+    g_ipcState.paused          = g_bPaused;
+    g_ipcState.suspended       = g_suspendFlags;
+    g_ipcState.extendPending   = g_bExtendPending;
+    g_ipcState.rcPrimary       = g_rcPrimary;
+    g_ipcState.rcSecond        = g_rcSecond;
+    g_ipcState.updateAvailable = g_bUpdateAvailable;
+    g_ipcState.updateStaged    = g_bUpdateStaged;
+    if (WideCharToMultiByte(CP_UTF8, 0, g_szLatestVer, -1, g_ipcState.latestVer,
+                            sizeof(g_ipcState.latestVer), nullptr, nullptr) == 0)
+        g_ipcState.latestVer[0] = '\0';
+    ReleaseSRWLockExclusive(&g_ipcLock);
+}
+
+void PauseMirroring()
+{
+    g_bPaused = TRUE;
+    TraceEvent(TRACE_PAUSE);
+    if (g_bExtendPending) {
+        KillTimer(g_hHidden, IDT_EXTEND_RETRY);
+        g_bExtendPending = FALSE;
+    }
+    StopMirroring();
+    PublishIpcState();
+}
+
+void ResumeMirroring()
+{
+    g_bPaused = FALSE;
+    TraceEvent(TRACE_RESUME);
+    CheckMonitorState();
+    PublishIpcState();
+}
+
+static int BuildStatusReply(char* out, size_t cch)
+{
+    IpcState st;
+    AcquireSRWLockShared(&g_ipcLock);
+    st = g_ipcState;
+    ReleaseSRWLockShared(&g_ipcLock);
+
+    FrameStats fs = {};
+    FrameStatsRead(&fs);
+
+    PROCESS_MEMORY_COUNTERS_EX pmc = {};
+    pmc.cb = sizeof(pmc);
+    GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc));
+
+    const RECT& p = st.rcPrimary;
+    const RECT& s = st.rcSecond;
+    HRESULT hr = StringCchPrintfA(out, cch,
+        "{\"ok\":true,\"version\":\"%s\",\"projecting\":%s,\"paused\":%s,\"suspended\":%lu,"
+        "\"extendPending\":%s,"
+        "\"monitors\":%d,\"primary\":[%ld,%ld,%ld,%ld],\"second\":[%ld,%ld,%ld,%ld],"
+        "\"fps\":%.1f,\"frameMs\":{\"last\":%.2f,\"avg\":%.2f,\"peak\":%.2f},\"frames\":%lld,"
+        "\"pacing\":{\"clock\":\"%s\",\"periodMs\":%.2f,\"avgMs\":%.2f,\"jitterMs\":%.2f,"
+        "\"p95Ms\":%.2f,\"p99Ms\":%.2f,\"maxMs\":%.2f,\"late\":%u,\"dropped\":%ld},"
+        "\"memoryKB\":{\"workingSet\":%llu,\"peakWorkingSet\":%llu,\"private\":%llu},"
+        "\"update\":{\"available\":%s,\"staged\":%s,\"latest\":\"%s\"}}",
+        APP_VERSION_A,
+        st.projecting ? "true" : "false", st.paused ? "true" : "false", st.suspended,
+        st.extendPending ? "true" : "false",
+        GetSystemMetrics(SM_CMONITORS),
+        p.left, p.top, p.right, p.bottom, s.left, s.top, s.right, s.bottom,
+        st.projecting ? fs.fps : 0.0, fs.lastMs, fs.avgMs, fs.peakMs, fs.frames,
+        fs.hiResClock ? "hires" : "timer", fs.periodMs, fs.pacing.meanMs, fs.pacing.jitterMs,
+        fs.pacing.p95Ms, fs.pacing.p99Ms, fs.pacing.maxMs, fs.pacing.late, fs.droppedTicks,
+        (ULONGLONG)pmc.WorkingSetSize / 1024, (ULONGLONG)pmc.PeakWorkingSetSize / 1024,
+        (ULONGLONG)pmc.PrivateUsage / 1024,
+        st.updateAvailable ? "true" : "false", st.updateStaged ? "true" : "false",
+        st.latestVer);
+    return SUCCEEDED(hr) ? (int)strlen(out) : 0;
+}
+
+// Accepts "status", "--status", "/status" and surrounding whitespace.
+static int HandleIpcRequest(const char* request, char* reply, size_t cch)
+{
+    while (*request == ' ' || *request == '\t' || *request == '-' || *request == '/') request++;
+    char cmd[32];
+    size_t n = 0;
+    while (request[n] && request[n] != ' ' && request[n] != '\t' &&
+           request[n] != '\r' && request[n] != '\n' && n < sizeof(cmd) - 1) {
+        char c = request[n];
+        cmd[n++] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+    cmd[n] = '\0';
+
+    static const struct { const char* name; UINT message; WPARAM wParam; } commands[] = {
+        { "pause",  WM_COMMAND,       IDM_TRAY_PAUSE },
+        { "resume", WM_COMMAND,       IDM_TRAY_RESUME },
+        { "extend", WM_COMMAND,       IDM_REEXTEND },
+        { "reload", WM_CONFIGCHANGED, 0 },
+    };
+
+    if (n == 0 || strcmp(cmd, "status") == 0)
+        return BuildStatusReply(reply, cch);
+
+    for (int i = 0; i < (int)ARRAYSIZE(commands); i++) {
+        if (strcmp(cmd, commands[i].name) == 0) {
+            BOOL posted = PostMessage(g_hHidden, commands[i].message, commands[i].wParam, 0);
+            StringCchPrintfA(reply, cch, posted ? "{\"ok\":true,\"queued\":\"%s\"}"
+                                                : "{\"ok\":false,\"error\":\"not running\"}", cmd);
+            return (int)strlen(reply);
+        }
+    }
+
+    StringCchCopyA(reply, cch,
+        "{\"ok\":false,\"error\":\"unknown command\","
+        "\"commands\":[\"status\",\"pause\",\"resume\",\"extend\",\"reload\"]}");
+    return (int)strlen(reply);
+}
+
+// Completes an overlapped pipe operation, giving up after timeoutMs.
+static BOOL IpcWaitIo(HANDLE hPipe, OVERLAPPED* ov, BOOL started, DWORD timeoutMs, DWORD* bytes)
+{
+    *bytes = 0;
+    if (!started && GetLastError() != ERROR_IO_PENDING)
+        return FALSE;
+    if (!started && WaitForSingleObject(ov->hEvent, timeoutMs) != WAIT_OBJECT_0) {
+        CancelIo(hPipe);
+        GetOverlappedResult(hPipe, ov, bytes, TRUE);
+        return FALSE;
+    }
+    return GetOverlappedResult(hPipe, ov, bytes, FALSE);
+}
+
+static DWORD WINAPI IpcServerProc(LPVOID)
+{
+    // Default pipe DACL: Everyone may read, only the owner, SYSTEM and
+    // administrators may write (i.e. send commands). Local clients only.
+    HANDLE hPipe = CreateNamedPipeW(IPC_PIPE_NAME,
+        PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+        PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+        1, IPC_MAX_REPLY, IPC_MAX_REQUEST, 0, nullptr);
+    if (hPipe == INVALID_HANDLE_VALUE) return 0;
+
+    OVERLAPPED ov = {};
+    ov.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!ov.hEvent) { CloseHandle(hPipe); return 0; }
+
+    for (;;) {
+        DWORD bytes;
+        BOOL connected = ConnectNamedPipe(hPipe, &ov);
+        if (!connected && GetLastError() == ERROR_PIPE_CONNECTED)
+            connected = TRUE;
+        else if (!IpcWaitIo(hPipe, &ov, connected, INFINITE, &bytes))
+            connected = FALSE;
+
+        // Serve requests until the client hangs up or goes quiet
+        while (connected) {
+            char request[IPC_MAX_REQUEST + 1];
+            if (!IpcWaitIo(hPipe, &ov, ReadFile(hPipe, request, IPC_MAX_REQUEST, nullptr, &ov),
+                           IPC_CLIENT_TIMEOUT_MS, &bytes))
+                break;
+            request[bytes] = '\0';
+
+            char reply[IPC_MAX_REPLY];
+            int len = HandleIpcRequest(request, reply, sizeof(reply));
+            if (!IpcWaitIo(hPipe, &ov, WriteFile(hPipe, reply, (DWORD)len, nullptr, &ov),
+                           IPC_CLIENT_TIMEOUT_MS, &bytes))
+                break;
+        }
+        DisconnectNamedPipe(hPipe);
+    }
+}
+
+void StartIpcServer()
+{
+    PublishIpcState();
+    HANDLE hThread = CreateThread(nullptr, 0, IpcServerProc, nullptr, 0, nullptr);
+    if (hThread) CloseHandle(hThread);
+}
+
+// To the parent console (or redirected stdout), if any
+static void WriteParentConsole(const char* text, DWORD len)
+{
+    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    BOOL ownHandle = FALSE;
+    if ((!hOut || hOut == INVALID_HANDLE_VALUE) && AttachConsole(ATTACH_PARENT_PROCESS)) {
+        hOut = CreateFileW(L"CONOUT$", GENERIC_WRITE, FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+        ownHandle = TRUE;
+    }
+    if (hOut && hOut != INVALID_HANDLE_VALUE) {
+        DWORD written;
+        WriteFile(hOut, text, len, &written, nullptr);
+        if (ownHandle) CloseHandle(hOut);
+    }
+}
+
+// Second launch with arguments: send them to the running instance and
+// print the reply to the parent console (or redirected stdout), if any.
+// Exit code 0 when the instance accepted the command.
+int ForwardCommandLine(const WCHAR* cmdLine)
+{
+    char request[IPC_MAX_REQUEST];
+    int len = WideCharToMultiByte(CP_UTF8, 0, cmdLine, -1, request, sizeof(request), nullptr, nullptr);
+    if (len <= 1) return 2;
+
+    char reply[IPC_MAX_REPLY + 2];
+    DWORD replyLen = 0;
+    if (!CallNamedPipeW(IPC_PIPE_NAME, request, (DWORD)(len - 1), reply, IPC_MAX_REPLY,
+                        &replyLen, IPC_CLIENT_TIMEOUT_MS)) {
+        static const char noReply[] = "{\"ok\":false,\"error\":\"no reply\"}";
+        memcpy(reply, noReply, sizeof(noReply));
+        replyLen = sizeof(noReply) - 1;
+    }
+    reply[replyLen] = '\n';
+    reply[replyLen + 1] = '\0';
+    WriteParentConsole(reply, replyLen + 1);
+    return strstr(reply, "\"ok\":true") ? 0 : 1;
+}
+
+// � Soak mode ���������������������������������������������������������
+// TeacherToolkit.exe --soak [hours] skips the tray app and projects
+// synthetic content (SoakDrawFrame) for hours, to catch what only leaks
+// slowly on the Windows side: the capture DIB, the cursor and warp paths,
+// the projector window across reconnects (StopMirroring / StartMirroring)
+// and the buffers across resolution changes, both scripted by SoakScript.
+// The projector is the second monitor if there is one, else a window on
+// the primary. A sample every SOAK_SAMPLE_MS goes to soak.csv in
+// %LOCALAPPDATA%\TeacherToolkit, the verdict to soak.txt and the console.
+// Exit code 0 if nothing kept growing, 1 if something did, 2 if the run
+// could not start. tools/SoakRun soaks the portable pipeline on any OS.
+
+#define SOAK_DEFAULT_HOURS  4.0
+#define SOAK_SAMPLE_MS      10000
+#define SOAK_RECONNECT_MS   (10 * 60000)
+#define SOAK_RESIZE_MS      (15 * 60000)
+#define SOAK_STROKE_MS      20000       // a new annotation stroke, all cleared every SOAK_STROKES_KEPT
+#define SOAK_STROKES_KEPT   12
+
+static void SoakFreeSource()
+{
+    if (g_soak.hdc) {
+        if (g_soak.hOldBmp) SelectObject(g_soak.hdc, g_soak.hOldBmp);
+        DeleteDC(g_soak.hdc);
+    }
+    if (g_soak.hBmp) DeleteObject(g_soak.hBmp);
+    g_soak.hdc = nullptr;
+    g_soak.hBmp = nullptr;
+    g_soak.hOldBmp = nullptr;
+    g_soak.bits = nullptr;
+    g_soak.width = g_soak.height = 0;
+}
+
+// The synthetic primary monitor: a DIB of this size at the origin. The
+// next frame reallocates the mirror buffers, as after WM_DISPLAYCHANGE
+static BOOL SoakSetSize(int width, int height)
+{
+    SoakFreeSource();
+
+    BITMAPINFO bmi = {};
+    bmi.bmiHeader.biSize        = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth       = width;
+    bmi.bmiHeader.biHeight      = -height;
+    bmi.bmiHeader.biPlanes      = 1;
+    bmi.bmiHeader.biBitCount    = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    HDC hdcScreen = GetDC(nullptr);
+    void* bits = nullptr;
+    g_soak.hdc  = CreateCompatibleDC(hdcScreen);
+    g_soak.hBmp = CreateDIBSection(hdcScreen, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
+    ReleaseDC(nullptr, hdcScreen);
+    if (!g_soak.hdc || !g_soak.hBmp) {
+        SoakFreeSource();
+        return FALSE;
+    }
+    g_soak.hOldBmp = (HBITMAP)SelectObject(g_soak.hdc, g_soak.hBmp);
+    g_soak.bits = (UINT32*)bits;
+    g_soak.width = width;
+    g_soak.height = height;
+    g_soak.frameNo = 0;
+    SetRect(&g_rcPrimary, 0, 0, width, height);
+    return TRUE;
+}
+
+static void SoakNextFrame()
+{
+    if (!g_soak.bits) return;
+    GdiFlush();
+    SoakDrawFrame((uint32_t*)g_soak.bits, g_soak.width, g_soak.width, g_soak.height, g_soak.frameNo++);
+}
+
+static void SoakStroke(uint32_t n)
+{
+    if (g_annot.width != g_soak.width || g_annot.height != g_soak.height) return;   // not sized yet
+    if (n % SOAK_STROKES_KEPT == 0) AnnotClear(&g_annot);
+    float x = (float)(n % 16) * g_soak.width / 16.0f, y = g_soak.height / 4.0f;
+    AnnotBeginStroke(&g_annot, x, y, g_annotColor ? g_annotColor : ANNOT_COLORS[0],
+                     (float)ScaleForDpi(g_cfg.annotWidthPx, g_dpiPrimary));
+    for (int k = 1; k <= 30; k++)
+        AnnotAddPoint(&g_annot, x + k * 6.0f, y + (k % 7) * 9.0f);
+    AnnotEndStroke(&g_annot);
+}
+
+static void SoakWrite(HANDLE hFile, const char* text, size_t len)
+{
+    DWORD written;
+    if (hFile != INVALID_HANDLE_VALUE) WriteFile(hFile, text, (DWORD)len, &written, nullptr);
+}
+
+static int RunSoak(double hours)
+{
+    LoadConfig();
+
+    RECT rcPrimary, rcSecond;
+    if (!HasSecondMonitor(&rcPrimary, &rcSecond)) {
+        // No projector: half the primary's work area stands in
+        MONITORINFO mi = { sizeof(mi) };
+        GetMonitorInfoW(MonitorFromPoint(POINT{ 0, 0 }, MONITOR_DEFAULTTOPRIMARY), &mi);
+        int w = (mi.rcWork.right - mi.rcWork.left) / 2, h = (mi.rcWork.bottom - mi.rcWork.top) / 2;
+        SetRect(&rcSecond, mi.rcWork.right - w, mi.rcWork.bottom - h, mi.rcWork.right, mi.rcWork.bottom);
+    }
+    g_rcSecond = rcSecond;
+    if (!SoakSetSize(SOAK_SIZES[0].width, SOAK_SIZES[0].height)) return 2;
+
+    WCHAR dir[MAX_PATH], path[MAX_PATH];
+    HANDLE hCsv = INVALID_HANDLE_VALUE, hReport = INVALID_HANDLE_VALUE;
+    if (GetConfigDir(CSIDL_LOCAL_APPDATA, dir, MAX_PATH)) {
+        CreateDirectoryW(dir, nullptr);
+        if (SUCCEEDED(StringCchPrintfW(path, MAX_PATH, L"%s\\soak.csv", dir)))
+            hCsv = CreateFileW(path, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (SUCCEEDED(StringCchPrintfW(path, MAX_PATH, L"%s\\soak.txt", dir)))
+            hReport = CreateFileW(path, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+    char line[256];
+    SoakWrite(hCsv, line, SoakFormatCsvHeader(line, sizeof(line)));
+
+    SoakScript script;
+    SoakScriptInit(&script, SOAK_RECONNECT_MS, SOAK_RESIZE_MS);
+    std::vector<SoakSample> samples;
+    g_soak.active = TRUE;
+    StartMirroring();
+
+    ULONGLONG start = GetTickCount64(), endMs = (ULONGLONG)(hours * 3600000.0);
+    ULONGLONG nextSample = SOAK_SAMPLE_MS, nextStroke = SOAK_STROKE_MS;
+    uint32_t strokes = 0, reconnects = 0, resizes = 0;
+    BOOL quit = FALSE;
+    while (!quit) {
+        MsgWaitForMultipleObjects(0, nullptr, FALSE, 100, QS_ALLINPUT);
+        MSG msg;
+        while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+            if (msg.message == WM_QUIT) quit = TRUE;
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+        ULONGLONG now = GetTickCount64() - start;
+        if (now >= endMs) break;
+
+        switch (SoakScriptStep(&script, now)) {
+        case SOAK_RECONNECT:
+            StopMirroring();
+            StartMirroring();
+            reconnects++;
+            break;
+        case SOAK_RESIZE:
+            SoakSetSize(SOAK_SIZES[script.sizeIndex].width, SOAK_SIZES[script.sizeIndex].height);
+            resizes++;
+            break;
+        case SOAK_NONE:
+            break;
+        }
+        if (now >= nextStroke) {
+            SoakStroke(strokes++);
+            nextStroke += SOAK_STROKE_MS;
+        }
+        if (now >= nextSample) {
+            SoakSample s = {};
+            s.tMs = now;
+            s.width = g_soak.width;
+            s.height = g_soak.height;
+            SoakReadProcess(&s);
+            SoakFrameSummary(&g_soak.times, &s);
+            samples.push_back(s);
+            SoakWrite(hCsv, line, SoakFormatCsvRow(&s, line, sizeof(line)));
+            nextSample += SOAK_SAMPLE_MS;
+        }
+    }
+    StopMirroring();
+    g_soak.active = FALSE;
+    SoakFreeSource();
+    if (hCsv != INVALID_HANDLE_VALUE) CloseHandle(hCsv);
+
+    SoakLimits limits;
+    SoakDefaultLimits(&limits);
+    SoakReport report;
+    BOOL ok = SoakAnalyze(samples.data(), samples.size(), &limits, &report);
+    static char text[1024];
+    StringCchPrintfA(text, ARRAYSIZE(text), "soak %.2f h, %u reconnects, %u resolution changes, %u samples\n",
+                     (double)(GetTickCount64() - start) / 3600000.0, reconnects, resizes, (UINT)samples.size());
+    size_t len = strlen(text);
+    len += SoakFormatReport(&report, text + len, ARRAYSIZE(text) - len);
+    SoakWrite(hReport, text, len);
+    if (hReport != INVALID_HANDLE_VALUE) CloseHandle(hReport);
+    WriteParentConsole(text, (DWORD)len);
+    return ok ? 0 : 1;
+}
+
+// � Update test �������������������������������������������������������
+// "TeacherToolkit.exe --update-test <base url>", test builds only. Runs the
+// background update end to end against tools/UpdateStandIn on loopback,
+// with a scratch folder under %TEMP% standing in for %APPDATA%\TeacherToolkit
+// and this exe as the installed copy. The stand-in cuts every asset
+// transfer that is not a Range request halfway, so each download is
+// interrupted once and can only finish by resuming. Steps:
+//   unsigned   an asset not signed by the test certificate is not staged
+//   tampered   an asset that does not match the published digest is not staged
+//   cut        the first transfer keeps a partial file and stages nothing
+//   resumed    the next one fetches the rest, verifies it and stages it
+//   apply      ApplyStagedUpdate swaps it in and keeps the old copy
+//   refused    a staged file altered after staging is deleted, not applied
+// Prints one line per step; exit code 0 when all passed, 1 when one failed,
+// 2 when the scratch folder could not be set up.
+#ifdef UPDATE_TEST_TRUST
+static BOOL UpdateTestFileExists(const WCHAR* path)
+{
+    return GetFileAttributesW(path) != INVALID_FILE_ATTRIBUTES;
+}
+
+static ULONGLONG UpdateTestFileSize(const WCHAR* path)
+{
+    WIN32_FILE_ATTRIBUTE_DATA fad;
+    if (!GetFileAttributesExW(path, GetFileExInfoStandard, &fad)) return 0;
+    return ((ULONGLONG)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+}
+
+static void UpdateTestStep(char* report, size_t cch, int* failures, BOOL ok, const char* what)
+{
+    StringCchCatA(report, cch, ok ? "ok    " : "FAIL  ");
+    StringCchCatA(report, cch, what);
+    StringCchCatA(report, cch, "\n");
+    if (!ok) (*failures)++;
+}
+
+// Asks base + path for the latest release as if for the first time, and
+// names the partial download that release would use.
+static BOOL UpdateTestCheck(const WCHAR* base, const WCHAR* path, UpdateCache* cache,
+                            WCHAR* partial, DWORD partialCch)
+{
+    ZeroMemory(cache, sizeof(*cache));
+    SaveUpdateCache(cache);
+
+    UpdateSettings settings = {};
+    StringCchPrintfW(settings.url, ARRAYSIZE(settings.url), L"%s%s", base, path);
+    WCHAR latest[64];
+    BOOL newer = CheckForUpdate(&settings, latest, ARRAYSIZE(latest));
+    LoadUpdateCache(cache);
+
+    StringCchPrintfW(partial, partialCch, L"%s\\TeacherToolkit-%s.partial", g_szUpdateTestDir, cache->latestVer);
+    DeleteFileW(partial);
+    return newer && cache->assetUrl[0] != L'\0';
+}
+
+static int RunUpdateTest(const WCHAR* base)
+{
+    WCHAR self[MAX_PATH], installed[MAX_PATH], staged[MAX_PATH], old[MAX_PATH], partial[MAX_PATH];
+    if (base[0] == L'\0' ||
+        !GetTempPathW(MAX_PATH, g_szUpdateTestDir) ||
+        FAILED(StringCchCatW(g_szUpdateTestDir, MAX_PATH, L"TeacherToolkit-update-test")))
+        return 2;
+    CreateDirectoryW(g_szUpdateTestDir, nullptr);
+    if (!GetModuleFileNameW(nullptr, self, MAX_PATH) || !GetAppDataExePath(installed, MAX_PATH) ||
+        !GetUpdateSidePath(staged, MAX_PATH, L".new") || !GetUpdateSidePath(old, MAX_PATH, L".old") ||
+        !CopyFileW(self, installed, FALSE))
+        return 2;
+    DeleteFileW(staged);
+    DeleteFileW(old);
+    ClearStagedUpdate();
+
+    static char report[2048];
+    report[0] = '\0';
+    int failures = 0;
+    UpdateCache cache;
+    BOOL found, first, second;
+
+    found  = UpdateTestCheck(base, L"/unsigned/release.json", &cache, partial, MAX_PATH);
+    first  = DownloadAndStageUpdate(&cache, 0);
+    second = DownloadAndStageUpdate(&cache, 0);
+    UpdateTestStep(report, ARRAYSIZE(report), &failures,
+                   found && !first && !second && !UpdateTestFileExists(partial) && !UpdateTestFileExists(staged),
+                   "unsigned: the asset is downloaded, then rejected and deleted");
+
+    found  = UpdateTestCheck(base, L"/tampered/release.json", &cache, partial, MAX_PATH);
+    first  = DownloadAndStageUpdate(&cache, 0);
+    second = DownloadAndStageUpdate(&cache, 0);
+    UpdateTestStep(report, ARRAYSIZE(report), &failures,
+                   found && !first && !second && !UpdateTestFileExists(partial) && !UpdateTestFileExists(staged),
+                   "tampered: a digest mismatch is rejected and deleted");
+
+    found = UpdateTestCheck(base, L"/release.json", &cache, partial, MAX_PATH);
+    first = DownloadAndStageUpdate(&cache, 0);
+    ULONGLONG have = UpdateTestFileSize(partial);
+    UpdateTestStep(report, ARRAYSIZE(report), &failures,
+                   found && !first && have > 0 && have < cache.assetSize && !UpdateTestFileExists(staged),
+                   "cut: the partial download is kept and nothing is staged");
+
+    second = DownloadAndStageUpdate(&cache, 0);
+    WCHAR stagedVer[64], stagedDigest[RELEASE_MAX_DIGEST];
+    UpdateTestStep(report, ARRAYSIZE(report), &failures,
+                   second && !UpdateTestFileExists(partial) && FileMatchesDigest(staged, cache.assetDigest) &&
+                   LoadStagedUpdate(stagedVer, ARRAYSIZE(stagedVer), stagedDigest, ARRAYSIZE(stagedDigest)) &&
+                   wcscmp(stagedVer, cache.latestVer) == 0,
+                   "resumed: the rest arrives by Range and the verified exe is staged");
+
+    BOOL relaunch = ApplyStagedUpdate();
+    UpdateTestStep(report, ARRAYSIZE(report), &failures,
+                   !relaunch && FileMatchesDigest(installed, cache.assetDigest) && UpdateTestFileExists(old) &&
+                   !UpdateTestFileExists(staged) &&
+                   !LoadStagedUpdate(stagedVer, ARRAYSIZE(stagedVer), stagedDigest, ARRAYSIZE(stagedDigest)),
+                   "apply: the staged exe replaces the installed copy, kept as .old");
+
+    // Stage the good file again, then flip a byte behind the updater's back
+    BOOL tampered = CopyFileW(installed, staged, FALSE);
+    HANDLE hFile = tampered ? CreateFileW(staged, GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)
+                            : INVALID_HANDLE_VALUE;
+    if (hFile != INVALID_HANDLE_VALUE) {
+        BYTE b = 0;
+        DWORD n = 0;
+        LARGE_INTEGER mid;
+        mid.QuadPart = (LONGLONG)(cache.assetSize / 2);
+        tampered = SetFilePointerEx(hFile, mid, nullptr, FILE_BEGIN) && ReadFile(hFile, &b, 1, &n, nullptr) && n == 1;
+        b ^= 0xFF;
+        tampered = tampered && SetFilePointerEx(hFile, mid, nullptr, FILE_BEGIN) && WriteFile(hFile, &b, 1, &n, nullptr);
+        CloseHandle(hFile);
+    }
+    SaveStagedUpdate(cache.latestVer, cache.assetDigest);
+    relaunch = ApplyStagedUpdate();
+    UpdateTestStep(report, ARRAYSIZE(report), &failures,
+                   tampered && !relaunch && !UpdateTestFileExists(staged) &&
+                   FileMatchesDigest(installed, cache.assetDigest),
+                   "refused: an altered staged file is deleted and not applied");
+
+    StringCchCatA(report, ARRAYSIZE(report), failures ? "FAILED\n" : "all steps passed\n");
+    WriteParentConsole(report, (DWORD)strlen(report));
+    return failures ? 1 : 0;
+}
+#endif
+
+// � Entry point �������������������������������������������������������
+int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
+                      _In_opt_ HINSTANCE hPrevInstance,
+                      _In_ LPWSTR    lpCmdLine,
+                      _In_ int       nCmdShow)
+{
+    UNREFERENCED_PARAMETER(hPrevInstance);
+    UNREFERENCED_PARAMETER(nCmdShow);
+
+    StartupTimelineBegin();
+    TraceInit();
+    TraceThreadName("ui");
+
+    EnableDpiAwareness();
+
+    // Single-instance check
+    g_hMutex = CreateMutexW(nullptr, TRUE, MUTEX_NAME);
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        // "TeacherToolkit.exe pause" etc. is handed to the running instance
+        if (lpCmdLine && lpCmdLine[0] != L'\0' && wcsncmp(lpCmdLine, L"--soak", 6) != 0 &&
+            wcsncmp(lpCmdLine, L"--update-test", 13) != 0) {
+            if (g_hMutex) CloseHandle(g_hMutex);
+            return ForwardCommandLine(lpCmdLine);
+        }
+        MessageBoxW(nullptr,
+            L"O TeacherToolkit j� est� em execu��o.\n"
+            L"Feche a inst�ncia anterior primeiro.",
+            L"TeacherToolkit", MB_OK | MB_ICONWARNING);
+        if (g_hMutex) CloseHandle(g_hMutex);
+        return 0;
+    }
+
+    // "TeacherToolkit.exe --soak [hours]" runs the soak test instead
+    if (lpCmdLine && wcsncmp(lpCmdLine, L"--soak", 6) == 0) {
+        hInst = hInstance;
+        RegisterMirrorClass(hInstance);
+        double hours = _wtof(lpCmdLine + 6);
+        int code = RunSoak(hours > 0 ? hours : SOAK_DEFAULT_HOURS);
+        StopTraceWriter();
+        if (g_hMutex) { ReleaseMutex(g_hMutex); CloseHandle(g_hMutex); }
+        return code;
+    }
+
+#ifdef UPDATE_TEST_TRUST
+    // "TeacherToolkit.exe --update-test http://127.0.0.1:<port>"
+    if (lpCmdLine && wcsncmp(lpCmdLine, L"--update-test", 13) == 0) {
+        const WCHAR* base = lpCmdLine + 13;
+        while (*base == L' ') base++;
+        int code = RunUpdateTest(base);
+        if (g_hMutex) { ReleaseMutex(g_hMutex); CloseHandle(g_hMutex); }
+        return code;
+    }
+#endif
+
+    // A background-downloaded update is swapped in before anything else;
+    // if this process is the copy that was replaced, relaunch into it.
+    if (ApplyStagedUpdate()) {
+        WCHAR appDataExe[MAX_PATH];
+        if (GetAppDataExePath(appDataExe, MAX_PATH)) {
+            ReleaseMutex(g_hMutex);
+            CloseHandle(g_hMutex);
+            g_hMutex = nullptr;
+
+            STARTUPINFOW si = {};
+            si.cb = sizeof(si);
+            PROCESS_INFORMATION pi = {};
+            if (CreateProcessW(appDataExe, nullptr, nullptr, nullptr, FALSE, 0,
+                               nullptr, nullptr, &si, &pi)) {
+                CloseHandle(pi.hThread);
+                CloseHandle(pi.hProcess);
+                return 0;
+            }
+            // Could not start the new build: carry on as this one
+            g_hMutex = CreateMutexW(nullptr, TRUE, MUTEX_NAME);
+        }
+    }
+
+    LoadStringW(hInstance, IDS_APP_TITLE, szTitle, MAX_LOADSTRING);
+    LoadStringW(hInstance, IDC_TEACHERTOOLKIT, szWindowClass, MAX_LOADSTRING);
+
+    RegisterHiddenClass(hInstance);
+    RegisterMirrorClass(hInstance);
+    RegisterAnnotateClass(hInstance);
+
+    // Tray icon and mirroring come up first; config, the startup-copy
+    // self-check and the update check run from WM_DEFERREDINIT.
+    if (!InitInstance(hInstance, nCmdShow)) {
+        if (g_hMutex) { ReleaseMutex(g_hMutex); CloseHandle(g_hMutex); }
+        return FALSE;
+    }
+
+    MSG msg;
+    while (GetMessage(&msg, nullptr, 0, 0)) {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+
+    ClipCursor(nullptr);
+    UnregisterDeviceNotifications();
+    RemoveTrayIcon();
+    StopTraceWriter();
+    if (g_hMutex) { ReleaseMutex(g_hMutex); CloseHandle(g_hMutex); }
+    return (int)msg.wParam;
+}
+
+// � Window class registration �����������������������������������������
+ATOM RegisterHiddenClass(HINSTANCE hInstance)
+{
+    WNDCLASSEXW wcex = {};
+    wcex.cbSize        = sizeof(wcex);
+    wcex.lpfnWndProc   = HiddenWndProc;
+    wcex.hInstance      = hInstance;
+    wcex.lpszClassName  = szWindowClass;
+    wcex.hIcon          = LoadIcon(hInstance, MAKEINTRESOURCE(IDI_TEACHERTOOLKIT));
+    wcex.hIconSm        = LoadIcon(hInstance, MAKEINTRESOURCE(IDI_SMALL));
+    return RegisterClassExW(&wcex);
+}
+
+ATOM RegisterMirrorClass(HINSTANCE hInstance)
+{
+    WNDCLASSEXW wcex = {};
+    wcex.cbSize        = sizeof(wcex);
+    wcex.style         = CS_HREDRAW | CS_VREDRAW;
+    wcex.lpfnWndProc   = MirrorWndProc;
+    wcex.hInstance      = hInstance;
+    wcex.hCursor       = LoadCursor(nullptr, IDC_ARROW);
+    wcex.hbrBackground = (HBRUSH)GetStockObject(BLACK_BRUSH);
+    wcex.lpszClassName = MIRROR_CLASS;
+    return RegisterClassExW(&wcex);
+}
+
+ATOM RegisterAnnotateClass(HINSTANCE hInstance)
+{
+    WNDCLASSEXW wcex = {};
+    wcex.cbSize        = sizeof(wcex);
+    wcex.lpfnWndProc   = AnnotateWndProc;
+    wcex.hInstance      = hInstance;
+    wcex.hCursor       = LoadCursor(nullptr, IDC_CROSS);
+    wcex.lpszClassName = ANNOTATE_CLASS;
+    return RegisterClassExW(&wcex);
+}
+
+// � InitInstance � create hidden window + tray icon �������������������
+BOOL InitInstance(HINSTANCE hInstance, int)
 {
     hInst = hInstance;
 
-    g_hHidden = CreateWindowW(szWindowClass, szTitle, WS_OVERLAPPEDWINDOW,
-        CW_USEDEFAULT, 0, CW_USEDEFAULT, 0, nullptr, nullptr, hInstance, nullptr);
-    if (!g_hHidden) return FALSE;
+    g_hHidden = CreateWindowW(szWindowClass, szTitle, WS_OVERLAPPEDWINDOW,
+        CW_USEDEFAULT, 0, CW_USEDEFAULT, 0, nullptr, nullptr, hInstance, nullptr);
+    if (!g_hHidden) return FALSE;
+
+    AddTrayIcon(g_hHidden);
+
+    // Critical path: an already-extended projector gets its first frame
+    // before anything else runs.
+    if (HasSecondMonitor(&g_rcPrimary, &g_rcSecond)) {
+        StartMirroring();
+    }
+
+    RegisterForDeviceNotifications(g_hHidden);
+    SetTimer(g_hHidden, IDT_MONITOR_POLL, g_cfg.monitorPollMs, nullptr);
+
+    PostMessage(g_hHidden, WM_DEFERREDINIT, 0, 0);
+    return TRUE;
+}
+
+// � Deferred startup work ���������������������������������������������
+struct UpdateCheckResult {
+    BOOL  available;
+    BOOL  staged;           // verified download waiting for the next launch
+    WCHAR latestVer[64];
+};
+
+// Background worker for the slow, non-interactive part of startup: file
+// I/O for the startup-copy self-check and the network update check. Owns
+// the UpdateSettings it is given (nullptr = skip the check). The result is
+// handed to the UI thread through WM_UPDATECHECKED.
+static DWORD WINAPI StartupWorkerProc(LPVOID param)
+{
+    auto* settings = (UpdateSettings*)param;
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+    TraceThreadName("startup");
+
+    UpdateStartupExeIfNeeded();
+
+    auto* result = (UpdateCheckResult*)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                                 sizeof(UpdateCheckResult));
+    if (result && settings) {
+        uint64_t traceStart = TraceNow();
+        result->available = CheckForUpdate(settings, result->latestVer, ARRAYSIZE(result->latestVer));
+        TraceSpan(TRACE_UPDATE_CHECK, traceStart, result->available);
+        if (result->available && settings->autoUpdate && !IsVersionSkipped(result->latestVer)) {
+            UpdateCache cache;
+            LoadUpdateCache(&cache);
+            result->staged = DownloadAndStageUpdate(&cache, settings->downloadKBps);
+        }
+        if (!PostMessage(g_hHidden, WM_UPDATECHECKED, 0, (LPARAM)result))
+            HeapFree(GetProcessHeap(), 0, result);
+    }
+    else if (result) {
+        HeapFree(GetProcessHeap(), 0, result);
+    }
+    if (settings) HeapFree(GetProcessHeap(), 0, settings);
+
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+    return 0;
+}
+
+// Runs once the message loop is up and the first frame (if any) is out.
+static void RunDeferredStartup()
+{
+    LoadConfig();
+    StartConfigWatcher();
+    StartIpcServer();
+
+    // Taken by another app: the tray item still works
+    RegisterHotKey(g_hHidden, HOTKEY_ANNOTATE, MOD_CONTROL | MOD_ALT | MOD_NOREPEAT, 'A');
+    RegisterHotKey(g_hHidden, HOTKEY_REPLAY_BACK, MOD_CONTROL | MOD_ALT, VK_PRIOR);    // held: scrub
+    RegisterHotKey(g_hHidden, HOTKEY_REPLAY_FWD, MOD_CONTROL | MOD_ALT, VK_NEXT);
+    RegisterHotKey(g_hHidden, HOTKEY_REPLAY_LIVE, MOD_CONTROL | MOD_ALT | MOD_NOREPEAT, VK_END);
+
+    // No extended projector yet: see whether one is attached but inactive
+    if (!g_bProjecting && !g_bExtendPending && CountPhysicalDisplays() >= 2) {
+        TryExtendAndMirror();
+    }
+
+    auto* settings = (UpdateSettings*)HeapAlloc(GetProcessHeap(), 0, sizeof(UpdateSettings));
+    if (settings) GetUpdateSettings(settings);
+    HANDLE hThread = CreateThread(nullptr, 0, StartupWorkerProc, settings, 0, nullptr);
+    if (hThread) CloseHandle(hThread);
+    else if (settings) HeapFree(GetProcessHeap(), 0, settings);
+    ScheduleIdleTrim();
+}
+
+static void OnUpdateChecked(HWND hWnd, UpdateCheckResult* result)
+{
+    StringCchCopyW(g_szLatestVer, ARRAYSIZE(g_szLatestVer), result->latestVer);
+    g_bUpdateAvailable = result->available;
+    g_bUpdateStaged = result->staged;
+    HeapFree(GetProcessHeap(), 0, result);
+    PublishIpcState();
+    ScheduleIdleTrim();         // the check's buffers are gone now
+
+    // A staged update installs itself on the next launch; no need to ask
+    if (g_bUpdateAvailable && !g_bUpdateStaged) {
+        PromptUpdate(hWnd);
+    }
+}
+
+// � Hidden window proc (tray + monitor polling) �����������������������
+LRESULT CALLBACK HiddenWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    switch (message)
+    {
+    case WM_TIMER:
+        if (wParam == IDT_MONITOR_POLL) {
+            // No notification exists for the screensaver; while it runs a
+            // slower timer only watches for it to end
+            BOOL saver = FALSE;
+            if (SystemParametersInfoW(SPI_GETSCREENSAVERRUNNING, 0, &saver, 0) && saver) {
+                SetSuspendFlag(SUSPEND_SCREENSAVER, TRUE);
+                SetTimer(hWnd, IDT_SCREENSAVER, SCREENSAVER_POLL_MS, nullptr);
+            } else {
+                CheckMonitorState();
+            }
+        }
+        else if (wParam == IDT_SCREENSAVER) {
+            BOOL saver = FALSE;
+            if (!SystemParametersInfoW(SPI_GETSCREENSAVERRUNNING, 0, &saver, 0) || !saver) {
+                KillTimer(hWnd, IDT_SCREENSAVER);
+                SetSuspendFlag(SUSPEND_SCREENSAVER, FALSE);
+            }
+        }
+        else if (wParam == IDT_IDLE_TRIM) {
+            KillTimer(hWnd, IDT_IDLE_TRIM);
+            ReleaseIdleResources();
+        }
+        else if (wParam == IDT_DISPLAY_SETTLE) {
+            KillTimer(hWnd, IDT_DISPLAY_SETTLE);
+            CheckMonitorState();
+        }
+        else if (wParam == IDT_EXTEND_RETRY) {
+            g_nExtendRetries++;
+            if (HasSecondMonitor(&g_rcPrimary, &g_rcSecond)) {
+                KillTimer(g_hHidden, IDT_EXTEND_RETRY);
+                g_bExtendPending = FALSE;
+                TraceEvent(TRACE_EXTEND_RESULT, 1, g_nExtendRetries);
+                StartMirroring();
+            } else if (g_nExtendRetries >= 10) {
+                KillTimer(g_hHidden, IDT_EXTEND_RETRY);
+                g_bExtendPending = FALSE;
+                TraceEvent(TRACE_EXTEND_RESULT, 0, g_nExtendRetries);
+            }
+        }
+        break;
+
+    case WM_CHECKMONITOR:
+        CheckMonitorState();
+        break;
+
+    case WM_DEFERREDINIT:
+        RunDeferredStartup();
+        break;
+
+    case WM_UPDATECHECKED:
+        OnUpdateChecked(hWnd, (UpdateCheckResult*)lParam);
+        break;
+
+    case WM_CONFIGCHANGED:
+        TraceEvent(TRACE_CONFIG_RELOAD);
+        LoadConfig();
+        break;
+
+    case WM_DISPLAYCHANGE:
+        TraceEvent(TRACE_DISPLAY_CHANGE, LOWORD(lParam), HIWORD(lParam));
+        // WM_DISPLAYCHANGE fires before the display list is fully updated.
+        // Post an immediate check, then arm a settle timer to catch the case
+        // where EnumDisplayMonitors hasn't refreshed yet on the first check.
+        PostMessage(hWnd, WM_CHECKMONITOR, 0, 0);
+        SetTimer(hWnd, IDT_DISPLAY_SETTLE, 500, nullptr);
+        break;
+
+    case WM_DEVICECHANGE:
+        if (wParam == DBT_DEVNODES_CHANGED ||
+            wParam == DBT_DEVICEARRIVAL ||
+            wParam == DBT_DEVICEREMOVECOMPLETE) {
+            PostMessage(hWnd, WM_CHECKMONITOR, 0, 0);
+        }
+        break;
+
+    case WM_WTSSESSION_CHANGE:
+        if (wParam == WTS_SESSION_LOCK || wParam == WTS_SESSION_UNLOCK)
+            SetSuspendFlag(SUSPEND_LOCKED, wParam == WTS_SESSION_LOCK);
+        else if (wParam == WTS_CONSOLE_DISCONNECT || wParam == WTS_CONSOLE_CONNECT)
+            SetSuspendFlag(SUSPEND_DISCONNECTED, wParam == WTS_CONSOLE_DISCONNECT);
+        break;
+
+    case WM_POWERBROADCAST:
+        if (wParam == PBT_POWERSETTINGCHANGE)
+            OnPowerSettingChange((const POWERBROADCAST_SETTING*)lParam);
+        else if (wParam == PBT_APMSUSPEND)
+            SetSuspendFlag(SUSPEND_SLEEP, TRUE);
+        else if (wParam == PBT_APMRESUMEAUTOMATIC || wParam == PBT_APMRESUMESUSPEND)
+            SetSuspendFlag(SUSPEND_SLEEP, FALSE);
+        return TRUE;
+
+    case WM_HOTKEY:
+        if (wParam == HOTKEY_ANNOTATE) {
+            if (g_hAnnotInput) EndAnnotating();
+            else               BeginAnnotating();
+        }
+        else if (wParam == HOTKEY_REPLAY_BACK) StepReplay(-1);
+        else if (wParam == HOTKEY_REPLAY_FWD)  StepReplay(1);
+        else if (wParam == HOTKEY_REPLAY_LIVE) LeaveReplay(TRUE);
+        break;
+
+    case WM_TRAYICON:
+        switch (LOWORD(lParam))
+        {
+        case WM_LBUTTONUP:
+        case WM_RBUTTONUP:
+        case WM_CONTEXTMENU:
+            ShowTrayMenu(hWnd);
+            break;
+        }
+        break;
+
+    case WM_COMMAND:
+        if (LOWORD(wParam) == IDM_TRAY_EXIT || LOWORD(wParam) == IDM_EXIT) {
+            StopMirroring();
+            UnregisterDeviceNotifications();
+            RemoveTrayIcon();
+            PostQuitMessage(0);
+        }
+        else if (LOWORD(wParam) == IDM_TRAY_STARTUP) {
+            if (IsStartupEnabled()) {
+                DisableStartup();
+            } else {
+                EnableStartup();
+            }
+        }
+        else if (LOWORD(wParam) == IDM_TRAY_ABOUT) {
+            ShowAboutDialog(hWnd);
+        }
+        else if (LOWORD(wParam) == IDM_TRAY_UPDATE) {
+            PromptUpdate(hWnd);
+        }
+        else if (LOWORD(wParam) == IDM_TRAY_DIAG) {
+            ShowDiagnosticsDialog(hWnd);
+        }
+        else if (LOWORD(wParam) == IDM_TRAY_ANNOTATE) {
+            if (g_hAnnotInput) EndAnnotating();
+            else               BeginAnnotating();
+        }
+        else if (LOWORD(wParam) == IDM_TRAY_SLIDES) {
+            if (g_slides.on) StopSlideCapture(TRUE);
+            else             StartSlideCapture();
+        }
+        else if (LOWORD(wParam) == IDM_TRAY_PAUSE) {
+            PauseMirroring();
+        }
+        else if (LOWORD(wParam) == IDM_TRAY_RESUME) {
+            ResumeMirroring();
+        }
+        else if (LOWORD(wParam) == IDM_REEXTEND) {
+            if (!g_bPaused && !g_bProjecting) {
+                KillTimer(hWnd, IDT_EXTEND_RETRY);
+                g_bExtendPending = FALSE;
+                TryExtendAndMirror();
+                PublishIpcState();
+            }
+        }
+        break;
+
+    case WM_DESTROY:
+        StopMirroring();
+        StopSlideCapture(FALSE);
+        UnregisterDeviceNotifications();
+        RemoveTrayIcon();
+        PostQuitMessage(0);
+        break;
+
+    default:
+        return DefWindowProc(hWnd, message, wParam, lParam);
+    }
+    return 0;
+}
+
+// � Compute letterbox/pillarbox destination rect ����������������������
+// Returns a centered rect within (0,0,dstW,dstH) that fits srcW�srcH
+// without distortion.
+static RECT ComputeLetterboxRect(int srcW, int srcH, int dstW, int dstH)
+{
+    RECT r = {};
+    if (srcW <= 0 || srcH <= 0 || dstW <= 0 || dstH <= 0) return r;
+
+    // Scale uniformly to fit the destination
+    int scaledW, scaledH;
+    if (dstW * srcH <= dstH * srcW) {
+        // Width is the limiting dimension
+        scaledW = dstW;
+        scaledH = (dstW * srcH) / srcW;
+    } else {
+        // Height is the limiting dimension
+        scaledH = dstH;
+        scaledW = (dstH * srcW) / srcH;
+    }
+
+    r.left   = (dstW - scaledW) / 2;
+    r.top    = (dstH - scaledH) / 2;
+    r.right  = r.left + scaledW;
+    r.bottom = r.top  + scaledH;
+    return r;
+}
+
+// Black bars around the letterbox rect
+static void FillLetterboxBars(HDC hdc, int dstW, int dstH, const RECT& dst)
+{
+    HBRUSH hBlack = (HBRUSH)GetStockObject(BLACK_BRUSH);
+    if (dst.top > 0) {
+        RECT bar = { 0, 0, dstW, dst.top };
+        FillRect(hdc, &bar, hBlack);
+    }
+    if (dst.bottom < dstH) {
+        RECT bar = { 0, dst.bottom, dstW, dstH };
+        FillRect(hdc, &bar, hBlack);
+    }
+    if (dst.left > 0) {
+        RECT bar = { 0, dst.top, dst.left, dst.bottom };
+        FillRect(hdc, &bar, hBlack);
+    }
+    if (dst.right < dstW) {
+        RECT bar = { dst.right, dst.top, dstW, dst.bottom };
+        FillRect(hdc, &bar, hBlack);
+    }
+}
+
+// � Cursor fast path ��������������������������������������������������
+// Between full frames, mouse moves (raw input, delivered even though the
+// mirror window never has focus) repaint only the rectangle the cursor
+// left and the one it moved to: the clean frame still in g_hdcMem is
+// rescaled for just those pixels and the cursor drawn over it, in a small
+// scratch bitmap so the projector never shows the gap. With keystone
+// correction on the cursor stays baked into the frame, as it has to go
+// through the warp.
+
+int GetMonitorRefreshHz(const RECT* rc)
+{
+    MONITORINFOEXW mi = {};
+    mi.cbSize = sizeof(mi);
+    DEVMODEW dm = {};
+    dm.dmSize = sizeof(dm);
+    if (GetMonitorInfoW(MonitorFromRect(rc, MONITOR_DEFAULTTONEAREST), &mi) &&
+        EnumDisplaySettingsW(mi.szDevice, ENUM_CURRENT_SETTINGS, &dm) &&
+        dm.dmDisplayFrequency > 1 && dm.dmDisplayFrequency <= 500)
+        return (int)dm.dmDisplayFrequency;
+    return 60;      // 0 and 1 mean "hardware default"
+}
+
+// Window rect of the current cursor, scaled like the frame. Empty if the
+// cursor is hidden.
+static void GetScaledCursor(HCURSOR* phCursor, RECT* rc)
+{
+    SetRectEmpty(rc);
+    *phCursor = nullptr;
+
+    CURSORINFO ci = {};
+    ci.cbSize = sizeof(ci);
+    if (!GetCursorInfo(&ci) || !(ci.flags & CURSOR_SHOWING) || !ci.hCursor) return;
+
+    if (ci.hCursor != g_cursor.shape) {
+        ICONINFO ii = {};
+        if (!GetIconInfo(ci.hCursor, &ii)) return;
+        BITMAP bm = {};
+        GetObject(ii.hbmColor ? ii.hbmColor : ii.hbmMask, sizeof(bm), &bm);
+        g_cursor.shape  = ci.hCursor;
+        g_cursor.shapeW = bm.bmWidth;
+        g_cursor.shapeH = ii.hbmColor ? bm.bmHeight : bm.bmHeight / 2;     // AND + XOR masks
+        g_cursor.hotX   = (int)ii.xHotspot;
+        g_cursor.hotY   = (int)ii.yHotspot;
+        if (ii.hbmMask)  DeleteObject(ii.hbmMask);
+        if (ii.hbmColor) DeleteObject(ii.hbmColor);
+    }
+
+    int boxW = g_cursor.box.right - g_cursor.box.left;
+    int boxH = g_cursor.box.bottom - g_cursor.box.top;
+    int x = ci.ptScreenPos.x - g_rcPrimary.left - g_cursor.hotX;
+    int y = ci.ptScreenPos.y - g_rcPrimary.top  - g_cursor.hotY;
+    rc->left   = g_cursor.box.left + MulDiv(x, boxW, g_cursor.srcW);
+    rc->top    = g_cursor.box.top  + MulDiv(y, boxH, g_cursor.srcH);
+    rc->right  = rc->left + max(1, MulDiv(g_cursor.shapeW, boxW, g_cursor.srcW));
+    rc->bottom = rc->top  + max(1, MulDiv(g_cursor.shapeH, boxH, g_cursor.srcH));
+    *phCursor = ci.hCursor;
+}
+
+// Repaints window rect r from the clean frame, with the cursor at
+// cursorRc on top.
+static void PaintCursorRect(HDC hdcWnd, const RECT& r, HCURSOR hCursor, const RECT& cursorRc)
+{
+    int w = r.right - r.left, h = r.bottom - r.top;
+    if (w <= 0 || h <= 0) return;
+
+    if (!g_cursor.hdc || g_cursor.bufW < w || g_cursor.bufH < h) {
+        FreeCursorResources();
+        g_cursor.bufW = max(w, 128);
+        g_cursor.bufH = max(h, 128);
+        g_cursor.hdc  = CreateCompatibleDC(hdcWnd);
+        g_cursor.hBmp = CreateCompatibleBitmap(hdcWnd, g_cursor.bufW, g_cursor.bufH);
+        if (!g_cursor.hdc || !g_cursor.hBmp) {
+            FreeCursorResources();
+            return;
+        }
+        g_cursor.hOldBmp = (HBITMAP)SelectObject(g_cursor.hdc, g_cursor.hBmp);
+    }
+    // Same filter the frame underneath was most likely painted with
+    SetStretchBltMode(g_cursor.hdc, g_cfg.regionClassify ? HALFTONE : COLORONCOLOR);
+    SetBrushOrgEx(g_cursor.hdc, 0, 0, nullptr);
+
+    RECT fill = { 0, 0, w, h };
+    FillRect(g_cursor.hdc, &fill, (HBRUSH)GetStockObject(BLACK_BRUSH));
+
+    // Source pixels covering the part of r inside the letterbox, and where
+    // the full-frame stretch put them
+    RECT in;
+    const RECT& box = g_cursor.box;
+    int boxW = box.right - box.left, boxH = box.bottom - box.top;
+    if (IntersectRect(&in, &r, &box)) {
+        int sx0 = MulDiv(in.left - box.left, g_cursor.srcW, boxW);
+        int sy0 = MulDiv(in.top  - box.top,  g_cursor.srcH, boxH);
+        int sx1 = min(g_cursor.srcW, MulDiv(in.right  - box.left, g_cursor.srcW, boxW) + 1);
+        int sy1 = min(g_cursor.srcH, MulDiv(in.bottom - box.top,  g_cursor.srcH, boxH) + 1);
+        int dx0 = box.left + MulDiv(sx0, boxW, g_cursor.srcW);
+        int dy0 = box.top  + MulDiv(sy0, boxH, g_cursor.srcH);
+        int dx1 = box.left + MulDiv(sx1, boxW, g_cursor.srcW);
+        int dy1 = box.top  + MulDiv(sy1, boxH, g_cursor.srcH);
+        StretchBlt(g_cursor.hdc, dx0 - r.left, dy0 - r.top, dx1 - dx0, dy1 - dy0,
+                   g_hdcMem, sx0, sy0, sx1 - sx0, sy1 - sy0, SRCCOPY);
+    }
+
+    RECT overlap;
+    if (hCursor && IntersectRect(&overlap, &r, &cursorRc)) {
+        DrawIconEx(g_cursor.hdc, cursorRc.left - r.left, cursorRc.top - r.top, hCursor,
+                   cursorRc.right - cursorRc.left, cursorRc.bottom - cursorRc.top, 0, nullptr, DI_NORMAL);
+    }
+    BitBlt(hdcWnd, r.left, r.top, w, h, g_cursor.hdc, 0, 0, SRCCOPY);
+}
+
+// force: the frame was just repainted without a cursor; draw it now,
+// ignoring the rate limit. hdcWnd may be null.
+void UpdateMirrorCursor(HDC hdcWnd, BOOL force)
+{
+    if (!g_cursor.active || !g_hMirror || !g_hdcMem || g_suspendFlags) return;
+
+    HCURSOR hCursor;
+    RECT rc;
+    GetScaledCursor(&hCursor, &rc);
+    if (!force && hCursor == g_cursor.hCursor && EqualRect(&rc, &g_cursor.drawn)) return;
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    if (!force && now.QuadPart - g_cursor.lastTicks < g_cursor.minTicks) {
+        // Too soon for the projector to show it anyway; catch up once the
+        // refresh period is over (a live timer ID is just re-armed)
+        SetTimer(g_hMirror, IDT_CURSOR_REFRESH, USER_TIMER_MINIMUM, nullptr);
+        return;
+    }
+    g_cursor.lastTicks = now.QuadPart;
+
+    HDC hdc = hdcWnd ? hdcWnd : GetDC(g_hMirror);
+    if (!hdc) return;
+
+    // Overlapping rectangles are painted as one, so no intermediate state
+    // ever reaches the window
+    RECT both;
+    if (!IsRectEmpty(&g_cursor.drawn) && !IsRectEmpty(&rc) && IntersectRect(&both, &g_cursor.drawn, &rc)) {
+        UnionRect(&both, &g_cursor.drawn, &rc);
+        PaintCursorRect(hdc, both, hCursor, rc);
+    } else {
+        if (!IsRectEmpty(&g_cursor.drawn)) PaintCursorRect(hdc, g_cursor.drawn, hCursor, rc);
+        if (!IsRectEmpty(&rc))             PaintCursorRect(hdc, rc, hCursor, rc);
+    }
+    g_cursor.drawn = rc;
+    g_cursor.hCursor = hCursor;
+
+    if (!hdcWnd) ReleaseDC(g_hMirror, hdc);
+    GdiFlush();
+    LatencyCursorDrawn(&g_latency, NowMicros());
+}
+
+void FreeCursorResources()
+{
+    if (g_cursor.hdc) {
+        if (g_cursor.hOldBmp) SelectObject(g_cursor.hdc, g_cursor.hOldBmp);
+        DeleteDC(g_cursor.hdc);
+    }
+    if (g_cursor.hBmp) DeleteObject(g_cursor.hBmp);
+    g_cursor.hdc = nullptr;
+    g_cursor.hBmp = nullptr;
+    g_cursor.hOldBmp = nullptr;
+    g_cursor.bufW = g_cursor.bufH = 0;
+}
+
+// � Per-region repaint ������������������������������������������������
+// With region_classify on, the letterboxed frame is not restretched as a
+// whole: only tiles whose content changed (RegionClassify.h) are, in runs
+// of neighbours that share a filter. Static and occasionally changing
+// tiles (slides, documents, typing) get HALFTONE, which keeps small text
+// legible but is slow; video tiles get the cheap COLORONCOLOR. A static
+// slide therefore costs a hash pass per frame and nothing else. The
+// application profile can pin the filter either way, or turn the tiles
+// off for content that changes everywhere anyway.
+
+static BOOL TileRepaintOn()
+{
+    return g_cfg.regionClassify && g_profile.active.capture != PROFILE_CAPTURE_FULL;
+}
+
+static void PaintChangedRegions(HDC hdcWnd, int srcW, int srcH, const RECT& box)
+{
+    if (g_regions.width != srcW || g_regions.height != srcH || !EqualRect(&g_regionBox, &box)) {
+        RegionInit(&g_regions, srcW, srcH);
+        g_regionBox = box;
+    }
+    GdiFlush();
+    int changed = g_passHashed
+        ? RegionUpdateHashed(&g_regions, (const uint32_t*)g_pMemBits, srcW, g_passHashes.data())
+        : RegionUpdate(&g_regions, (const uint32_t*)g_pMemBits, srcW);
+    if (changed == 0)
+        return;
+
+    int boxW = box.right - box.left, boxH = box.bottom - box.top;
+    int mode = 0;
+    for (int ty = 0; ty < g_regions.tilesY; ty++) {
+        int sy0 = ty * REGION_TILE;
+        int sy1 = min(sy0 + REGION_TILE, srcH);
+        int dy0 = box.top + MulDiv(sy0, boxH, srcH);
+        int dy1 = box.top + MulDiv(sy1, boxH, srcH);
+
+        for (int tx = 0; tx < g_regions.tilesX; ) {
+            const RegionTile* t = RegionAt(&g_regions, tx, ty);
+            if (!t->dirty) { tx++; continue; }
+
+            BOOL video = t->label == REGION_VIDEO;
+            int end = tx + 1;
+            while (end < g_regions.tilesX && RegionAt(&g_regions, end, ty)->dirty &&
+                   (RegionAt(&g_regions, end, ty)->label == REGION_VIDEO) == video)
+                end++;
+
+            int want = g_profile.active.scaler == PROFILE_SCALER_SHARP ? HALFTONE
+                     : g_profile.active.scaler == PROFILE_SCALER_FAST ? COLORONCOLOR
+                     : video ? COLORONCOLOR : HALFTONE;
+            if (mode != want) {
+                SetStretchBltMode(hdcWnd, want);
+                SetBrushOrgEx(hdcWnd, 0, 0, nullptr);   // required after HALFTONE
+                mode = want;
+            }
+            int sx0 = tx * REGION_TILE;
+            int sx1 = min(end * REGION_TILE, srcW);
+            int dx0 = box.left + MulDiv(sx0, boxW, srcW);
+            int dx1 = box.left + MulDiv(sx1, boxW, srcW);
+            StretchBlt(hdcWnd, dx0, dy0, dx1 - dx0, dy1 - dy0,
+                       g_hdcMem, sx0, sy0, sx1 - sx0, sy1 - sy0, SRCCOPY);
+            tx = end;
+        }
+    }
+}
+
+// � Instant replay ����������������������������������������������������
+// Every replay_interval_ms the finished frame (masks and annotations in,
+// no cursor) is sampled into a ReplayRing: only tiles whose hash changed
+// are copied, reusing the hashes the tile repaint has just computed, and
+// an encoder thread compresses them into the ring below normal priority.
+// A sample is skipped while the previous one is still being encoded.
+// Ctrl+Alt+PgUp / PgDn step through the history on the projector only,
+// with the age of the frame in a corner; Ctrl+Alt+End, stepping past the
+// newest frame, suspension or the end of the projection go back to live.
+
+static DWORD WINAPI ReplayEncoderProc(LPVOID)
+{
+    TraceThreadName("replay");
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+    for (;;) {
+        WaitForSingleObject(g_replay.hWake, INFINITE);
+        uint64_t start = TraceNow();
+        AcquireSRWLockExclusive(&g_replay.lock);
+        ReplayCommit(&g_replay.ring, &g_replay.job);
+        ReleaseSRWLockExclusive(&g_replay.lock);
+        TraceSpan(TRACE_REPLAY_ENCODE, start, (uint64_t)g_replay.job.tiles.size());
+        InterlockedExchange(&g_replay.busy, 0);
+    }
+}
+
+static BOOL StartReplayEncoder()
+{
+    if (g_replay.hWake) return TRUE;
+    g_replay.hWake = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    HANDLE hThread = g_replay.hWake ? CreateThread(nullptr, 0, ReplayEncoderProc, nullptr, 0, nullptr) : nullptr;
+    if (!hThread) {
+        if (g_replay.hWake) CloseHandle(g_replay.hWake);
+        g_replay.hWake = nullptr;
+        return FALSE;
+    }
+    CloseHandle(hThread);
+    return TRUE;
+}
+
+// Once the encoder is idle the UI thread owns the ring and the job
+static BOOL ReplayEncoderBusy()
+{
+    return InterlockedCompareExchange(&g_replay.busy, 0, 0) != 0;
+}
+
+static void FreeReplayView()
+{
+    if (g_replay.hdc) {
+        if (g_replay.hOldBmp) SelectObject(g_replay.hdc, g_replay.hOldBmp);
+        DeleteDC(g_replay.hdc);
+    }
+    if (g_replay.hBmp) DeleteObject(g_replay.hBmp);
+    g_replay.hdc = nullptr;
+    g_replay.hBmp = nullptr;
+    g_replay.hOldBmp = nullptr;
+    g_replay.pBits = nullptr;
+    g_replay.w = g_replay.h = 0;
+}
+
+void FreeReplayHistory()
+{
+    while (ReplayEncoderBusy()) Sleep(1);
+    ReplayFree(&g_replay.ring);
+    g_replay.job = ReplayJob();
+    g_replay.lastSample = 0;
+    FreeReplayView();
+}
+
+// Called from RenderMirrorFrame with the finished frame in g_pMemBits.
+// regions, if given, holds this frame's tile hashes.
+static void SampleReplayFrame(int srcW, int srcH, const RegionMap* regions)
+{
+    if (!g_pMemBits || ReplayEncoderBusy()) return;
+    if (g_cfg.replayMB <= 0) {
+        if (g_replay.ring.width) {
+            LeaveReplay(FALSE);
+            FreeReplayHistory();
+        }
+        return;
+    }
+
+    ULONGLONG now = GetTickCount64();
+    if (now - g_replay.lastSample < g_cfg.replayIntervalMs || !StartReplayEncoder()) return;
+    g_replay.lastSample = now;
+
+    size_t budget = (size_t)g_cfg.replayMB << 20;
+    uint64_t maxAge = (uint64_t)g_cfg.replayMinutes * 60000;
+    if (g_replay.ring.width != srcW || g_replay.ring.height != srcH) {
+        LeaveReplay(FALSE);             // its frames are about to go
+        ReplayInit(&g_replay.ring, srcW, srcH, budget, maxAge);
+    } else {
+        ReplaySetLimits(&g_replay.ring, budget, maxAge);
+    }
+
+    GdiFlush();
+    if (ReplayCapture(&g_replay.ring, &g_replay.job, (const uint32_t*)g_pMemBits, srcW, regions, now) == 0)
+        return;
+    InterlockedExchange(&g_replay.busy, 1);
+    SetEvent(g_replay.hWake);
+}
+
+static void ShowReplayFrame()
+{
+    int srcW = g_replay.ring.width, srcH = g_replay.ring.height;
+    int dstW = g_rcSecond.right  - g_rcSecond.left;
+    int dstH = g_rcSecond.bottom - g_rcSecond.top;
+    if (srcW <= 0 || srcH <= 0 || dstW <= 0 || dstH <= 0) return;
+
+    HDC hdcWnd = GetDC(g_hMirror);
+    HDC hdcScreen = GetDC(nullptr);
+    if (!hdcWnd || !hdcScreen) {
+        if (hdcWnd)    ReleaseDC(g_hMirror, hdcWnd);
+        if (hdcScreen) ReleaseDC(nullptr, hdcScreen);
+        return;
+    }
+
+    if (!g_replay.hdc || g_replay.w != srcW || g_replay.h != srcH) {
+        FreeReplayView();
+        g_replay.hdc = CreateCompatibleDC(hdcScreen);
+
+        BITMAPINFO bmi = {};
+        bmi.bmiHeader.biSize        = sizeof(bmi.bmiHeader);
+        bmi.bmiHeader.biWidth       = srcW;
+        bmi.bmiHeader.biHeight      = -srcH;
+        bmi.bmiHeader.biPlanes      = 1;
+        bmi.bmiHeader.biBitCount    = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        void* bits = nullptr;
+        g_replay.hBmp = CreateDIBSection(hdcScreen, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
+        g_replay.pBits = g_replay.hBmp ? (UINT32*)bits : nullptr;
+        g_replay.hOldBmp = (g_replay.hdc && g_replay.hBmp) ? (HBITMAP)SelectObject(g_replay.hdc, g_replay.hBmp) : nullptr;
+        g_replay.w = srcW;
+        g_replay.h = srcH;
+    }
+
+    uint64_t timeMs = 0;
+    BOOL ok = FALSE;
+    if (g_replay.hdc && g_replay.pBits) {
+        AcquireSRWLockShared(&g_replay.lock);
+        ok = ReplayDecode(&g_replay.ring, g_replay.seq, (uint32_t*)g_replay.pBits, srcW, &timeMs);
+        ReleaseSRWLockShared(&g_replay.lock);
+    }
+
+    if (ok) {
+        RECT dst = ComputeLetterboxRect(srcW, srcH, dstW, dstH);
+        if (!g_bWarpEnabled || !RenderWarpedFrame(hdcWnd, hdcScreen, g_replay.pBits, srcW, srcH, dstW, dstH, dst)) {
+            FillLetterboxBars(hdcWnd, dstW, dstH, dst);
+            SetStretchBltMode(hdcWnd, HALFTONE);
+            SetBrushOrgEx(hdcWnd, 0, 0, nullptr);
+            StretchBlt(hdcWnd, dst.left, dst.top, dst.right - dst.left, dst.bottom - dst.top,
+                       g_replay.hdc, 0, 0, srcW, srcH, SRCCOPY);
+        }
+
+        // How long ago, so nobody takes it for the live screen
+        ULONGLONG ago = (GetTickCount64() - timeMs) / 1000;
+        WCHAR label[32];
+        StringCchPrintfW(label, ARRAYSIZE(label), L" \x25C0 -%llu:%02llu ", ago / 60, ago % 60);
+        HFONT hFont = CreateFontW(-max(16, dstH / 24), 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
+                                  DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
+                                  CLEARTYPE_QUALITY, DEFAULT_PITCH, L"Segoe UI");
+        HGDIOBJ hOldFont = hFont ? SelectObject(hdcWnd, hFont) : nullptr;
+        SetTextColor(hdcWnd, RGB(255, 255, 255));
+        SetBkColor(hdcWnd, RGB(192, 0, 0));
+        SetBkMode(hdcWnd, OPAQUE);
+        TextOutW(hdcWnd, dstW / 40, dstH / 40, label, (int)wcslen(label));
+        if (hOldFont) SelectObject(hdcWnd, hOldFont);
+        if (hFont) DeleteObject(hFont);
+        TraceEvent(TRACE_REPLAY_SHOW, (uint32_t)ago);
+    }
+
+    ReleaseDC(nullptr, hdcScreen);
+    ReleaseDC(g_hMirror, hdcWnd);
+}
+
+// delta < 0: one frame older, > 0: one frame newer (past the newest: live)
+void StepReplay(int delta)
+{
+    if (!g_bProjecting || !g_hMirror || g_suspendFlags) return;
+
+    AcquireSRWLockShared(&g_replay.lock);
+    BOOL empty = ReplayIsEmpty(&g_replay.ring);
+    uint32_t oldest = ReplayOldestSeq(&g_replay.ring);
+    uint32_t newest = ReplayNewestSeq(&g_replay.ring);
+    ReleaseSRWLockShared(&g_replay.lock);
+    if (empty) return;
+
+    uint32_t seq;
+    if (!g_replay.showing) {
+        if (delta > 0) return;
+        // The newest sample is, give or take an interval, what is live
+        seq = newest != oldest ? newest - 1 : newest;
+    } else {
+        // The frame on show may have been evicted meanwhile
+        uint32_t at = (int32_t)(g_replay.seq - oldest) < 0 ? oldest : g_replay.seq;
+        if (delta > 0 && at == newest) {
+            LeaveReplay(TRUE);
+            return;
+        }
+        seq = delta > 0 ? at + 1 : (at != oldest ? at - 1 : oldest);
+    }
+
+    if (!g_replay.showing) {
+        g_replay.showing = TRUE;
+        g_cursor.active = FALSE;        // the cursor fast path repaints from the live frame
+        KillTimer(g_hMirror, IDT_CURSOR_REFRESH);
+    }
+    g_replay.seq = seq;
+    ShowReplayFrame();
+}
+
+// repaint: render a live frame right away rather than on the next tick
+void LeaveReplay(BOOL repaint)
+{
+    if (!g_replay.showing) return;
+    g_replay.showing = FALSE;
+    FreeReplayView();
+    RegionFree(&g_regions);             // every tile is repainted
+    SetRectEmpty(&g_cursor.drawn);
+    if (repaint && g_hMirror) RenderMirrorFrame(g_hMirror);
+}
+
+void AppendReplayText(WCHAR* buf, size_t cch)
+{
+    AcquireSRWLockShared(&g_replay.lock);
+    size_t frames = g_replay.ring.frames.size();
+    size_t bytes = g_replay.ring.bytes;
+    uint64_t span = frames ? g_replay.ring.frames.back().timeMs - g_replay.ring.frames.front().timeMs : 0;
+    ReleaseSRWLockShared(&g_replay.lock);
+
+    WCHAR line[160];
+    if (g_cfg.replayMB <= 0)
+        StringCchCopyW(line, ARRAYSIZE(line), L"  repeti\x00E7\x00E3o: desligada\n");
+    else
+        StringCchPrintfW(line, ARRAYSIZE(line), L"  repeti\x00E7\x00E3o: %zu imagens, %zu KB de %d MB, %llu:%02llu min\n",
+            frames, bytes / 1024, g_cfg.replayMB, span / 60000, span / 1000 % 60);
+    StringCchCatW(buf, cch, line);
+}
+
+// � Slide capture �����������������������������������������������������
+// While on ("Guardar diapositivos", or slides=1 with every projection), the
+// live frame goes through the slide detector (SlideCapture.h) after the
+// replay has sampled it, reusing the tile hashes of the repaint. A frame
+// that settled on new content is fingerprinted on the UI thread (a few ms,
+// once per slide); a new slide, or a fuller version of the latest one, is
+// copied for an encoder thread that writes diapositivo-NNN.png in the
+// background into Documents\TeacherToolkit\Diapositivos\<date time>.
+// A candidate that arrives while a PNG is still being written waits for
+// the next frame. The session lasts until capture is turned off, across
+// projector changes; each time projection stops, and when capture ends,
+// the PNGs are bound into diapositivos.pdf next to them.
+
+static bool WriteSlideBytes(void* ctx, const void* data, size_t bytes)
+{
+    DWORD written = 0;
+    return WriteFile((HANDLE)ctx, data, (DWORD)bytes, &written, nullptr) && written == bytes;
+}
+
+static BOOL GetSlidePath(int slide, WCHAR* buf, DWORD cch)
+{
+    return SUCCEEDED(StringCchPrintfW(buf, cch, L"%s\\diapositivo-%03d.png", g_slides.dir, slide));
+}
+
+// Writes through a temporary file so an updated slide never leaves a
+// half-written PNG behind
+static BOOL WriteSlidePng(const WCHAR* path, const uint32_t* frame, int w, int h)
+{
+    WCHAR tmp[MAX_PATH];
+    if (FAILED(StringCchPrintfW(tmp, MAX_PATH, L"%s.tmp", path))) return FALSE;
+    HANDLE hFile = CreateFileW(tmp, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return FALSE;
+    BOOL ok = SlideEncodePng(frame, w, w, h, WriteSlideBytes, hFile);
+    CloseHandle(hFile);
+    ok = ok && MoveFileExW(tmp, path, MOVEFILE_REPLACE_EXISTING);
+    if (!ok) DeleteFileW(tmp);
+    return ok;
+}
+
+static DWORD WINAPI SlideEncoderProc(LPVOID)
+{
+    TraceThreadName("slides");
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+    for (;;) {
+        WaitForSingleObject(g_slides.hWake, INFINITE);
+        uint64_t start = TraceNow();
+        WCHAR path[MAX_PATH];
+        BOOL ok = GetSlidePath(g_slides.jobSlide, path, MAX_PATH) &&
+                  WriteSlidePng(path, g_slides.job.data(), g_slides.jobW, g_slides.jobH);
+        if (ok && g_slides.jobSlide > g_slides.saved) InterlockedExchange(&g_slides.saved, g_slides.jobSlide);
+        g_slides.failed = !ok;
+        TraceSpan(TRACE_SLIDE_ENCODE, start, (uint64_t)g_slides.jobSlide);
+        InterlockedExchange(&g_slides.busy, 0);
+    }
+}
+
+static BOOL StartSlideEncoder()
+{
+    if (g_slides.hWake) return TRUE;
+    g_slides.hWake = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    HANDLE hThread = g_slides.hWake ? CreateThread(nullptr, 0, SlideEncoderProc, nullptr, 0, nullptr) : nullptr;
+    if (!hThread) {
+        if (g_slides.hWake) CloseHandle(g_slides.hWake);
+        g_slides.hWake = nullptr;
+        return FALSE;
+    }
+    CloseHandle(hThread);
+    return TRUE;
+}
+
+// Once the encoder is idle the UI thread owns the job and the counters
+static BOOL SlideEncoderBusy()
+{
+    return InterlockedCompareExchange(&g_slides.busy, 0, 0) != 0;
+}
 
-    AddTrayIcon(g_hHidden);
-    RegisterForDeviceNotifications(g_hHidden);
+// Documents\TeacherToolkit\Diapositivos\<date time>, made when the
+// first slide is kept so an empty session leaves nothing behind
+static BOOL EnsureSlideDir()
+{
+    if (g_slides.dir[0]) return TRUE;
+    WCHAR dir[MAX_PATH];
+    if (!GetConfigDir(CSIDL_PERSONAL, dir, MAX_PATH)) return FALSE;
+    CreateDirectoryW(dir, nullptr);
+    if (FAILED(StringCchCatW(dir, MAX_PATH, L"\\Diapositivos"))) return FALSE;
+    CreateDirectoryW(dir, nullptr);
+
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    WCHAR session[MAX_PATH];
+    for (int n = 1; n < 100; n++) {
+        HRESULT hr = n == 1
+            ? StringCchPrintfW(session, MAX_PATH, L"%s\\%04u-%02u-%02u %02uh%02u", dir,
+                               st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute)
+            : StringCchPrintfW(session, MAX_PATH, L"%s\\%04u-%02u-%02u %02uh%02u (%d)", dir,
+                               st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, n);
+        if (FAILED(hr)) return FALSE;
+        if (CreateDirectoryW(session, nullptr)) {
+            StringCchCopyW(g_slides.dir, MAX_PATH, session);
+            return TRUE;
+        }
+        if (GetLastError() != ERROR_ALREADY_EXISTS) return FALSE;
+    }
+    return FALSE;
+}
 
-    UpdateStartupExeIfNeeded();
+void StartSlideCapture()
+{
+    if (g_slides.on) return;
+    SlideDetectorReset(&g_slides.detector);
+    g_slides.index.slides.clear();
+    g_slides.dir[0] = L'\0';
+    g_slides.saved = 0;
+    g_slides.failed = FALSE;
+    g_slides.on = TRUE;
+}
+
+// Binds the PNGs of this session into diapositivos.pdf and lets go of the
+// frame-sized buffers; the session itself goes on
+void ExportSlides()
+{
+    if (!g_slides.on) return;
+    while (SlideEncoderBusy()) Sleep(1);
+    g_slides.detector = SlideDetector();
+    SlideDetectorReset(&g_slides.detector);
+    std::vector<uint32_t>().swap(g_slides.job);
+    if (!g_cfg.slidesPdf || g_slides.saved == 0) return;
+
+    WCHAR path[MAX_PATH], tmp[MAX_PATH];
+    if (FAILED(StringCchPrintfW(path, MAX_PATH, L"%s\\diapositivos.pdf", g_slides.dir)) ||
+        FAILED(StringCchPrintfW(tmp, MAX_PATH, L"%s.tmp", path)))
+        return;
+    HANDLE hPdf = CreateFileW(tmp, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hPdf == INVALID_HANDLE_VALUE) return;
+
+    SlidePdf pdf;
+    SlidePdfBegin(&pdf, WriteSlideBytes, hPdf);
+    std::vector<uint8_t> png;
+    for (int i = 1; i <= g_slides.saved; i++) {
+        WCHAR pngPath[MAX_PATH];
+        if (!GetSlidePath(i, pngPath, MAX_PATH)) continue;
+        HANDLE hPng = CreateFileW(pngPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (hPng == INVALID_HANDLE_VALUE) continue;       // deleted by the teacher: skipped
+        LARGE_INTEGER size = {};
+        DWORD read = 0;
+        BOOL ok = GetFileSizeEx(hPng, &size) && size.QuadPart > 0 && size.QuadPart < (1LL << 30);
+        if (ok) {
+            png.resize((size_t)size.QuadPart);
+            ok = ReadFile(hPng, png.data(), (DWORD)png.size(), &read, nullptr) && read == png.size();
+        }
+        CloseHandle(hPng);
+        if (ok) SlidePdfAddPng(&pdf, png.data(), png.size());
+    }
+    BOOL ok = SlidePdfEnd(&pdf) && pdf.pages > 0;
+    CloseHandle(hPdf);
+    if (!ok || !MoveFileExW(tmp, path, MOVEFILE_REPLACE_EXISTING))
+        DeleteFileW(tmp);
+}
 
-    SetTimer(g_hHidden, IDT_MONITOR_POLL, MONITOR_POLL_MS, nullptr);
+void StopSlideCapture(BOOL openFolder)
+{
+    if (!g_slides.on) return;
+    ExportSlides();
+    g_slides.on = FALSE;
+    g_slides.index = SlideIndex();
+    if (openFolder && g_slides.saved > 0)
+        ShellExecuteW(nullptr, L"open", g_slides.dir, nullptr, nullptr, SW_SHOWNORMAL);
+}
 
-    if (HasSecondMonitor(&g_rcPrimary, &g_rcSecond)) {
-        StartMirroring();
-    } else if (CountPhysicalDisplays() >= 2) {
-        TryExtendAndMirror();
+// Called from RenderMirrorFrame with the finished live frame in g_pMemBits
+// (no cursor). regions, if given, holds this frame's tile hashes.
+static void SampleSlideFrame(int srcW, int srcH, const RegionMap* regions)
+{
+    if (!g_slides.on || !g_pMemBits) return;
+    GdiFlush();
+    const uint32_t* frame = (const uint32_t*)g_pMemBits;
+    if (!SlideDetectorUpdate(&g_slides.detector, frame, srcW, srcW, srcH, regions, NowMicros()))
+        return;
+    if (SlideEncoderBusy() || !StartSlideEncoder()) return;     // offered again next frame
+
+    SlideFingerprint fp;
+    SlideFingerprintFrame(frame, srcW, srcW, srcH, &fp);
+    int slide = 0;
+    SlideVerdict verdict = SlideIndexAdd(&g_slides.index, &fp, &slide);
+    SlideDetectorTake(&g_slides.detector);
+    TraceEvent(TRACE_SLIDE, (uint32_t)verdict, (uint64_t)slide);
+    if (verdict == SLIDE_SEEN || !EnsureSlideDir()) return;
+
+    g_slides.job.assign(frame, frame + (size_t)srcW * srcH);
+    g_slides.jobW = srcW;
+    g_slides.jobH = srcH;
+    g_slides.jobSlide = slide;
+    InterlockedExchange(&g_slides.busy, 1);
+    SetEvent(g_slides.hWake);
+}
+
+void AppendSlidesText(WCHAR* buf, size_t cch)
+{
+    if (!g_slides.on) return;
+    WCHAR line[MAX_PATH + 160];
+    StringCchPrintfW(line, ARRAYSIZE(line), L"\nDiapositivos\n  %ld guardados%s\n  %s\n",
+        InterlockedCompareExchange(&g_slides.saved, 0, 0),
+        g_slides.failed ? L", o \x00FAltimo n\x00E3o p\x00F4de ser escrito" : L"",
+        g_slides.dir[0] ? g_slides.dir : L"(pasta criada com o primeiro)");
+    StringCchCatW(buf, cch, line);
+}
+
+// � Shared frames �����������������������������������������������������
+// Each frame, as the replay samples it (masks and annotations in, no
+// cursor), is also published in shared memory (FrameRing.h) so a lesson
+// recorder or a screen reader helper can use it instead of capturing the
+// screen a second time; tools/FrameRead shows how to read it. The ring is
+// sized for the primary when projection starts. Nothing is hashed or
+// copied while no reader is polling, so with no consumer around it costs
+// one atomic load per frame and the frame pages are never touched.
+
+struct FrameShare {
+    FrameRingMapping map;
+    FrameRingWriter  writer;
+    BOOL     tooSmall;          // an older, smaller ring is still held open
+    uint32_t published;
+    BOOL     readers;           // as of the last frame
+};
+static FrameShare g_share;
+
+void StartFrameShare()
+{
+    StopFrameShare();
+    int w = g_rcPrimary.right  - g_rcPrimary.left;
+    int h = g_rcPrimary.bottom - g_rcPrimary.top;
+    if (!g_cfg.frameShare || w <= 0 || h <= 0) return;
+
+    if (!FrameRingCreate(&g_share.map, FRAME_RING_NAME, FrameRingBytes(w, h))) return;
+    if (!FrameRingFormat(&g_share.writer, g_share.map.base, g_share.map.bytes, w, h,
+                         GetTickCount() ^ (GetCurrentProcessId() << 16))) {
+        FrameRingUnmap(&g_share.map);
+        g_share.tooSmall = TRUE;
     }
+}
 
-    return TRUE;
+void StopFrameShare()
+{
+    if (g_share.map.base) {
+        FrameRingStop(&g_share.writer);
+        FrameRingUnmap(&g_share.map);
+        FrameRingRemove(FRAME_RING_NAME);
+    }
+    g_share.writer = FrameRingWriter();     // drops the hash tables too
+    g_share.tooSmall = FALSE;
+    g_share.published = 0;
+    g_share.readers = FALSE;
 }
 
-// � Hidden window proc (tray + monitor polling) �����������������������
-LRESULT CALLBACK HiddenWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+// Called from RenderMirrorFrame next to SampleReplayFrame, same frame
+static void PublishSharedFrame(int srcW, int srcH, const RegionMap* regions, LONGLONG frameTicks)
 {
-    switch (message)
-    {
-    case WM_TIMER:
-        if (wParam == IDT_MONITOR_POLL) {
-            CheckMonitorState();
+    if (!g_share.map.base || !g_pMemBits) return;
+    g_share.readers = FrameRingWanted(&g_share.writer, GetTickCount64());
+    if (!g_share.readers) return;
+
+    if ((uint32_t)srcW > g_share.writer.header->maxWidth || (uint32_t)srcH > g_share.writer.header->maxHeight) {
+        StartFrameShare();      // the primary grew; readers see the restart
+        if (!g_share.map.base) return;
+    }
+    GdiFlush();
+    if (FrameRingPublish(&g_share.writer, (const uint32_t*)g_pMemBits, srcW, srcW, srcH,
+                         regions, (uint64_t)QpcMicros(frameTicks)))
+        g_share.published++;
+}
+
+void AppendFrameShareText(WCHAR* buf, size_t cch)
+{
+    WCHAR line[160];
+    if (!g_cfg.frameShare)
+        StringCchCopyW(line, ARRAYSIZE(line), L"  partilha de imagens: desligada\n");
+    else if (g_share.tooSmall)
+        StringCchCopyW(line, ARRAYSIZE(line), L"  partilha de imagens: indispon\x00ED" L"vel (um leitor ainda usa a anterior)\n");
+    else if (!g_share.map.base)
+        StringCchCopyW(line, ARRAYSIZE(line), L"  partilha de imagens: indispon\x00ED" L"vel\n");
+    else
+        StringCchPrintfW(line, ARRAYSIZE(line), L"  partilha de imagens: %u publicadas, %s\n",
+            g_share.published, g_share.readers ? L"com leitores" : L"sem leitores");
+    StringCchCatW(buf, cch, line);
+}
+
+// � Mirror frame (captures primary screen + draws cursor) �������������
+void RenderMirrorFrame(HWND hWnd)
+{
+    if (g_suspendFlags) return;
+    if (g_soak.active) SoakNextFrame();     // not part of the frame time
+
+    LARGE_INTEGER frameStart;
+    QueryPerformanceCounter(&frameStart);
+    uint64_t traceStart = TraceNow();
+
+    if (!g_soak.active) MoveOtherWindowsToPrimaryFromSecond();
+
+    // Capture and blit directly � skip InvalidateRect/WM_PAINT overhead
+    int srcW = g_rcPrimary.right  - g_rcPrimary.left;
+    int srcH = g_rcPrimary.bottom - g_rcPrimary.top;
+    int dstW = g_rcSecond.right   - g_rcSecond.left;
+    int dstH = g_rcSecond.bottom  - g_rcSecond.top;
+
+    if (srcW <= 0 || srcH <= 0 || dstW <= 0 || dstH <= 0)
+        return;
+
+    HDC hdcWnd = GetDC(hWnd);
+    HDC hdcScreen = GetDC(nullptr);
+    if (!hdcWnd || !hdcScreen) {
+        if (hdcWnd)    ReleaseDC(hWnd, hdcWnd);
+        if (hdcScreen) ReleaseDC(nullptr, hdcScreen);
+        return;
+    }
+
+    // Reinitialize memory DC / bitmap only if size changed
+    if (!g_hdcMem || !g_hBmpMem || g_memW != srcW || g_memH != srcH) {
+        FreeMirrorResources();
+        g_hdcMem  = CreateCompatibleDC(hdcScreen);
+
+        // 32bpp top-down DIB so overlays can be composited in place
+        BITMAPINFO bmi = {};
+        bmi.bmiHeader.biSize        = sizeof(bmi.bmiHeader);
+        bmi.bmiHeader.biWidth       = srcW;
+        bmi.bmiHeader.biHeight      = -srcH;
+        bmi.bmiHeader.biPlanes      = 1;
+        bmi.bmiHeader.biBitCount    = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        void* bits = nullptr;
+        g_hBmpMem = CreateDIBSection(hdcScreen, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
+        g_pMemBits = g_hBmpMem ? (UINT32*)bits : nullptr;
+        g_memW = srcW;
+        g_memH = srcH;
+        if (g_hdcMem && g_hBmpMem) {
+            g_hOldBmp = (HBITMAP)SelectObject(g_hdcMem, g_hBmpMem);
         }
-        else if (wParam == IDT_DISPLAY_SETTLE) {
-            KillTimer(hWnd, IDT_DISPLAY_SETTLE);
-            CheckMonitorState();
+    }
+
+    if (g_hdcMem && g_hBmpMem) {
+        BitBlt(g_hdcMem, 0, 0, srcW, srcH, g_soak.active ? g_soak.hdc : hdcScreen,
+               g_rcPrimary.left, g_rcPrimary.top, SRCCOPY);
+
+        // Privacy masks, the profile's colour table, then annotations
+        // (only the tiles strokes touched), all under the cursor, then the
+        // tile hashes for the per-region repaint: one pass over the frame
+        // (PixelPipeline.h).
+        // Pixelation with blocks that straddle tiles goes first on its own
+        if (g_annot.width != srcW || g_annot.height != srcH)
+            AnnotInit(&g_annot, srcW, srcH);
+        g_passHashed = FALSE;
+        if (g_pMemBits) {
+            BOOL hashed = TileRepaintOn() && !g_bWarpEnabled && !g_replay.showing;
+            int tilesX = (srcW + PIXEL_TILE - 1) / PIXEL_TILE;
+            if (hashed)
+                g_passHashes.resize((size_t)tilesX * ((srcH + PIXEL_TILE - 1) / PIXEL_TILE));
+            GdiFlush();
+            if (!MaskIsEmpty(&g_maskSet) && !MaskStage::Fusable(g_maskRules.mode, g_maskRules.blockPx))
+                MaskApply(&g_maskSet, (uint32_t*)g_pMemBits, srcW, g_maskRules.mode, g_maskRules.blockPx);
+            const uint8_t* lut = ProfileColorLut(g_profile.active.color);
+            auto pass = FusePixelStages(MaskStage{ &g_maskSet, g_maskRules.mode, g_maskRules.blockPx },
+                                        LutStage{ lut, lut, lut },
+                                        AnnotStage{ &g_annot },
+                                        HashStage{ hashed ? g_passHashes.data() : nullptr, tilesX });
+            pass.Run((uint32_t*)g_pMemBits, srcW, srcW, srcH);
+            g_passHashed = hashed;
         }
-        else if (wParam == IDT_EXTEND_RETRY) {
-            g_nExtendRetries++;
-            if (HasSecondMonitor(&g_rcPrimary, &g_rcSecond)) {
-                KillTimer(g_hHidden, IDT_EXTEND_RETRY);
-                g_bExtendPending = FALSE;
-                StartMirroring();
-            } else if (g_nExtendRetries >= 10) {
-                KillTimer(g_hHidden, IDT_EXTEND_RETRY);
-                g_bExtendPending = FALSE;
+
+        // Instant replay samples the frame without the cursor. While an
+        // older frame is on the projector nothing else is drawn
+        if (g_replay.showing) {
+            SampleReplayFrame(srcW, srcH, nullptr);
+            PublishSharedFrame(srcW, srcH, nullptr, frameStart.QuadPart);
+        } else {
+            // The warp needs the cursor in the frame; otherwise it is drawn on
+            // the window afterwards so it can move between frames
+            if (g_bWarpEnabled) {
+                SampleReplayFrame(srcW, srcH, nullptr);     // before the cursor goes in
+                PublishSharedFrame(srcW, srcH, nullptr, frameStart.QuadPart);
+                SampleSlideFrame(srcW, srcH, nullptr);
             }
-        }
-        break;
 
-    case WM_CHECKMONITOR:
-        CheckMonitorState();
-        break;
+            CURSORINFO ci = {};
+            ci.cbSize = sizeof(ci);
+            if (g_bWarpEnabled && GetCursorInfo(&ci) && (ci.flags & CURSOR_SHOWING)) {
+                ICONINFO ii = {};
+                if (GetIconInfo(ci.hCursor, &ii)) {
+                    int cx = ci.ptScreenPos.x - g_rcPrimary.left - (int)ii.xHotspot;
+                    int cy = ci.ptScreenPos.y - g_rcPrimary.top  - (int)ii.yHotspot;
+                    DrawIconEx(g_hdcMem, cx, cy, ci.hCursor, 0, 0, 0, nullptr, DI_NORMAL);
+                    if (ii.hbmMask)  DeleteObject(ii.hbmMask);
+                    if (ii.hbmColor) DeleteObject(ii.hbmColor);
+                }
+            }
 
-    case WM_DISPLAYCHANGE:
-        // WM_DISPLAYCHANGE fires before the display list is fully updated.
-        // Post an immediate check, then arm a settle timer to catch the case
-        // where EnumDisplayMonitors hasn't refreshed yet on the first check.
-        PostMessage(hWnd, WM_CHECKMONITOR, 0, 0);
-        SetTimer(hWnd, IDT_DISPLAY_SETTLE, 500, nullptr);
-        break;
+            // Letterbox into the destination, through the keystone warp if
+            // this projector has one
+            RECT dst = ComputeLetterboxRect(srcW, srcH, dstW, dstH);
+            BOOL partial = FALSE;
+            if (!g_bWarpEnabled || !RenderWarpedFrame(hdcWnd, hdcScreen, g_pMemBits, srcW, srcH, dstW, dstH, dst)) {
+                FillLetterboxBars(hdcWnd, dstW, dstH, dst);
 
-    case WM_DEVICECHANGE:
-        if (wParam == DBT_DEVNODES_CHANGED ||
-            wParam == DBT_DEVICEARRIVAL ||
-            wParam == DBT_DEVICEREMOVECOMPLETE) {
-            PostMessage(hWnd, WM_CHECKMONITOR, 0, 0);
-        }
-        break;
+                int scaledW = dst.right  - dst.left;
+                int scaledH = dst.bottom - dst.top;
 
-    case WM_TRAYICON:
-        switch (LOWORD(lParam))
-        {
-        case WM_LBUTTONUP:
-        case WM_RBUTTONUP:
-        case WM_CONTEXTMENU:
-            ShowTrayMenu(hWnd);
-            break;
-        }
-        break;
+                if (TileRepaintOn() && g_pMemBits) {
+                    // Tiles left alone keep the cursor painted over them
+                    partial = TRUE;
+                    PaintChangedRegions(hdcWnd, srcW, srcH, dst);
+                } else {
+                    // A profile that repaints whole frames keeps the tiles
+                    // for when the next application wants them back
+                    if (!g_cfg.regionClassify) RegionFree(&g_regions);
+                    if (g_profile.active.scaler == PROFILE_SCALER_SHARP) {
+                        SetStretchBltMode(hdcWnd, HALFTONE);
+                        SetBrushOrgEx(hdcWnd, 0, 0, nullptr);
+                    } else {
+                        SetStretchBltMode(hdcWnd, COLORONCOLOR);
+                    }
+                    StretchBlt(hdcWnd, dst.left, dst.top, scaledW, scaledH,
+                               g_hdcMem, 0, 0, srcW, srcH, SRCCOPY);
+                }
+            }
 
-    case WM_COMMAND:
-        if (LOWORD(wParam) == IDM_TRAY_EXIT || LOWORD(wParam) == IDM_EXIT) {
-            StopMirroring();
-            UnregisterDeviceNotifications();
-            RemoveTrayIcon();
-            PostQuitMessage(0);
-        }
-        else if (LOWORD(wParam) == IDM_TRAY_STARTUP) {
-            if (IsStartupEnabled()) {
-                DisableStartup();
-            } else {
-                EnableStartup();
+            if (!g_bWarpEnabled) {
+                SampleReplayFrame(srcW, srcH, partial ? &g_regions : nullptr);
+                PublishSharedFrame(srcW, srcH, partial ? &g_regions : nullptr, frameStart.QuadPart);
+                SampleSlideFrame(srcW, srcH, partial ? &g_regions : nullptr);
             }
+            LatencyCapture(&g_latency, QpcMicros(frameStart.QuadPart), partial ? &g_regions : nullptr,
+                           g_bWarpEnabled != FALSE);
+
+            g_cursor.active = !g_bWarpEnabled;
+            g_cursor.srcW = srcW;
+            g_cursor.srcH = srcH;
+            g_cursor.box = dst;
+            if (!partial)
+                SetRectEmpty(&g_cursor.drawn);  // the frame just covered it
+            UpdateMirrorCursor(hdcWnd, TRUE);
         }
-        else if (LOWORD(wParam) == IDM_TRAY_ABOUT) {
-            ShowAboutDialog(hWnd);
-        }
-        else if (LOWORD(wParam) == IDM_TRAY_UPDATE) {
-            PromptUpdate(hWnd);
-        }
-        break;
+        StartupTimelineMark(STARTUP_FIRST_FRAME);
+    }
 
-    case WM_DESTROY:
-        StopMirroring();
-        UnregisterDeviceNotifications();
-        RemoveTrayIcon();
-        PostQuitMessage(0);
-        break;
+    ReleaseDC(nullptr, hdcScreen);
+    ReleaseDC(hWnd, hdcWnd);
+
+    // Presented here means handed to the compositor: the projector shows
+    // it at its next refresh, which the app cannot observe
+    GdiFlush();
+    LARGE_INTEGER frameEnd;
+    QueryPerformanceCounter(&frameEnd);
+    if (LatencyPresent(&g_latency, QpcMicros(frameEnd.QuadPart)))
+        TraceEvent(TRACE_INPUT_LATENCY, g_latency.lastKind, (uint64_t)g_latency.lastUs);
+    FrameStatsRecord(frameStart.QuadPart, frameEnd.QuadPart);
+    TraceSpan(TRACE_FRAME, traceStart, (uint64_t)g_frameStats.frames);
+}
 
-    default:
-        return DefWindowProc(hWnd, message, wParam, lParam);
+// � Frame clock �������������������������������������������������������
+// SetTimer rounds to the ~15.6 ms system tick and WM_TIMER is only made
+// when the queue is otherwise empty, so 33 ms came out anywhere between 31
+// and 47 ms. With mirror_clock=1 a thread instead sleeps on a
+// high-resolution waitable timer until deadlines on a fixed grid
+// (FramePacer.h), a whole number of projector refreshes apart with
+// mirror_vsync=1, and posts WM_MIRRORTICK. Only one tick is ever in
+// flight, so a slow frame drops ticks rather than queueing them. Where
+// high-resolution timers are missing (before Windows 10 1803) WM_TIMER is
+// used as before. Either way the interval between ticks is measured and
+// published with the frame stats once a second.
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+struct FrameClock {
+    HANDLE         hThread;
+    HANDLE         hStop;
+    HANDLE         hTimer;
+    HWND           hWnd;            // receives WM_MIRRORTICK
+    volatile LONG64 periodUs;       // set by the UI thread, picked up at the next deadline
+    BOOL           hiRes;           // thread running; otherwise IDT_MIRROR_REFRESH
+    volatile LONG  tickPending;
+    volatile LONG  dropped;
+    FrameIntervals intervals;       // UI thread
+};
+static FrameClock g_clock = {};
+
+int64_t QpcMicros(LONGLONG ticks)
+{
+    LONGLONG f = g_startup.freq.QuadPart;
+    return f ? (ticks / f) * 1000000 + (ticks % f) * 1000000 / f : 0;
+}
+
+int64_t NowMicros()
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return QpcMicros(now.QuadPart);
+}
+
+static DWORD WINAPI FrameClockProc(LPVOID)
+{
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);    // it only ever waits
+    FramePacer pacer;
+    PacerInit(&pacer, g_clock.periodUs, NowMicros());
+    HANDLE handles[2] = { g_clock.hStop, g_clock.hTimer };
+
+    for (;;) {
+        int64_t periodUs = InterlockedCompareExchange64(&g_clock.periodUs, 0, 0);
+        if (periodUs != pacer.periodUs) PacerInit(&pacer, periodUs, NowMicros());
+        int64_t waitUs = PacerNextDeadline(&pacer) - NowMicros();
+        if (waitUs > 0) {
+            LARGE_INTEGER due;
+            due.QuadPart = -waitUs * 10;        // relative, in 100 ns units
+            if (!SetWaitableTimerEx(g_clock.hTimer, &due, 0, nullptr, nullptr, nullptr, 0) ||
+                WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0 + 1)
+                break;
+        } else if (WaitForSingleObject(g_clock.hStop, 0) == WAIT_OBJECT_0) {
+            break;
+        }
+        PacerAdvance(&pacer, NowMicros());
+
+        if (InterlockedExchange(&g_clock.tickPending, 1) == 0)
+            PostMessage(g_clock.hWnd, WM_MIRRORTICK, 0, 0);
+        else
+            InterlockedIncrement(&g_clock.dropped);
     }
     return 0;
 }
 
-// � Compute letterbox/pillarbox destination rect ����������������������
-// Returns a centered rect within (0,0,dstW,dstH) that fits srcW�srcH
-// without distortion.
-static RECT ComputeLetterboxRect(int srcW, int srcH, int dstW, int dstH)
+void StopFrameClock()
 {
-    RECT r = {};
-    if (srcW <= 0 || srcH <= 0 || dstW <= 0 || dstH <= 0) return r;
+    if (g_clock.hThread) {
+        SetEvent(g_clock.hStop);
+        WaitForSingleObject(g_clock.hThread, INFINITE);
+        CloseHandle(g_clock.hThread);
+        g_clock.hThread = nullptr;
+    }
+    if (g_clock.hStop) {
+        CloseHandle(g_clock.hStop);
+        g_clock.hStop = nullptr;
+    }
+    if (g_clock.hTimer) {
+        CloseHandle(g_clock.hTimer);
+        g_clock.hTimer = nullptr;
+    }
+    g_clock.hiRes = FALSE;
+    if (g_hMirror) KillTimer(g_hMirror, IDT_MIRROR_REFRESH);
+}
 
-    // Scale uniformly to fit the destination
-    int scaledW, scaledH;
-    if (dstW * srcH <= dstH * srcW) {
-        // Width is the limiting dimension
-        scaledW = dstW;
-        scaledH = (dstW * srcH) / srcW;
-    } else {
-        // Height is the limiting dimension
-        scaledH = dstH;
-        scaledW = (dstH * srcW) / srcH;
+// mirror_fps_ms, or the application profile's rate
+static int64_t FrameClockPeriodUs()
+{
+    int64_t targetUs = g_profile.active.frameUs ? (int64_t)g_profile.active.frameUs
+                                                : (int64_t)g_cfg.mirrorFpsMs * 1000;
+    int refreshHz = g_cfg.mirrorVsync ? GetMonitorRefreshHz(&g_rcSecond) : 0;
+    return PacerAlignPeriod(targetUs, refreshHz);
+}
+
+// (Re)starts the clock with the current configuration
+void StartFrameClock()
+{
+    StopFrameClock();
+    if (!g_hMirror) return;
+
+    g_clock.periodUs = FrameClockPeriodUs();
+    g_clock.hWnd = g_hMirror;
+    g_clock.tickPending = 0;
+    g_clock.dropped = 0;
+    IntervalsReset(&g_clock.intervals, g_clock.periodUs);
+
+    if (g_cfg.mirrorHiResClock) {
+        g_clock.hTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                                TIMER_ALL_ACCESS);
+        g_clock.hStop = g_clock.hTimer ? CreateEventW(nullptr, TRUE, FALSE, nullptr) : nullptr;
+        g_clock.hThread = g_clock.hStop ? CreateThread(nullptr, 0, FrameClockProc, nullptr, 0, nullptr) : nullptr;
+        g_clock.hiRes = g_clock.hThread != nullptr;
+        if (!g_clock.hiRes) StopFrameClock();
     }
+    if (!g_clock.hiRes)
+        SetTimer(g_hMirror, IDT_MIRROR_REFRESH, (UINT)((g_clock.periodUs + 500) / 1000), nullptr);
 
-    r.left   = (dstW - scaledW) / 2;
-    r.top    = (dstH - scaledH) / 2;
-    r.right  = r.left + scaledW;
-    r.bottom = r.top  + scaledH;
-    return r;
+    FrameIntervalSummary none = {};
+    FrameStatsSetPacing(&none, g_clock.periodUs / 1000.0, g_clock.hiRes, 0);
+    TraceEvent(TRACE_FRAME_CLOCK, (uint32_t)g_clock.periodUs, (uint64_t)g_clock.hiRes);
 }
 
-// � Mirror window proc (captures primary screen + draws cursor) �������
-LRESULT CALLBACK MirrorWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+// Moves the running clock to a new period without restarting it: the
+// thread re-anchors its grid when it next wakes, which is brought forward
+// to now, and WM_TIMER is simply re-armed
+static void SetFrameClockPeriod()
 {
-    switch (message)
-    {
-    case WM_TIMER:
-        if (wParam == IDT_MIRROR_REFRESH) {
-            MoveOtherWindowsToPrimaryFromSecond();
+    int64_t periodUs = FrameClockPeriodUs();
+    if (!g_hMirror || g_suspendFlags || periodUs == g_clock.periodUs) return;
+    InterlockedExchange64(&g_clock.periodUs, periodUs);
+    IntervalsReset(&g_clock.intervals, periodUs);
+    if (g_clock.hiRes) {
+        LARGE_INTEGER due;
+        due.QuadPart = -1;
+        SetWaitableTimerEx(g_clock.hTimer, &due, 0, nullptr, nullptr, nullptr, 0);
+    } else {
+        SetTimer(g_hMirror, IDT_MIRROR_REFRESH, (UINT)((periodUs + 500) / 1000), nullptr);
+    }
+    FrameIntervalSummary none = {};
+    FrameStatsSetPacing(&none, periodUs / 1000.0, g_clock.hiRes, 0);
+    TraceEvent(TRACE_FRAME_CLOCK, (uint32_t)periodUs, (uint64_t)g_clock.hiRes);
+}
 
-            // Capture and blit directly � skip InvalidateRect/WM_PAINT overhead
-            int srcW = g_rcPrimary.right  - g_rcPrimary.left;
-            int srcH = g_rcPrimary.bottom - g_rcPrimary.top;
-            int dstW = g_rcSecond.right   - g_rcSecond.left;
-            int dstH = g_rcSecond.bottom  - g_rcSecond.top;
+static void OnFrameClockTick(HWND hWnd)
+{
+    FrameIntervals* iv = &g_clock.intervals;
+    IntervalsRecord(iv, NowMicros());
+    if (iv->sumUs >= 1000000.0) {
+        FrameIntervalSummary summary;
+        IntervalsSummarize(iv, &summary);
+        FrameStatsSetPacing(&summary, g_clock.periodUs / 1000.0, g_clock.hiRes,
+                            InterlockedCompareExchange(&g_clock.dropped, 0, 0));
+        IntervalsRestart(iv, g_clock.periodUs);
+    }
 
-            if (srcW <= 0 || srcH <= 0 || dstW <= 0 || dstH <= 0)
-                break;
+    RenderMirrorFrame(hWnd);
+    InterlockedExchange(&g_clock.tickPending, 0);   // ticks during the frame were dropped
+}
 
-            HDC hdcWnd = GetDC(hWnd);
-            HDC hdcScreen = GetDC(nullptr);
-            if (!hdcWnd || !hdcScreen) {
-                if (hdcWnd)    ReleaseDC(hWnd, hdcWnd);
-                if (hdcScreen) ReleaseDC(nullptr, hdcScreen);
-                break;
+// Starts a latency measurement (InputLatency.h) for mouse moves, button
+// presses and key presses anywhere on the desktop. Clicks are placed at
+// the pointer and keys at the focused window's caret, in frame pixels.
+// Modifiers, releases and the wheel have nothing to look for
+static void NoteRawInput(HRAWINPUT hRaw)
+{
+    RAWINPUT ri;
+    UINT size = sizeof(ri);
+    if (GetRawInputData(hRaw, RID_INPUT, &ri, &size, sizeof(RAWINPUTHEADER)) == (UINT)-1) return;
+    int64_t nowUs = NowMicros();
+
+    if (ri.header.dwType == RIM_TYPEMOUSE) {
+        const USHORT downs = RI_MOUSE_LEFT_BUTTON_DOWN | RI_MOUSE_RIGHT_BUTTON_DOWN | RI_MOUSE_MIDDLE_BUTTON_DOWN;
+        POINT pt;
+        if (ri.data.mouse.usButtonFlags & downs) {
+            if (GetCursorPos(&pt))
+                LatencyInput(&g_latency, LATENCY_CLICK, nowUs, pt.x - g_rcPrimary.left, pt.y - g_rcPrimary.top);
+        } else if (ri.data.mouse.lLastX || ri.data.mouse.lLastY) {
+            LatencyInput(&g_latency, LATENCY_POINTER, nowUs, -1, -1);
+        }
+    } else if (ri.header.dwType == RIM_TYPEKEYBOARD) {
+        USHORT vk = ri.data.keyboard.VKey;
+        if ((ri.data.keyboard.Flags & RI_KEY_BREAK) || vk == VK_SHIFT || vk == VK_CONTROL || vk == VK_MENU ||
+            vk == VK_LWIN || vk == VK_RWIN || vk == VK_CAPITAL || vk == VK_NUMLOCK || vk == 0xFF)
+            return;
+        int x = -1, y = -1;
+        GUITHREADINFO gti = {};
+        gti.cbSize = sizeof(gti);
+        if (GetGUIThreadInfo(0, &gti) && gti.hwndCaret) {
+            POINT pt = { gti.rcCaret.left, gti.rcCaret.top };
+            if (ClientToScreen(gti.hwndCaret, &pt)) {
+                x = pt.x - g_rcPrimary.left;
+                y = pt.y - g_rcPrimary.top;
             }
+        }
+        LatencyInput(&g_latency, LATENCY_KEY, nowUs, x, y);
+    }
+}
 
-            // Reinitialize memory DC / bitmap only if size changed
-            if (!g_hdcMem || !g_hBmpMem || g_memW != srcW || g_memH != srcH) {
-                FreeMirrorResources();
-                g_hdcMem  = CreateCompatibleDC(hdcScreen);
-                g_hBmpMem = CreateCompatibleBitmap(hdcScreen, srcW, srcH);
-                g_memW = srcW;
-                g_memH = srcH;
-                if (g_hdcMem && g_hBmpMem) {
-                    g_hOldBmp = (HBITMAP)SelectObject(g_hdcMem, g_hBmpMem);
-                }
-            }
+// � Application profiles ����������������������������������������������
+// While projecting, the foreground application picks the mirror profile
+// (MirrorProfile.h). An out-of-context WinEvent hook, which costs other
+// processes nothing, reports foreground changes on the UI thread; our own
+// windows (annotation input) are skipped and keep the profile. Switching
+// allocates nothing: the frame clock changes period in place, the repaint
+// reads scaler and capture per frame, and the colour tables are static.
+// Config keys, then built-ins, are looked up by executable name, then by
+// window class. profiles=0 keeps the global settings for everything.
+
+static BOOL LookupProfile(const WCHAR* key, MirrorProfile* out)
+{
+    char name[64], scoped[80];
+    if (!WideCharToMultiByte(CP_UTF8, 0, key, -1, name, ARRAYSIZE(name), nullptr, nullptr) ||
+        FAILED(StringCchPrintfA(scoped, ARRAYSIZE(scoped), "profile.%s", name)))
+        return FALSE;
+    const char* spec = ConfigGet(&g_config, scoped);
+    if (!spec) spec = ProfileBuiltin(name);
+    return spec && ProfileParse(out, spec);
+}
 
-            if (g_hdcMem && g_hBmpMem) {
-                BitBlt(g_hdcMem, 0, 0, srcW, srcH,
-                       hdcScreen, g_rcPrimary.left, g_rcPrimary.top, SRCCOPY);
-
-                // Draw cursor onto the captured image
-                CURSORINFO ci = {};
-                ci.cbSize = sizeof(ci);
-                if (GetCursorInfo(&ci) && (ci.flags & CURSOR_SHOWING)) {
-                    ICONINFO ii = {};
-                    if (GetIconInfo(ci.hCursor, &ii)) {
-                        int cx = ci.ptScreenPos.x - g_rcPrimary.left - (int)ii.xHotspot;
-                        int cy = ci.ptScreenPos.y - g_rcPrimary.top  - (int)ii.yHotspot;
-                        DrawIconEx(g_hdcMem, cx, cy, ci.hCursor, 0, 0, 0, nullptr, DI_NORMAL);
-                        if (ii.hbmMask)  DeleteObject(ii.hbmMask);
-                        if (ii.hbmColor) DeleteObject(ii.hbmColor);
-                    }
-                }
+static void ApplyProfile(const MirrorProfile* p, const WCHAR* key)
+{
+    StringCchCopyW(g_profile.key, ARRAYSIZE(g_profile.key), key);
+    if (ProfileEqual(p, &g_profile.active)) {
+        g_profile.active = *p;
+        return;
+    }
+    if (p->capture != g_profile.active.capture)
+        SetRectEmpty(&g_regionBox);     // back on tiles: repaint them all once
+    g_profile.active = *p;
+    SetFrameClockPeriod();
+    TraceEvent(TRACE_PROFILE, p->frameUs,
+               (uint64_t)p->scaler | (uint64_t)p->capture << 8 | (uint64_t)p->color << 16);
+}
+
+static void SelectProfile(HWND hWnd)
+{
+    MirrorProfile p;
+    ProfileDefault(&p);
+    WCHAR exe[MAX_PATH], cls[64];
+    const WCHAR* key = L"";
+    DWORD pid = 0;
+    if (hWnd && GetWindowThreadProcessId(hWnd, &pid)) {
+        if (GetProcessExeName(pid, exe, MAX_PATH) && LookupProfile(exe, &p))
+            key = exe;
+        else if (GetClassNameW(hWnd, cls, ARRAYSIZE(cls)) && LookupProfile(cls, &p))
+            key = cls;
+    }
+    ApplyProfile(&p, key);
+}
 
-                // Letterbox into the destination
-                RECT dst = ComputeLetterboxRect(srcW, srcH, dstW, dstH);
+static void CALLBACK ForegroundChanged(HWINEVENTHOOK, DWORD, HWND hWnd, LONG idObject, LONG, DWORD, DWORD)
+{
+    if (idObject == OBJID_WINDOW && g_profile.hHook) SelectProfile(hWnd);
+}
 
-                // Black bars
-                HBRUSH hBlack = (HBRUSH)GetStockObject(BLACK_BRUSH);
-                if (dst.top > 0) {
-                    RECT bar = { 0, 0, dstW, dst.top };
-                    FillRect(hdcWnd, &bar, hBlack);
-                }
-                if (dst.bottom < dstH) {
-                    RECT bar = { 0, dst.bottom, dstW, dstH };
-                    FillRect(hdcWnd, &bar, hBlack);
-                }
-                if (dst.left > 0) {
-                    RECT bar = { 0, dst.top, dst.left, dst.bottom };
-                    FillRect(hdcWnd, &bar, hBlack);
-                }
-                if (dst.right < dstW) {
-                    RECT bar = { dst.right, dst.top, dstW, dst.bottom };
-                    FillRect(hdcWnd, &bar, hBlack);
-                }
+void StartProfiles()
+{
+    if (!g_profile.hHook)
+        g_profile.hHook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr,
+                                          ForegroundChanged, 0, 0,
+                                          WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+    SelectProfile(GetForegroundWindow());
+}
 
-                int scaledW = dst.right  - dst.left;
-                int scaledH = dst.bottom - dst.top;
+void StopProfiles()
+{
+    if (g_profile.hHook) {
+        UnhookWinEvent(g_profile.hHook);
+        g_profile.hHook = nullptr;
+    }
+    MirrorProfile p;
+    ProfileDefault(&p);
+    ApplyProfile(&p, L"");
+}
 
-                SetStretchBltMode(hdcWnd, COLORONCOLOR);
-                StretchBlt(hdcWnd, dst.left, dst.top, scaledW, scaledH,
-                           g_hdcMem, 0, 0, srcW, srcH, SRCCOPY);
-            }
+void AppendProfileText(WCHAR* buf, size_t cch)
+{
+    const MirrorProfile& p = g_profile.active;
+    WCHAR line[256];
+    if (!g_profile.hHook) {
+        StringCchCopyW(line, ARRAYSIZE(line), L"  perfil: desligado\n");
+    } else if (!g_profile.key[0]) {
+        StringCchCopyW(line, ARRAYSIZE(line), L"  perfil: predefinido\n");
+    } else {
+        static const WCHAR* scalers[] = { L"por zona", L"n\x00EDtido", L"r\x00E1pido" };
+        static const WCHAR* colors[] = { L"normal", L"mais clara", L"mais contraste" };
+        WCHAR rate[32];
+        if (p.frameUs) StringCchPrintfW(rate, ARRAYSIZE(rate), L"%u fps", (1000000 + p.frameUs / 2) / p.frameUs);
+        else           StringCchCopyW(rate, ARRAYSIZE(rate), L"mirror_fps_ms");
+        StringCchPrintfW(line, ARRAYSIZE(line), L"  perfil: %S%s(%s): %s, filtro %s, %s, cor %s\n",
+            p.preset, p.preset[0] ? L" " : L"", g_profile.key, rate, scalers[p.scaler],
+            p.capture == PROFILE_CAPTURE_FULL ? L"imagem inteira" : L"s\x00F3 o que muda",
+            colors[p.color]);
+    }
+    StringCchCatW(buf, cch, line);
+}
 
-            ReleaseDC(nullptr, hdcScreen);
-            ReleaseDC(hWnd, hdcWnd);
+// � Mirror window proc ������������������������������������������������
+LRESULT CALLBACK MirrorWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    switch (message)
+    {
+    case WM_TIMER:
+        if (wParam == IDT_MIRROR_REFRESH) {
+            OnFrameClockTick(hWnd);
+        } else if (wParam == IDT_CURSOR_REFRESH) {
+            KillTimer(hWnd, IDT_CURSOR_REFRESH);
+            UpdateMirrorCursor(nullptr, FALSE);
         }
         break;
 
+    case WM_MIRRORTICK:
+        OnFrameClockTick(hWnd);
+        break;
+
+    case WM_DPICHANGED:
+        PinWindowOnDpiChange(hWnd, &g_rcSecond, wParam);
+        break;
+
+    case WM_INPUT:
+        NoteRawInput((HRAWINPUT)lParam);
+        UpdateMirrorCursor(nullptr, FALSE);
+        return DefWindowProc(hWnd, message, wParam, lParam);    // frees the raw input
+
     case WM_PAINT:
     {
         PAINTSTRUCT ps;
@@ -1347,7 +5759,8 @@ LRESULT CALLBACK MirrorWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lP
         return 1;
 
     case WM_DESTROY:
-        KillTimer(hWnd, IDT_MIRROR_REFRESH);
+        StopFrameClock();
+        KillTimer(hWnd, IDT_CURSOR_REFRESH);
         FreeMirrorResources();
         break;
 
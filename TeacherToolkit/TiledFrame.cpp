@@ -0,0 +1,172 @@
+// TiledFrame.cpp : linear <-> tiled conversion, change tracking, halving.
+
+#include "TiledFrame.h"
+
+#include <string.h>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TILED_SSE2 1
+#include <emmintrin.h>
+#endif
+
+void TiledFrameInit(TiledFrame* tf, int width, int height)
+{
+    tf->width  = width;
+    tf->height = height;
+    tf->tilesX = (width  + TILED_TILE - 1) / TILED_TILE;
+    tf->tilesY = (height + TILED_TILE - 1) / TILED_TILE;
+    tf->seq = 0;
+    tf->dirtyTiles = 0;
+
+    tf->tiles.assign((size_t)tf->tilesX * tf->tilesY, TiledTile());
+    for (int ty = 0; ty < tf->tilesY; ty++)
+        for (int tx = 0; tx < tf->tilesX; tx++) {
+            TiledTile& t = tf->tiles[(size_t)ty * tf->tilesX + tx];
+            t.width  = (uint8_t)(width  - tx * TILED_TILE < TILED_TILE ? width  - tx * TILED_TILE : TILED_TILE);
+            t.height = (uint8_t)(height - ty * TILED_TILE < TILED_TILE ? height - ty * TILED_TILE : TILED_TILE);
+        }
+
+    // 16 extra pixels so the tiles can start on a cache line
+    tf->storage.assign(tf->tiles.size() * TILED_TILE_PIXELS + 16, 0);
+    uintptr_t base = (uintptr_t)tf->storage.data();
+    tf->pixels = tf->storage.data() + ((64 - (base & 63)) & 63) / sizeof(uint32_t);
+}
+
+void TiledFrameFree(TiledFrame* tf)
+{
+    std::vector<TiledTile>().swap(tf->tiles);
+    std::vector<uint32_t>().swap(tf->storage);
+    tf->pixels = nullptr;
+    tf->width = tf->height = tf->tilesX = tf->tilesY = 0;
+    tf->seq = 0;
+    tf->dirtyTiles = 0;
+}
+
+// True if n pixels at src differ from those at dst (16-byte aligned, as
+// every tile row is). Only reads.
+static bool RowDiffers(const uint32_t* dst, const uint32_t* src, int n)
+{
+    int x = 0;
+#ifdef TILED_SSE2
+    __m128i acc = _mm_setzero_si128();
+    for (; x + 8 <= n; x += 8) {
+        __m128i a = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + x)),
+                                  _mm_load_si128((const __m128i*)(dst + x)));
+        __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + x + 4)),
+                                  _mm_load_si128((const __m128i*)(dst + x + 4)));
+        acc = _mm_or_si128(acc, _mm_or_si128(a, b));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) != 0xFFFF)
+        return true;
+#endif
+    for (; x < n; x++)
+        if (src[x] != dst[x]) return true;
+    return false;
+}
+
+static void CopyRow(uint32_t* dst, const uint32_t* src, int n)
+{
+    int x = 0;
+#ifdef TILED_SSE2
+    for (; x + 8 <= n; x += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + x));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + x + 4));
+        _mm_storeu_si128((__m128i*)(dst + x), a);
+        _mm_storeu_si128((__m128i*)(dst + x + 4), b);
+    }
+#endif
+    for (; x < n; x++) dst[x] = src[x];
+}
+
+int TiledFrameLoad(TiledFrame* tf, const uint32_t* frame, int stride, uint64_t timeUs)
+{
+    bool first = tf->seq == 0;
+    tf->seq++;
+    tf->dirtyTiles = 0;
+
+    // Row by row through the source, so it is read strictly in order;
+    // a tile row's tiles are written side by side. Unchanged rows are
+    // only compared, which keeps the tile's cache lines clean
+    for (int ty = 0; ty < tf->tilesY; ty++) {
+        TiledTile* row = &tf->tiles[(size_t)ty * tf->tilesX];
+        for (int tx = 0; tx < tf->tilesX; tx++) row[tx].dirty = first;
+
+        int rows = row[0].height;
+        for (int y = 0; y < rows; y++) {
+            const uint32_t* src = frame + (size_t)(ty * TILED_TILE + y) * stride;
+            for (int tx = 0; tx < tf->tilesX; tx++) {
+                uint32_t* dst = TiledTilePixels(tf, tx, ty) + y * TILED_TILE;
+                const uint32_t* s = src + tx * TILED_TILE;
+                if (first || RowDiffers(dst, s, row[tx].width)) {
+                    CopyRow(dst, s, row[tx].width);
+                    row[tx].dirty = 1;
+                }
+            }
+        }
+
+        for (int tx = 0; tx < tf->tilesX; tx++) {
+            TiledTile& t = row[tx];
+            if (!t.dirty) continue;
+            t.hash = RegionHashTile(TiledTilePixels(tf, tx, ty), TILED_TILE, 0, 0, t.width, t.height);
+            t.changedUs = timeUs;
+            t.changedSeq = tf->seq;
+            tf->dirtyTiles++;
+        }
+    }
+    return tf->dirtyTiles;
+}
+
+void TiledFrameStore(const TiledFrame* tf, uint32_t* frame, int stride, bool dirtyOnly)
+{
+    for (int ty = 0; ty < tf->tilesY; ty++) {
+        const TiledTile* row = &tf->tiles[(size_t)ty * tf->tilesX];
+        for (int y = 0; y < row[0].height; y++) {
+            uint32_t* dst = frame + (size_t)(ty * TILED_TILE + y) * stride;
+            for (int tx = 0; tx < tf->tilesX; tx++) {
+                if (dirtyOnly && !row[tx].dirty) continue;
+                CopyRow(dst + tx * TILED_TILE, TiledTilePixels(tf, tx, ty) + y * TILED_TILE, row[tx].width);
+            }
+        }
+    }
+}
+
+// Per byte (a + b + 1) / 2, as _mm_avg_epu8
+static inline uint32_t Avg(uint32_t a, uint32_t b)
+{
+    return (a | b) - (((a ^ b) >> 1) & 0x7F7F7F7Fu);
+}
+
+void TiledHalveBlock(const uint32_t* src, int srcStride, int w, int h, uint32_t* dst, int dstStride)
+{
+    int outW = w / 2, outH = h / 2;
+    for (int y = 0; y < outH; y++) {
+        const uint32_t* r0 = src + (size_t)(2 * y) * srcStride;
+        const uint32_t* r1 = r0 + srcStride;
+        uint32_t* out = dst + (size_t)y * dstStride;
+        int x = 0;
+#ifdef TILED_SSE2
+        for (; x + 4 <= outW; x += 4) {
+            __m128i lo = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(r0 + 2 * x)),
+                                      _mm_loadu_si128((const __m128i*)(r1 + 2 * x)));
+            __m128i hi = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(r0 + 2 * x + 4)),
+                                      _mm_loadu_si128((const __m128i*)(r1 + 2 * x + 4)));
+            __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd  = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_si128((__m128i*)(out + x), _mm_avg_epu8(_mm_castps_si128(even), _mm_castps_si128(odd)));
+        }
+#endif
+        for (; x < outW; x++)
+            out[x] = Avg(Avg(r0[2 * x], r1[2 * x]), Avg(r0[2 * x + 1], r1[2 * x + 1]));
+    }
+}
+
+void TiledFrameHalve(const TiledFrame* tf, uint32_t* dst, int dstStride, bool dirtyOnly)
+{
+    for (int ty = 0; ty < tf->tilesY; ty++)
+        for (int tx = 0; tx < tf->tilesX; tx++) {
+            const TiledTile* t = TiledTileAt(tf, tx, ty);
+            if (dirtyOnly && !t->dirty) continue;
+            TiledHalveBlock(TiledTilePixels(tf, tx, ty), TILED_TILE, t->width, t->height,
+                            dst + (size_t)ty * (TILED_TILE / 2) * dstStride + tx * (TILED_TILE / 2), dstStride);
+        }
+}
@@ -0,0 +1,82 @@
+// TiledFrame.h : frame stored as contiguous 64x64 tiles with per-tile state.
+//
+// In the linear capture bitmap one 64x64 tile spans 64 rows, each on its
+// own cache lines and, at 4K (15 KB per row), on up to 64 different pages.
+// Anything that works tile by tile (change detection, repainting or
+// scaling only what changed) pays for that in cache and TLB misses. Here
+// each tile's 16 KB of pixels are contiguous, tiles in row-major order, so
+// a tile is four pages at most and is walked strictly in order.
+//
+// Conversion happens at the boundaries: TiledFrameLoad takes a linear
+// frame after capture and compares it with the stored tiles while copying,
+// so the diff costs no extra pass; TiledFrameStore writes (changed) tiles
+// back to a linear bitmap for presentation. Both use SSE2 where available.
+// Edge tiles are padded to the full size; the padding is kept at zero.
+// Portable: no Windows headers.
+//
+// Not part of the app build: the mirror keeps its linear DIB, which GDI
+// blits from and PixelPipeline already hashes tile by tile. tools/TileBench
+// builds this to compare the two layouts.
+
+#pragma once
+
+#include "RegionClassify.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define TILED_TILE          REGION_TILE
+#define TILED_TILE_PIXELS   (TILED_TILE * TILED_TILE)
+
+struct TiledTile {
+    uint64_t hash;              // RegionHashTile of the tile's pixels
+    uint64_t changedUs;         // load time of the last change
+    uint32_t changedSeq;        // load number of the last change
+    uint8_t  dirty;             // changed in the latest load
+    uint8_t  width, height;     // valid pixels, less than TILED_TILE on the right/bottom edge
+    uint8_t  reserved;
+};
+
+struct TiledFrame {
+    int width, height;
+    int tilesX, tilesY;
+    uint32_t seq;               // loads so far
+    int dirtyTiles;             // in the latest load
+    std::vector<TiledTile> tiles;
+    std::vector<uint32_t> storage;
+    uint32_t* pixels;           // into storage, 64-byte aligned, TILED_TILE_PIXELS per tile
+};
+
+void TiledFrameInit(TiledFrame* tf, int width, int height);
+void TiledFrameFree(TiledFrame* tf);
+
+// Copies a linear 32bpp frame (stride in pixels) into the tiles and marks
+// the ones whose content differs; the first load after Init marks all.
+// Hashes are only recomputed for changed tiles. Returns the number of
+// dirty tiles.
+int TiledFrameLoad(TiledFrame* tf, const uint32_t* frame, int stride, uint64_t timeUs);
+
+// Writes the tiles back to a linear frame of the same size; with
+// dirtyOnly, only those changed in the latest load.
+void TiledFrameStore(const TiledFrame* tf, uint32_t* frame, int stride, bool dirtyOnly);
+
+// Half-size box filter (each output pixel the average of 2x2) into a
+// linear frame of (width / 2) x (height / 2); with dirtyOnly, only the
+// parts under changed tiles. Works a tile at a time, in tile memory order.
+void TiledFrameHalve(const TiledFrame* tf, uint32_t* dst, int dstStride, bool dirtyOnly);
+
+// The same filter over a w x h block of any 32bpp layout, writing
+// (w / 2) x (h / 2) pixels at dst
+void TiledHalveBlock(const uint32_t* src, int srcStride, int w, int h, uint32_t* dst, int dstStride);
+
+inline const TiledTile* TiledTileAt(const TiledFrame* tf, int tx, int ty)
+{
+    return &tf->tiles[(size_t)ty * tf->tilesX + tx];
+}
+
+// Pixels of one tile, TILED_TILE per row
+inline uint32_t* TiledTilePixels(const TiledFrame* tf, int tx, int ty)
+{
+    return tf->pixels + ((size_t)ty * tf->tilesX + tx) * TILED_TILE_PIXELS;
+}
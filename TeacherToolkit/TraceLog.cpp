@@ -0,0 +1,310 @@
+// TraceLog.cpp : per-thread event rings and the rotating file writer.
+
+#include "TraceLog.h"
+
+#include <atomic>
+#include <chrono>
+#include <string.h>
+
+#ifdef _WIN32
+#include <wchar.h>
+#endif
+
+const TraceEventInfo g_traceEventInfo[TRACE_EVENT_COUNT] = {
+    { "",              TRACE_KIND_META,    nullptr,     nullptr },
+    { "thread_name",   TRACE_KIND_META,    nullptr,     "name" },
+    { "dropped",       TRACE_KIND_INSTANT, "count",     nullptr },
+    { "display_change",TRACE_KIND_INSTANT, "width",     "height" },
+    { "monitor_check", TRACE_KIND_INSTANT, "second",    "projecting" },
+    { "extend",        TRACE_KIND_SPAN,    nullptr,     "ok" },
+    { "extend_result", TRACE_KIND_INSTANT, "projecting","retries" },
+    { "mirror_start",  TRACE_KIND_INSTANT, "width",     "height" },
+    { "mirror_stop",   TRACE_KIND_INSTANT, nullptr,     nullptr },
+    { "frame",         TRACE_KIND_SPAN,    nullptr,     "frame" },
+    { "evict",         TRACE_KIND_INSTANT, nullptr,     "hwnd" },
+    { "update_check",  TRACE_KIND_SPAN,    nullptr,     "available" },
+    { "config_reload", TRACE_KIND_INSTANT, nullptr,     nullptr },
+    { "pause",         TRACE_KIND_INSTANT, nullptr,     nullptr },
+    { "resume",        TRACE_KIND_INSTANT, nullptr,     nullptr },
+    { "warp_build",    TRACE_KIND_SPAN,    nullptr,     "pixels" },
+    { "idle_trim",     TRACE_KIND_INSTANT, "workingSetKB", "privateKB" },
+    { "suspend",       TRACE_KIND_INSTANT, "reasons",   nullptr },
+    { "replay_encode", TRACE_KIND_SPAN,    nullptr,     "tiles" },
+    { "replay_show",   TRACE_KIND_INSTANT, "ageSeconds", nullptr },
+    { "frame_clock",   TRACE_KIND_INSTANT, "periodUs",  "highRes" },
+    { "dpi_change",    TRACE_KIND_INSTANT, "dpi",       "hwnd" },
+    { "input_latency", TRACE_KIND_INSTANT, "kind",      "us" },
+    { "slide",         TRACE_KIND_INSTANT, "verdict",   "slide" },
+    { "slide_encode",  TRACE_KIND_SPAN,    nullptr,     "slide" },
+    { "profile",       TRACE_KIND_INSTANT, "frameUs",   "settings" },
+};
+
+// Single producer (the owning thread), single consumer (the flusher).
+struct TraceRing {
+    std::atomic<uint32_t> head;         // next slot to write, owner only
+    std::atomic<uint32_t> tail;         // next slot to read, flusher only
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint64_t> name;         // packed TraceThreadName, repeated in each file
+    std::atomic<bool>     owned;        // a live thread writes here
+    TraceRecord           events[TRACE_RING_EVENTS];
+};
+
+static TraceRing               g_rings[TRACE_MAX_THREADS];
+static std::atomic<int>        g_ringCount{ 0 };       // slots ever handed out
+static std::atomic<uint32_t>   g_unringedDrops{ 0 };   // threads beyond TRACE_MAX_THREADS
+static std::atomic<bool>       g_enabled{ false };
+static thread_local int        t_ringIndex = -1;
+
+static std::chrono::steady_clock::time_point g_start;
+static uint64_t                g_startUnixMicros;
+
+void TraceInit()
+{
+    g_start = std::chrono::steady_clock::now();
+    g_startUnixMicros = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    g_enabled.store(true, std::memory_order_relaxed);
+}
+
+void TraceSetEnabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool TraceIsEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t TraceNow()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_start).count();
+}
+
+static void Push(uint16_t id, uint64_t ts, uint32_t a, uint64_t b);
+
+// Hands the ring back when its thread exits, so short-lived threads (the
+// startup worker, slide encoders) do not use up TRACE_MAX_THREADS. The
+// release store pairs with the next owner's acquire, which then carries on
+// from the old head while the flusher drains what is left.
+struct RingLease {
+    int index = -1;
+    ~RingLease()
+    {
+        if (index < 0) return;
+        TraceRing* ring = &g_rings[index];
+        if (ring->name.exchange(0, std::memory_order_relaxed))
+            Push(TRACE_THREAD_NAME, TraceNow(), 0, 0);      // unnamed from here on
+        t_ringIndex = TRACE_MAX_THREADS;                    // later events are only counted
+        ring->owned.store(false, std::memory_order_release);
+    }
+};
+
+static TraceRing* GetThreadRing()
+{
+    if (t_ringIndex < 0) {
+        t_ringIndex = TRACE_MAX_THREADS;
+        for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+            bool expected = false;
+            if (g_rings[i].owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                t_ringIndex = i;
+                break;
+            }
+        }
+        if (t_ringIndex < TRACE_MAX_THREADS) {
+            thread_local RingLease lease;
+            lease.index = t_ringIndex;
+            int count = g_ringCount.load(std::memory_order_relaxed);
+            while (count <= t_ringIndex &&
+                   !g_ringCount.compare_exchange_weak(count, t_ringIndex + 1, std::memory_order_relaxed)) {
+            }
+        }
+    }
+    return (t_ringIndex < TRACE_MAX_THREADS) ? &g_rings[t_ringIndex] : nullptr;
+}
+
+static void Push(uint16_t id, uint64_t ts, uint32_t a, uint64_t b)
+{
+    TraceRing* ring = GetThreadRing();
+    if (!ring) {
+        g_unringedDrops.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    uint32_t tail = ring->tail.load(std::memory_order_acquire);
+    if (head - tail >= TRACE_RING_EVENTS) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    TraceRecord* r = &ring->events[head & (TRACE_RING_EVENTS - 1)];
+    r->ts = ts;
+    r->id = id;
+    r->thread = (uint8_t)t_ringIndex;
+    r->reserved = 0;
+    r->a = a;
+    r->b = b;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void TraceEvent(uint16_t id, uint32_t a, uint64_t b)
+{
+    if (!g_enabled.load(std::memory_order_relaxed)) return;
+    Push(id, TraceNow(), a, b);
+}
+
+void TraceSpan(uint16_t id, uint64_t startNs, uint64_t b)
+{
+    if (!g_enabled.load(std::memory_order_relaxed)) return;
+    uint64_t durUs = (TraceNow() - startNs) / 1000;
+    Push(id, startNs, durUs > UINT32_MAX ? UINT32_MAX : (uint32_t)durUs, b);
+}
+
+void TraceThreadName(const char* name)
+{
+    uint64_t packed = 0;
+    for (int i = 0; i < 8 && name[i]; i++)
+        packed |= (uint64_t)(uint8_t)name[i] << (8 * i);
+
+    TraceRing* ring = GetThreadRing();
+    if (ring) ring->name.store(packed, std::memory_order_relaxed);
+    Push(TRACE_THREAD_NAME, TraceNow(), 0, packed);
+}
+
+// � Rotating trace file �����������������������������������������������
+
+static FILE* OpenForWrite(const TracePathChar* path)
+{
+    FILE* fp = nullptr;
+#ifdef _WIN32
+    if (_wfopen_s(&fp, path, L"wb") != 0) fp = nullptr;
+#else
+    fp = fopen(path, "wb");
+#endif
+    return fp;
+}
+
+static void RotateOut(const TracePathChar* path, const TracePathChar* oldPath)
+{
+#ifdef _WIN32
+    _wremove(oldPath);
+    _wrename(path, oldPath);
+#else
+    remove(oldPath);
+    rename(path, oldPath);
+#endif
+}
+
+static bool StartFile(TraceFile* f)
+{
+    RotateOut(f->path, f->oldPath);
+    f->fp = OpenForWrite(f->path);
+    if (!f->fp) return false;
+
+    TraceFileHeader header = {};
+    memcpy(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_FILE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    header.ticksPerSecond = 1000000000ull;
+    header.startUnixMicros = g_startUnixMicros;
+    f->written = fwrite(&header, 1, sizeof(header), f->fp);
+    if (f->written != sizeof(header)) return false;
+
+    // Each part must decode on its own, so restate the thread names
+    int rings = g_ringCount.load(std::memory_order_relaxed);
+    if (rings > TRACE_MAX_THREADS) rings = TRACE_MAX_THREADS;
+    for (int i = 0; i < rings; i++) {
+        uint64_t name = g_rings[i].name.load(std::memory_order_relaxed);
+        if (!name) continue;
+        TraceRecord r = { TraceNow(), TRACE_THREAD_NAME, (uint8_t)i, 0, 0, name };
+        if (fwrite(&r, sizeof(r), 1, f->fp) == 1)
+            f->written += sizeof(r);
+    }
+    return true;
+}
+
+bool TraceFileOpen(TraceFile* f, const TracePathChar* path, uint64_t capBytes)
+{
+    memset(f, 0, sizeof(*f));
+#ifdef _WIN32
+    size_t len = wcslen(path);
+#else
+    size_t len = strlen(path);
+#endif
+    if (len + 3 > TRACE_MAX_PATH) return false;
+
+    memcpy(f->path, path, (len + 1) * sizeof(TracePathChar));
+    memcpy(f->oldPath, path, len * sizeof(TracePathChar));
+    f->oldPath[len]     = '.';
+    f->oldPath[len + 1] = '1';
+    f->oldPath[len + 2] = '\0';
+
+    f->maxBytes = capBytes / 2;
+    if (f->maxBytes < sizeof(TraceFileHeader) + 64 * sizeof(TraceRecord))
+        f->maxBytes = sizeof(TraceFileHeader) + 64 * sizeof(TraceRecord);
+    return StartFile(f);
+}
+
+void TraceFileClose(TraceFile* f)
+{
+    if (f->fp) {
+        fclose(f->fp);
+        f->fp = nullptr;
+    }
+}
+
+static bool WriteRecords(TraceFile* f, const TraceRecord* records, size_t count)
+{
+    size_t bytes = count * sizeof(TraceRecord);
+    if (f->written + bytes > f->maxBytes) {
+        TraceFileClose(f);
+        if (!StartFile(f)) return false;
+    }
+    if (fwrite(records, sizeof(TraceRecord), count, f->fp) != count)
+        return false;
+    f->written += bytes;
+    return true;
+}
+
+size_t TraceFlush(TraceFile* f)
+{
+    if (!f->fp) return 0;
+
+    size_t total = 0;
+    int rings = g_ringCount.load(std::memory_order_relaxed);
+    if (rings > TRACE_MAX_THREADS) rings = TRACE_MAX_THREADS;
+
+    for (int i = 0; i < rings; i++) {
+        TraceRing* ring = &g_rings[i];
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+
+        // Write the readable part in at most two contiguous runs
+        while (tail != head) {
+            uint32_t start = tail & (TRACE_RING_EVENTS - 1);
+            uint32_t run = head - tail;
+            if (run > TRACE_RING_EVENTS - start) run = TRACE_RING_EVENTS - start;
+            if (!WriteRecords(f, &ring->events[start], run)) break;
+            tail += run;
+            total += run;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+
+        uint32_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped) {
+            TraceRecord r = { TraceNow(), TRACE_DROPPED, (uint8_t)i, 0, dropped, 0 };
+            if (WriteRecords(f, &r, 1)) total++;
+        }
+    }
+
+    uint32_t lost = g_unringedDrops.exchange(0, std::memory_order_relaxed);
+    if (lost) {
+        TraceRecord r = { TraceNow(), TRACE_DROPPED, TRACE_MAX_THREADS, 0, lost, 0 };
+        if (WriteRecords(f, &r, 1)) total++;
+    }
+
+    fflush(f->fp);
+    return total;
+}
@@ -0,0 +1,126 @@
+// TraceLog.h : low-overhead binary event tracer for field diagnostics.
+//
+// Each thread that emits events gets its own single-producer ring, so
+// recording is a timestamp read plus a 24-byte store: no locks, no
+// allocation, no system calls. When a ring is full the event is dropped
+// and counted rather than waiting. At most TRACE_MAX_THREADS threads hold a
+// ring at once; a thread's ring goes back to the pool when it exits (what
+// it left unread is still flushed), and events from threads beyond the
+// limit are only counted. A background thread drains the rings into a
+// size-capped pair of rotating files (TraceFlush); tools/TraceDecode turns
+// them into text or Chrome trace JSON.
+// Portable: no Windows headers.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define TRACE_MAX_THREADS   16
+#define TRACE_RING_EVENTS   1024        // per thread, power of two
+
+#define TRACE_FILE_MAGIC    "TTTRACE1"
+#define TRACE_FILE_VERSION  1
+
+enum TraceEventId : uint16_t {
+    TRACE_THREAD_NAME = 1,      // b = up to 8 chars of the name
+    TRACE_DROPPED,              // a = events lost since the last flush
+    TRACE_DISPLAY_CHANGE,       // a = width, b = height (WM_DISPLAYCHANGE)
+    TRACE_MONITOR_CHECK,        // a = second monitor present, b = projecting
+    TRACE_EXTEND,               // span; b = SetExtendMode succeeded
+    TRACE_EXTEND_RESULT,        // a = projector came up, b = retries
+    TRACE_MIRROR_START,         // a = width, b = height of the projector
+    TRACE_MIRROR_STOP,
+    TRACE_FRAME,                // span; b = frame number
+    TRACE_EVICT,                // b = window handle moved off the projector
+    TRACE_UPDATE_CHECK,         // span; b = update available
+    TRACE_CONFIG_RELOAD,
+    TRACE_PAUSE,
+    TRACE_RESUME,
+    TRACE_WARP_BUILD,           // span; b = output pixels remapped
+    TRACE_IDLE_TRIM,            // a = working set KB, b = private KB afterwards
+    TRACE_SUSPEND,              // a = suspension reasons now in effect, 0 = resumed
+    TRACE_REPLAY_ENCODE,        // span; b = tiles compressed into the replay history
+    TRACE_REPLAY_SHOW,          // a = age in seconds of the frame put on the projector
+    TRACE_FRAME_CLOCK,          // a = frame period in us, b = 1 if high-resolution
+    TRACE_DPI_CHANGE,           // a = new DPI, b = window (WM_DPICHANGED)
+    TRACE_INPUT_LATENCY,        // a = LatencyKind, b = input to present, us
+    TRACE_SLIDE,                // a = SlideVerdict, b = slide number
+    TRACE_SLIDE_ENCODE,         // span; b = slide number written
+    TRACE_PROFILE,              // a = frame period in us, b = scaler | capture << 8 | color << 16
+    TRACE_EVENT_COUNT
+};
+
+enum TraceEventKind : uint8_t {
+    TRACE_KIND_INSTANT,
+    TRACE_KIND_SPAN,            // ts is the start, a is the duration in us
+    TRACE_KIND_META,
+};
+
+struct TraceEventInfo {
+    const char*    name;
+    TraceEventKind kind;
+    const char*    aName;       // nullptr = unused
+    const char*    bName;
+};
+
+// Indexed by TraceEventId; shared with the decoder.
+extern const TraceEventInfo g_traceEventInfo[TRACE_EVENT_COUNT];
+
+// On-disk layout (little-endian, packed as declared)
+struct TraceRecord {
+    uint64_t ts;                // ns since TraceInit
+    uint16_t id;
+    uint8_t  thread;            // ring slot
+    uint8_t  reserved;
+    uint32_t a;
+    uint64_t b;
+};
+static_assert(sizeof(TraceRecord) == 24, "TraceRecord must stay 24 bytes");
+
+struct TraceFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t ticksPerSecond;    // unit of TraceRecord::ts
+    uint64_t startUnixMicros;   // wall clock at TraceInit
+};
+static_assert(sizeof(TraceFileHeader) == 32, "TraceFileHeader must stay 32 bytes");
+
+void     TraceInit();
+void     TraceSetEnabled(bool enabled);
+bool     TraceIsEnabled();
+
+uint64_t TraceNow();            // ns since TraceInit
+void     TraceEvent(uint16_t id, uint32_t a = 0, uint64_t b = 0);
+void     TraceSpan(uint16_t id, uint64_t startNs, uint64_t b = 0);
+void     TraceThreadName(const char* name);
+
+// � Rotating trace file �����������������������������������������������
+
+#ifdef _WIN32
+typedef wchar_t TracePathChar;
+#else
+typedef char TracePathChar;
+#endif
+
+#define TRACE_MAX_PATH  300
+
+// Two files of at most capBytes / 2 each: <path> is being written, <path>.1
+// holds the previous part. Opening rotates whatever is at <path> (the last
+// run) into <path>.1 first, so the run that just stuttered survives a restart.
+struct TraceFile {
+    FILE*         fp;
+    uint64_t      written;
+    uint64_t      maxBytes;
+    TracePathChar path[TRACE_MAX_PATH];
+    TracePathChar oldPath[TRACE_MAX_PATH];
+};
+
+bool TraceFileOpen(TraceFile* f, const TracePathChar* path, uint64_t capBytes);
+void TraceFileClose(TraceFile* f);
+
+// Drains every ring into f. Call from one thread only. Returns the number
+// of records written.
+size_t TraceFlush(TraceFile* f);
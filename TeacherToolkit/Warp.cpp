@@ -0,0 +1,237 @@
+// Warp.cpp : remap table construction and bilinear application.
+
+#include "Warp.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WARP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static const float IDENTITY_CORNERS[8] = { 0, 0, 1, 0, 1, 1, 0, 1 };
+
+void WarpParamsIdentity(WarpParams* params)
+{
+    memcpy(params->corners, IDENTITY_CORNERS, sizeof(IDENTITY_CORNERS));
+    params->rotateDeg = 0.0f;
+}
+
+bool WarpIsIdentity(const WarpParams* params)
+{
+    return memcmp(params->corners, IDENTITY_CORNERS, sizeof(IDENTITY_CORNERS)) == 0 &&
+           params->rotateDeg == 0.0f;
+}
+
+bool WarpParseCorners(WarpParams* params, const char* text)
+{
+    float v[8];
+    const char* p = text;
+    for (int i = 0; i < 8; i++) {
+        char* end = nullptr;
+        v[i] = strtof(p, &end);
+        if (end == p || v[i] < -1.0f || v[i] > 2.0f) return false;
+        p = end;
+        while (*p == ' ' || *p == ',' || *p == ';') p++;
+    }
+    memcpy(params->corners, v, sizeof(v));
+    return true;
+}
+
+// Unit square -> quad (Heckbert), as a 3x3 matrix acting on (u, v, 1).
+static bool SquareToQuad(const double* q, double* m)
+{
+    double x0 = q[0], y0 = q[1], x1 = q[2], y1 = q[3];
+    double x2 = q[4], y2 = q[5], x3 = q[6], y3 = q[7];
+    double dx3 = x0 - x1 + x2 - x3, dy3 = y0 - y1 + y2 - y3;
+    double g = 0.0, h = 0.0;
+
+    if (fabs(dx3) > 1e-12 || fabs(dy3) > 1e-12) {
+        double dx1 = x1 - x2, dx2 = x3 - x2, dy1 = y1 - y2, dy2 = y3 - y2;
+        double den = dx1 * dy2 - dx2 * dy1;
+        if (fabs(den) < 1e-12) return false;
+        g = (dx3 * dy2 - dx2 * dy3) / den;
+        h = (dx1 * dy3 - dx3 * dy1) / den;
+    }
+    m[0] = x1 - x0 + g * x1;  m[1] = x3 - x0 + h * x3;  m[2] = x0;
+    m[3] = y1 - y0 + g * y1;  m[4] = y3 - y0 + h * y3;  m[5] = y0;
+    m[6] = g;                 m[7] = h;                 m[8] = 1.0;
+    return true;
+}
+
+static bool Invert3x3(const double* m, double* inv)
+{
+    double c0 = m[4] * m[8] - m[5] * m[7];
+    double c1 = m[5] * m[6] - m[3] * m[8];
+    double c2 = m[3] * m[7] - m[4] * m[6];
+    double det = m[0] * c0 + m[1] * c1 + m[2] * c2;
+    if (fabs(det) < 1e-12) return false;
+    double r = 1.0 / det;
+    inv[0] = c0 * r; inv[1] = (m[2] * m[7] - m[1] * m[8]) * r; inv[2] = (m[1] * m[5] - m[2] * m[4]) * r;
+    inv[3] = c1 * r; inv[4] = (m[0] * m[8] - m[2] * m[6]) * r; inv[5] = (m[2] * m[3] - m[0] * m[5]) * r;
+    inv[6] = c2 * r; inv[7] = (m[1] * m[6] - m[0] * m[7]) * r; inv[8] = (m[0] * m[4] - m[1] * m[3]) * r;
+    return true;
+}
+
+bool WarpIsReady(const WarpMap* map)
+{
+    return !map->table.empty();
+}
+
+void WarpFree(WarpMap* map)
+{
+    std::vector<uint32_t>().swap(map->table);
+    map->srcW = map->srcH = map->dstW = map->dstH = 0;
+}
+
+bool WarpBuild(WarpMap* map, const WarpParams* params, int srcW, int srcH, int dstW, int dstH,
+               int boxLeft, int boxTop, int boxRight, int boxBottom)
+{
+    if (map->srcW == srcW && map->srcH == srcH && map->dstW == dstW && map->dstH == dstH &&
+        map->boxLeft == boxLeft && map->boxTop == boxTop &&
+        map->boxRight == boxRight && map->boxBottom == boxBottom &&
+        memcmp(&map->params, params, sizeof(WarpParams)) == 0)
+        return false;
+
+    // Remember the inputs even if they cannot be warped, so a bad
+    // configuration is rejected once rather than on every frame
+    std::vector<uint32_t>().swap(map->table);
+    map->srcW = srcW;  map->srcH = srcH;
+    map->dstW = dstW;  map->dstH = dstH;
+    map->boxLeft = boxLeft;   map->boxTop = boxTop;
+    map->boxRight = boxRight; map->boxBottom = boxBottom;
+    map->params = *params;
+
+    int boxW = boxRight - boxLeft, boxH = boxBottom - boxTop;
+    if (srcW < 2 || srcH < 2 || srcW > WARP_MAX_SOURCE || srcH > WARP_MAX_SOURCE ||
+        dstW <= 0 || dstH <= 0 || boxW <= 0 || boxH <= 0)
+        return true;
+
+    double quad[8], m[9], inv[9];
+    for (int i = 0; i < 8; i++) quad[i] = params->corners[i];
+    if (!SquareToQuad(quad, m) || !Invert3x3(m, inv))
+        return true;
+
+    map->table.resize((size_t)dstW * dstH);
+
+    const double pi = 3.14159265358979323846;
+    double angle = -params->rotateDeg * pi / 180.0;     // inverse rotation
+    double cs = cos(angle), sn = sin(angle);
+    double cx = dstW * 0.5, cy = dstH * 0.5;
+    double scaleX = (double)srcW / boxW, scaleY = (double)srcH / boxH;
+    int maxX = (srcW - 1) * 16, maxY = (srcH - 1) * 16;
+
+    uint32_t* out = map->table.data();
+    for (int y = 0; y < dstH; y++) {
+        for (int x = 0; x < dstW; x++) {
+            // Output pixel centre -> undo rotation -> normalized -> undo perspective
+            double px = x + 0.5 - cx, py = y + 0.5 - cy;
+            double rx = (px * cs - py * sn + cx) / dstW;
+            double ry = (px * sn + py * cs + cy) / dstH;
+            double w = inv[6] * rx + inv[7] * ry + inv[8];
+            uint32_t entry = WARP_BLACK;
+            if (w > 1e-9) {
+                double u = (inv[0] * rx + inv[1] * ry + inv[2]) / w * dstW;
+                double v = (inv[3] * rx + inv[4] * ry + inv[5]) / w * dstH;
+                // ...then the letterbox
+                if (u >= boxLeft && u < boxRight && v >= boxTop && v < boxBottom) {
+                    double sx = (u - boxLeft) * scaleX - 0.5;
+                    double sy = (v - boxTop) * scaleY - 0.5;
+                    int fx = (int)floor(sx * 16.0 + 0.5);
+                    int fy = (int)floor(sy * 16.0 + 0.5);
+                    fx = fx < 0 ? 0 : (fx > maxX ? maxX : fx);
+                    fy = fy < 0 ? 0 : (fy > maxY ? maxY : fy);
+                    entry = (uint32_t)fx | ((uint32_t)fy << 16);
+                }
+            }
+            *out++ = entry;
+        }
+    }
+    return true;
+}
+
+// One bilinear sample with 4-bit weights. Entries on the last source row or
+// column have a zero weight towards the missing neighbour, which is then
+// clamped instead of read.
+static inline uint32_t SampleScalar(const uint32_t* src, int stride, int srcW, int srcH, uint32_t entry)
+{
+    int fx = entry & 0xF, fy = (entry >> 16) & 0xF;
+    int ix = (entry >> 4) & 0xFFF, iy = (entry >> 20) & 0xFFF;
+    const uint32_t* p = src + (size_t)iy * stride + ix;
+    int dx = ix + 1 < srcW ? 1 : 0;
+    int dy = iy + 1 < srcH ? stride : 0;
+    uint32_t w00 = (16 - fx) * (16 - fy), w01 = fx * (16 - fy);
+    uint32_t w10 = (16 - fx) * fy,        w11 = fx * fy;
+    uint32_t out = 0xFF000000u;
+    for (int shift = 0; shift < 24; shift += 8) {
+        uint32_t c = ((p[0] >> shift) & 0xFF) * w00 + ((p[dx] >> shift) & 0xFF) * w01 +
+                     ((p[dy] >> shift) & 0xFF) * w10 + ((p[dy + dx] >> shift) & 0xFF) * w11;
+        out |= ((c + 128) >> 8) << shift;
+    }
+    return out;
+}
+
+void WarpApplyScalar(const WarpMap* map, const uint32_t* src, int srcStride, uint32_t* dst, int dstStride)
+{
+    if (!WarpIsReady(map)) return;
+    const uint32_t* table = map->table.data();
+
+    for (int y = 0; y < map->dstH; y++) {
+        const uint32_t* row = table + (size_t)y * map->dstW;
+        uint32_t* out = dst + (size_t)y * dstStride;
+        for (int x = 0; x < map->dstW; x++) {
+            uint32_t entry = row[x];
+            out[x] = entry == WARP_BLACK ? 0xFF000000u : SampleScalar(src, srcStride, map->srcW, map->srcH, entry);
+        }
+    }
+}
+
+void WarpApply(const WarpMap* map, const uint32_t* src, int srcStride, uint32_t* dst, int dstStride)
+{
+#ifndef WARP_SSE2
+    WarpApplyScalar(map, src, srcStride, dst, dstStride);
+#else
+    if (!WarpIsReady(map)) return;
+    const uint32_t* table = map->table.data();
+    const uint32_t lastX = (uint32_t)(map->srcW - 1) << 4, lastY = (uint32_t)(map->srcH - 1) << 4;
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i sixteen = _mm_set1_epi16(16);
+    const __m128i round = _mm_set1_epi16(128);
+
+    for (int y = 0; y < map->dstH; y++) {
+        const uint32_t* row = table + (size_t)y * map->dstW;
+        uint32_t* out = dst + (size_t)y * dstStride;
+        for (int x = 0; x < map->dstW; x++) {
+            uint32_t entry = row[x];
+            if (entry == WARP_BLACK) { out[x] = 0xFF000000u; continue; }
+            if ((entry & 0xFFF0) >= lastX || (entry >> 16 & 0xFFF0) >= lastY) {
+                out[x] = SampleScalar(src, srcStride, map->srcW, map->srcH, entry);
+                continue;
+            }
+            int fx = entry & 0xF, fy = (entry >> 16) & 0xF;
+            const uint32_t* p = src + (size_t)((entry >> 20) & 0xFFF) * srcStride + ((entry >> 4) & 0xFFF);
+
+            // [p00 | p01] and [p10 | p11] as 16-bit lanes
+            __m128i top = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), zero);
+            __m128i bot = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + srcStride)), zero);
+
+            // Horizontal: (16 - fx) on the left pixel, fx on the right one
+            __m128i wx = _mm_unpacklo_epi64(_mm_sub_epi16(sixteen, _mm_set1_epi16((short)fx)),
+                                            _mm_set1_epi16((short)fx));
+            top = _mm_mullo_epi16(top, wx);
+            bot = _mm_mullo_epi16(bot, wx);
+            top = _mm_add_epi16(top, _mm_srli_si128(top, 8));   // <= 255 * 16
+            bot = _mm_add_epi16(bot, _mm_srli_si128(bot, 8));
+
+            // Vertical: fits 16 bits, 255 * 256 at most
+            __m128i sum = _mm_add_epi16(_mm_mullo_epi16(top, _mm_set1_epi16((short)(16 - fy))),
+                                        _mm_mullo_epi16(bot, _mm_set1_epi16((short)fy)));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 8);
+            out[x] = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(sum, zero)) | 0xFF000000u;
+        }
+    }
+#endif
+}
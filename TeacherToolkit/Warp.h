@@ -0,0 +1,55 @@
+// Warp.h : keystone / rotation correction of the projector output.
+//
+// The correction is a perspective transform of the whole letterboxed
+// output, given as the four places (normalized to the output size) its
+// corners should land, plus an optional rotation about the centre. Both
+// are folded, together with the letterbox scaling, into one remap table:
+// for every output pixel, the source position in 12.4 fixed point, or
+// "black". The table is only rebuilt when the geometry changes; applying
+// it is one bilinear sample per pixel, four neighbours at a time in SSE2.
+// Portable: no Windows headers.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define WARP_MAX_SOURCE     4095        // 12.4 fixed point limit per axis
+#define WARP_BLACK          0xFFFFFFFFu
+
+struct WarpParams {
+    float corners[8];           // TL, TR, BR, BL as x,y in 0..1 of the output
+    float rotateDeg;            // clockwise, about the output centre
+};
+
+struct WarpMap {
+    int srcW, srcH;
+    int dstW, dstH;
+    int boxLeft, boxTop, boxRight, boxBottom;   // letterbox rect in the output
+    WarpParams params;
+    std::vector<uint32_t> table;                // dstW * dstH: x | y << 16, 12.4 each
+};
+
+void WarpParamsIdentity(WarpParams* params);
+bool WarpIsIdentity(const WarpParams* params);
+
+// Parses "x0,y0,x1,y1,x2,y2,x3,y3" (TL, TR, BR, BL). Returns false and
+// leaves params alone on malformed input.
+bool WarpParseCorners(WarpParams* params, const char* text);
+
+// Rebuilds the table only if an input differs from the last call; returns
+// true if it did. If the geometry cannot be warped (degenerate quad, source
+// larger than WARP_MAX_SOURCE) the table is left empty: check WarpIsReady.
+bool WarpBuild(WarpMap* map, const WarpParams* params, int srcW, int srcH, int dstW, int dstH,
+               int boxLeft, int boxTop, int boxRight, int boxBottom);
+
+bool WarpIsReady(const WarpMap* map);
+void WarpFree(WarpMap* map);
+
+// Strides in pixels. src must be srcW x srcH, dst dstW x dstH (32bpp).
+void WarpApply(const WarpMap* map, const uint32_t* src, int srcStride, uint32_t* dst, int dstStride);
+
+// The same one pixel at a time without SSE2: what WarpApply does on builds
+// without it, and the reference tools/WarpBench holds the SSE2 path to.
+void WarpApplyScalar(const WarpMap* map, const uint32_t* src, int srcStride, uint32_t* dst, int dstStride);
@@ -22,6 +22,10 @@
 #include <wincrypt.h>
 #include <wininet.h>
 #include <commctrl.h>
+#include <psapi.h>
+#include <wtsapi32.h>
+#include <wintrust.h>
+#include <softpub.h>
 
 #pragma comment(lib, "Shell32.lib")
 #pragma comment(lib, "Gdi32.lib")
@@ -29,3 +33,11 @@
 #pragma comment(lib, "Advapi32.lib")
 #pragma comment(lib, "Wininet.lib")
 #pragma comment(lib, "Comctl32.lib")
+#pragma comment(lib, "Version.lib")
+#pragma comment(lib, "Wtsapi32.lib")
+#pragma comment(lib, "Wintrust.lib")
+
+// Wininet, Wintrust, Ole32, Comctl32 and Version are only needed by the update check,
+// the startup shortcut and dialogs; the project lists them in DelayLoadDLLs
+// so an idle instance never maps them.
+#pragma comment(lib, "delayimp.lib")
@@ -0,0 +1,296 @@
+// AnnotCheck.cpp : stroke rasterizer and tile compositor checks (Annotate.h).
+//
+// Draws strokes on a layer the size of a projector frame (not a multiple of
+// the tile size) and checks what reaches the frame:
+//   shape      an opaque stroke is solid along its spine, covers
+//              length x width + the round caps, and leaves everything
+//              beyond its edge untouched
+//   sparse     only tiles the stroke reached are allocated and blended;
+//              blending them one by one gives the same frame
+//   even       a translucent stroke looks the same drawn in one segment or
+//              in many short ones, and where it crosses itself; two
+//              strokes over each other do stack
+//   blend      the compositor matches a straight premultiplied "over"
+//              within one level per channel
+//   undo       undoing a stroke restores the frame exactly; clearing
+//              leaves nothing to blend
+//   edges      strokes running off the frame are clipped
+// and prints the time to rasterize a long stroke and to composite it.
+//
+// Build:  g++ -std=c++17 -O2 -I../TeacherToolkit AnnotCheck.cpp ../TeacherToolkit/Annotate.cpp -o AnnotCheck
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit AnnotCheck.cpp ..\TeacherToolkit\Annotate.cpp
+// Usage:  AnnotCheck [--width 1366] [--height 768]
+// Exit:   0 every check passed, 1 one failed, 2 bad arguments
+
+#include "Annotate.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        g_failures++;
+    }
+}
+
+static int W, H;
+
+// A frame with some texture, so blending mistakes show
+static std::vector<uint32_t> Backdrop()
+{
+    std::vector<uint32_t> f((size_t)W * H);
+    for (int y = 0; y < H; y++)
+        for (int x = 0; x < W; x++)
+            f[(size_t)y * W + x] = 0xFF000000u | (uint32_t)((x * 3) & 0xFF) << 16 |
+                                   (uint32_t)((y * 5) & 0xFF) << 8 | (uint32_t)((x ^ y) & 0xFF);
+    return f;
+}
+
+static std::vector<uint32_t> Composite(const AnnotationLayer* layer)
+{
+    std::vector<uint32_t> f = Backdrop();
+    AnnotComposite(layer, f.data(), W);
+    return f;
+}
+
+static int MaxChannelDiff(uint32_t a, uint32_t b)
+{
+    int m = 0;
+    for (int s = 0; s < 32; s += 8) {
+        int d = abs((int)((a >> s) & 0xFF) - (int)((b >> s) & 0xFF));
+        if (d > m) m = d;
+    }
+    return m;
+}
+
+static uint32_t TilePixel(const AnnotationLayer* layer, int x, int y)
+{
+    const uint32_t* tile = layer->tiles[(y / ANNOT_TILE) * layer->tilesX + x / ANNOT_TILE];
+    return tile ? tile[(y % ANNOT_TILE) * ANNOT_TILE + x % ANNOT_TILE] : 0;
+}
+
+static void DrawPolyline(AnnotationLayer* layer, const std::vector<AnnotPoint>& pts, uint32_t color, float width)
+{
+    AnnotBeginStroke(layer, pts[0].x, pts[0].y, color, width);
+    for (size_t i = 1; i < pts.size(); i++) AnnotAddPoint(layer, pts[i].x, pts[i].y);
+    AnnotEndStroke(layer);
+}
+
+static void CheckShape()
+{
+    AnnotationLayer layer = {};
+    AnnotInit(&layer, W, H);
+    const float x0 = 100.5f, x1 = 400.5f, y = 200.5f, width = 9.0f, r = width / 2;
+    DrawPolyline(&layer, { { x0, y }, { x1, y } }, 0xFFFF0000, width);
+
+    std::vector<uint32_t> before = Backdrop(), after = Composite(&layer);
+    bool solid = true, outside = true;
+    double area = 0;
+    for (int py = 0; py < H; py++) {
+        for (int px = 0; px < W; px++) {
+            float cx = fminf(fmaxf(px + 0.5f, x0), x1);
+            float d = hypotf(px + 0.5f - cx, py + 0.5f - y);
+            uint32_t t = TilePixel(&layer, px, py);
+            area += (t >> 24) / 255.0;
+            if (d <= r - 1 && after[(size_t)py * W + px] != 0xFFFF0000) solid = false;
+            if (d >= r + 1 && after[(size_t)py * W + px] != before[(size_t)py * W + px]) outside = false;
+        }
+    }
+    double expected = (x1 - x0) * width + 3.14159265 * r * r;
+    Check(solid, "opaque stroke is solid along its spine");
+    Check(outside, "nothing beyond the stroke's edge changes");
+    Check(fabs(area - expected) < expected * 0.02, "covered area is length x width + caps");
+
+    // Only tiles the capsule reaches
+    int minTx = (int)((x0 - r - 1) / ANNOT_TILE), maxTx = (int)((x1 + r + 1) / ANNOT_TILE);
+    int minTy = (int)((y - r - 1) / ANNOT_TILE), maxTy = (int)((y + r + 1) / ANNOT_TILE);
+    bool inBox = true;
+    for (int index : layer.activeTiles) {
+        int tx = index % layer.tilesX, ty = index / layer.tilesX;
+        if (tx < minTx || tx > maxTx || ty < minTy || ty > maxTy) inBox = false;
+    }
+    Check(inBox && (int)layer.activeTiles.size() <= (maxTx - minTx + 1) * (maxTy - minTy + 1),
+          "only the tiles the stroke reached are allocated");
+
+    std::vector<uint32_t> byTile = Backdrop();
+    int blended = 0;
+    for (int ty = 0; ty < layer.tilesY; ty++)
+        for (int tx = 0; tx < layer.tilesX; tx++)
+            blended += AnnotCompositeTile(&layer, byTile.data(), W, tx, ty);
+    Check(blended == (int)layer.activeTiles.size() && byTile == after, "tile-by-tile blending gives the same frame");
+    printf("shape: %.0f px covered (expected %.0f), %zu of %d tiles touched\n",
+           area, expected, layer.activeTiles.size(), layer.tilesX * layer.tilesY);
+    AnnotFree(&layer);
+}
+
+static void CheckEven()
+{
+    const uint32_t pen = 0x80FFD700;        // half-transparent highlighter
+    const float width = 14.0f;
+    AnnotationLayer one = {}, many = {};
+    AnnotInit(&one, W, H);
+    AnnotInit(&many, W, H);
+
+    DrawPolyline(&one, { { 50, 300 }, { 650, 300 } }, pen, width);
+    std::vector<AnnotPoint> steps;
+    for (float x = 50; x < 650; x += 1.25f) steps.push_back({ x, 300 });
+    steps.push_back({ 650, 300 });
+    DrawPolyline(&many, steps, pen, width);
+
+    int worst = 0;
+    for (int y = 280; y < 320; y++)
+        for (int x = 30; x < 670; x++) {
+            int d = MaxChannelDiff(TilePixel(&one, x, y), TilePixel(&many, x, y));
+            if (d > worst) worst = d;
+        }
+    Check(worst <= 2, "translucent stroke looks the same in one or many segments");
+
+    // Crossing itself: still one coat
+    AnnotationLayer loop = {};
+    AnnotInit(&loop, W, H);
+    std::vector<AnnotPoint> pts;
+    for (int i = 0; i <= 720; i += 4) {
+        float a = i * 3.14159265f / 180.0f;
+        pts.push_back({ 900 + 120 * sinf(2 * a), 400 + 120 * sinf(a) });   // figure eight
+    }
+    DrawPolyline(&loop, pts, pen, width);
+    uint32_t maxAlpha = 0;
+    for (int y = 0; y < H; y++)
+        for (int x = 0; x < W; x++) {
+            uint32_t a = TilePixel(&loop, x, y) >> 24;
+            if (a > maxAlpha) maxAlpha = a;
+        }
+    Check(maxAlpha <= (pen >> 24) + 1, "a stroke crossing itself is not blended twice");
+
+    // Two strokes do stack
+    DrawPolyline(&one, { { 350, 250 }, { 350, 350 } }, pen, width);
+    uint32_t a1 = TilePixel(&many, 350, 300) >> 24, a2 = TilePixel(&one, 350, 300) >> 24;
+    Check(a2 > a1 + 40, "separate strokes stack");
+    printf("even: one vs many segments differ by %d, loop alpha %u, two coats %u -> %u\n",
+           worst, maxAlpha, a1, a2);
+    AnnotFree(&one);
+    AnnotFree(&many);
+    AnnotFree(&loop);
+}
+
+static void CheckBlend()
+{
+    AnnotationLayer layer = {};
+    AnnotInit(&layer, W, H);
+    const uint32_t colors[] = { 0x20FF0000, 0x6000FF00, 0xA00000FF, 0xE0FFFFFF, 0x01000000, 0xFF123456 };
+    for (int i = 0; i < 6; i++)
+        DrawPolyline(&layer, { { 60.0f + i * 40, 500 }, { 80.0f + i * 40, 700 } }, colors[i], 10.0f + i * 3);
+
+    std::vector<uint32_t> before = Backdrop(), after = Composite(&layer);
+    int worst = 0;
+    bool premultiplied = true;
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            uint32_t s = TilePixel(&layer, x, y), d = before[(size_t)y * W + x];
+            double a = (s >> 24) / 255.0;
+            uint32_t ref = 0xFF000000;
+            for (int sh = 0; sh < 24; sh += 8) {
+                uint32_t sc = (s >> sh) & 0xFF;
+                if (sc > (s >> 24)) premultiplied = false;
+                double v = sc + ((d >> sh) & 0xFF) * (1.0 - a);
+                ref |= (uint32_t)(v + 0.5 > 255 ? 255 : v + 0.5) << sh;
+            }
+            int diff = MaxChannelDiff(ref, after[(size_t)y * W + x]);
+            if (diff > worst) worst = diff;
+        }
+    }
+    Check(premultiplied, "tiles hold premultiplied colour");
+    Check(worst <= 1, "compositor matches premultiplied over");
+    printf("blend: largest difference from exact over %d\n", worst);
+    AnnotFree(&layer);
+}
+
+static void CheckUndoAndEdges()
+{
+    AnnotationLayer layer = {};
+    AnnotInit(&layer, W, H);
+    DrawPolyline(&layer, { { 200, 100 }, { 260, 160 }, { 320, 100 } }, 0xC0FF0000, 6.0f);
+    DrawPolyline(&layer, { { 210, 90 }, { 330, 170 } }, 0x8000FF00, 20.0f);
+    std::vector<uint32_t> two = Composite(&layer);
+    size_t tilesTwo = layer.activeTiles.size();
+
+    DrawPolyline(&layer, { { 250, 50 }, { 600, 600 } }, 0xFF0000FF, 30.0f);
+    AnnotUndo(&layer);
+    Check(Composite(&layer) == two && layer.activeTiles.size() == tilesTwo, "undo restores the frame exactly");
+
+    AnnotClear(&layer);
+    std::vector<uint32_t> cleared = Backdrop();
+    Check(AnnotIsEmpty(&layer) && AnnotComposite(&layer, cleared.data(), W) == 0 && cleared == Backdrop(),
+          "clear leaves nothing to blend");
+
+    // Off every edge, including the partial last row and column of tiles
+    DrawPolyline(&layer, { { -50, -50 }, { (float)W + 50, (float)H + 50 } }, 0xFFFFFFFF, 25.0f);
+    DrawPolyline(&layer, { { (float)W - 3, -20 }, { (float)W - 3, (float)H + 20 } }, 0x80FF00FF, 12.0f);
+    std::vector<uint32_t> padded((size_t)(W + 16) * (H + 1), 0x11223344);
+    AnnotComposite(&layer, padded.data(), W + 16);
+    bool clipped = true;
+    for (int y = 0; y < H + 1; y++)
+        for (int x = 0; x < W + 16; x++)
+            if ((y >= H || x >= W) && padded[(size_t)y * (W + 16) + x] != 0x11223344) clipped = false;
+    Check(clipped, "strokes off the frame are clipped to it");
+    AnnotFree(&layer);
+}
+
+static void Timing()
+{
+    AnnotationLayer layer = {};
+    AnnotInit(&layer, W, H);
+    std::vector<AnnotPoint> pts;
+    for (int i = 0; i < 2000; i++)
+        pts.push_back({ W / 2 + (W / 3) * sinf(i * 0.011f), H / 2 + (H / 3) * sinf(i * 0.017f) });
+
+    auto t0 = std::chrono::steady_clock::now();
+    DrawPolyline(&layer, pts, 0xC0FF4000, 6.0f);
+    auto t1 = std::chrono::steady_clock::now();
+    std::vector<uint32_t> frame = Backdrop();
+    const int reps = 50;
+    auto t2 = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++) AnnotComposite(&layer, frame.data(), W);
+    auto t3 = std::chrono::steady_clock::now();
+    printf("timing: 2000-point stroke rasterized in %.2f ms; %zu tiles composited in %.3f ms per frame\n",
+           std::chrono::duration<double, std::milli>(t1 - t0).count(), layer.activeTiles.size(),
+           std::chrono::duration<double, std::milli>(t3 - t2).count() / reps);
+    AnnotFree(&layer);
+}
+
+int main(int argc, char** argv)
+{
+    W = 1366;
+    H = 768;
+    for (int i = 1; i < argc; i++) {
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (v && strcmp(argv[i], "--width") == 0)       W = atoi(v);
+        else if (v && strcmp(argv[i], "--height") == 0) H = atoi(v);
+        else {
+            fprintf(stderr, "usage: AnnotCheck [--width 1366] [--height 768]\n");
+            return 2;
+        }
+        i++;
+    }
+    if (W < 1000 || H < 720 || W > 8192 || H > 8192) {
+        fprintf(stderr, "width 1000..8192, height 720..8192\n");
+        return 2;
+    }
+
+    CheckShape();
+    CheckEven();
+    CheckBlend();
+    CheckUndoAndEdges();
+    Timing();
+
+    printf("%s\n", g_failures ? "FAILED" : "all checks passed");
+    return g_failures ? 1 : 0;
+}
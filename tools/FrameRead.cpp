@@ -0,0 +1,205 @@
+// FrameRead.cpp : reads the frames TeacherToolkit publishes in shared memory.
+//
+// Example consumer of the frame ring (FrameRing.h). It attaches while the
+// app is projecting, reads every pixel of each new frame in place, counts
+// frames that were skipped or overwritten while being read, and prints a
+// line a second. --save writes one intact frame as a BMP. --demo runs a
+// producer with moving test content in the same process, so the protocol
+// can be exercised without the app (and on Linux, over POSIX shared
+// memory); --slow-ms makes the reader lag behind it on purpose.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I../TeacherToolkit FrameRead.cpp ../TeacherToolkit/FrameRing.cpp ../TeacherToolkit/RegionClassify.cpp -o FrameRead
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit FrameRead.cpp ..\TeacherToolkit\FrameRing.cpp ..\TeacherToolkit\RegionClassify.cpp
+// Usage:  FrameRead [--seconds 10] [--save frame.bmp] [--demo] [--slow-ms 0]
+// Exit:   0 frames were read, 1 none arrived, 2 no frame ring to attach to
+
+#include "FrameRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define DEMO_NAME       "TeacherToolkit.Frames.Demo"
+#define DEMO_WIDTH      1280
+#define DEMO_HEIGHT     720
+#define DEMO_PERIOD_MS  16
+
+static uint64_t NowUs()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void SleepMs(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// A static background with a small square sweeping across it, so only a
+// few tiles change per frame
+static void DemoProducer(std::atomic<bool>* stop, std::atomic<uint32_t>* published)
+{
+    FrameRingMapping map;
+    if (!FrameRingCreate(&map, DEMO_NAME, FrameRingBytes(DEMO_WIDTH, DEMO_HEIGHT))) {
+        fprintf(stderr, "demo: cannot create shared memory\n");
+        return;
+    }
+    FrameRingWriter writer;
+    if (!FrameRingFormat(&writer, map.base, map.bytes, DEMO_WIDTH, DEMO_HEIGHT, (uint32_t)NowUs())) {
+        fprintf(stderr, "demo: shared memory too small\n");
+        FrameRingUnmap(&map);
+        return;
+    }
+
+    std::vector<uint32_t> frame((size_t)DEMO_WIDTH * DEMO_HEIGHT);
+    for (int y = 0; y < DEMO_HEIGHT; y++)
+        for (int x = 0; x < DEMO_WIDTH; x++)
+            frame[(size_t)y * DEMO_WIDTH + x] = 0xFF000000u | (uint32_t)(x * 255 / DEMO_WIDTH) << 8 | (uint32_t)(y & 0xFF);
+
+    int pos = 0;
+    while (!stop->load()) {
+        uint64_t nowUs = NowUs();
+        if (FrameRingWanted(&writer, nowUs / 1000)) {
+            int x0 = pos % (DEMO_WIDTH - 100), y0 = (pos / 7) % (DEMO_HEIGHT - 100);
+            for (int y = y0; y < y0 + 100; y++)
+                for (int x = x0; x < x0 + 100; x++)
+                    frame[(size_t)y * DEMO_WIDTH + x] ^= 0x00FFFFFFu;
+            if (FrameRingPublish(&writer, frame.data(), DEMO_WIDTH, DEMO_WIDTH, DEMO_HEIGHT, nullptr, nowUs))
+                published->fetch_add(1);
+            pos += 13;
+        }
+        SleepMs(DEMO_PERIOD_MS);
+    }
+    FrameRingStop(&writer);
+    FrameRingUnmap(&map);
+    FrameRingRemove(DEMO_NAME);
+}
+
+static bool SaveBmp(const char* path, const uint32_t* pixels, int width, int height)
+{
+    FILE* fp = nullptr;
+#ifdef _WIN32
+    if (fopen_s(&fp, path, "wb") != 0) fp = nullptr;
+#else
+    fp = fopen(path, "wb");
+#endif
+    if (!fp) return false;
+
+    uint32_t imageBytes = (uint32_t)width * height * 4;
+    uint8_t hdr[54] = { 'B', 'M' };
+    auto put32 = [&hdr](int at, uint32_t v) { memcpy(hdr + at, &v, 4); };
+    put32(2, 54 + imageBytes);
+    put32(10, 54);
+    put32(14, 40);
+    put32(18, (uint32_t)width);
+    put32(22, (uint32_t)-height);           // top-down
+    hdr[26] = 1;
+    hdr[28] = 32;
+    put32(34, imageBytes);
+    bool ok = fwrite(hdr, sizeof(hdr), 1, fp) == 1 &&
+              fwrite(pixels, imageBytes, 1, fp) == 1;
+    return fclose(fp) == 0 && ok;
+}
+
+int main(int argc, char** argv)
+{
+    int seconds = 10, slowMs = 0;
+    const char* savePath = nullptr;
+    bool demo = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)      seconds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--slow-ms") == 0 && i + 1 < argc) slowMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc)    savePath = argv[++i];
+        else if (strcmp(argv[i], "--demo") == 0)                    demo = true;
+        else {
+            fprintf(stderr, "usage: FrameRead [--seconds 10] [--save frame.bmp] [--demo] [--slow-ms 0]\n");
+            return 2;
+        }
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint32_t> published(0);
+    std::thread producer;
+    if (demo) {
+        producer = std::thread(DemoProducer, &stop, &published);
+        SleepMs(100);
+    }
+    auto finish = [&](int code) {
+        stop = true;
+        if (producer.joinable()) producer.join();
+        return code;
+    };
+
+    const char* name = demo ? DEMO_NAME : FRAME_RING_NAME;
+    FrameRingMapping map;
+    FrameRingReader reader;
+    if (!FrameRingOpen(&map, name) || !FrameRingAttach(&reader, map.base, map.bytes)) {
+        fprintf(stderr, "%s: no frame ring (is TeacherToolkit projecting?)\n", name);
+        FrameRingUnmap(&map);
+        return finish(2);
+    }
+
+    uint64_t frames = 0, torn = 0, skipped = 0, dirtyTiles = 0, totalTiles = 0;
+    uint32_t lastSeq = 0, checksum = 0;
+    std::vector<uint32_t> copy;
+    uint64_t start = NowUs(), lastReport = start;
+    while (NowUs() - start < (uint64_t)seconds * 1000000) {
+        FrameView view;
+        FrameRingResult r = FrameRingAcquire(&reader, &view);
+        if (r == FRAME_RING_ENDED) {
+            printf("producer stopped\n");
+            break;
+        }
+        if (r == FRAME_RING_OK) {
+            // Read in place, as a real consumer would encode or OCR it
+            for (int y = 0; y < view.height; y++) {
+                const uint32_t* row = view.pixels + (size_t)y * view.stride;
+                for (int x = 0; x < view.width; x++) checksum = checksum * 31 + row[x];
+            }
+            if (savePath && copy.empty()) {
+                copy.resize((size_t)view.width * view.height);
+                for (int y = 0; y < view.height; y++)
+                    memcpy(copy.data() + (size_t)y * view.width, view.pixels + (size_t)y * view.stride,
+                           (size_t)view.width * sizeof(uint32_t));
+            }
+            if (slowMs) SleepMs(slowMs);
+
+            if (!FrameRingRelease(&reader, &view)) {
+                torn++;
+                if (savePath) copy.clear();         // try the next one
+            } else {
+                if (lastSeq && view.seq - lastSeq > 1) skipped += view.seq - lastSeq - 1;
+                lastSeq = view.seq;
+                frames++;
+                dirtyTiles += view.allDirty ? (uint64_t)view.tilesX * view.tilesY : (uint64_t)view.dirtyTiles;
+                totalTiles += (uint64_t)view.tilesX * view.tilesY;
+                if (savePath && !copy.empty()) {
+                    if (!SaveBmp(savePath, copy.data(), view.width, view.height))
+                        fprintf(stderr, "%s: cannot write\n", savePath);
+                    else
+                        printf("saved frame %u (%dx%d) to %s\n", view.seq, view.width, view.height, savePath);
+                    savePath = nullptr;
+                }
+            }
+        } else {
+            SleepMs(2);
+        }
+
+        uint64_t now = NowUs();
+        if (now - lastReport >= 1000000) {
+            printf("frames %llu  skipped %llu  torn %llu  changed tiles %.1f%%",
+                   (unsigned long long)frames, (unsigned long long)skipped, (unsigned long long)torn,
+                   totalTiles ? 100.0 * (double)dirtyTiles / (double)totalTiles : 0.0);
+            if (demo) printf("  published %u", published.load());
+            printf("\n");
+            lastReport = now;
+        }
+    }
+    printf("checksum %08x\n", checksum);
+    FrameRingUnmap(&map);
+    return finish(frames ? 0 : 1);
+}
@@ -0,0 +1,116 @@
+// IdleCheck.cpp : fails if an idle TeacherToolkit uses more memory than allowed.
+//
+// Asks the running instance for its status over the control pipe, after
+// giving it time to reach the idle state (buffers released, working set
+// trimmed a few seconds after startup or the end of projection), and
+// compares its private bytes against a threshold. Meant for a test
+// machine without a projector, before publishing a release.
+//
+// Build:  cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit IdleCheck.cpp ..\TeacherToolkit\JsonScan.cpp
+// Usage:  IdleCheck [--launch path\TeacherToolkit.exe] [--settle-ms 8000]
+//                   [--max-private-kb 3072] [--max-ws-kb 0]
+// Exit:   0 within limits, 1 over a limit, 2 could not measure
+
+#include <windows.h>
+
+#include "JsonScan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#define IPC_PIPE_NAME   L"\\\\.\\pipe\\TeacherToolkit"     // as in TeacherToolkit.cpp
+#define IPC_MAX_REPLY   1024
+
+struct StatusFields {
+    bool     projecting;
+    bool     gotMemory;
+    uint64_t privateKB;
+    uint64_t workingSetKB;
+};
+
+static void OnField(void* ctx, const char* path, int, JsonValueType type,
+                    const char* value, size_t, bool)
+{
+    StatusFields* f = (StatusFields*)ctx;
+    if (strcmp(path, "projecting") == 0 && type == JSON_LITERAL) {
+        f->projecting = strcmp(value, "true") == 0;
+    } else if (strcmp(path, "memoryKB.private") == 0 && type == JSON_NUMBER) {
+        f->privateKB = _strtoui64(value, nullptr, 10);
+        f->gotMemory = true;
+    } else if (strcmp(path, "memoryKB.workingSet") == 0 && type == JSON_NUMBER) {
+        f->workingSetKB = _strtoui64(value, nullptr, 10);
+    }
+}
+
+static bool QueryStatus(StatusFields* f, DWORD timeoutMs)
+{
+    char reply[IPC_MAX_REPLY + 1];
+    DWORD replyLen = 0;
+    DWORD start = GetTickCount();
+    for (;;) {
+        if (CallNamedPipeW(IPC_PIPE_NAME, (void*)"status", 6, reply, IPC_MAX_REPLY, &replyLen, 2000))
+            break;
+        if (GetTickCount() - start > timeoutMs) return false;
+        Sleep(250);     // not up yet
+    }
+    reply[replyLen] = '\0';
+
+    JsonScanner s;
+    JsonScanInit(&s, OnField, f);
+    return JsonScanFeed(&s, reply, replyLen) && JsonScanFinish(&s) && f->gotMemory;
+}
+
+int wmain(int argc, wchar_t** argv)
+{
+    const wchar_t* launch = nullptr;
+    DWORD settleMs = 8000;
+    uint64_t maxPrivateKB = 3072, maxWorkingSetKB = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (wcscmp(argv[i], L"--launch") == 0 && i + 1 < argc)              launch = argv[++i];
+        else if (wcscmp(argv[i], L"--settle-ms") == 0 && i + 1 < argc)      settleMs = (DWORD)_wtoi(argv[++i]);
+        else if (wcscmp(argv[i], L"--max-private-kb") == 0 && i + 1 < argc) maxPrivateKB = _wcstoui64(argv[++i], nullptr, 10);
+        else if (wcscmp(argv[i], L"--max-ws-kb") == 0 && i + 1 < argc)      maxWorkingSetKB = _wcstoui64(argv[++i], nullptr, 10);
+        else {
+            fwprintf(stderr, L"usage: IdleCheck [--launch exe] [--settle-ms N] [--max-private-kb N] [--max-ws-kb N]\n");
+            return 2;
+        }
+    }
+
+    PROCESS_INFORMATION pi = {};
+    if (launch) {
+        STARTUPINFOW si = { sizeof(si) };
+        wchar_t cmd[MAX_PATH + 2];
+        swprintf_s(cmd, L"\"%s\"", launch);
+        if (!CreateProcessW(launch, cmd, nullptr, nullptr, FALSE, 0, nullptr, nullptr, &si, &pi)) {
+            fwprintf(stderr, L"cannot start %s (%lu)\n", launch, GetLastError());
+            return 2;
+        }
+    }
+
+    Sleep(settleMs);
+
+    StatusFields f = {};
+    int result = 2;
+    if (!QueryStatus(&f, 10000)) {
+        fwprintf(stderr, L"no status from TeacherToolkit\n");
+    } else if (f.projecting) {
+        fwprintf(stderr, L"TeacherToolkit is projecting; idle memory cannot be measured\n");
+    } else {
+        bool over = f.privateKB > maxPrivateKB || (maxWorkingSetKB && f.workingSetKB > maxWorkingSetKB);
+        wprintf(L"idle: private %llu KB (max %llu), working set %llu KB",
+                f.privateKB, maxPrivateKB, f.workingSetKB);
+        if (maxWorkingSetKB) wprintf(L" (max %llu)", maxWorkingSetKB);
+        wprintf(L" -> %s\n", over ? L"FAIL" : L"ok");
+        result = over ? 1 : 0;
+    }
+
+    if (launch && pi.hProcess) {
+        TerminateProcess(pi.hProcess, 0);
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+    }
+    return result;
+}
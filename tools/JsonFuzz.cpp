@@ -0,0 +1,296 @@
+// JsonFuzz.cpp : robustness and throughput of the streaming JSON scanner.
+//
+// Runs the scanner (JsonScan.h) the way the update check does, over
+// release metadata shaped like GitHub's, and checks that:
+//   chunks   the same document fed whole, one byte at a time and in random
+//            chunk sizes gives the same fields, in the same order, and the
+//            same verdict
+//   nesting  JSON_MAX_DEPTH levels are read, one more is rejected, and an
+//            endless run of '[' is rejected without growing anything
+//   escapes  \u escapes, surrogate pairs and lone surrogates decode to UTF-8
+//   fuzz     mutated documents (flipped, inserted, deleted and truncated
+//            bytes) never crash, never report a value longer than
+//            JSON_MAX_VALUE or a path longer than JSON_MAX_PATH, and do not
+//            depend on how they are chunked
+// and prints the throughput over a large document with --mb megabytes of
+// assets and release notes.
+//
+// Build:  g++ -std=c++17 -O2 -I../TeacherToolkit JsonFuzz.cpp ../TeacherToolkit/JsonScan.cpp -o JsonFuzz
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit JsonFuzz.cpp ..\TeacherToolkit\JsonScan.cpp
+// Usage:  JsonFuzz [--iterations 20000] [--seed 1] [--mb 16]
+// Exit:   0 every check passed, 1 one failed, 2 bad arguments
+
+#include "JsonScan.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        g_failures++;
+    }
+}
+
+static uint64_t g_rng = 1;
+
+static uint32_t Rand()
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return (uint32_t)(g_rng >> 16);
+}
+
+// Every field the scanner reported, folded into one hash, plus the
+// invariants the callers rely on
+struct Transcript {
+    uint64_t hash;
+    uint32_t fields;
+    bool     sane;
+};
+
+static void Mix(Transcript* t, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) t->hash = (t->hash ^ p[i]) * 1099511628211ull;
+}
+
+static void OnField(void* ctx, const char* path, int arrayIndex, JsonValueType type,
+                    const char* value, size_t len, bool truncated)
+{
+    auto* t = (Transcript*)ctx;
+    size_t pathLen = strlen(path);
+    if (len >= JSON_MAX_VALUE || value[len] != '\0' || pathLen >= JSON_MAX_PATH ||
+        (truncated && len != JSON_MAX_VALUE - 1))
+        t->sane = false;
+    Mix(t, path, pathLen + 1);
+    Mix(t, &arrayIndex, sizeof(arrayIndex));
+    Mix(t, &type, sizeof(type));
+    Mix(t, value, len);
+    Mix(t, &truncated, sizeof(truncated));
+    t->fields++;
+}
+
+// chunk 0 = whole, -1 = random sizes, else that many bytes at a time
+static bool Scan(const std::string& doc, int chunk, Transcript* t)
+{
+    static JsonScanner s;               // large; as the app keeps it off the stack
+    *t = Transcript{ 14695981039346656037ull, 0, true };
+    JsonScanInit(&s, OnField, t);
+    size_t pos = 0;
+    bool ok = true;
+    while (pos < doc.size() && ok) {
+        size_t n = chunk == 0 ? doc.size() : chunk > 0 ? (size_t)chunk : 1 + Rand() % 700;
+        if (n > doc.size() - pos) n = doc.size() - pos;
+        ok = JsonScanFeed(&s, doc.data() + pos, n);
+        pos += n;
+    }
+    ok = ok && JsonScanFinish(&s);
+    Mix(t, &ok, sizeof(ok));
+    return ok;
+}
+
+static std::string Asset(int i, const char* name, size_t notesBytes)
+{
+    char head[1024];
+    snprintf(head, sizeof(head),
+        "{\"url\":\"https://api.github.com/repos/o/r/releases/assets/%d\",\"id\":%d,"
+        "\"name\":\"%s\",\"label\":null,\"uploader\":{\"login\":\"o\",\"site_admin\":false},"
+        "\"content_type\":\"application/octet-stream\",\"state\":\"uploaded\",\"size\":%d,"
+        "\"digest\":\"sha256:%064x\",\"download_count\":%d,\"created_at\":\"2025-01-0%dT10:00:00Z\","
+        "\"browser_download_url\":\"https://github.com/o/r/releases/download/v1.4.2/%s\",\"notes\":\"",
+        1000 + i, 1000 + i, name, 100000 + i, i, i % 7, 1 + i % 9, name);
+    std::string a = head;
+    while (a.size() < strlen(head) + notesBytes)
+        a += "Corre\\u00e7\\u00f5es e melhorias \\ud83d\\ude80 \\\"aspas\\\" \\n ";
+    return a + "\"}";
+}
+
+// A /releases/latest answer with the wanted asset in the middle
+static std::string Release(int assets, size_t notesBytes)
+{
+    std::string doc = "{\"url\":\"https://api.github.com/repos/o/r/releases/1\",\"tag_name\":\"v1.4.2\","
+                      "\"draft\":false,\"prerelease\":false,\"author\":{\"login\":\"o\",\"id\":1},"
+                      "\"published_at\":\"2025-01-02T10:00:00Z\",\"reactions\":{\"+1\":3,\"total\":-1.5e+2},"
+                      "\"assets\":[";
+    for (int i = 0; i < assets; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), i == assets / 2 ? "TeacherToolkit.exe" : "extra-%d.zip", i);
+        if (i) doc += ",";
+        doc += Asset(i, name, notesBytes);
+    }
+    return doc + "],\"body\":\"\"}\n";
+}
+
+static void CheckRelease()
+{
+    std::string doc = Release(5, 64);
+    for (int chunk : { 0, 1, 7, -1 }) {
+        ReleaseInfo info;
+        ReleaseInfoInit(&info, "TeacherToolkit.exe");
+        size_t n = chunk <= 0 ? doc.size() : (size_t)chunk;
+        bool ok = true;
+        for (size_t pos = 0; pos < doc.size() && ok; pos += n)
+            ok = ReleaseInfoFeed(&info, doc.data() + pos, n < doc.size() - pos ? n : doc.size() - pos);
+        ok = ok && ReleaseInfoFinish(&info);
+        Check(ok && strcmp(info.tagName, "v1.4.2") == 0 && info.assetCount == 5 && info.haveAsset &&
+              info.asset.size == 100002 && strncmp(info.asset.digest, "sha256:", 7) == 0 &&
+              strstr(info.asset.url, "/v1.4.2/TeacherToolkit.exe") != nullptr,
+              "release fields, whole and chunked");
+    }
+}
+
+static void CheckChunking()
+{
+    std::string doc = Release(12, 3000);   // long values: truncation on every asset
+    Transcript whole, t;
+    bool ok = Scan(doc, 0, &whole);
+    Check(ok && whole.sane && whole.fields == 12 * 14 + 10, "large release is read whole");
+    for (int chunk : { 1, 2, 3, 13, 4096, -1, -1, -1 }) {
+        bool ok2 = Scan(doc, chunk, &t);
+        Check(ok2 == ok && t.hash == whole.hash && t.fields == whole.fields, "chunking does not change the fields");
+    }
+}
+
+static void CheckNesting()
+{
+    Transcript t;
+    std::string deep = std::string(JSON_MAX_DEPTH, '[') + "1" + std::string(JSON_MAX_DEPTH, ']');
+    Check(Scan(deep, 1, &t) && t.fields == 1, "JSON_MAX_DEPTH levels are read");
+    std::string deeper = std::string(JSON_MAX_DEPTH + 1, '[') + "1" + std::string(JSON_MAX_DEPTH + 1, ']');
+    Check(!Scan(deeper, 0, &t), "one level more is rejected");
+    std::string objects;
+    for (int i = 0; i < JSON_MAX_DEPTH; i++) objects += "{\"k\":";
+    objects += "true" + std::string(JSON_MAX_DEPTH, '}');
+    Check(Scan(objects, 3, &t) && t.fields == 1, "nested objects build the dotted path");
+    std::string endless(1 << 20, '[');
+    Check(!Scan(endless, 4096, &t) && t.fields == 0, "an endless run of '[' is rejected");
+}
+
+struct Captured {
+    std::string value;
+};
+
+static void OnCapture(void* ctx, const char*, int, JsonValueType, const char* value, size_t len, bool)
+{
+    ((Captured*)ctx)->value.assign(value, len);
+}
+
+static void CheckEscapes()
+{
+    struct { const char* in; const char* out; } cases[] = {
+        { "\"a\\u00e9b\"",          "a\xC3\xA9" "b" },
+        { "\"\\ud83d\\ude80\"",     "\xF0\x9F\x9A\x80" },
+        { "\"\\ud83dx\"",           "\xEF\xBF\xBDx" },          // lone high surrogate
+        { "\"\\ude80\"",            "\xEF\xBF\xBD" },           // lone low surrogate
+        { "\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"", "\"\\/\b\f\n\r\t" },
+    };
+    for (const auto& c : cases) {
+        JsonScanner s;
+        Captured cap;
+        JsonScanInit(&s, OnCapture, &cap);
+        bool ok = JsonScanFeed(&s, c.in, strlen(c.in)) && JsonScanFinish(&s);
+        Check(ok && cap.value == c.out, c.in);
+    }
+    const char* bad[] = { "\"\\x\"", "\"\\u12g4\"", "\"a\nb\"", "[1,]", "{\"a\" 1}", "tru", "[1 2]", "{}{}" };
+    for (const char* b : bad) {
+        JsonScanner s;
+        JsonScanInit(&s, nullptr, nullptr);
+        Check(!(JsonScanFeed(&s, b, strlen(b)) && JsonScanFinish(&s)), b);
+    }
+}
+
+static void Fuzz(int iterations)
+{
+    static const char alphabet[] = "{}[]:,\"\\u0123456789abcdefABCDEF-+.eEtrufalsn \n\t";
+    std::string base = Release(3, 40);
+    int accepted = 0;
+    for (int it = 0; it < iterations; it++) {
+        std::string doc = base;
+        int edits = 1 + Rand() % 8;
+        for (int e = 0; e < edits && !doc.empty(); e++) {
+            size_t at = Rand() % doc.size();
+            switch (Rand() % 5) {
+            case 0: doc[at] = (char)Rand(); break;
+            case 1: doc[at] = alphabet[Rand() % (sizeof(alphabet) - 1)]; break;
+            case 2: doc.insert(at, 1, alphabet[Rand() % (sizeof(alphabet) - 1)]); break;
+            case 3: doc.erase(at, 1 + Rand() % 16); break;
+            case 4: doc.resize(at); break;
+            }
+        }
+        Transcript whole, t;
+        bool ok = Scan(doc, 0, &whole);
+        Scan(doc, -1, &t);
+        bool same = t.hash == whole.hash && t.fields == whole.fields;
+        Check(whole.sane && t.sane, "fuzz: values and paths stay in bounds");
+        Check(same, "fuzz: chunking does not change the outcome");
+        if (!whole.sane || !same) {
+            printf("  iteration %d, %zu bytes\n", it, doc.size());
+            return;
+        }
+        accepted += ok;
+    }
+    printf("fuzz: %d mutated documents, %d still valid\n", iterations, accepted);
+}
+
+static void Throughput(int mb)
+{
+    size_t target = (size_t)mb << 20;
+    int assets = (int)(target / 66000) + 1;
+    std::string doc = Release(assets, 64000);
+    Transcript t;
+    auto start = std::chrono::steady_clock::now();
+    bool ok = Scan(doc, 4096, &t);
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Check(ok, "large document is read");
+
+    ReleaseInfo info;
+    ReleaseInfoInit(&info, "TeacherToolkit.exe");
+    start = std::chrono::steady_clock::now();
+    for (size_t pos = 0; pos < doc.size(); pos += 4096)
+        ReleaseInfoFeed(&info, doc.data() + pos, doc.size() - pos < 4096 ? doc.size() - pos : 4096);
+    ok = ReleaseInfoFinish(&info);
+    double s2 = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Check(ok && info.haveAsset && info.assetCount == assets, "large release finds its asset");
+
+    printf("throughput: %.1f MB, %u fields: scanner %.0f MB/s, release extractor %.0f MB/s, state %zu bytes\n",
+           doc.size() / 1048576.0, t.fields, doc.size() / 1048576.0 / s, doc.size() / 1048576.0 / s2,
+           sizeof(ReleaseInfo));
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = 20000, mb = 16;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (v && strcmp(argv[i], "--iterations") == 0)  iterations = atoi(v);
+        else if (v && strcmp(argv[i], "--seed") == 0)   seed = strtoull(v, nullptr, 10);
+        else if (v && strcmp(argv[i], "--mb") == 0)     mb = atoi(v);
+        else {
+            fprintf(stderr, "usage: JsonFuzz [--iterations 20000] [--seed 1] [--mb 16]\n");
+            return 2;
+        }
+        i++;
+    }
+    if (iterations < 0 || mb < 1) return 2;
+    g_rng = seed ? seed : 1;
+
+    CheckRelease();
+    CheckChunking();
+    CheckNesting();
+    CheckEscapes();
+    Fuzz(iterations);
+    Throughput(mb);
+
+    printf("%s\n", g_failures ? "FAILED" : "all checks passed");
+    return g_failures ? 1 : 0;
+}
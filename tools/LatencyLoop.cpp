@@ -0,0 +1,240 @@
+// LatencyLoop.cpp : checks the input latency tracker against a simulation.
+//
+// Loopback test of InputLatency.h without a display: a simulated desktop
+// receives synthetic input (pointer moves, clicks, typing), applies each
+// click and key to its frame after a random application delay, and is
+// captured, classified (RegionClassify.h) and "presented" on the mirror's
+// schedule: a frame every --fps, a random render time, the cursor drawn at
+// most once per refresh. Because the simulation knows when every change
+// reached the frame, it knows each input's true latency. The tracker only
+// sees what the app sees (input times and positions, tile changes,
+// present times); both sets of percentiles are printed side by side.
+// --video animates a region away from the input to check that unrelated
+// changes do not cut measurements short. Time is simulated, so an hour of
+// input runs in seconds.
+//
+// Build:  g++ -std=c++17 -O2 -I../TeacherToolkit LatencyLoop.cpp ../TeacherToolkit/InputLatency.cpp ../TeacherToolkit/RegionClassify.cpp -o LatencyLoop
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit LatencyLoop.cpp ..\TeacherToolkit\InputLatency.cpp ..\TeacherToolkit\RegionClassify.cpp
+// Usage:  LatencyLoop [--seconds 600] [--fps 30] [--refresh 60] [--video] [--seed 1]
+// Exit:   0 the tracker agrees with the truth, 1 it does not, 2 bad arguments
+
+#include "InputLatency.h"
+
+#include <algorithm>
+#include <math.h>
+#include <queue>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define SIM_WIDTH       1280
+#define SIM_HEIGHT      720
+#define INPUT_GAP_US    150000      // mean time between inputs
+// Histogram buckets are 0.5 ms. A key typed before the previous key's
+// change was captured is credited to that frame (its own change lands in
+// the same tiles a frame later), which pulls the key and click percentiles
+// down by a small part of a frame period when typing fast.
+#define TOLERANCE_MS    1.0
+#define TOLERANCE_FRAME 0.04
+
+enum SimEventType { SIM_APPLY, SIM_CAPTURE, SIM_PRESENT, SIM_CURSOR, SIM_INPUT };   // same-time order
+
+struct SimEvent {
+    int64_t t;
+    int     type;
+    int     index;                  // input or frame
+    bool operator<(const SimEvent& o) const { return t != o.t ? t > o.t : type > o.type; }
+};
+
+struct SimInput {
+    int64_t t;
+    int     kind;
+    int     x, y;
+    bool    timed;                  // not coalesced away
+    bool    applied;                // the change is in the frame
+    int     frame;                  // frame that captured it, -1 until then
+    int64_t truthUs;                // -1 until presented
+};
+
+static uint32_t g_seed = 1;
+
+static double Uniform()
+{
+    g_seed = g_seed * 1664525u + 1013904223u;
+    return (g_seed >> 8) / 16777216.0;
+}
+
+static void Fill(std::vector<uint32_t>& frame, int x0, int y0, int x1, int y1, uint32_t color)
+{
+    for (int y = std::max(0, y0); y < std::min(SIM_HEIGHT, y1); y++)
+        for (int x = std::max(0, x0); x < std::min(SIM_WIDTH, x1); x++)
+            frame[(size_t)y * SIM_WIDTH + x] = color;
+}
+
+static double TruthPercentile(std::vector<double> v, int pct)
+{
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t rank = (v.size() * pct + 99) / 100;
+    return v[(rank ? rank : 1) - 1];
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = 600, fps = 30, refreshHz = 60;
+    bool video = false;
+    for (int i = 1; i < argc; i++) {
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(argv[i], "--video") == 0)               { video = true; continue; }
+        if (v && strcmp(argv[i], "--seconds") == 0)        seconds = atof(v);
+        else if (v && strcmp(argv[i], "--fps") == 0)       fps = atof(v);
+        else if (v && strcmp(argv[i], "--refresh") == 0)   refreshHz = atof(v);
+        else if (v && strcmp(argv[i], "--seed") == 0)      g_seed = (uint32_t)atoi(v);
+        else {
+            fprintf(stderr, "usage: LatencyLoop [--seconds 600] [--fps 30] [--refresh 60] [--video] [--seed 1]\n");
+            return 2;
+        }
+        i++;
+    }
+    if (seconds <= 0 || fps <= 0 || refreshHz <= 0) return 2;
+
+    int64_t endUs = (int64_t)(seconds * 1e6), periodUs = (int64_t)(1e6 / fps), refreshUs = (int64_t)(1e6 / refreshHz);
+    std::priority_queue<SimEvent> events;
+    std::vector<SimInput> inputs;
+    for (int64_t t = (int64_t)(-log(1.0 - Uniform()) * INPUT_GAP_US); t < endUs;
+         t += 1 + (int64_t)(-log(1.0 - Uniform()) * INPUT_GAP_US)) {
+        SimInput in = {};
+        in.t = t;
+        double r = Uniform();
+        in.kind = r < 0.6 ? LATENCY_KEY : r < 0.85 ? LATENCY_POINTER : LATENCY_CLICK;
+        in.frame = -1;
+        in.truthUs = -1;
+        inputs.push_back(in);
+        events.push({ t, SIM_INPUT, (int)inputs.size() - 1 });
+    }
+    for (int64_t t = 0, n = 0; t < endUs + LATENCY_TIMEOUT_US; t += periodUs, n++)
+        events.push({ t, SIM_CAPTURE, (int)n });
+
+    std::vector<uint32_t> frame((size_t)SIM_WIDTH * SIM_HEIGHT, 0xFFFFFFFFu);
+    RegionMap regions = {};
+    RegionInit(&regions, SIM_WIDTH, SIM_HEIGHT);
+    static LatencyTracker tracker;
+    LatencyReset(&tracker);
+
+    int caretX = 40, caretY = 40, pointerX = 300, pointerY = 300;
+    int64_t lastCursorUs = -refreshUs;
+    bool cursorQueued = false;
+    int pointerWaiting = -1;            // timed pointer input not yet drawn
+    uint32_t frames = 0;
+    size_t uncaptured = 0, unpresented = 0;     // inputs before these are done with
+    while (!events.empty()) {
+        SimEvent e = events.top();
+        events.pop();
+        switch (e.type) {
+        case SIM_INPUT: {
+            SimInput& in = inputs[e.index];
+            if (in.kind == LATENCY_KEY) {
+                in.x = caretX;
+                in.y = caretY;
+                caretX += 12;
+                if (caretX > 700) { caretX = 40; caretY = caretY >= 400 ? 40 : caretY + 24; }
+                events.push({ in.t + 2000 + (int64_t)(Uniform() * 18000), SIM_APPLY, e.index });
+                in.timed = true;
+            } else if (in.kind == LATENCY_CLICK) {
+                in.x = pointerX;
+                in.y = pointerY;
+                events.push({ in.t + 5000 + (int64_t)(Uniform() * 35000), SIM_APPLY, e.index });
+                in.timed = true;
+            } else {
+                pointerX = 20 + (int)(Uniform() * 740);
+                pointerY = 20 + (int)(Uniform() * 680);
+                in.x = pointerX;
+                in.y = pointerY;
+                in.timed = pointerWaiting < 0;
+                if (in.timed) pointerWaiting = e.index;
+                if (!cursorQueued) {
+                    events.push({ std::max(in.t, lastCursorUs + refreshUs), SIM_CURSOR, 0 });
+                    cursorQueued = true;
+                }
+            }
+            LatencyInput(&tracker, (LatencyKind)in.kind, in.t, in.x, in.y);
+            break;
+        }
+        case SIM_APPLY: {
+            SimInput& in = inputs[e.index];
+            uint32_t color = 0xFF000000u | (uint32_t)e.index * 2654435761u >> 8;
+            if (in.kind == LATENCY_KEY) Fill(frame, in.x, in.y, in.x + 10, in.y + 16, color);
+            else                        Fill(frame, in.x - 30, in.y - 10, in.x + 30, in.y + 10, color);
+            in.applied = true;
+            break;
+        }
+        case SIM_CAPTURE: {
+            if (video) {
+                uint32_t c = 0xFF000000u | (uint32_t)e.index * 0x010305u;
+                Fill(frame, 900, 450, 1240, 700, c);
+            }
+            RegionUpdate(&regions, frame.data(), SIM_WIDTH);
+            LatencyCapture(&tracker, e.t, &regions, false);
+            for (size_t i = uncaptured; i < inputs.size() && inputs[i].t <= e.t; i++) {
+                SimInput& in = inputs[i];
+                if (in.kind != LATENCY_POINTER && in.applied && in.frame < 0) in.frame = e.index;
+            }
+            while (uncaptured < inputs.size() && (inputs[uncaptured].kind == LATENCY_POINTER || inputs[uncaptured].frame >= 0))
+                uncaptured++;
+            events.push({ e.t + 3000 + (int64_t)(Uniform() * 7000), SIM_PRESENT, e.index });
+            frames++;
+            break;
+        }
+        case SIM_PRESENT:
+            LatencyPresent(&tracker, e.t);
+            // The mirror draws the cursor again right after each frame
+            LatencyCursorDrawn(&tracker, e.t);
+            for (size_t i = unpresented; i < inputs.size() && inputs[i].t <= e.t; i++) {
+                SimInput& in = inputs[i];
+                if (in.frame == e.index && in.truthUs < 0) in.truthUs = e.t - in.t;
+            }
+            while (unpresented < inputs.size() && (inputs[unpresented].kind == LATENCY_POINTER || inputs[unpresented].truthUs >= 0))
+                unpresented++;
+            if (pointerWaiting >= 0 && inputs[pointerWaiting].t < e.t) {
+                inputs[pointerWaiting].truthUs = e.t - inputs[pointerWaiting].t;
+                pointerWaiting = -1;
+            }
+            lastCursorUs = e.t;
+            break;
+        case SIM_CURSOR:
+            LatencyCursorDrawn(&tracker, e.t);
+            if (pointerWaiting >= 0 && inputs[pointerWaiting].t < e.t) {
+                inputs[pointerWaiting].truthUs = e.t - inputs[pointerWaiting].t;
+                pointerWaiting = -1;
+            }
+            lastCursorUs = e.t;
+            cursorQueued = false;
+            break;
+        }
+    }
+
+    static const char* const names[LATENCY_KIND_COUNT] = { "pointer", "click", "key" };
+    printf("%.0f s simulated, %zu inputs, %u frames at %.0f fps, cursor at %.0f Hz%s\n",
+           seconds, inputs.size(), frames, fps, refreshHz, video ? ", video playing" : "");
+    printf("%-8s %8s %8s   %17s %17s %17s\n", "", "truth n", "tracked", "p50 truth/tracked",
+           "p95 truth/tracked", "p99 truth/tracked");
+    bool ok = true;
+    double tolMs = TOLERANCE_MS + TOLERANCE_FRAME * periodUs / 1000.0;
+    for (int k = 0; k < LATENCY_KIND_COUNT; k++) {
+        std::vector<double> truth;
+        for (const SimInput& in : inputs)
+            if (in.kind == k && in.timed && in.truthUs >= 0) truth.push_back(in.truthUs / 1000.0);
+        LatencySummary s;
+        LatencySummarize(&tracker, (LatencyKind)k, &s);
+        double t50 = TruthPercentile(truth, 50), t95 = TruthPercentile(truth, 95), t99 = TruthPercentile(truth, 99);
+        printf("%-8s %8zu %8u   %7.2f / %7.2f %7.2f / %7.2f %7.2f / %7.2f ms\n", names[k], truth.size(), s.count,
+               t50, s.p50Ms, t95, s.p95Ms, t99, s.p99Ms);
+        ok = ok && s.count >= truth.size() * 98 / 100 &&
+             fabs(t50 - s.p50Ms) <= tolMs && fabs(t95 - s.p95Ms) <= tolMs;
+    }
+    printf("no visible effect %u, dropped %u\n%s (within %.1f ms)\n", tracker.unseen, tracker.dropped,
+           ok ? "agrees" : "DISAGREES", tolMs);
+    RegionFree(&regions);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+// PacerCheck.cpp : deadline, skip and vsync checks for the frame pacer (FramePacer.h).
+//
+// Runs the frame clock loop against a simulated clock, with a scripted
+// wake-up latency and scripted stalls, so every deadline is exact:
+//   grid      deadlines stay on start + k * period however late each wake-up
+//             is; a frame late by less than a period does not move the
+//             next deadline, and the mean interval is the period exactly
+//   skip      a frame late by whole periods skips to the first grid point
+//             after now, returning (and counting) the points it missed
+//   vsync     PacerAlignPeriod rounds to the nearest whole number of
+//             refreshes; an aligned period keeps every frame on the wall
+//             for the same number of refreshes, an unaligned one does not
+//   stats     FrameIntervals reports the mean, extremes, percentiles and
+//             late frames of a known cadence, and Restart loses no interval
+// and prints the cost of one PacerAdvance.
+//
+// Build:  g++ -std=c++17 -O2 -I../TeacherToolkit PacerCheck.cpp ../TeacherToolkit/FramePacer.cpp -o PacerCheck
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit PacerCheck.cpp ..\TeacherToolkit\FramePacer.cpp
+// Usage:  PacerCheck [--frames 10000]
+// Exit:   0 every check passed, 1 one failed, 2 bad arguments
+
+#include "FramePacer.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        g_failures++;
+    }
+}
+
+// The injected clock: time only moves when the loop says so
+struct SimClock {
+    int64_t  nowUs;
+    uint32_t seed;
+};
+
+static uint32_t NextRandom(SimClock* clock)
+{
+    clock->seed = clock->seed * 1664525u + 1013904223u;
+    return clock->seed >> 8;
+}
+
+// One pass of the frame clock loop: wait for the deadline (waking up to
+// 2 ms late), then advance. Returns the deadline that was waited for.
+static int64_t Tick(FramePacer* pacer, SimClock* clock, int64_t stallUs, int* skipped)
+{
+    int64_t deadline = PacerNextDeadline(pacer);
+    if (clock->nowUs < deadline) clock->nowUs = deadline;
+    clock->nowUs += 100 + NextRandom(clock) % 1900 + stallUs;
+    *skipped = PacerAdvance(pacer, clock->nowUs);
+    return deadline;
+}
+
+static void CheckGrid(int frames)
+{
+    const int64_t periodUs = 33333, startUs = 5000000;
+    SimClock clock = { startUs, 1 };
+    FramePacer pacer;
+    FrameIntervals iv;
+    PacerInit(&pacer, periodUs, clock.nowUs);
+    IntervalsReset(&iv, periodUs);
+    Check(PacerNextDeadline(&pacer) == startUs + periodUs, "the first deadline is one period after init");
+
+    bool onGrid = true, noSkips = true;
+    for (int k = 1; k <= frames; k++) {
+        int skipped = 0;
+        int64_t deadline = Tick(&pacer, &clock, 0, &skipped);
+        onGrid = onGrid && deadline == startUs + k * periodUs;
+        noSkips = noSkips && skipped == 0;
+        IntervalsRecord(&iv, deadline);
+    }
+    Check(onGrid, "deadlines stay on start + k * period");
+    Check(noSkips && pacer.skipped == 0 && pacer.ticks == (uint64_t)frames, "late wake-ups within a period skip nothing");
+
+    // Late, but by less than one period: the next deadline does not move
+    int skipped = 0;
+    int64_t next = PacerNextDeadline(&pacer);
+    clock.nowUs = next + periodUs - 1;
+    skipped = PacerAdvance(&pacer, clock.nowUs);
+    Check(skipped == 0 && PacerNextDeadline(&pacer) == next + periodUs, "a frame late by under a period keeps the grid");
+
+    FrameIntervalSummary s;
+    IntervalsSummarize(&iv, &s);
+    Check(s.count == (uint32_t)frames - 1 && s.minMs == s.maxMs && s.meanMs == periodUs / 1000.0 && s.late == 0,
+          "deadline intervals are exactly one period");
+    printf("grid: %d frames at %lld us with up to 2 ms wake-up latency, mean %.3f ms, 0 skipped\n",
+           frames, (long long)periodUs, s.meanMs);
+
+    PacerInit(&pacer, 0, 0);
+    Check(pacer.periodUs == 1 && PacerNextDeadline(&pacer) == 1, "a zero period is clamped to 1 us");
+}
+
+static void CheckSkip()
+{
+    const int64_t periodUs = 20000, startUs = 0;
+    SimClock clock = { startUs, 7 };
+    FramePacer pacer;
+    PacerInit(&pacer, periodUs, clock.nowUs);
+
+    // Stalls in periods; the latency adds 0.1 to 2 ms on top
+    const int stalls[] = { 0, 1, 0, 3, 0, 0, 10, 2, 0, 250, 0, 1 };
+    bool exact = true, after = true, grid = true;
+    uint64_t total = 0;
+    for (int stall : stalls) {
+        int skipped = 0;
+        int64_t deadline = Tick(&pacer, &clock, stall * periodUs, &skipped);
+
+        // Grid points in (deadline, now] were missed
+        int64_t missed = (clock.nowUs - deadline) / periodUs;
+        exact = exact && skipped == missed;
+        total += (uint64_t)skipped;
+        int64_t next = PacerNextDeadline(&pacer);
+        after = after && next > clock.nowUs && next - clock.nowUs <= periodUs;
+        grid = grid && (next - startUs) % periodUs == 0;
+    }
+    Check(exact, "a stall skips exactly the grid points it covered");
+    Check(after, "after a stall the next deadline is the first grid point after now");
+    Check(grid, "skipping stays on the grid");
+    Check(pacer.skipped == total && total == 267, "skipped counts every missed grid point");
+
+    // Waking exactly on the following grid point skips it too
+    int64_t next = PacerNextDeadline(&pacer);
+    int skipped = PacerAdvance(&pacer, next + periodUs);
+    Check(skipped == 1 && PacerNextDeadline(&pacer) == next + 2 * periodUs, "a wake-up on the next grid point skips it");
+    printf("skip: %d ticks with stalls of up to 250 periods, %llu grid points skipped\n",
+           (int)(sizeof(stalls) / sizeof(stalls[0])) + 1, (unsigned long long)pacer.skipped);
+}
+
+// Refreshes each frame stays on the wall, for frames presented at the
+// first vsync after deadline + latency; true if they are all equal
+static bool EvenOnWall(int64_t periodUs, int refreshHz, int frames, int* minRefreshes, int* maxRefreshes)
+{
+    const double refreshUs = 1000000.0 / refreshHz;
+    SimClock clock = { (int64_t)(refreshUs * 100) + 3000, 3 };    // 3 ms after a vsync
+    FramePacer pacer;
+    PacerInit(&pacer, periodUs, clock.nowUs);
+    int64_t lastVsync = -1;
+    *minRefreshes = 1 << 30;
+    *maxRefreshes = 0;
+    for (int k = 0; k < frames; k++) {
+        int skipped = 0;
+        Tick(&pacer, &clock, 0, &skipped);
+        int64_t vsync = (int64_t)ceil(clock.nowUs / refreshUs);
+        if (lastVsync >= 0) {
+            int n = (int)(vsync - lastVsync);
+            if (n < *minRefreshes) *minRefreshes = n;
+            if (n > *maxRefreshes) *maxRefreshes = n;
+        }
+        lastVsync = vsync;
+    }
+    return *minRefreshes == *maxRefreshes;
+}
+
+static void CheckVsync()
+{
+    const int rates[] = { 24, 30, 50, 59, 60, 75, 90, 120, 144, 165, 240 };
+    bool nearest = true;
+    for (int hz : rates) {
+        double refreshUs = 1000000.0 / hz;
+        for (int64_t target = 1000; target <= 200000; target += 777) {
+            int64_t p = PacerAlignPeriod(target, hz);
+            double n = p / refreshUs;
+            bool whole = fabs(n - floor(n + 0.5)) * refreshUs <= 0.5;
+            bool closest = fabs((double)p - target) <= refreshUs / 2 + 0.5 || (target < refreshUs && floor(n + 0.5) == 1.0);
+            nearest = nearest && whole && closest && n > 0.5;
+        }
+    }
+    Check(nearest, "PacerAlignPeriod rounds to the nearest whole number of refreshes");
+    Check(PacerAlignPeriod(40000, 60) == 33333 && PacerAlignPeriod(45000, 60) == 50000 &&
+          PacerAlignPeriod(5000, 60) == 16667 && PacerAlignPeriod(40000, 144) == 41667,
+          "PacerAlignPeriod examples (40 ms and 45 ms at 60 Hz, 5 ms at 60 Hz, 40 ms at 144 Hz)");
+    Check(PacerAlignPeriod(40000, 0) == 40000, "an unknown refresh rate keeps the target");
+
+    int alignedMin, alignedMax, rawMin, rawMax;
+    bool aligned = EvenOnWall(PacerAlignPeriod(40000, 60), 60, 1000, &alignedMin, &alignedMax);
+    bool raw = EvenOnWall(40000, 60, 1000, &rawMin, &rawMax);
+    Check(aligned && alignedMin == 2, "an aligned period keeps every frame up for the same refreshes");
+    Check(!raw, "an unaligned period does not (the check can tell)");
+    printf("vsync: 40 ms at 60 Hz aligned to %lld us, frames up for %d refreshes; unaligned %d to %d\n",
+           (long long)PacerAlignPeriod(40000, 60), alignedMin, rawMin, rawMax);
+}
+
+static void CheckStats()
+{
+    // 96 frames 10 ms apart, 3 at 20 ms, 1 at 120 ms
+    const int64_t periodUs = 10000;
+    FrameIntervals iv;
+    IntervalsReset(&iv, periodUs);
+    int64_t t = 1000;
+    IntervalsRecord(&iv, t);
+    for (int k = 0; k < 100; k++) {
+        t += k < 96 ? periodUs : k < 99 ? 2 * periodUs : 12 * periodUs;
+        IntervalsRecord(&iv, t);
+        if (k == 49) IntervalsRestart(&iv, periodUs);       // a window boundary
+    }
+    FrameIntervalSummary s;
+    IntervalsSummarize(&iv, &s);
+    double mean = (46 * 10.0 + 3 * 20.0 + 120.0) / 50;
+    Check(s.count == 50, "Restart keeps the previous frame, so no interval is lost");
+    Check(s.late == 4 && s.minMs == 10.0 && s.maxMs == 120.0 && fabs(s.meanMs - mean) < 1e-9,
+          "count, late frames, extremes and mean of a known cadence");
+    Check(s.p50Ms == 10.25 && s.p95Ms == 20.25 && s.p99Ms == 100.0,
+          "percentiles are the upper edge of their 0.25 ms bucket, the last bucket ending at 100 ms");
+    printf("stats: mean %.2f ms, jitter %.2f ms, p50/p95/p99 %.2f/%.2f/%.2f ms, %u late\n",
+           s.meanMs, s.jitterMs, s.p50Ms, s.p95Ms, s.p99Ms, s.late);
+
+    IntervalsReset(&iv, periodUs);
+    IntervalsRecord(&iv, 5000);
+    IntervalsRecord(&iv, 4000);                              // clock went backwards
+    IntervalsSummarize(&iv, &s);
+    Check(s.count == 0, "a backwards step records no interval");
+}
+
+static void Cost()
+{
+    FramePacer pacer;
+    PacerInit(&pacer, 16667, 0);
+    const int n = 10000000;
+    int64_t now = 0, skipped = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        now = PacerNextDeadline(&pacer) + (i & 1023);
+        skipped += PacerAdvance(&pacer, now);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("cost: %.1f ns per PacerAdvance (%lld skipped)\n", ns / n, (long long)skipped);
+}
+
+int main(int argc, char** argv)
+{
+    int frames = 10000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) {
+            frames = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: PacerCheck [--frames 10000]\n");
+            return 2;
+        }
+    }
+    if (frames < 2) return 2;
+
+    CheckGrid(frames);
+    CheckSkip();
+    CheckVsync();
+    CheckStats();
+    Cost();
+
+    printf("%s\n", g_failures ? "FAILED" : "all checks passed");
+    return g_failures ? 1 : 0;
+}
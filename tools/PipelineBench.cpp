@@ -0,0 +1,133 @@
+// PipelineBench.cpp : fused vs stage-by-stage pixel pipeline (PixelPipeline.h).
+//
+// Builds the stages the mirror runs on each captured frame (privacy masks,
+// a few annotation strokes, a colour table and the tile hashes) over a
+// synthetic frame, then times both ways of running them: every stage over
+// the whole frame in turn, and the fused single pass. Before each run the
+// frame is refilled and the caches flushed with a large scratch buffer, as
+// after a screen capture. Prints median ns/frame and the frame bytes each
+// variant moves, and checks that both produce the same pixels and hashes.
+//
+// Build:  g++ -std=c++17 -O2 -I../TeacherToolkit PipelineBench.cpp ../TeacherToolkit/MaskSpans.cpp ../TeacherToolkit/Annotate.cpp ../TeacherToolkit/RegionClassify.cpp -o PipelineBench
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit PipelineBench.cpp ..\TeacherToolkit\MaskSpans.cpp ..\TeacherToolkit\Annotate.cpp ..\TeacherToolkit\RegionClassify.cpp
+// Usage:  PipelineBench [--width 1920] [--height 1080] [--frames 50] [--pixelate 16]
+// Exit:   0 both variants produced the same frame, 1 they differ, 2 bad arguments
+
+#include "PixelPipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define FLUSH_BYTES     (64u << 20)
+
+static std::vector<uint8_t> g_flush(FLUSH_BYTES);
+
+static void FlushCaches()
+{
+    for (size_t i = 0; i < g_flush.size(); i += 64) g_flush[i]++;
+}
+
+static double NowNs()
+{
+    using namespace std::chrono;
+    return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static double Median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0.0 : v[v.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+    int width = 1920, height = 1080, frames = 50, pixelate = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--width") == 0)         width = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--height") == 0)   height = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--frames") == 0)   frames = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--pixelate") == 0) pixelate = atoi(argv[i + 1]);
+    }
+    if (width < 256 || height < 256 || frames < 1) {
+        fprintf(stderr, "usage: PipelineBench [--width 1920] [--height 1080] [--frames 50] [--pixelate 16]\n");
+        return 2;
+    }
+
+    // A desktop-ish frame: gradients with some text-like noise
+    std::vector<uint32_t> source((size_t)width * height);
+    uint32_t seed = 12345;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++) {
+            seed = seed * 1664525u + 1013904223u;
+            uint32_t noise = (seed >> 28) == 0 ? 0x00404040u : 0;
+            source[(size_t)y * width + x] = 0xFF000000u | ((x * 255 / width) << 16) | ((y * 255 / height) << 8) | noise;
+        }
+
+    MaskRect rects[] = {
+        { 0, height - 48, width, height },                              // taskbar
+        { width / 2, height / 8, width / 2 + 640, height / 8 + 420 },   // a masked window
+    };
+    MaskSet masks = {};
+    MaskUpdate(&masks, rects, 2, width, height);
+
+    AnnotationLayer annot = {};
+    AnnotInit(&annot, width, height);
+    for (int s = 0; s < 6; s++) {
+        AnnotBeginStroke(&annot, 100.0f + s * 120, 200.0f, 0xC0E53935, 5.0f);
+        for (int k = 1; k <= 40; k++)
+            AnnotAddPoint(&annot, 100.0f + s * 120 + 60 * sinf(k * 0.3f), 200.0f + k * 10.0f);
+        AnnotEndStroke(&annot);
+    }
+
+    uint8_t lut[256];
+    for (int i = 0; i < 256; i++) lut[i] = (uint8_t)(255.0 * pow(i / 255.0, 0.8) + 0.5);
+
+    int tilesX = (width + PIXEL_TILE - 1) / PIXEL_TILE, tilesY = (height + PIXEL_TILE - 1) / PIXEL_TILE;
+    std::vector<uint64_t> hashesA((size_t)tilesX * tilesY), hashesB(hashesA.size());
+
+    MaskMode mode = pixelate ? MASK_PIXELATE : MASK_BLACK;
+    int blockPx = pixelate ? pixelate : 16;
+    if (!MaskStage::Fusable(mode, blockPx)) {
+        fprintf(stderr, "--pixelate %d: blocks straddle tiles, cannot be fused\n", pixelate);
+        return 2;
+    }
+    auto unfused = FusePixelStages(MaskStage{ &masks, mode, blockPx }, AnnotStage{ &annot },
+                                   LutStage{ lut, lut, lut }, HashStage{ hashesA.data(), tilesX });
+    auto fused   = FusePixelStages(MaskStage{ &masks, mode, blockPx }, AnnotStage{ &annot },
+                                   LutStage{ lut, lut, lut }, HashStage{ hashesB.data(), tilesX });
+
+    std::vector<uint32_t> frameA(source.size()), frameB(source.size());
+    std::vector<double> nsA, nsB;
+    PixelPassStats statsA = {}, statsB = {};
+    for (int f = 0; f < frames; f++) {
+        memcpy(frameA.data(), source.data(), source.size() * sizeof(uint32_t));
+        FlushCaches();
+        double t0 = NowNs();
+        statsA = unfused.RunUnfused(frameA.data(), width, width, height);
+        nsA.push_back(NowNs() - t0);
+
+        memcpy(frameB.data(), source.data(), source.size() * sizeof(uint32_t));
+        FlushCaches();
+        t0 = NowNs();
+        statsB = fused.Run(frameB.data(), width, width, height);
+        nsB.push_back(NowNs() - t0);
+    }
+
+    bool same = frameA == frameB && hashesA == hashesB;
+    double mbA = (double)(statsA.bytesRead + statsA.bytesWritten) / (1 << 20);
+    double mbB = (double)(statsB.bytesRead + statsB.bytesWritten) / (1 << 20);
+    printf("%dx%d, 4 stages (masks%s, annotations, colour table, tile hashes), %d frames\n",
+           width, height, pixelate ? " pixelated" : "", frames);
+    printf("  unfused  %9.0f ns/frame  %7.1f MB moved\n", Median(nsA), mbA);
+    printf("  fused    %9.0f ns/frame  %7.1f MB moved\n", Median(nsB), mbB);
+    printf("  speedup  %.2fx, traffic %.2fx less, output %s\n",
+           Median(nsB) > 0 ? Median(nsA) / Median(nsB) : 0.0, mbB > 0 ? mbA / mbB : 0.0,
+           same ? "identical" : "DIFFERENT");
+    AnnotFree(&annot);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+// RegionCheck.cpp : tile classification checks on synthetic mixed content (RegionClassify.h).
+//
+// Feeds RegionUpdate a scripted 1280x720 desktop (a partial last tile row,
+// and a padded stride whose padding changes every frame) and checks the
+// labels and dirty tiles frame by frame:
+//   text      a page of text that never changes is static, and only dirty
+//             on the first frame
+//   video     a smooth moving picture becomes video on the sixth frame of
+//             change, stays video while it plays, is repainted once when
+//             it stops, and settles to static after the history window
+//   busy      scrolling text changes every frame but is never video;
+//             typing every fourth frame is occasional
+//   dirty     each frame's dirty count is exactly the tiles that changed
+//             plus those leaving video, and counts[] covers every tile
+//   hashed    RegionUpdateHashed with RegionHashTile hashes gives the same
+//             labels and dirty tiles as RegionUpdate
+// and prints the time RegionUpdate takes per frame.
+//
+// Build:  g++ -std=c++17 -O2 -I../TeacherToolkit RegionCheck.cpp ../TeacherToolkit/RegionClassify.cpp -o RegionCheck
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit RegionCheck.cpp ..\TeacherToolkit\RegionClassify.cpp
+// Usage:  RegionCheck [--frames 500]   (frames for the timing run)
+// Exit:   0 every check passed, 1 one failed, 2 bad arguments
+
+#include "RegionClassify.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define FRAME_W         1280
+#define FRAME_H         720
+#define FRAME_STRIDE    (FRAME_W + 24)
+#define VIDEO_STOP      100     // first frame the video no longer changes
+#define SCRIPT_FRAMES   160
+
+enum Area { AREA_TEXT, AREA_TYPING, AREA_VIDEO, AREA_SCROLL };
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        g_failures++;
+    }
+}
+
+// Tile layout of the synthetic desktop; everything else is a static page
+static Area AreaOf(int tx, int ty)
+{
+    if (ty == 0 && tx >= 12 && tx <= 13) return AREA_TYPING;
+    if (ty >= 2 && ty <= 7 && tx >= 10 && tx <= 17) return AREA_VIDEO;
+    if (ty >= 9 && ty <= 10 && tx >= 10 && tx <= 17) return AREA_SCROLL;
+    return AREA_TEXT;
+}
+
+static uint32_t Mix(uint32_t v)
+{
+    v ^= v >> 16;
+    v *= 0x7FEB352Du;
+    v ^= v >> 15;
+    v *= 0x846CA68Bu;
+    return v ^ (v >> 16);
+}
+
+// Dark strokes on white in 8x16 character cells, 12 rows of ink each
+static uint32_t TextPixel(int x, int y, uint32_t seed)
+{
+    int rx = x & 7, ry = y & 15;
+    if (rx >= 6 || ry >= 12) return 0xFFFFFFFFu;
+    uint32_t bits = Mix((uint32_t)(x >> 3) * 0x9E3779B9u ^ (uint32_t)(y >> 4) * 0x85EBCA6Bu ^ seed);
+    return (bits >> (rx + 6 * (ry / 4)) & 1) ? 0xFF202020u : 0xFFFFFFFFu;
+}
+
+// A gradient sliding diagonally: every pixel changes, no hard edges
+static uint32_t VideoPixel(int x, int y, int phase)
+{
+    int v = (x + 2 * y + 5 * phase) % 512;
+    v = v < 256 ? v : 511 - v;
+    return 0xFF000000u | (uint32_t)v << 16 | (uint32_t)(v / 2 + 64) << 8 | (uint32_t)(255 - v);
+}
+
+static bool VideoChanges(int t) { return t < VIDEO_STOP; }
+static bool TypingChanges(int t) { return t > 0 && t % 4 == 0; }
+
+static void Render(std::vector<uint32_t>& frame, int t)
+{
+    int phase = VideoChanges(t) ? t : VIDEO_STOP - 1;
+    for (int y = 0; y < FRAME_H; y++) {
+        uint32_t* row = frame.data() + (size_t)y * FRAME_STRIDE;
+        for (int x = 0; x < FRAME_W; x++) {
+            switch (AreaOf(x / REGION_TILE, y / REGION_TILE)) {
+            case AREA_TEXT:   row[x] = TextPixel(x, y, 0); break;
+            case AREA_TYPING: row[x] = TextPixel(x, y, 1 + (uint32_t)(t / 4)); break;
+            case AREA_VIDEO:  row[x] = VideoPixel(x, y, phase); break;
+            case AREA_SCROLL: row[x] = TextPixel(x, y + 3 * t, 7); break;
+            }
+        }
+        for (int x = FRAME_W; x < FRAME_STRIDE; x++) row[x] = Mix((uint32_t)(t * FRAME_H + y) ^ (uint32_t)x);
+    }
+}
+
+// Every tile of an area has the label
+static bool AreaIs(const RegionMap& map, Area area, RegionClass label)
+{
+    for (int ty = 0; ty < map.tilesY; ty++)
+        for (int tx = 0; tx < map.tilesX; tx++)
+            if (AreaOf(tx, ty) == area && map.tiles[(size_t)ty * map.tilesX + tx].label != label) return false;
+    return true;
+}
+
+static bool AreaDirty(const RegionMap& map, Area area, bool dirty)
+{
+    for (int ty = 0; ty < map.tilesY; ty++)
+        for (int tx = 0; tx < map.tilesX; tx++)
+            if (AreaOf(tx, ty) == area && map.tiles[(size_t)ty * map.tilesX + tx].dirty != dirty) return false;
+    return true;
+}
+
+static void CheckScript()
+{
+    std::vector<uint32_t> frame((size_t)FRAME_STRIDE * FRAME_H);
+    RegionMap map, hashed;
+    RegionInit(&map, FRAME_W, FRAME_H);
+    RegionInit(&hashed, FRAME_W, FRAME_H);
+    Check(map.tilesX == 20 && map.tilesY == 12, "1280x720 is 20x12 tiles, the last row partial");
+
+    int areaTiles[4] = {};
+    for (int ty = 0; ty < map.tilesY; ty++)
+        for (int tx = 0; tx < map.tilesX; tx++) areaTiles[AreaOf(tx, ty)]++;
+    int total = map.tilesX * map.tilesY;
+
+    std::vector<uint64_t> tileHashes((size_t)total);
+    bool textClean = true, scrollNeverVideo = true, dirtyExact = true, countsCover = true, same = true;
+    bool playing = true, stopRepaint = false, afterStopClean = true;
+    int firstVideo = -1, lastVideo = -1, firstStatic = -1, totalDirty = 0;
+
+    for (int t = 0; t < SCRIPT_FRAMES; t++) {
+        Render(frame, t);
+        int dirty = RegionUpdate(&map, frame.data(), FRAME_STRIDE);
+
+        for (int ty = 0; ty < map.tilesY; ty++) {
+            for (int tx = 0; tx < map.tilesX; tx++) {
+                int x0 = tx * REGION_TILE, y0 = ty * REGION_TILE;
+                int x1 = x0 + REGION_TILE < FRAME_W ? x0 + REGION_TILE : FRAME_W;
+                int y1 = y0 + REGION_TILE < FRAME_H ? y0 + REGION_TILE : FRAME_H;
+                tileHashes[(size_t)ty * map.tilesX + tx] = RegionHashTile(frame.data(), FRAME_STRIDE, x0, y0, x1, y1);
+            }
+        }
+        int dirtyHashed = RegionUpdateHashed(&hashed, frame.data(), FRAME_STRIDE, tileHashes.data());
+        same = same && dirty == dirtyHashed && memcmp(map.counts, hashed.counts, sizeof(map.counts)) == 0;
+        for (int i = 0; i < total; i++) {
+            const RegionTile& a = map.tiles[i];
+            const RegionTile& b = hashed.tiles[i];
+            same = same && a.hash == b.hash && a.label == b.label && a.dirty == b.dirty && a.history == b.history;
+        }
+
+        int counted = 0;
+        for (int c = 0; c < REGION_CLASS_COUNT; c++) counted += map.counts[c];
+        countsCover = countsCover && counted == total;
+
+        if (t > 0) textClean = textClean && AreaDirty(map, AREA_TEXT, false);
+        scrollNeverVideo = scrollNeverVideo && !AreaIs(map, AREA_SCROLL, REGION_VIDEO);
+
+        bool video = AreaIs(map, AREA_VIDEO, REGION_VIDEO);
+        if (video && firstVideo < 0) firstVideo = t;
+        if (video) lastVideo = t;
+        if (firstStatic < 0 && t >= VIDEO_STOP && AreaIs(map, AREA_VIDEO, REGION_STATIC)) firstStatic = t;
+
+        // Tiles leaving video are repainted once, even though unchanged
+        bool leaving = playing && t >= VIDEO_STOP && !video;
+        if (leaving) {
+            stopRepaint = AreaDirty(map, AREA_VIDEO, true);
+            playing = false;
+        } else if (t >= VIDEO_STOP) {
+            afterStopClean = afterStopClean && AreaDirty(map, AREA_VIDEO, false);
+        }
+
+        int expected = t == 0 ? total
+                     : areaTiles[AREA_SCROLL] +
+                       (VideoChanges(t) || leaving ? areaTiles[AREA_VIDEO] : 0) +
+                       (TypingChanges(t) ? areaTiles[AREA_TYPING] : 0);
+        dirtyExact = dirtyExact && dirty == expected;
+        totalDirty += dirty;
+
+        if (t == 40) {
+            Check(AreaIs(map, AREA_TEXT, REGION_STATIC), "a page of text is static");
+            Check(AreaIs(map, AREA_VIDEO, REGION_VIDEO), "a playing video is video");
+            Check(AreaIs(map, AREA_SCROLL, REGION_OCCASIONAL), "scrolling text is occasional");
+            Check(AreaIs(map, AREA_TYPING, REGION_OCCASIONAL), "typing is occasional");
+        }
+    }
+
+    Check(textClean, "unchanged text is only dirty on the first frame");
+    Check(firstVideo == 6, "video is recognised on its sixth frame of change");
+    Check(scrollNeverVideo, "text changing every frame is never video");
+    Check(lastVideo == VIDEO_STOP + 4, "video stays video while it still changed in 3 of the last 8 frames");
+    Check(!playing && stopRepaint, "tiles leaving video are repainted once");
+    Check(afterStopClean, "a stopped video is otherwise not repainted");
+    Check(firstStatic == VIDEO_STOP + 29, "a stopped video settles to static after the history window");
+    Check(dirtyExact, "dirty tiles are exactly the changed ones plus those leaving video");
+    Check(countsCover, "counts[] covers every tile");
+    Check(same, "RegionUpdateHashed matches RegionUpdate");
+
+    printf("script: %d frames of %dx%d, %d tiles (%d text, %d video, %d scrolling, %d typing), "
+           "video from frame %d to %d, static again at %d, %d tiles repainted in all\n",
+           SCRIPT_FRAMES, FRAME_W, FRAME_H, total, areaTiles[AREA_TEXT], areaTiles[AREA_VIDEO],
+           areaTiles[AREA_SCROLL], areaTiles[AREA_TYPING], firstVideo, lastVideo, firstStatic, totalDirty);
+    RegionFree(&map);
+    RegionFree(&hashed);
+}
+
+static void Timing(int frames)
+{
+    // A few pre-rendered frames in turn, so only RegionUpdate is timed
+    std::vector<std::vector<uint32_t>> rendered(8, std::vector<uint32_t>((size_t)FRAME_STRIDE * FRAME_H));
+    for (int i = 0; i < (int)rendered.size(); i++) Render(rendered[i], i + 1);
+
+    RegionMap map;
+    RegionInit(&map, FRAME_W, FRAME_H);
+    long long dirty = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < frames; t++)
+        dirty += RegionUpdate(&map, rendered[t % rendered.size()].data(), FRAME_STRIDE);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    printf("timing: %.1f us per RegionUpdate at %dx%d, %.1f dirty tiles per frame\n",
+           us / frames, FRAME_W, FRAME_H, (double)dirty / frames);
+    RegionFree(&map);
+}
+
+int main(int argc, char** argv)
+{
+    int frames = 500;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) {
+            frames = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: RegionCheck [--frames 500]\n");
+            return 2;
+        }
+    }
+    if (frames <= 0) return 2;
+
+    CheckScript();
+    Timing(frames);
+
+    printf("%s\n", g_failures ? "FAILED" : "all checks passed");
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,363 @@
+// ReplayCheck.cpp : codec, eviction and sequence checks for the replay history (ReplayRing.h).
+//
+// Drives a ReplayRing with scripted frames (a static page with a moving
+// box, a noisy tile that only compresses raw, and repeated frames that
+// must not be stored) and decodes what it kept:
+//   codec     every tile encodes and decodes back to exactly its input,
+//             whatever its runs and size; truncated or padded streams are
+//             rejected
+//   window    with a loose budget, the ring keeps exactly the frames of
+//             the last maxAgeMs, each decoding to the frame captured
+//   budget    with a tight budget, bytes never exceed it (unless one frame
+//             alone does), evicted tile versions are reused, the byte and
+//             reference counts match a recount, and the stored frames still
+//             decode exactly
+//   wrap      sequence numbers run through 2^32; decoding by seq, and
+//             clamping to the oldest and newest, keep working
+//   regions   capturing with the RegionClassify hashes stores the same as
+//             hashing in ReplayCapture
+// and prints the capture and commit time and the bytes kept per frame.
+//
+// Build:  g++ -std=c++17 -O2 -I../TeacherToolkit ReplayCheck.cpp ../TeacherToolkit/ReplayRing.cpp ../TeacherToolkit/RegionClassify.cpp -o ReplayCheck
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit ReplayCheck.cpp ..\TeacherToolkit\ReplayRing.cpp ..\TeacherToolkit\RegionClassify.cpp
+// Usage:  ReplayCheck [--frames 300]
+// Exit:   0 every check passed, 1 one failed, 2 bad arguments
+
+#include "ReplayRing.h"
+
+#include <chrono>
+#include <deque>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define FRAME_W         1000        // neither side a multiple of REGION_TILE
+#define FRAME_H         700
+#define FRAME_STRIDE    (FRAME_W + 16)
+#define FRAME_MS        40
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        g_failures++;
+    }
+}
+
+static uint32_t Mix(uint32_t v)
+{
+    v ^= v >> 16;
+    v *= 0x7FEB352Du;
+    v ^= v >> 15;
+    v *= 0x846CA68Bu;
+    return v ^ (v >> 16);
+}
+
+// Every seventh frame repeats the one before it
+static int SceneOf(int k) { return k % 7 == 6 ? k - 1 : k; }
+
+static void Render(std::vector<uint32_t>& frame, int k)
+{
+    // The page is the same in every frame
+    static std::vector<uint32_t> page;
+    if (page.empty()) {
+        page.resize((size_t)FRAME_W * FRAME_H);
+        for (int y = 0; y < FRAME_H; y++) {
+            for (int x = 0; x < FRAME_W; x++) {
+                uint32_t c = 0xFFF0F0F0u - (uint32_t)(y / 16 % 4) * 0x080808u;
+                if (y % 16 < 10 && (Mix((uint32_t)(x / 3) ^ (uint32_t)y * 7919u) & 7) == 0) c = 0xFF303030u;
+                page[(size_t)y * FRAME_W + x] = c;
+            }
+        }
+    }
+
+    int scene = SceneOf(k);
+    int boxX = (scene * 17) % (FRAME_W - 90), boxY = 300 + (scene * 5) % 200;
+    for (int y = 0; y < FRAME_H; y++) {
+        uint32_t* row = frame.data() + (size_t)y * FRAME_STRIDE;
+        memcpy(row, page.data() + (size_t)y * FRAME_W, FRAME_W * sizeof(uint32_t));
+        if (y >= boxY && y < boxY + 60)
+            for (int x = boxX; x < boxX + 90; x++) row[x] = 0xFFC04040u;
+        if (y < REGION_TILE)
+            for (int x = 0; x < REGION_TILE; x++) row[x] = Mix((uint32_t)(scene / 3) * 65599u ^ (uint32_t)(y * FRAME_W + x));
+        for (int x = FRAME_W; x < FRAME_STRIDE; x++) row[x] = Mix((uint32_t)(k * FRAME_H + y));
+    }
+}
+
+static bool SameImage(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+{
+    for (int y = 0; y < FRAME_H; y++)
+        if (memcmp(a.data() + (size_t)y * FRAME_STRIDE, b.data() + (size_t)y * FRAME_STRIDE, FRAME_W * sizeof(uint32_t)))
+            return false;
+    return true;
+}
+
+// The ring's byte count and blob references, recounted from its frames
+static bool Consistent(const ReplayRing& ring)
+{
+    std::vector<uint32_t> refs(ring.blobs.size(), 0);
+    for (const ReplayFrame& f : ring.frames)
+        for (uint32_t id : f.blobs) refs[id]++;
+    size_t bytes = ring.frames.size() * (sizeof(ReplayFrame) + (size_t)ring.tilesX * ring.tilesY * sizeof(uint32_t));
+    size_t live = 0;
+    for (size_t id = 0; id < ring.blobs.size(); id++) {
+        if (refs[id] != ring.blobs[id].refs) return false;
+        if (refs[id]) {
+            bytes += ring.blobs[id].data.capacity();
+            live++;
+        }
+    }
+    return bytes == ring.bytes && live + ring.freeBlobs.size() == ring.blobs.size();
+}
+
+// Captures and commits frame k; records which frame each stored seq holds
+static void Feed(ReplayRing* ring, ReplayJob* job, std::vector<uint32_t>& frame, int k,
+                 std::deque<int>* stored, const RegionMap* regions = nullptr)
+{
+    Render(frame, k);
+    if (!ReplayCapture(ring, job, frame.data(), FRAME_STRIDE, regions, (uint64_t)k * FRAME_MS)) return;
+    ReplayCommit(ring, job);
+    stored->push_back(k);
+    while (stored->size() > ring->frames.size()) stored->pop_front();
+}
+
+// Every stored frame decodes to the frame it was captured from
+static bool DecodesAll(const ReplayRing& ring, const std::deque<int>& stored)
+{
+    std::vector<uint32_t> want((size_t)FRAME_STRIDE * FRAME_H), got((size_t)FRAME_STRIDE * FRAME_H);
+    uint32_t seq = ReplayOldestSeq(&ring);
+    for (size_t i = 0; i < stored.size(); i++, seq++) {
+        uint64_t timeMs = 0;
+        Render(want, stored[i]);
+        if (!ReplayDecode(&ring, seq, got.data(), FRAME_STRIDE, &timeMs) ||
+            timeMs != (uint64_t)stored[i] * FRAME_MS || !SameImage(want, got))
+            return false;
+    }
+    return seq - 1 == ReplayNewestSeq(&ring);
+}
+
+static bool RoundTrips(const std::vector<uint32_t>& pixels, size_t* encoded)
+{
+    std::vector<uint8_t> data;
+    *encoded = ReplayEncodeTile(pixels.data(), (int)pixels.size(), &data);
+    std::vector<uint32_t> back(pixels.size() + 1, 0x12345678u);
+    if (*encoded != data.size() || !ReplayDecodeTile(data.data(), data.size(), back.data(), (int)pixels.size()))
+        return false;
+    if (memcmp(back.data(), pixels.data(), pixels.size() * sizeof(uint32_t)) || back.back() != 0x12345678u)
+        return false;
+
+    // No prefix of the stream (a sample of them for long ones), and nothing longer, decodes
+    for (size_t n = 0; n < data.size(); n += data.size() > 2000 ? 97 : 1)
+        if (ReplayDecodeTile(data.data(), n, back.data(), (int)pixels.size())) return false;
+    data.push_back(0);
+    return !ReplayDecodeTile(data.data(), data.size(), back.data(), (int)pixels.size());
+}
+
+static void CheckCodec()
+{
+    const int counts[] = { 1, 2, 3, 5, 37 * 5, 64 * 60, REPLAY_TILE_PIXELS, 0x8000 + 3, 70000 };
+    bool ok = true, solidSmall = true, noiseBounded = true;
+    int cases = 0;
+    uint32_t seed = 77;
+    for (int count : counts) {
+        bool big = count > REPLAY_TILE_PIXELS;
+        for (int pattern = 0; pattern < 6; pattern++) {
+            std::vector<uint32_t> p((size_t)count);
+            for (int i = 0; i < count; i++) {
+                seed = Mix(seed + (uint32_t)i);
+                switch (pattern) {
+                case 0: p[i] = 0xFF336699u; break;                          // one run
+                case 1: p[i] = seed; break;                                 // all literals
+                case 2: p[i] = (i / (1 + i % 4)) & 1 ? 0xFFFFFFFFu : 0xFF000000u; break;
+                case 3: p[i] = (uint32_t)((i % 7) < 2 ? 1 : (i % 7) < 5 ? 2 : i); break;  // runs of 2 and 3
+                case 4: p[i] = seed % 3 ? 0xFFF0F0F0u : seed; break;        // text-like
+                case 5: p[i] = i < count / 2 ? 0xFF000000u : seed; break;   // one long run, then noise
+                }
+            }
+            size_t encoded = 0;
+            ok = ok && RoundTrips(p, &encoded);
+            if (pattern == 0 && count >= 3) solidSmall = solidSmall && encoded <= 6 * (size_t)((count + 0x7FFF) / 0x8000);
+            if (pattern == 1 && !big) noiseBounded = noiseBounded && encoded <= (size_t)count * 4 + 2;
+            cases++;
+        }
+    }
+    Check(ok, "decode(encode(tile)) == tile; truncated or padded streams are rejected");
+    Check(solidSmall, "a solid tile of 3+ pixels encodes to one run per 32768");
+    Check(noiseBounded, "noise costs one header over raw pixels");
+    printf("codec: %d tiles round-tripped, sizes 1 to 70000 pixels\n", cases);
+}
+
+static void CheckWindow(int frames)
+{
+    const uint64_t maxAgeMs = 2000;
+    ReplayRing ring = {};
+    ReplayJob job;
+    std::vector<uint32_t> frame((size_t)FRAME_STRIDE * FRAME_H);
+    std::deque<int> stored;
+    ReplayInit(&ring, FRAME_W, FRAME_H, (size_t)1 << 40, maxAgeMs);
+    Check(ReplayIsEmpty(&ring), "a new ring is empty");
+
+    bool window = true, repeats = true, consistent = true, decodes = true;
+    for (int k = 0; k < frames; k++) {
+        size_t before = ring.frames.size();
+        uint32_t newest = ReplayNewestSeq(&ring);
+        Feed(&ring, &job, frame, k, &stored);
+        if (SceneOf(k) != k) repeats = repeats && ring.frames.size() == before && ReplayNewestSeq(&ring) == newest;
+
+        // The oldest frame is the first one within maxAgeMs of the newest
+        uint64_t newestMs = ring.frames.back().timeMs;
+        int first = 0;
+        while ((uint64_t)first * FRAME_MS + maxAgeMs < newestMs || SceneOf(first) != first) first++;
+        window = window && stored.front() == first;
+        consistent = consistent && Consistent(ring);
+        if (k % 50 == 49) decodes = decodes && DecodesAll(ring, stored);
+    }
+    decodes = decodes && DecodesAll(ring, stored);
+    Check(window, "the ring keeps exactly the frames of the last maxAgeMs");
+    Check(repeats, "a frame identical to the last is not stored");
+    Check(consistent, "byte and reference counts match a recount");
+    Check(decodes, "every stored frame decodes to the frame captured");
+    printf("window: %d frames over %llu ms, %zu kept (seq %u to %u) in %zu KB\n",
+           frames, (unsigned long long)maxAgeMs, ring.frames.size(), ReplayOldestSeq(&ring),
+           ReplayNewestSeq(&ring), ring.bytes / 1024);
+    ReplayFree(&ring);
+}
+
+static void CheckBudget(int frames)
+{
+    ReplayRing ring = {};
+    ReplayJob job;
+    std::vector<uint32_t> frame((size_t)FRAME_STRIDE * FRAME_H);
+    std::deque<int> stored;
+
+    // Room for the first (full) frame and a few hundred KB of changes
+    ReplayInit(&ring, FRAME_W, FRAME_H, SIZE_MAX, UINT64_MAX);
+    Feed(&ring, &job, frame, 0, &stored);
+    const size_t budget = ring.bytes + 256 * 1024;
+    ReplaySetLimits(&ring, budget, UINT64_MAX);
+
+    bool within = true, consistent = true, decodes = true;
+    size_t peakBlobs = 0, fewest = SIZE_MAX;
+    for (int k = 1; k < frames; k++) {
+        Feed(&ring, &job, frame, k, &stored);
+        within = within && (ring.bytes <= budget || ring.frames.size() == 1);
+        consistent = consistent && Consistent(ring);
+        if (k >= 20 && ring.blobs.size() > peakBlobs) peakBlobs = ring.blobs.size();
+        if (k >= 20 && ring.frames.size() < fewest) fewest = ring.frames.size();
+        if (k % 50 == 49) decodes = decodes && DecodesAll(ring, stored);
+    }
+    size_t blobsAfter = ring.blobs.size();
+    for (int k = frames; k < frames * 2; k++) Feed(&ring, &job, frame, k, &stored);
+    decodes = decodes && DecodesAll(ring, stored);
+
+    Check(within, "bytes stay within the budget");
+    Check(ReplayOldestSeq(&ring) > 0 && fewest > 1, "old frames are evicted, more than the newest is kept");
+    Check(consistent, "byte and reference counts match a recount under eviction");
+    Check(ring.blobs.size() <= blobsAfter + blobsAfter / 4, "evicted tile versions are reused");
+    Check(decodes, "frames left after eviction decode to the frame captured");
+    printf("budget: %d frames into %zu KB, %zu kept (seq %u to %u), %zu tile versions allocated\n",
+           frames * 2, budget / 1024, ring.frames.size(), ReplayOldestSeq(&ring), ReplayNewestSeq(&ring),
+           ring.blobs.size());
+
+    // A budget below one frame still keeps the newest
+    ReplaySetLimits(&ring, 1024, UINT64_MAX);
+    Feed(&ring, &job, frame, frames * 2, &stored);
+    Check(ring.frames.size() == 1 && DecodesAll(ring, stored), "a budget below one frame keeps just the newest");
+    ReplayFree(&ring);
+}
+
+static void CheckWrap()
+{
+    ReplayRing ring = {};
+    ReplayJob job;
+    std::vector<uint32_t> frame((size_t)FRAME_STRIDE * FRAME_H), want = frame, got = frame;
+    std::deque<int> stored;
+    ReplayInit(&ring, FRAME_W, FRAME_H, (size_t)1 << 40, 10 * FRAME_MS);
+    ring.firstSeq = 0xFFFFFFF0u;
+
+    bool wrapped = false;
+    for (int k = 0; k < 60; k++) {
+        Feed(&ring, &job, frame, k, &stored);
+        if (ReplayNewestSeq(&ring) < ReplayOldestSeq(&ring)) wrapped = true;
+    }
+    Check(wrapped && ReplayOldestSeq(&ring) < 0x80000000u, "sequence numbers ran through 2^32");
+    Check(DecodesAll(ring, stored), "frames decode by seq across the wrap");
+
+    uint64_t timeMs = 0;
+    Render(want, stored.front());
+    ReplayDecode(&ring, ReplayOldestSeq(&ring) - 5, got.data(), FRAME_STRIDE, &timeMs);
+    Check(SameImage(want, got) && timeMs == (uint64_t)stored.front() * FRAME_MS, "a seq before the oldest clamps to it");
+    Render(want, stored.back());
+    ReplayDecode(&ring, ReplayNewestSeq(&ring) + 5, got.data(), FRAME_STRIDE, &timeMs);
+    Check(SameImage(want, got) && timeMs == (uint64_t)stored.back() * FRAME_MS, "a seq after the newest clamps to it");
+    printf("wrap: seq %u to %u after starting at %u\n", ReplayOldestSeq(&ring), ReplayNewestSeq(&ring), 0xFFFFFFF0u);
+    ReplayFree(&ring);
+}
+
+static void CheckRegions(int frames)
+{
+    ReplayRing own = {}, shared = {};
+    ReplayJob job;
+    RegionMap map;
+    std::vector<uint32_t> frame((size_t)FRAME_STRIDE * FRAME_H);
+    std::deque<int> storedOwn, storedShared;
+    ReplayInit(&own, FRAME_W, FRAME_H, SIZE_MAX, 4000);
+    ReplayInit(&shared, FRAME_W, FRAME_H, SIZE_MAX, 4000);
+    RegionInit(&map, FRAME_W, FRAME_H);
+
+    double captureUs = 0, commitUs = 0;
+    int commits = 0;
+    bool same = true;
+    for (int k = 0; k < frames; k++) {
+        Feed(&own, &job, frame, k, &storedOwn);
+
+        Render(frame, k);
+        RegionUpdate(&map, frame.data(), FRAME_STRIDE);
+        auto t0 = std::chrono::steady_clock::now();
+        int changed = ReplayCapture(&shared, &job, frame.data(), FRAME_STRIDE, &map, (uint64_t)k * FRAME_MS);
+        auto t1 = std::chrono::steady_clock::now();
+        if (changed) {
+            ReplayCommit(&shared, &job);
+            storedShared.push_back(k);
+            while (storedShared.size() > shared.frames.size()) storedShared.pop_front();
+            commits++;
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        captureUs += std::chrono::duration<double, std::micro>(t1 - t0).count();
+        commitUs += std::chrono::duration<double, std::micro>(t2 - t1).count();
+        same = same && own.bytes == shared.bytes && storedOwn == storedShared;
+    }
+    Check(same && DecodesAll(shared, storedShared), "capturing with RegionClassify hashes stores the same");
+    printf("timing: %.1f us per capture, %.1f us per commit, %zu bytes kept per frame\n",
+           captureUs / frames, commits ? commitUs / commits : 0.0,
+           shared.frames.empty() ? (size_t)0 : shared.bytes / shared.frames.size());
+    RegionFree(&map);
+    ReplayFree(&own);
+    ReplayFree(&shared);
+}
+
+int main(int argc, char** argv)
+{
+    int frames = 300;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) {
+            frames = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: ReplayCheck [--frames 300]\n");
+            return 2;
+        }
+    }
+    if (frames < 100) return 2;
+
+    CheckCodec();
+    CheckWindow(frames);
+    CheckBudget(frames);
+    CheckWrap();
+    CheckRegions(frames);
+
+    printf("%s\n", g_failures ? "FAILED" : "all checks passed");
+    return g_failures ? 1 : 0;
+}
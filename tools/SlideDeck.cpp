@@ -0,0 +1,255 @@
+// SlideDeck.cpp : runs slide capture over a scripted synthetic lesson.
+//
+// Plays a lesson through the slide detector (SlideCapture.h) the way the
+// mirror would, frame by frame at --fps, with the region classifier
+// supplying tile changes (or, with --no-regions, the detector hashing the
+// frames itself). The lesson has five distinct slides on one template, a
+// slide whose bullet points appear one at a time, an animated transition,
+// a jump back to an earlier slide, a video, and a clock in the corner that
+// never stops. The expected handout is the five slides, the built-up one
+// in its final state. Kept slides are encoded to PNG and bound into a PDF
+// in --out if given; encode times and sizes are printed.
+//
+// Build:  g++ -std=c++17 -O2 -I../TeacherToolkit SlideDeck.cpp ../TeacherToolkit/SlideCapture.cpp ../TeacherToolkit/RegionClassify.cpp -o SlideDeck
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit SlideDeck.cpp ..\TeacherToolkit\SlideCapture.cpp ..\TeacherToolkit\RegionClassify.cpp
+// Usage:  SlideDeck [--width 1920] [--height 1080] [--fps 30] [--no-regions] [--out dir]
+// Exit:   0 the handout is as expected, 1 it is not, 2 bad arguments or output failed
+
+#include "SlideCapture.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+struct Segment {
+    int    slide;               // 0 = video
+    int    bullets;
+    double seconds;
+    bool   transition;          // slides in from the right over half a second
+};
+
+// The lesson, and which slide each kept image should be
+static const Segment kLesson[] = {
+    { 1, 0, 6, false },         // title
+    { 2, 1, 4, true },
+    { 2, 2, 4, false },         // builds up; kept once, complete
+    { 2, 3, 5, false },
+    { 3, 4, 6, true },
+    { 0, 0, 5, false },         // a video clip
+    { 4, 2, 5, true },
+    { 2, 3, 4, true },          // "can you go back?": already kept
+    { 5, 5, 6, true },
+};
+static const int kExpected[] = { 1, 2, 3, 4, 5 };
+
+static uint64_t NowUs()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void Fill(uint32_t* frame, int width, int height, int x0, int y0, int x1, int y1, uint32_t color)
+{
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > width) x1 = width;
+    if (y1 > height) y1 = height;
+    for (int y = y0; y < y1; y++)
+        for (int x = x0; x < x1; x++) frame[(size_t)y * width + x] = color;
+}
+
+// A line of "words": dark blocks of pseudo-random widths, seeded by the text
+static void Text(uint32_t* frame, int width, int height, int x, int y, int lineW, int glyphH, uint32_t seed)
+{
+    int end = x + lineW;
+    while (x < end) {
+        seed = seed * 1664525u + 1013904223u;
+        int w = glyphH / 2 + (int)((seed >> 16) % (uint32_t)(glyphH * 3));
+        Fill(frame, width, height, x, y, x + w < end ? x + w : end, y + glyphH, 0xFF202020u);
+        x += w + glyphH / 2;
+    }
+}
+
+// One slide on the common template, shifted right by dx pixels
+static void DrawSlide(uint32_t* frame, int width, int height, int slide, int bullets, int dx)
+{
+    int u = height / 36;                        // layout unit
+    Fill(frame, width, height, dx, 0, width, height, 0xFFF8F8F4u);
+    Fill(frame, width, height, dx, 0, width, 3 * u, 0xFF1F4E79u);          // title bar
+    Fill(frame, width, height, dx, height - u, width, height, 0xFF1F4E79u);
+    Text(frame, width, height, dx + 2 * u, 4 * u, width / 2 + slide * u, 2 * u, 1000u * slide);
+    for (int b = 0; b < bullets; b++) {
+        int y = 9 * u + b * 4 * u;
+        Fill(frame, width, height, dx + 2 * u, y + u / 2, dx + 3 * u, y + u + u / 2, 0xFF1F4E79u);
+        Text(frame, width, height, dx + 4 * u, y, width * 2 / 3 - (b * 7 % 5) * u, 3 * u / 2, 1000u * slide + 17u * (b + 1));
+    }
+    if (slide == 3)                             // a chart
+        for (int i = 0; i < 6; i++)
+            Fill(frame, width, height, dx + width / 2 + i * 3 * u, 30 * u - (i * 5 % 7 + 2) * 2 * u,
+                 dx + width / 2 + i * 3 * u + 2 * u, 30 * u, 0xFF4F81BDu);
+}
+
+static void DrawVideo(uint32_t* frame, int width, int height, uint32_t n)
+{
+    for (int y = 0; y < height; y++) {
+        uint32_t* row = frame + (size_t)y * width;
+        for (int x = 0; x < width; x++)
+            row[x] = 0xFF000000u | ((uint32_t)(x + n * 7) & 0xFF) << 16 | ((uint32_t)(y + n * 3) & 0xFF) << 8 | ((x ^ y) + n) % 256;
+    }
+}
+
+// The taskbar clock: a few pixels that change every second
+static void DrawClock(uint32_t* frame, int width, int height, int seconds)
+{
+    Fill(frame, width, height, width - 90, height - 30, width - 10, height - 8, 0xFF000000u);
+    Text(frame, width, height, width - 86, height - 26, 70, 12, 7919u * (uint32_t)seconds);
+}
+
+struct FileSink {
+    FILE* fp;
+};
+
+static bool WriteFile(void* ctx, const void* data, size_t bytes)
+{
+    return fwrite(data, 1, bytes, ((FileSink*)ctx)->fp) == bytes;
+}
+
+static bool WriteMemory(void* ctx, const void* data, size_t bytes)
+{
+    auto* v = (std::vector<uint8_t>*)ctx;
+    v->insert(v->end(), (const uint8_t*)data, (const uint8_t*)data + bytes);
+    return true;
+}
+
+static FILE* OpenOut(const char* dir, const char* name)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* fp = nullptr;
+#ifdef _WIN32
+    if (fopen_s(&fp, path, "wb") != 0) fp = nullptr;
+#else
+    fp = fopen(path, "wb");
+#endif
+    if (!fp) fprintf(stderr, "%s: cannot write\n", path);
+    return fp;
+}
+
+int main(int argc, char** argv)
+{
+    int width = 1920, height = 1080;
+    double fps = 30;
+    bool useRegions = true;
+    const char* outDir = nullptr;
+    for (int i = 1; i < argc; i++) {
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(argv[i], "--no-regions") == 0)        { useRegions = false; continue; }
+        if (v && strcmp(argv[i], "--width") == 0)        width = atoi(v);
+        else if (v && strcmp(argv[i], "--height") == 0)  height = atoi(v);
+        else if (v && strcmp(argv[i], "--fps") == 0)     fps = atof(v);
+        else if (v && strcmp(argv[i], "--out") == 0)     outDir = v;
+        else {
+            fprintf(stderr, "usage: SlideDeck [--width 1920] [--height 1080] [--fps 30] [--no-regions] [--out dir]\n");
+            return 2;
+        }
+        i++;
+    }
+    if (width < 320 || height < 240 || fps <= 0) return 2;
+
+    std::vector<uint32_t> frame((size_t)width * height);
+    RegionMap regions = {};
+    RegionInit(&regions, width, height);
+    SlideDetector detector;
+    SlideDetectorReset(&detector);
+    SlideIndex index;
+    std::vector<int> kept;                      // lesson slide behind each kept image
+    std::vector<std::vector<uint8_t>> pngs;
+    uint64_t detectUs = 0, hashUs = 0, encodeUs = 0;
+    uint32_t frames = 0, candidates = 0, encodes = 0;
+
+    int64_t periodUs = (int64_t)(1e6 / fps), t = 0;
+    for (const Segment& seg : kLesson) {
+        int64_t segEnd = t + (int64_t)(seg.seconds * 1e6), segStart = t;
+        for (; t < segEnd; t += periodUs, frames++) {
+            if (seg.slide) {
+                double p = (t - segStart) / 500000.0;
+                int dx = seg.transition && p < 1 ? (int)((1 - p) * width) : 0;
+                DrawSlide(frame.data(), width, height, seg.slide, seg.bullets, dx);
+            } else {
+                DrawVideo(frame.data(), width, height, frames);
+            }
+            DrawClock(frame.data(), width, height, (int)(t / 1000000));
+
+            if (useRegions) RegionUpdate(&regions, frame.data(), width);
+            uint64_t start = NowUs();
+            bool candidate = SlideDetectorUpdate(&detector, frame.data(), width, width, height,
+                                                 useRegions ? &regions : nullptr, t);
+            detectUs += NowUs() - start;
+            if (!candidate) continue;
+
+            candidates++;
+            start = NowUs();
+            SlideFingerprint fp;
+            SlideFingerprintFrame(frame.data(), width, width, height, &fp);
+            int slideNo = 0;
+            SlideVerdict verdict = SlideIndexAdd(&index, &fp, &slideNo);
+            hashUs += NowUs() - start;
+            SlideDetectorTake(&detector);
+            printf("%6.1f s  slide %d, %d bullets: %s %d\n", t / 1e6, seg.slide, seg.bullets,
+                   verdict == SLIDE_NEW ? "new" : verdict == SLIDE_UPDATE ? "updates" : "same as", slideNo);
+            if (verdict == SLIDE_SEEN) continue;
+
+            std::vector<uint8_t> png;
+            start = NowUs();
+            SlideEncodePng(frame.data(), width, width, height, WriteMemory, &png);
+            encodeUs += NowUs() - start;
+            encodes++;
+            if (verdict == SLIDE_NEW) {
+                kept.push_back(seg.slide);
+                pngs.push_back(std::move(png));
+            } else {
+                kept[slideNo - 1] = seg.slide;
+                pngs[slideNo - 1] = std::move(png);
+            }
+        }
+    }
+
+    size_t pngBytes = 0;
+    for (const auto& p : pngs) pngBytes += p.size();
+    printf("%u frames %dx%d at %.0f fps, %s: detection %.3f ms/frame, %u candidates, fingerprint %.1f ms each\n",
+           frames, width, height, fps, useRegions ? "region classifier" : "own tile hashes",
+           detectUs / 1000.0 / frames, candidates, candidates ? hashUs / 1000.0 / candidates : 0.0);
+    printf("%zu slides, %u PNGs at %.1f ms, %.0f KB each (raw %.0f KB)\n", pngs.size(), encodes,
+           encodes ? encodeUs / 1000.0 / encodes : 0.0, pngs.empty() ? 0.0 : pngBytes / 1024.0 / pngs.size(),
+           width * height * 3 / 1024.0);
+
+    if (outDir) {
+        for (size_t i = 0; i < pngs.size(); i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "slide-%03zu.png", i + 1);
+            FileSink sink = { OpenOut(outDir, name) };
+            if (!sink.fp) return 2;
+            bool ok = WriteFile(&sink, pngs[i].data(), pngs[i].size());
+            if (fclose(sink.fp) != 0 || !ok) return 2;
+        }
+        FileSink sink = { OpenOut(outDir, "slides.pdf") };
+        if (!sink.fp) return 2;
+        SlidePdf pdf;
+        SlidePdfBegin(&pdf, WriteFile, &sink);
+        for (const auto& p : pngs) SlidePdfAddPng(&pdf, p.data(), p.size());
+        bool ok = SlidePdfEnd(&pdf);
+        if (fclose(sink.fp) != 0 || !ok) return 2;
+        printf("wrote %zu PNGs and slides.pdf (%.0f KB) to %s\n", pngs.size(), pdf.offset / 1024.0, outDir);
+    }
+
+    size_t expected = sizeof(kExpected) / sizeof(kExpected[0]);
+    bool ok = kept.size() == expected;
+    for (size_t i = 0; ok && i < expected; i++) ok = kept[i] == kExpected[i];
+    printf("handout %s:", ok ? "as expected" : "WRONG");
+    for (int s : kept) printf(" %d", s);
+    printf("\n");
+    RegionFree(&regions);
+    return ok ? 0 : 1;
+}
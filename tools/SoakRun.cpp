@@ -0,0 +1,231 @@
+// SoakRun.cpp : soak test of the portable mirror pipeline on synthetic content.
+//
+// Runs what the mirror does to every frame after the capture, for hours:
+// privacy masks, annotations and tile hashes in one pass (PixelPipeline.h),
+// the region classifier, instant replay capture and compression, and
+// publishing to a shared frame ring. The content is SoakDrawFrame's moving
+// slide. As scripted by SoakScript, everything is torn down and rebuilt
+// (projector reconnect) or rebuilt at the next of SOAK_SIZES (resolution
+// change); annotation strokes come and go. Every --sample-s the process
+// counters and frame-time percentiles are sampled, optionally to CSV, and
+// at the end SoakAnalyze fails the run on growth. The Windows build covers
+// the GDI side with TeacherToolkit.exe --soak.
+//
+// Build:  g++ -std=c++17 -O2 -I../TeacherToolkit SoakRun.cpp ../TeacherToolkit/Soak.cpp ../TeacherToolkit/MaskSpans.cpp ../TeacherToolkit/Annotate.cpp ../TeacherToolkit/RegionClassify.cpp ../TeacherToolkit/ReplayRing.cpp ../TeacherToolkit/FrameRing.cpp -o SoakRun
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit SoakRun.cpp ..\TeacherToolkit\Soak.cpp ..\TeacherToolkit\MaskSpans.cpp ..\TeacherToolkit\Annotate.cpp ..\TeacherToolkit\RegionClassify.cpp ..\TeacherToolkit\ReplayRing.cpp ..\TeacherToolkit\FrameRing.cpp
+// Usage:  SoakRun [--hours 4] [--sample-s 10] [--reconnect-min 10] [--resize-min 15]
+//                 [--fps 30] [--csv soak.csv]
+//         (a quick check: --hours 0.05 --sample-s 1 --reconnect-min 0.5 --resize-min 0.3 --fps 0)
+// Exit:   0 no growth, 1 something grew, 2 bad arguments or setup failed
+
+#include "FrameRing.h"
+#include "PixelPipeline.h"
+#include "ReplayRing.h"
+#include "Soak.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define SOAK_RING_NAME      "TeacherToolkit.Frames.Soak"
+#define REPLAY_EVERY        15          // frames between replay samples
+#define REPLAY_BUDGET       (64u << 20)
+#define STROKE_EVERY        90          // frames between new annotation strokes
+#define STROKES_KEPT        12
+
+static uint64_t NowUs()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Everything the mirror holds while projecting
+struct Pipeline {
+    int width, height;
+    std::vector<uint32_t> frame;
+    uint32_t frameNo;
+    MaskSet masks;
+    AnnotationLayer annot;
+    std::vector<uint64_t> hashes;
+    RegionMap regions;
+    ReplayRing replay;
+    ReplayJob job;
+    FrameRingMapping map;
+    FrameRingWriter writer;
+    bool shared;
+};
+
+static void PipelineStart(Pipeline* p, int width, int height)
+{
+    p->width = width;
+    p->height = height;
+    p->frame.assign((size_t)width * height, 0);
+    p->frameNo = 0;
+
+    MaskRect rects[] = {
+        { 0, height - height / 20, width, height },                     // taskbar
+        { width / 10, height / 2, width / 10 + width / 5, height / 2 + height / 6 },
+    };
+    p->masks = MaskSet();
+    MaskUpdate(&p->masks, rects, 2, width, height);
+    p->annot = AnnotationLayer();
+    AnnotInit(&p->annot, width, height);
+    p->hashes.assign((size_t)((width + PIXEL_TILE - 1) / PIXEL_TILE) * ((height + PIXEL_TILE - 1) / PIXEL_TILE), 0);
+    p->regions = RegionMap();
+    RegionInit(&p->regions, width, height);
+    p->replay = ReplayRing();
+    ReplayInit(&p->replay, width, height, REPLAY_BUDGET, 5 * 60000);
+    p->job = ReplayJob();
+
+    p->shared = FrameRingCreate(&p->map, SOAK_RING_NAME, FrameRingBytes(width, height)) &&
+                FrameRingFormat(&p->writer, p->map.base, p->map.bytes, width, height, (uint32_t)NowUs());
+}
+
+static void PipelineStop(Pipeline* p)
+{
+    if (p->shared) FrameRingStop(&p->writer);
+    FrameRingUnmap(&p->map);
+    FrameRingRemove(SOAK_RING_NAME);
+    p->writer = FrameRingWriter();
+    p->shared = false;
+    ReplayFree(&p->replay);
+    std::vector<uint32_t>().swap(p->job.tiles);
+    std::vector<uint32_t>().swap(p->job.pixels);
+    RegionFree(&p->regions);
+    std::vector<uint64_t>().swap(p->hashes);
+    AnnotFree(&p->annot);
+    p->masks = MaskSet();
+    std::vector<uint32_t>().swap(p->frame);
+}
+
+// One frame; returns the time it took, without drawing the content
+static double PipelineFrame(Pipeline* p, uint64_t nowMs)
+{
+    SoakDrawFrame(p->frame.data(), p->width, p->width, p->height, p->frameNo);
+    uint64_t t0 = NowUs();
+
+    if (p->frameNo % STROKE_EVERY == 0) {
+        if (p->frameNo % (STROKE_EVERY * STROKES_KEPT) == 0) AnnotClear(&p->annot);
+        float x = (float)(p->frameNo / STROKE_EVERY % 16) * p->width / 16.0f, y = p->height / 4.0f;
+        AnnotBeginStroke(&p->annot, x, y, 0xC0E53935, 4.0f);
+        for (int k = 1; k <= 30; k++) AnnotAddPoint(&p->annot, x + k * 6.0f, y + (k % 7) * 9.0f);
+        AnnotEndStroke(&p->annot);
+    }
+
+    int tilesX = (p->width + PIXEL_TILE - 1) / PIXEL_TILE;
+    auto pass = FusePixelStages(MaskStage{ &p->masks, MASK_BLACK, 16 }, AnnotStage{ &p->annot },
+                                HashStage{ p->hashes.data(), tilesX });
+    pass.Run(p->frame.data(), p->width, p->width, p->height);
+    RegionUpdateHashed(&p->regions, p->frame.data(), p->width, p->hashes.data());
+
+    if (p->frameNo % REPLAY_EVERY == 0 &&
+        ReplayCapture(&p->replay, &p->job, p->frame.data(), p->width, &p->regions, nowMs) > 0)
+        ReplayCommit(&p->replay, &p->job);
+    if (p->shared)
+        FrameRingPublish(&p->writer, p->frame.data(), p->width, p->width, p->height, &p->regions, NowUs());
+
+    p->frameNo++;
+    return (double)(NowUs() - t0) / 1000.0;
+}
+
+int main(int argc, char** argv)
+{
+    double hours = 4, sampleS = 10, reconnectMin = 10, resizeMin = 15, fps = 30;
+    const char* csvPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (v && strcmp(argv[i], "--hours") == 0)              hours = atof(v);
+        else if (v && strcmp(argv[i], "--sample-s") == 0)      sampleS = atof(v);
+        else if (v && strcmp(argv[i], "--reconnect-min") == 0) reconnectMin = atof(v);
+        else if (v && strcmp(argv[i], "--resize-min") == 0)    resizeMin = atof(v);
+        else if (v && strcmp(argv[i], "--fps") == 0)           fps = atof(v);
+        else if (v && strcmp(argv[i], "--csv") == 0)           csvPath = v;
+        else {
+            fprintf(stderr, "usage: SoakRun [--hours 4] [--sample-s 10] [--reconnect-min 10] [--resize-min 15]\n"
+                            "               [--fps 30] [--csv soak.csv]\n");
+            return 2;
+        }
+        i++;
+    }
+    if (hours <= 0 || sampleS <= 0 || fps < 0) return 2;
+
+    FILE* csv = nullptr;
+    char line[256];
+    if (csvPath) {
+        csv = fopen(csvPath, "w");
+        if (!csv) {
+            fprintf(stderr, "%s: cannot write\n", csvPath);
+            return 2;
+        }
+        fwrite(line, 1, SoakFormatCsvHeader(line, sizeof(line)), csv);
+    }
+
+    SoakScript script;
+    SoakScriptInit(&script, (uint64_t)(reconnectMin * 60000), (uint64_t)(resizeMin * 60000));
+    Pipeline p = {};
+    PipelineStart(&p, SOAK_SIZES[0].width, SOAK_SIZES[0].height);
+
+    SoakFrameTimes times;
+    std::vector<SoakSample> samples;
+    uint64_t start = NowUs(), endMs = (uint64_t)(hours * 3600000), nextSample = (uint64_t)(sampleS * 1000);
+    uint64_t periodUs = fps > 0 ? (uint64_t)(1000000 / fps) : 0, nextFrameUs = start;
+    uint32_t reconnects = 0, resizes = 0;
+    for (;;) {
+        uint64_t nowMs = (NowUs() - start) / 1000;
+        if (nowMs >= endMs) break;
+
+        switch (SoakScriptStep(&script, nowMs)) {
+        case SOAK_RECONNECT:
+            PipelineStop(&p);
+            PipelineStart(&p, SOAK_SIZES[script.sizeIndex].width, SOAK_SIZES[script.sizeIndex].height);
+            reconnects++;
+            break;
+        case SOAK_RESIZE:
+            PipelineStop(&p);
+            PipelineStart(&p, SOAK_SIZES[script.sizeIndex].width, SOAK_SIZES[script.sizeIndex].height);
+            resizes++;
+            break;
+        case SOAK_NONE:
+            break;
+        }
+
+        SoakFrameTime(&times, PipelineFrame(&p, nowMs));
+
+        if (nowMs >= nextSample) {
+            SoakSample s = {};
+            s.tMs = nowMs;
+            s.width = p.width;
+            s.height = p.height;
+            SoakReadProcess(&s);
+            SoakFrameSummary(&times, &s);
+            samples.push_back(s);
+            if (csv) {
+                fwrite(line, 1, SoakFormatCsvRow(&s, line, sizeof(line)), csv);
+                fflush(csv);
+            }
+            while (nextSample <= nowMs) nextSample += (uint64_t)(sampleS * 1000);
+        }
+
+        if (periodUs) {
+            nextFrameUs += periodUs;
+            uint64_t now = NowUs();
+            if (nextFrameUs > now) std::this_thread::sleep_for(std::chrono::microseconds(nextFrameUs - now));
+            else nextFrameUs = now;
+        }
+    }
+    PipelineStop(&p);
+    if (csv) fclose(csv);
+
+    SoakLimits limits;
+    SoakDefaultLimits(&limits);
+    SoakReport report;
+    bool ok = SoakAnalyze(samples.data(), samples.size(), &limits, &report);
+    static char text[1024];
+    SoakFormatReport(&report, text, sizeof(text));
+    printf("%.2f h, %u reconnects, %u resolution changes, %zu samples\n%s",
+           hours, reconnects, resizes, samples.size(), text);
+    return ok ? 0 : 1;
+}
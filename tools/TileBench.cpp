@@ -0,0 +1,180 @@
+// TileBench.cpp : linear vs tiled frame layout (TiledFrame.h).
+//
+// Times the tile-by-tile work the mirror does on each frame over a
+// synthetic frame in which a fraction of the tiles changes between
+// frames, once on the linear bitmap and once on the tiled copy:
+//   diff    hash every tile and compare with the previous frame
+//   halve   2x box downscale of the changed tiles, and of the whole frame
+// and what the tiled layout costs at the boundaries: loading a linear
+// frame (which also does the diff) and storing changed tiles back. The
+// caches are flushed before every run, as after a capture.
+//
+// Build:  g++ -std=c++17 -O2 -I../TeacherToolkit TileBench.cpp ../TeacherToolkit/TiledFrame.cpp ../TeacherToolkit/RegionClassify.cpp -o TileBench
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit TileBench.cpp ..\TeacherToolkit\TiledFrame.cpp ..\TeacherToolkit\RegionClassify.cpp
+// Usage:  TileBench [--width 3840] [--height 2160] [--frames 30] [--changed 10]
+// Exit:   0 both layouts gave the same results, 1 they differ, 2 bad arguments
+
+#include "TiledFrame.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define FLUSH_BYTES     (64u << 20)
+
+static std::vector<uint8_t> g_flush(FLUSH_BYTES);
+
+static void FlushCaches()
+{
+    for (size_t i = 0; i < g_flush.size(); i += 64) g_flush[i]++;
+}
+
+static double NowNs()
+{
+    using namespace std::chrono;
+    return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static double Median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0.0 : v[v.size() / 2];
+}
+
+struct Timer {
+    std::vector<double> ns;
+    double t0;
+    void Start() { FlushCaches(); t0 = NowNs(); }
+    void Stop()  { ns.push_back(NowNs() - t0); }
+};
+
+static void Report(const char* what, const Timer& linear, const Timer& tiled)
+{
+    double a = Median(linear.ns), b = Median(tiled.ns);
+    printf("  %-22s linear %9.0f ns   tiled %9.0f ns   %.2fx\n", what, a, b, b > 0 ? a / b : 0.0);
+}
+
+int main(int argc, char** argv)
+{
+    int width = 3840, height = 2160, frames = 30, changedPct = 10;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--width") == 0)        width = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--height") == 0)  height = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--frames") == 0)  frames = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--changed") == 0) changedPct = atoi(argv[i + 1]);
+    }
+    if (width < 64 || height < 64 || frames < 1 || changedPct < 0 || changedPct > 100) {
+        fprintf(stderr, "usage: TileBench [--width 3840] [--height 2160] [--frames 30] [--changed 10]\n");
+        return 2;
+    }
+
+    // Two frames that differ in changedPct% of the tiles, alternated
+    TiledFrame tf = {};
+    TiledFrameInit(&tf, width, height);
+    size_t tileCount = (size_t)tf.tilesX * tf.tilesY;
+    std::vector<uint32_t> frameA((size_t)width * height), frameB;
+    uint32_t seed = 2024;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            frameA[(size_t)y * width + x] = 0xFF000000u | ((x * 255 / width) << 16) | ((y * 255 / height) << 8);
+    frameB = frameA;
+    for (size_t i = 0; i < tileCount; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        if ((seed >> 8) % 100 >= (uint32_t)changedPct) continue;
+        int tx = (int)(i % tf.tilesX), ty = (int)(i / tf.tilesX);
+        int y = std::min(ty * TILED_TILE + 10, height - 1), x = tx * TILED_TILE;
+        frameB[(size_t)y * width + x] ^= 0x00FFFFFFu;
+    }
+    const std::vector<uint32_t>* frame[2] = { &frameA, &frameB };
+
+    TiledFrameLoad(&tf, frameA.data(), width, 0);
+    std::vector<uint64_t> hashes(tileCount), tiledHashes(tileCount);
+    std::vector<uint8_t> dirty(tileCount);
+    for (size_t i = 0; i < tileCount; i++) hashes[i] = tiledHashes[i] = tf.tiles[i].hash;
+
+    int outW = width / 2, outH = height / 2;
+    std::vector<uint32_t> outLinear((size_t)outW * outH), outTiled(outLinear.size());
+    std::vector<uint32_t> stored(frameA.size());
+
+    Timer diffL, diffT, loadT, halveL, halveT, fullL, fullT, storeT;
+    bool same = true;
+    int dirtyCount = 0;
+    for (int f = 1; f <= frames; f++) {
+        const uint32_t* cur = frame[f & 1]->data();
+
+        // Diff on the linear frame, as RegionUpdate does
+        diffL.Start();
+        dirtyCount = 0;
+        for (int ty = 0; ty < tf.tilesY; ty++)
+            for (int tx = 0; tx < tf.tilesX; tx++) {
+                const TiledTile* t = TiledTileAt(&tf, tx, ty);
+                size_t i = (size_t)ty * tf.tilesX + tx;
+                uint64_t h = RegionHashTile(cur, width, tx * TILED_TILE, ty * TILED_TILE,
+                                            tx * TILED_TILE + t->width, ty * TILED_TILE + t->height);
+                dirty[i] = h != hashes[i];
+                dirtyCount += dirty[i];
+                hashes[i] = h;
+            }
+        diffL.Stop();
+
+        // Boundary: linear frame in, diffed on the way
+        loadT.Start();
+        int loaded = TiledFrameLoad(&tf, cur, width, (uint64_t)f);
+        loadT.Stop();
+        same = same && loaded == dirtyCount;
+
+        // Diff of the tiled frame alone, had the capture produced tiles
+        diffT.Start();
+        for (size_t i = 0; i < tileCount; i++) {
+            const TiledTile* t = &tf.tiles[i];
+            uint64_t h = RegionHashTile(tf.pixels + i * TILED_TILE_PIXELS, TILED_TILE, 0, 0, t->width, t->height);
+            same = same && (h != tiledHashes[i]) == (t->dirty != 0);
+            tiledHashes[i] = h;
+        }
+        diffT.Stop();
+
+        halveL.Start();
+        for (int ty = 0; ty < tf.tilesY; ty++)
+            for (int tx = 0; tx < tf.tilesX; tx++) {
+                const TiledTile* t = TiledTileAt(&tf, tx, ty);
+                if (!dirty[(size_t)ty * tf.tilesX + tx]) continue;
+                TiledHalveBlock(cur + (size_t)ty * TILED_TILE * width + tx * TILED_TILE, width, t->width, t->height,
+                                outLinear.data() + (size_t)ty * (TILED_TILE / 2) * outW + tx * (TILED_TILE / 2), outW);
+            }
+        halveL.Stop();
+
+        halveT.Start();
+        TiledFrameHalve(&tf, outTiled.data(), outW, true);
+        halveT.Stop();
+
+        fullL.Start();
+        TiledHalveBlock(cur, width, width, height, outLinear.data(), outW);
+        fullL.Stop();
+
+        fullT.Start();
+        TiledFrameHalve(&tf, outTiled.data(), outW, false);
+        fullT.Stop();
+        same = same && outLinear == outTiled;
+
+        storeT.Start();
+        TiledFrameStore(&tf, stored.data(), width, f > 1);
+        storeT.Stop();
+    }
+    same = same && stored == *frame[frames & 1];
+
+    double frameMb = (double)frameA.size() * sizeof(uint32_t) / (1 << 20);
+    printf("%dx%d (%.1f MB), %d%% of %zu tiles change per frame (%d), %d frames\n",
+           width, height, frameMb, changedPct, tileCount, dirtyCount, frames);
+    Report("diff", diffL, diffT);
+    Report("halve changed tiles", halveL, halveT);
+    Report("halve whole frame", fullL, fullT);
+    printf("  %-22s %9.0f ns (%.1f GB/s, includes the diff)\n", "load linear -> tiled",
+           Median(loadT.ns), frameMb / 1024 / (Median(loadT.ns) / 1e9));
+    printf("  %-22s %9.0f ns\n", "store changed tiles", Median(storeT.ns));
+    printf("  results %s\n", same ? "identical" : "DIFFERENT");
+    TiledFrameFree(&tf);
+    return same ? 0 : 1;
+}
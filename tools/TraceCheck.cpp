@@ -0,0 +1,284 @@
+// TraceCheck.cpp : concurrency and rotation checks for the event tracer (TraceLog.h).
+//
+// Runs the tracer the way the app does, with producer threads and one
+// flusher, and reads back what reached the files:
+//   ring      four threads record numbered events while a flusher drains
+//             them concurrently; every thread's events arrive in order,
+//             and received + counted as dropped == recorded
+//   reuse     many short-lived threads in turn all get a ring (slots are
+//             handed back when a thread exits); with more threads alive
+//             than TRACE_MAX_THREADS, the extra ones are counted as lost
+//   rotation  a small cap rotates <path> into <path>.1; both parts stay
+//             under the cap, start with a header and the thread names, and
+//             the older part holds the older events
+// and prints the cost of one TraceEvent.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I../TeacherToolkit TraceCheck.cpp ../TeacherToolkit/TraceLog.cpp -o TraceCheck
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit TraceCheck.cpp ..\TeacherToolkit\TraceLog.cpp
+// Usage:  TraceCheck [--events 200000]   (writes tracecheck.ttt* in the current directory)
+// Exit:   0 every check passed, 1 one failed, 2 bad arguments
+
+#include "TraceLog.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define TRACE_PATH  L"tracecheck.ttt"
+#else
+#define TRACE_PATH  "tracecheck.ttt"
+#endif
+#define TRACE_PATH_A    "tracecheck.ttt"
+#define TRACE_PATH_OLD  "tracecheck.ttt.1"
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        g_failures++;
+    }
+}
+
+static uint64_t PackName(const char* name)
+{
+    uint64_t packed = 0;
+    for (int i = 0; i < 8 && name[i]; i++)
+        packed |= (uint64_t)(uint8_t)name[i] << (8 * i);
+    return packed;
+}
+
+// Records after the header; false if the header is not the tracer's
+static bool ReadRecords(const char* path, std::vector<TraceRecord>* out, long* fileBytes)
+{
+    out->clear();
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return false;
+    TraceFileHeader header;
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+              memcmp(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+              header.recordSize == sizeof(TraceRecord);
+    TraceRecord r;
+    while (ok && fread(&r, sizeof(r), 1, fp) == 1) out->push_back(r);
+    *fileBytes = ftell(fp);
+    fclose(fp);
+    return ok;
+}
+
+// Slot of the thread that named itself name, from the names in records
+static int SlotOf(const std::vector<TraceRecord>& records, const char* name)
+{
+    uint64_t packed = PackName(name);
+    for (const TraceRecord& r : records)
+        if (r.id == TRACE_THREAD_NAME && r.b == packed) return r.thread;
+    return -1;
+}
+
+static uint64_t DroppedOn(const std::vector<TraceRecord>& records, int slot)
+{
+    uint64_t n = 0;
+    for (const TraceRecord& r : records)
+        if (r.id == TRACE_DROPPED && r.thread == slot) n += r.a;
+    return n;
+}
+
+static void CheckRing(uint32_t events)
+{
+    const int producers = 4;
+    TraceFile f;
+    Check(TraceFileOpen(&f, TRACE_PATH, 1ull << 40), "trace file opens");
+
+    // Producers stay alive until the last flush: exiting records the ring's
+    // release, which would land in the drop count of a full ring
+    std::atomic<int> running{ producers };
+    std::atomic<bool> flushed{ false };
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([p, events, &running, &flushed] {
+            char name[8];
+            snprintf(name, sizeof(name), "prod%d", p);
+            TraceThreadName(name);
+            for (uint32_t i = 0; i < events; i++) TraceEvent(TRACE_FRAME, (uint32_t)p, i);
+            running--;
+            while (!flushed) std::this_thread::yield();
+        });
+    }
+    while (running > 0) {
+        TraceFlush(&f);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    TraceFlush(&f);
+    TraceFileClose(&f);
+    flushed = true;
+    for (auto& t : threads) t.join();
+
+    std::vector<TraceRecord> records;
+    long bytes = 0;
+    Check(ReadRecords(TRACE_PATH_A, &records, &bytes), "trace file reads back");
+    uint64_t received = 0, dropped = 0;
+    for (int p = 0; p < producers; p++) {
+        char name[8];
+        snprintf(name, sizeof(name), "prod%d", p);
+        int slot = SlotOf(records, name);
+        Check(slot >= 0 && slot < TRACE_MAX_THREADS, "each producer has a named ring");
+        uint64_t last = 0, count = 0;
+        bool ordered = true;
+        for (const TraceRecord& r : records) {
+            if (r.thread != slot || r.id != TRACE_FRAME) continue;
+            if (r.a != (uint32_t)p || (count && r.b <= last)) ordered = false;
+            last = r.b;
+            count++;
+        }
+        uint64_t lost = DroppedOn(records, slot);
+        Check(ordered, "a producer's events arrive in order, from its own ring");
+        Check(count + lost == events, "received + dropped == recorded");
+        received += count;
+        dropped += lost;
+    }
+    printf("ring: %d x %u events, %llu received, %llu dropped while the flusher lagged\n",
+           producers, events, (unsigned long long)received, (unsigned long long)dropped);
+}
+
+static void CheckReuse()
+{
+    TraceFile f;
+    TraceFileOpen(&f, TRACE_PATH, 1ull << 40);
+
+    // One after another: each exits and gives its ring back
+    const int serial = TRACE_MAX_THREADS * 3;
+    for (int i = 0; i < serial; i++) {
+        std::thread([i] {
+            char name[8];
+            snprintf(name, sizeof(name), "s%d", i);
+            TraceThreadName(name);
+            for (uint32_t k = 0; k < 10; k++) TraceEvent(TRACE_EVICT, (uint32_t)i, k);
+        }).join();
+    }
+    TraceFlush(&f);
+
+    // All alive at once: only TRACE_MAX_THREADS get a ring
+    const int wide = TRACE_MAX_THREADS + 4;
+    std::atomic<int> ready{ 0 };
+    std::atomic<bool> go{ false };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < wide; i++) {
+        threads.emplace_back([&] {
+            TraceEvent(TRACE_PAUSE);
+            ready++;
+            while (!go) std::this_thread::yield();
+            TraceEvent(TRACE_RESUME);
+        });
+    }
+    while (ready < wide) std::this_thread::yield();
+    go = true;
+    for (auto& t : threads) t.join();
+    TraceFlush(&f);
+    TraceFileClose(&f);
+
+    std::vector<TraceRecord> records;
+    long bytes = 0;
+    ReadRecords(TRACE_PATH_A, &records, &bytes);
+    int serialEvents = 0, resumes = 0;
+    uint64_t lost = 0;
+    for (const TraceRecord& r : records) {
+        if (r.id == TRACE_EVICT) serialEvents++;
+        if (r.id == TRACE_RESUME) resumes++;
+        if (r.id == TRACE_DROPPED && r.thread == TRACE_MAX_THREADS) lost += r.a;
+    }
+    Check(serialEvents == serial * 10, "short-lived threads all get a ring");
+    Check(resumes == TRACE_MAX_THREADS && lost == 2 * (uint64_t)(wide - TRACE_MAX_THREADS),
+          "threads beyond TRACE_MAX_THREADS are counted as lost");
+    printf("reuse: %d threads in turn, %d at once: %d with a ring, %llu events counted as lost\n",
+           serial, wide, resumes, (unsigned long long)lost);
+}
+
+static void CheckRotation()
+{
+    const uint64_t cap = 64 * 1024;
+    TraceFile f;
+    Check(TraceFileOpen(&f, TRACE_PATH, cap), "small trace file opens");
+    TraceThreadName("rotate");
+    const uint32_t total = 20000;
+    for (uint32_t i = 0; i < total; i++) {
+        TraceEvent(TRACE_MONITOR_CHECK, 7, i);
+        if ((i & 255) == 255) TraceFlush(&f);
+    }
+    TraceFlush(&f);
+    TraceFileClose(&f);
+
+    std::vector<TraceRecord> cur, old;
+    long curBytes = 0, oldBytes = 0;
+    Check(ReadRecords(TRACE_PATH_A, &cur, &curBytes) && ReadRecords(TRACE_PATH_OLD, &old, &oldBytes),
+          "both parts start with a header");
+    Check((uint64_t)curBytes <= cap / 2 && (uint64_t)oldBytes <= cap / 2, "each part stays under half the cap");
+    Check(!cur.empty() && !old.empty() && cur[0].id == TRACE_THREAD_NAME && old[0].id == TRACE_THREAD_NAME,
+          "each part restates the thread names first");
+    Check(SlotOf(cur, "rotate") >= 0 && SlotOf(old, "rotate") >= 0, "each part decodes the thread on its own");
+
+    uint64_t oldMax = 0, curMin = UINT64_MAX, curMax = 0;
+    for (const TraceRecord& r : old)
+        if (r.id == TRACE_MONITOR_CHECK && r.b > oldMax) oldMax = r.b;
+    for (const TraceRecord& r : cur) {
+        if (r.id != TRACE_MONITOR_CHECK) continue;
+        if (r.b < curMin) curMin = r.b;
+        if (r.b > curMax) curMax = r.b;
+    }
+    Check(oldMax < curMin && curMax == total - 1, "the older part holds the older events");
+
+    // Reopening moves the last run aside
+    Check(TraceFileOpen(&f, TRACE_PATH, cap), "reopen");
+    TraceFileClose(&f);
+    std::vector<TraceRecord> moved;
+    long movedBytes = 0;
+    Check(ReadRecords(TRACE_PATH_OLD, &moved, &movedBytes) && movedBytes == curBytes,
+          "reopening keeps the last run in <path>.1");
+    printf("rotation: %u events through a %llu KB cap, parts of %ld and %ld bytes\n",
+           total, (unsigned long long)(cap / 1024), oldBytes, curBytes);
+}
+
+static void Cost()
+{
+    TraceFile f;
+    TraceFileOpen(&f, TRACE_PATH, 1ull << 40);
+    const int batches = 2000, perBatch = TRACE_RING_EVENTS / 2;
+    double ns = 0;
+    for (int b = 0; b < batches; b++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < perBatch; i++) TraceEvent(TRACE_FRAME, 0, (uint64_t)i);
+        ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        TraceFlush(&f);
+    }
+    TraceFileClose(&f);
+    printf("cost: %.1f ns per TraceEvent\n", ns / ((double)batches * perBatch));
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t events = 200000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--events") == 0) {
+            events = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "usage: TraceCheck [--events 200000]\n");
+            return 2;
+        }
+    }
+    if (events == 0) return 2;
+
+    TraceInit();
+    CheckRing(events);
+    CheckReuse();
+    CheckRotation();
+    Cost();
+    remove(TRACE_PATH_A);
+    remove(TRACE_PATH_OLD);
+
+    printf("%s\n", g_failures ? "FAILED" : "all checks passed");
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+// TraceDecode.cpp : converts TeacherToolkit trace files to text or Chrome trace JSON.
+//
+// The app writes %LOCALAPPDATA%\TeacherToolkit\trace.ttt (current part) and
+// trace.ttt.1 (previous part). Pass both, oldest first; records are merged
+// and sorted by time.
+//
+// Build:  g++ -std=c++17 -O2 -I../TeacherToolkit TraceDecode.cpp ../TeacherToolkit/TraceLog.cpp -o TraceDecode
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit TraceDecode.cpp ..\TeacherToolkit\TraceLog.cpp
+// Usage:  TraceDecode [--json] trace.ttt.1 trace.ttt > trace.txt
+//         (open the --json output in chrome://tracing or ui.perfetto.dev)
+
+#include "TraceLog.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+struct Decoded {
+    TraceRecord r;
+    uint64_t    ts;             // ns, relative to the first file's start
+};
+
+static bool ReadTraceFile(const char* path, std::vector<Decoded>* out, uint64_t* firstStart)
+{
+    FILE* fp = nullptr;
+#ifdef _WIN32
+    if (fopen_s(&fp, path, "rb") != 0) fp = nullptr;
+#else
+    fp = fopen(path, "rb");
+#endif
+    if (!fp) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+
+    TraceFileHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TRACE_FILE_VERSION || header.recordSize != sizeof(TraceRecord) ||
+        header.ticksPerSecond == 0) {
+        fprintf(stderr, "%s: not a TeacherToolkit trace (or an unsupported version)\n", path);
+        fclose(fp);
+        return false;
+    }
+
+    // Files from different runs are placed on one timeline by wall clock
+    if (*firstStart == 0) *firstStart = header.startUnixMicros;
+    int64_t offsetNs = ((int64_t)header.startUnixMicros - (int64_t)*firstStart) * 1000;
+
+    TraceRecord r;
+    while (fread(&r, sizeof(r), 1, fp) == 1) {
+        Decoded d;
+        d.r = r;
+        uint64_t ns = (header.ticksPerSecond == 1000000000ull)
+            ? r.ts : (uint64_t)((double)r.ts * 1e9 / (double)header.ticksPerSecond);
+        int64_t ts = (int64_t)ns + offsetNs;
+        d.ts = ts < 0 ? 0 : (uint64_t)ts;
+        out->push_back(d);
+    }
+    fclose(fp);
+    return true;
+}
+
+static const TraceEventInfo* InfoFor(uint16_t id)
+{
+    return (id > 0 && id < TRACE_EVENT_COUNT) ? &g_traceEventInfo[id] : nullptr;
+}
+
+static void UnpackName(uint64_t packed, char* name)
+{
+    int i = 0;
+    for (; i < 8; i++) {
+        char c = (char)(packed >> (8 * i));
+        if (!c) break;
+        name[i] = (c == '"' || c == '\\' || (unsigned char)c < 0x20) ? '_' : c;
+    }
+    name[i] = '\0';
+}
+
+static void PrintText(const std::vector<Decoded>& events)
+{
+    // A slot is reused once its thread exits: start from each slot's first
+    // name and follow the renames in time order
+    char threadNames[TRACE_MAX_THREADS + 1][9] = {};
+    bool named[TRACE_MAX_THREADS + 1] = {};
+    for (const Decoded& d : events) {
+        if (d.r.id == TRACE_THREAD_NAME && d.r.thread <= TRACE_MAX_THREADS && !named[d.r.thread]) {
+            UnpackName(d.r.b, threadNames[d.r.thread]);
+            named[d.r.thread] = true;
+        }
+    }
+
+    for (const Decoded& d : events) {
+        if (d.r.id == TRACE_THREAD_NAME && d.r.thread <= TRACE_MAX_THREADS)
+            UnpackName(d.r.b, threadNames[d.r.thread]);
+        const TraceEventInfo* info = InfoFor(d.r.id);
+        if (info && info->kind == TRACE_KIND_META) continue;
+
+        const char* thread = (d.r.thread <= TRACE_MAX_THREADS) ? threadNames[d.r.thread] : "";
+        printf("%12.3f ms  %-8s ", d.ts / 1e6, thread[0] ? thread : "?");
+        if (!info) {
+            printf("event_%u a=%u b=%llu\n", d.r.id, d.r.a, (unsigned long long)d.r.b);
+            continue;
+        }
+        printf("%-14s", info->name);
+        if (info->kind == TRACE_KIND_SPAN) printf(" dur=%.3f ms", d.r.a / 1e3);
+        else if (info->aName)              printf(" %s=%u", info->aName, d.r.a);
+        if (info->bName && d.r.id == TRACE_EVICT)
+            printf(" %s=0x%llx", info->bName, (unsigned long long)d.r.b);
+        else if (info->bName)
+            printf(" %s=%llu", info->bName, (unsigned long long)d.r.b);
+        printf("\n");
+    }
+}
+
+static void PrintChromeJson(const std::vector<Decoded>& events)
+{
+    printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    printf("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"TeacherToolkit\"}}");
+
+    for (const Decoded& d : events) {
+        const TraceEventInfo* info = InfoFor(d.r.id);
+        double tsUs = d.ts / 1e3;
+
+        if (d.r.id == TRACE_THREAD_NAME) {
+            char name[9];
+            UnpackName(d.r.b, name);
+            printf(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                   d.r.thread, name);
+            continue;
+        }
+        if (!info) {
+            printf(",\n{\"name\":\"event_%u\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                   "\"args\":{\"a\":%u,\"b\":%llu}}",
+                   d.r.id, tsUs, d.r.thread, d.r.a, (unsigned long long)d.r.b);
+            continue;
+        }
+
+        if (info->kind == TRACE_KIND_SPAN)
+            printf(",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%u,\"pid\":1,\"tid\":%u,\"args\":{",
+                   info->name, tsUs, d.r.a, d.r.thread);
+        else
+            printf(",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{",
+                   info->name, tsUs, d.r.thread);
+
+        bool first = true;
+        if (info->kind != TRACE_KIND_SPAN && info->aName) {
+            printf("\"%s\":%u", info->aName, d.r.a);
+            first = false;
+        }
+        if (info->bName)
+            printf("%s\"%s\":%llu", first ? "" : ",", info->bName, (unsigned long long)d.r.b);
+        printf("}}");
+    }
+    printf("\n]}\n");
+}
+
+int main(int argc, char** argv)
+{
+    bool json = false;
+    std::vector<Decoded> events;
+    uint64_t firstStart = 0;
+    int files = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) { json = true; continue; }
+        if (!ReadTraceFile(argv[i], &events, &firstStart)) return 1;
+        files++;
+    }
+    if (files == 0) {
+        fprintf(stderr, "usage: %s [--json] trace.ttt.1 trace.ttt\n", argv[0]);
+        return 2;
+    }
+
+    std::stable_sort(events.begin(), events.end(),
+                     [](const Decoded& x, const Decoded& y) { return x.ts < y.ts; });
+
+    if (json) PrintChromeJson(events);
+    else      PrintText(events);
+    return 0;
+}
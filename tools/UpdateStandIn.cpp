@@ -0,0 +1,326 @@
+// UpdateStandIn.cpp : loopback release server for the background update test.
+//
+// Serves GitHub-shaped release metadata and the release asset on
+// 127.0.0.1 so a test build (cl /DUPDATE_TEST_TRUST) can run
+// "TeacherToolkit.exe --update-test" without GitHub or a real certificate:
+//   /release.json             the signed asset, with its SHA-256 digest
+//   /tampered/release.json    the same asset, announced with a wrong digest
+//   /unsigned/release.json    the unsigned asset, with its own digest
+//   /TeacherToolkit.exe, /unsigned/TeacherToolkit.exe   the assets
+// Asset requests honour "Range: bytes=N-" (206 or 416). A request without
+// a Range gets the full Content-Length but only the first half of the
+// body before the connection closes, so every download is interrupted
+// once and only finishes by resuming. Each request is logged to stdout.
+//
+// The whole test, from a Developer Command Prompt in TeacherToolkit\:
+//   set CL=/DUPDATE_TEST_TRUST
+//   msbuild TeacherToolkit.sln /p:Configuration=Debug /p:Platform=x86
+//   powershell:
+//     $c = New-SelfSignedCertificate -Type CodeSigningCert -Subject "CN=TeacherToolkit test" `
+//                                    -CertStoreLocation Cert:\CurrentUser\My
+//     copy Debug\TeacherToolkit.exe signed.exe;   copy Debug\TeacherToolkit.exe unsigned.exe
+//     Set-AuthenticodeSignature signed.exe $c
+//     $env:TEACHERTOOLKIT_TEST_SIGNER = $c.Thumbprint
+//     start UpdateStandIn "--asset signed.exe --unsigned unsigned.exe"
+//     start -Wait -NoNewWindow Debug\TeacherToolkit.exe "--update-test http://127.0.0.1:8731"
+// Close any running TeacherToolkit first. The test build keeps its own
+// registry key and works in %TEMP%\TeacherToolkit-update-test.
+//
+// Build:  g++ -std=c++17 -O2 UpdateStandIn.cpp -o UpdateStandIn
+//         cl /std:c++17 /O2 /EHsc UpdateStandIn.cpp
+// Usage:  UpdateStandIn --asset signed.exe --unsigned unsigned.exe [--port 8731]
+//                       [--version 999.0.0] [--requests 0]
+//         (--requests N exits after N requests; 0 serves until killed)
+// Exit:   0 served the requested number of requests, 2 bad arguments or
+//         the port could not be opened
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET Socket;
+#define CloseSocket closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int Socket;
+#define INVALID_SOCKET (-1)
+#define CloseSocket close
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// SHA-256 (FIPS 180-4), for the digests the release metadata publishes
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t Rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static void Sha256Block(uint32_t* h, const uint8_t* p)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 | (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + K256[i] + w[i];
+        uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+// Lower-case hex digest, as in a GitHub asset's "sha256:<hex>"
+static std::string Sha256Hex(const std::vector<uint8_t>& data)
+{
+    uint32_t h[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    size_t full = data.size() / 64 * 64;
+    for (size_t i = 0; i < full; i += 64)
+        Sha256Block(h, data.data() + i);
+
+    uint8_t tail[128] = {};
+    size_t rest = data.size() - full;
+    if (rest) memcpy(tail, data.data() + full, rest);
+    tail[rest] = 0x80;
+    size_t tailLen = rest < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)data.size() * 8;
+    for (int i = 0; i < 8; i++)
+        tail[tailLen - 1 - i] = (uint8_t)(bits >> (i * 8));
+    for (size_t i = 0; i < tailLen; i += 64)
+        Sha256Block(h, tail + i);
+
+    char hex[65];
+    for (int i = 0; i < 8; i++)
+        snprintf(hex + i * 8, 9, "%08x", h[i]);
+    return hex;
+}
+
+struct Asset {
+    std::vector<uint8_t> bytes;
+    std::string digest;     // "sha256:<hex>"
+};
+
+static bool LoadAsset(const char* path, Asset* out)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        out->bytes.insert(out->bytes.end(), buf, buf + n);
+    fclose(f);
+    out->digest = "sha256:" + Sha256Hex(out->bytes);
+    return !out->bytes.empty();
+}
+
+// The fields the updater's release scanner reads from GitHub's answer
+static std::string ReleaseJson(const std::string& version, const std::string& url,
+                               size_t size, const std::string& digest)
+{
+    char json[1024];
+    snprintf(json, sizeof(json),
+             "{\"tag_name\":\"v%s\",\"name\":\"TeacherToolkit %s\",\"assets\":[{"
+             "\"name\":\"TeacherToolkit.exe\",\"size\":%zu,\"digest\":\"%s\","
+             "\"browser_download_url\":\"%s\"}]}",
+             version.c_str(), version.c_str(), size, digest.c_str(), url.c_str());
+    return json;
+}
+
+// The same digest with its last hex digit changed
+static std::string WrongDigest(std::string digest)
+{
+    char& last = digest.back();
+    last = last == '0' ? '1' : '0';
+    return digest;
+}
+
+static void SendAll(Socket s, const char* data, size_t len)
+{
+    while (len > 0) {
+        int n = send(s, data, (int)(len > 65536 ? 65536 : len), 0);
+        if (n <= 0) return;
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void SendHead(Socket s, const char* status, const char* type, size_t length, const char* extra)
+{
+    char head[512];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n%sConnection: close\r\n\r\n",
+                     status, type, length, extra);
+    SendAll(s, head, (size_t)n);
+}
+
+// Reads up to the blank line that ends the request headers
+static bool ReadRequest(Socket s, std::string* request)
+{
+    char buf[1024];
+    while (request->find("\r\n\r\n") == std::string::npos) {
+        if (request->size() > 16384) return false;
+        int n = recv(s, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        request->append(buf, (size_t)n);
+    }
+    return true;
+}
+
+// Start offset of "Range: bytes=N-", or -1 without one
+static long long RangeStart(const std::string& request)
+{
+    size_t at = 0;
+    while ((at = request.find("\r\n", at)) != std::string::npos) {
+        at += 2;
+        if (request.compare(at, 13, "Range: bytes=") == 0 || request.compare(at, 13, "range: bytes=") == 0)
+            return atoll(request.c_str() + at + 13);
+    }
+    return -1;
+}
+
+static void ServeAsset(Socket s, const Asset& asset, long long from, const char** outcome)
+{
+    size_t size = asset.bytes.size();
+    if (from < 0) {
+        // No Range: announce all of it, send half, hang up
+        SendHead(s, "200 OK", "application/octet-stream", size, "");
+        SendAll(s, (const char*)asset.bytes.data(), size / 2);
+        *outcome = "200, cut at half";
+    } else if ((size_t)from >= size) {
+        char extra[64];
+        snprintf(extra, sizeof(extra), "Content-Range: bytes */%zu\r\n", size);
+        SendHead(s, "416 Range Not Satisfiable", "text/plain", 0, extra);
+        *outcome = "416";
+    } else {
+        char extra[96];
+        snprintf(extra, sizeof(extra), "Content-Range: bytes %lld-%zu/%zu\r\n", from, size - 1, size);
+        SendHead(s, "206 Partial Content", "application/octet-stream", size - (size_t)from, extra);
+        SendAll(s, (const char*)asset.bytes.data() + from, size - (size_t)from);
+        *outcome = "206";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* signedPath = nullptr;
+    const char* unsignedPath = nullptr;
+    const char* version = "999.0.0";
+    int port = 8731;
+    long requests = 0;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--asset") == 0)         signedPath = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "--unsigned") == 0) unsignedPath = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "--version") == 0)  version = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "--port") == 0)     port = atoi(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--requests") == 0) requests = atol(argv[++i]);
+        else {
+            signedPath = nullptr;
+            break;
+        }
+    }
+    if (!signedPath || !unsignedPath || port <= 0 || port > 65535 || requests < 0) {
+        fprintf(stderr, "usage: UpdateStandIn --asset signed.exe --unsigned unsigned.exe [--port 8731]\n"
+                        "                     [--version 999.0.0] [--requests 0]\n");
+        return 2;
+    }
+
+    Asset good, bare;
+    if (!LoadAsset(signedPath, &good) || !LoadAsset(unsignedPath, &bare)) {
+        fprintf(stderr, "cannot read %s or %s\n", signedPath, unsignedPath);
+        return 2;
+    }
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return 2;
+#endif
+    Socket listener = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listener == INVALID_SOCKET || bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(listener, 8) != 0) {
+        fprintf(stderr, "cannot listen on 127.0.0.1:%d\n", port);
+        return 2;
+    }
+
+    char base[64];
+    snprintf(base, sizeof(base), "http://127.0.0.1:%d", port);
+    const std::string goodUrl = std::string(base) + "/TeacherToolkit.exe";
+    const std::string bareUrl = std::string(base) + "/unsigned/TeacherToolkit.exe";
+    printf("serving %s %s (%zu bytes, %s) and %s (%zu bytes) on %s\n", version, signedPath,
+           good.bytes.size(), good.digest.c_str(), unsignedPath, bare.bytes.size(), base);
+    fflush(stdout);
+
+    for (long served = 0; requests == 0 || served < requests; served++) {
+        Socket s = accept(listener, nullptr, nullptr);
+        if (s == INVALID_SOCKET) continue;
+
+        std::string request;
+        if (!ReadRequest(s, &request)) {
+            CloseSocket(s);
+            continue;
+        }
+        std::string path = request.substr(0, request.find("\r\n"));
+        bool get = path.compare(0, 4, "GET ") == 0;
+        path = get ? path.substr(4, path.find(' ', 4) - 4) : "";
+        long long from = RangeStart(request);
+
+        const char* outcome = "404";
+        std::string json;
+        if (path == "/release.json")
+            json = ReleaseJson(version, goodUrl, good.bytes.size(), good.digest);
+        else if (path == "/tampered/release.json")
+            json = ReleaseJson(version, goodUrl, good.bytes.size(), WrongDigest(good.digest));
+        else if (path == "/unsigned/release.json")
+            json = ReleaseJson(version, bareUrl, bare.bytes.size(), bare.digest);
+
+        if (!json.empty()) {
+            SendHead(s, "200 OK", "application/json", json.size(), "");
+            SendAll(s, json.data(), json.size());
+            outcome = "200";
+        } else if (get && path == "/TeacherToolkit.exe") {
+            ServeAsset(s, good, from, &outcome);
+        } else if (get && path == "/unsigned/TeacherToolkit.exe") {
+            ServeAsset(s, bare, from, &outcome);
+        } else {
+            SendHead(s, "404 Not Found", "text/plain", 0, "");
+        }
+        CloseSocket(s);
+
+        if (from >= 0) printf("GET %s range %lld- -> %s\n", path.c_str(), from, outcome);
+        else           printf("GET %s -> %s\n", path.c_str(), outcome);
+        fflush(stdout);
+    }
+
+    CloseSocket(listener);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
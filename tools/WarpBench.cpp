@@ -0,0 +1,202 @@
+// WarpBench.cpp : keystone / rotation correction (Warp.h), SSE2 against scalar.
+//
+// Warps a synthetic desktop (gradients, hard edges, text-like strokes,
+// noise, and a saturated white and black border) through a set of
+// geometries and compares WarpApply with WarpApplyScalar pixel for pixel:
+//   identity   same size, so every last-row and last-column entry is hit
+//   keystone   each corner pulled in, as on a projector tilted up
+//   rotate     a few degrees either way, plus keystone and rotation together
+//   scale      a smaller and a larger source letterboxed into the output
+//   extreme    corners at the limits WarpParseCorners accepts
+// Destination strides are padded so a write past the row end shows up.
+// Then times WarpBuild and both apply paths at --width x --height and
+// prints ms/frame. On a build without SSE2 both paths are the scalar one.
+//
+// Build:  g++ -std=c++17 -O2 -I../TeacherToolkit WarpBench.cpp ../TeacherToolkit/Warp.cpp -o WarpBench
+//         cl /std:c++17 /O2 /EHsc /I..\TeacherToolkit WarpBench.cpp ..\TeacherToolkit\Warp.cpp
+// Usage:  WarpBench [--width 1920] [--height 1080] [--frames 200]
+// Exit:   0 both paths gave the same pixels, 1 they differ, 2 bad arguments
+
+#include "Warp.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define PAD     13      // extra pixels per destination row, left untouched
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        g_failures++;
+    }
+}
+
+static double NowMs()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void DrawDesktop(std::vector<uint32_t>* bits, int w, int h)
+{
+    bits->assign((size_t)w * h, 0);
+    uint32_t seed = 12345;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            uint32_t c;
+            if (x < 4 || y < 4 || x >= w - 4 || y >= h - 4) {
+                c = ((x + y) & 1) ? 0xFFFFFFu : 0x000000u;              // border
+            } else if (y < h / 3) {
+                c = (uint32_t)(x * 255 / w) | (uint32_t)(y * 255 / h) << 8 | 0x80u << 16;
+            } else if (y < 2 * h / 3) {
+                bool ink = ((x / 2) % 7 == 0) || ((y / 3) % 9 == 0);    // strokes
+                c = ink ? 0x202020u : 0xF8F8F8u;
+            } else {
+                seed = seed * 1664525u + 1013904223u;
+                c = seed >> 8;
+            }
+            (*bits)[(size_t)y * w + x] = 0xFF000000u | c;
+        }
+    }
+}
+
+struct Case {
+    const char* name;
+    float corners[8];
+    float rotateDeg;
+    int srcW, srcH;     // 0 = the output size
+};
+
+// Both paths over one geometry; the padding after each row must survive
+static void CompareCase(const Case& c, int dstW, int dstH)
+{
+    int srcW = c.srcW ? c.srcW : dstW, srcH = c.srcH ? c.srcH : dstH;
+    std::vector<uint32_t> src;
+    DrawDesktop(&src, srcW, srcH);
+
+    // Letterbox the source aspect into the output, as the mirror does
+    int boxW = dstW, boxH = (int)((long long)dstW * srcH / srcW);
+    if (boxH > dstH) { boxH = dstH; boxW = (int)((long long)dstH * srcW / srcH); }
+    int left = (dstW - boxW) / 2, top = (dstH - boxH) / 2;
+
+    WarpParams params;
+    memcpy(params.corners, c.corners, sizeof(params.corners));
+    params.rotateDeg = c.rotateDeg;
+    WarpMap map = {};
+    WarpBuild(&map, &params, srcW, srcH, dstW, dstH, left, top, left + boxW, top + boxH);
+
+    char what[128];
+    snprintf(what, sizeof(what), "%s: the table was built", c.name);
+    Check(WarpIsReady(&map), what);
+    if (!WarpIsReady(&map)) return;
+
+    int stride = dstW + PAD;
+    std::vector<uint32_t> simd((size_t)stride * dstH, 0x12345678u), scalar(simd);
+    WarpApply(&map, src.data(), srcW, simd.data(), stride);
+    WarpApplyScalar(&map, src.data(), srcW, scalar.data(), stride);
+
+    size_t differ = 0, black = 0, padOk = 0;
+    int firstX = -1, firstY = -1;
+    for (int y = 0; y < dstH; y++) {
+        for (int x = 0; x < stride; x++) {
+            uint32_t a = simd[(size_t)y * stride + x], b = scalar[(size_t)y * stride + x];
+            if (x >= dstW) {
+                padOk += a == 0x12345678u && b == 0x12345678u;
+                continue;
+            }
+            if (a != b && differ++ == 0) { firstX = x; firstY = y; }
+            black += map.table[(size_t)y * dstW + x] == WARP_BLACK;
+        }
+    }
+    if (differ) {
+        size_t at = (size_t)firstY * stride + firstX;
+        printf("%s: first difference at %d,%d: sse2 %08x scalar %08x\n",
+               c.name, firstX, firstY, simd[at], scalar[at]);
+    }
+    snprintf(what, sizeof(what), "%s: SSE2 and scalar give the same pixels", c.name);
+    Check(differ == 0, what);
+    snprintf(what, sizeof(what), "%s: nothing written past the row", c.name);
+    Check(padOk == (size_t)PAD * dstH, what);
+
+    printf("%-10s %5dx%-5d -> %dx%d  %zu pixels differ, %.1f%% black\n", c.name, srcW, srcH,
+           dstW, dstH, differ, 100.0 * black / ((double)dstW * dstH));
+}
+
+static void Time(int w, int h, int frames)
+{
+    std::vector<uint32_t> src, dst((size_t)w * h);
+    DrawDesktop(&src, w, h);
+    WarpParams params;
+    WarpParseCorners(&params, "0.04,0.02 0.97,0.05 0.99,0.98 0.02,0.95");
+    params.rotateDeg = 2.5f;
+
+    WarpMap map = {};
+    double t0 = NowMs();
+    WarpBuild(&map, &params, w, h, w, h, 0, 0, w, h);
+    double buildMs = NowMs() - t0;
+    if (!WarpIsReady(&map)) {
+        Check(false, "timing: the table was built");
+        return;
+    }
+
+    volatile uint32_t sink = 0;
+    double best[2] = { 1e30, 1e30 }, total[2] = { 0, 0 };
+    for (int i = 0; i < frames; i++) {
+        for (int path = 0; path < 2; path++) {
+            double start = NowMs();
+            if (path == 0) WarpApply(&map, src.data(), w, dst.data(), w);
+            else           WarpApplyScalar(&map, src.data(), w, dst.data(), w);
+            double ms = NowMs() - start;
+            sink = sink + dst[(size_t)(i % h) * w + i % w];
+            total[path] += ms;
+            if (ms < best[path]) best[path] = ms;
+        }
+    }
+    printf("timing %dx%d, %d frames: build %.1f ms; apply %.2f ms/frame (best %.2f) SSE2, "
+           "%.2f ms/frame (best %.2f) scalar, %.1fx\n", w, h, frames, buildMs,
+           total[0] / frames, best[0], total[1] / frames, best[1], total[1] / total[0]);
+}
+
+int main(int argc, char** argv)
+{
+    int width = 1920, height = 1080, frames = 200;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--width") == 0) {
+            width = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--height") == 0) {
+            height = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) {
+            frames = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: WarpBench [--width 1920] [--height 1080] [--frames 200]\n");
+            return 2;
+        }
+    }
+    if (width < 16 || height < 16 || width > WARP_MAX_SOURCE || height > WARP_MAX_SOURCE || frames < 1)
+        return 2;
+
+    static const Case cases[] = {
+        { "identity", { 0, 0, 1, 0, 1, 1, 0, 1 }, 0.0f, 0, 0 },
+        { "keystone", { 0.08f, 0, 0.92f, 0, 1, 1, 0, 1 }, 0.0f, 0, 0 },
+        { "rotate",   { 0, 0, 1, 0, 1, 1, 0, 1 }, 3.5f, 0, 0 },
+        { "rotate",   { 0, 0, 1, 0, 1, 1, 0, 1 }, -7.0f, 0, 0 },
+        { "both",     { 0.03f, 0.02f, 0.95f, 0.06f, 0.98f, 0.97f, 0.01f, 0.93f }, 1.25f, 0, 0 },
+        { "scale",    { 0, 0, 1, 0, 1, 1, 0, 1 }, 0.0f, 1024, 768 },
+        { "scale",    { 0.05f, 0, 0.95f, 0, 1, 1, 0, 1 }, 0.0f, 2560, 1600 },
+        { "extreme",  { -1, -1, 2, -1, 2, 2, -1, 2 }, 45.0f, 0, 0 },
+        { "extreme",  { 0.45f, 0.45f, 0.55f, 0.45f, 0.55f, 0.55f, 0.45f, 0.55f }, 0.0f, 0, 0 },
+    };
+    for (const Case& c : cases)
+        CompareCase(c, width, height);
+
+    Time(width, height, frames);
+
+    printf("%s\n", g_failures ? "FAILED" : "all checks passed");
+    return g_failures ? 1 : 0;
+}